@@ -0,0 +1,151 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+// measures cache_queue throughput under the access pattern of the
+// out-of-core cache: one cut update thread pushes and re-prioritizes
+// jobs while several loader threads take and retire them. a queue
+// with a single shard behaves like the former single-lock heap.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lamure/types.h>
+#include <lamure/ren/cache_queue.h>
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+double run_benchmark(const size_t num_shards,
+                     const uint32_t num_loaders,
+                     const size_t num_jobs,
+                     const size_t updates_per_push,
+                     const lamure::model_t num_models) {
+    using lamure::ren::cache_queue;
+
+    cache_queue queue;
+    queue.initialize(cache_queue::update_mode::UPDATE_ALWAYS, num_models, num_shards);
+
+    std::atomic<size_t> num_retired(0);
+    std::atomic<bool> producer_done(false);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&] {
+        std::mt19937 generator(0);
+        std::uniform_int_distribution<int32_t> priorities(0, 1 << 20);
+
+        for (size_t i = 0; i < num_jobs; ++i) {
+            lamure::model_t model_id = i % num_models;
+            lamure::node_t node_id = (lamure::node_t)(i / num_models);
+            queue.push_job(cache_queue::job(model_id, node_id, i, priorities(generator), nullptr, nullptr));
+
+            // re-prioritize recently requested nodes, as the next cut update would
+            for (size_t u = 0; u < updates_per_push && i > 0; ++u) {
+                size_t other = i - 1 - (generator() % std::min<size_t>(i, 1024));
+                queue.update_job(other % num_models, (lamure::node_t)(other / num_models), priorities(generator));
+            }
+        }
+        producer_done = true;
+    });
+
+    std::vector<std::thread> loaders;
+    for (uint32_t t = 0; t < num_loaders; ++t) {
+        loaders.push_back(std::thread([&] {
+            while (num_retired.load() < num_jobs) {
+                cache_queue::job job = queue.top_job();
+                if (job.node_id_ == lamure::invalid_node_t) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                queue.pop_job(job);
+                ++num_retired;
+            }
+        }));
+    }
+
+    producer.join();
+    for (auto& loader : loaders) {
+        loader.join();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    // push + updates + top + pop per job
+    double num_operations = (double)num_jobs * (3 + updates_per_push);
+    return num_operations / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char *argv[]) {
+
+    if (cmd_option_exists(argv, argv+argc, "-h")) {
+        std::cout << "Usage: " << argv[0] << " <flags>\n" <<
+            "INFO: cache_queue_benchmark\n" <<
+            "\t-n: number of jobs per run (default: 1000000)\n" <<
+            "\t-u: priority updates per push (default: 2)\n" <<
+            "\t-s: number of shards of the sharded queue (default: 16)\n" <<
+            "\t-t: maximum number of loader threads (default: 32)\n" <<
+            "\t-m: number of models (default: 4)\n" <<
+            std::endl;
+        return 0;
+    }
+
+    size_t num_jobs = 1000000;
+    if (cmd_option_exists(argv, argv+argc, "-n")) {
+        num_jobs = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-n")));
+    }
+
+    size_t updates_per_push = 2;
+    if (cmd_option_exists(argv, argv+argc, "-u")) {
+        updates_per_push = std::max(0, atoi(get_cmd_option(argv, argv + argc, "-u")));
+    }
+
+    size_t num_shards = 16;
+    if (cmd_option_exists(argv, argv+argc, "-s")) {
+        num_shards = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-s")));
+    }
+
+    uint32_t max_loaders = 32;
+    if (cmd_option_exists(argv, argv+argc, "-t")) {
+        max_loaders = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-t")));
+    }
+
+    lamure::model_t num_models = 4;
+    if (cmd_option_exists(argv, argv+argc, "-m")) {
+        num_models = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-m")));
+    }
+
+    std::cout << "jobs: " << num_jobs << ", updates per push: " << updates_per_push << std::endl;
+    std::cout << std::setw(10) << "loaders"
+              << std::setw(20) << "1 shard [Mops/s]"
+              << std::setw(20) << (std::to_string(num_shards) + " shards [Mops/s]") << std::endl;
+
+    for (uint32_t num_loaders = 1; num_loaders <= max_loaders; num_loaders *= 2) {
+        double single = run_benchmark(1, num_loaders, num_jobs, updates_per_push, num_models);
+        double sharded = run_benchmark(num_shards, num_loaders, num_jobs, updates_per_push, num_models);
+        std::cout << std::setw(10) << num_loaders
+                  << std::setw(20) << std::fixed << std::setprecision(2) << single / 1000000.0
+                  << std::setw(20) << sharded / 1000000.0 << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,282 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+// replays a recorded camera session through the cut update and the
+// out-of-core cache without a render device. the primary buffer of the
+// context is plain host memory (controller::dispatch_host), so this runs
+// on machines without a gpu. one csv line is written per cut update.
+// camera sessions use the format of the rendering app's measurement
+// files: one view matrix per line, 16 values in column major order.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lamure/types.h>
+#include <lamure/ren/camera.h>
+#include <lamure/ren/config.h>
+#include <lamure/ren/controller.h>
+#include <lamure/ren/cut_database.h>
+#include <lamure/ren/model_database.h>
+#include <lamure/ren/ooc_cache.h>
+#include <lamure/ren/policy.h>
+
+#include <scm/core/math.h>
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+std::vector<scm::math::mat4d> parse_camera_session_file(const std::string& session_file_path) {
+    std::ifstream camera_session_file(session_file_path);
+
+    std::string view_matrix_as_string;
+    std::vector<scm::math::mat4d> view_matrices;
+
+    while (std::getline(camera_session_file, view_matrix_as_string)) {
+        if (view_matrix_as_string.empty()) {
+            continue;
+        }
+
+        scm::math::mat4d view_matrix;
+        std::istringstream view_matrix_as_strstream(view_matrix_as_string);
+
+        for (int matrix_element_idx = 0; matrix_element_idx < 16; ++matrix_element_idx) {
+            view_matrix_as_strstream >> view_matrix[matrix_element_idx];
+        }
+
+        view_matrices.push_back(view_matrix);
+    }
+
+    return view_matrices;
+}
+
+double hit_rate(const uint64_t hits, const uint64_t misses) {
+    return hits + misses > 0 ? (double)hits / (double)(hits + misses) : 1.0;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 1 ||
+        cmd_option_exists(argv, argv+argc, "-h") ||
+        !cmd_option_exists(argv, argv+argc, "-p")) {
+        std::cout << "Usage: " << argv[0] << " <flags> -p <camera session> <model.bvh> [<model.bvh> ...]\n" <<
+            "INFO: cut_update_benchmark\n" <<
+            "\t-p: camera session file, one view matrix per line\n" <<
+            "\t-o: csv output file (default: cut_update_benchmark.csv)\n" <<
+            "\t-n: cut updates per camera (default: 1)\n" <<
+            "\t-t: error threshold (default: " << LAMURE_DEFAULT_THRESHOLD << ")\n" <<
+            "\t-u: upload budget in MB (default: " << LAMURE_DEFAULT_UPLOAD_BUDGET << ")\n" <<
+            "\t-r: render budget in MB, host memory (default: " << LAMURE_DEFAULT_VIDEO_MEMORY_BUDGET << ")\n" <<
+            "\t-m: out-of-core budget in MB (default: " << LAMURE_DEFAULT_MAIN_MEMORY_BUDGET << ")\n" <<
+            "\t-x: viewport width (default: 1920)\n" <<
+            "\t-y: viewport height (default: 1080)\n" <<
+            "\t-l: loading mode, pread, mmap or io_uring (default: pread)\n" <<
+            std::endl;
+        return 0;
+    }
+
+    std::string session_file_path = get_cmd_option(argv, argv + argc, "-p");
+
+    std::string output_file_path = "cut_update_benchmark.csv";
+    if (cmd_option_exists(argv, argv+argc, "-o")) {
+        output_file_path = get_cmd_option(argv, argv + argc, "-o");
+    }
+
+    uint32_t updates_per_camera = 1;
+    if (cmd_option_exists(argv, argv+argc, "-n")) {
+        updates_per_camera = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-n")));
+    }
+
+    float error_threshold = LAMURE_DEFAULT_THRESHOLD;
+    if (cmd_option_exists(argv, argv+argc, "-t")) {
+        error_threshold = atof(get_cmd_option(argv, argv + argc, "-t"));
+    }
+
+    size_t upload_budget = LAMURE_DEFAULT_UPLOAD_BUDGET;
+    if (cmd_option_exists(argv, argv+argc, "-u")) {
+        upload_budget = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-u")));
+    }
+
+    size_t render_budget = LAMURE_DEFAULT_VIDEO_MEMORY_BUDGET;
+    if (cmd_option_exists(argv, argv+argc, "-r")) {
+        render_budget = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-r")));
+    }
+
+    size_t out_of_core_budget = LAMURE_DEFAULT_MAIN_MEMORY_BUDGET;
+    if (cmd_option_exists(argv, argv+argc, "-m")) {
+        out_of_core_budget = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-m")));
+    }
+
+    int32_t width = 1920;
+    if (cmd_option_exists(argv, argv+argc, "-x")) {
+        width = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-x")));
+    }
+
+    int32_t height = 1080;
+    if (cmd_option_exists(argv, argv+argc, "-y")) {
+        height = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-y")));
+    }
+
+    lamure::ren::policy* policy = lamure::ren::policy::get_instance();
+    policy->set_max_upload_budget_in_mb(upload_budget);
+    policy->set_render_budget_in_mb(render_budget);
+    policy->set_out_of_core_budget_in_mb(out_of_core_budget);
+    policy->set_window_width(width);
+    policy->set_window_height(height);
+
+    if (cmd_option_exists(argv, argv+argc, "-l")) {
+        std::string loading_mode = get_cmd_option(argv, argv + argc, "-l");
+        if (loading_mode == "mmap") {
+            policy->set_loading_mode(lamure::ren::policy::LOADING_MODE_MMAP);
+        }
+        else if (loading_mode == "io_uring") {
+            policy->set_loading_mode(lamure::ren::policy::LOADING_MODE_IO_URING);
+        }
+        else {
+            policy->set_loading_mode(lamure::ren::policy::LOADING_MODE_PREAD);
+        }
+    }
+
+    std::vector<std::string> model_filenames;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.size() > 4 && arg.substr(arg.size() - 4) == ".bvh") {
+            model_filenames.push_back(arg);
+        }
+    }
+
+    if (model_filenames.empty()) {
+        std::cout << "no .bvh files given" << std::endl;
+        return 1;
+    }
+
+    std::vector<scm::math::mat4d> view_matrices = parse_camera_session_file(session_file_path);
+
+    if (view_matrices.empty()) {
+        std::cout << "no cameras in session file " << session_file_path << std::endl;
+        return 1;
+    }
+
+    lamure::ren::model_database* database = lamure::ren::model_database::get_instance();
+    lamure::ren::controller* controller = lamure::ren::controller::get_instance();
+    lamure::ren::cut_database* cuts = lamure::ren::cut_database::get_instance();
+
+    std::vector<lamure::model_t> model_ids;
+    for (const auto& filename : model_filenames) {
+        lamure::model_t model_id = database->add_model(filename, std::to_string(model_ids.size()));
+        model_ids.push_back(controller->deduce_model_id(std::to_string(model_id)));
+    }
+
+    lamure::context_t context_id = controller->deduce_context_id(0);
+    lamure::view_t view_id = controller->deduce_view_id(0, 0);
+
+    const float near_plane = 0.001f;
+    const float far_plane = 1000.f;
+
+    scm::math::mat4f projection_matrix;
+    scm::math::perspective_matrix(projection_matrix, 30.f, float(width) / float(height), near_plane, far_plane);
+
+    std::ofstream output(output_file_path);
+    output << "camera,update,cut_update_us,dispatch_us,cut_nodes,nodes_transferred,"
+           << "nodes_loaded,bytes_loaded,syscalls,"
+           << "ooc_hits,ooc_misses,ooc_hit_rate,gpu_hits,gpu_misses,gpu_hit_rate" << std::endl;
+
+    lamure::ren::ooc_cache* ooc_cache = lamure::ren::ooc_cache::get_instance();
+
+    lamure::ren::cut_update_pool::statistics last_update_stats = controller->get_cut_update_statistics(context_id);
+    lamure::ren::ooc_pool::statistics last_loading_stats = ooc_cache->get_loading_statistics();
+    uint64_t last_ooc_hits = ooc_cache->num_hits();
+    uint64_t last_ooc_misses = ooc_cache->num_misses();
+
+    double total_cut_update_us = 0.0;
+    size_t num_updates = 0;
+
+    for (size_t camera_id = 0; camera_id < view_matrices.size(); ++camera_id) {
+        lamure::ren::camera camera(view_id, near_plane, scm::math::mat4f(view_matrices[camera_id]), projection_matrix);
+
+        std::vector<scm::math::vec3d> corner_values = camera.get_frustum_corners();
+        double top_minus_bottom = scm::math::length((corner_values[2]) - (corner_values[0]));
+        float height_divided_by_top_minus_bottom = height / top_minus_bottom;
+
+        for (uint32_t update = 0; update < updates_per_camera; ++update) {
+            for (const auto model_id : model_ids) {
+                cuts->send_transform(context_id, model_id, scm::math::mat4f::identity());
+                cuts->send_threshold(context_id, model_id, error_threshold);
+                cuts->send_rendered(context_id, model_id);
+            }
+            cuts->send_camera(context_id, view_id, camera);
+            cuts->send_height_divided_by_top_minus_bottom(context_id, view_id, height_divided_by_top_minus_bottom);
+
+            auto dispatch_start = std::chrono::steady_clock::now();
+
+            controller->dispatch_host(context_id);
+            while (controller->is_cut_update_in_progress(context_id)) {
+                std::this_thread::yield();
+            }
+
+            auto dispatch_end = std::chrono::steady_clock::now();
+
+            size_t cut_nodes = 0;
+            for (const auto model_id : model_ids) {
+                cut_nodes += cuts->get_cut(context_id, view_id, model_id).complete_set().size();
+            }
+
+            lamure::ren::cut_update_pool::statistics update_stats = controller->get_cut_update_statistics(context_id);
+            lamure::ren::ooc_pool::statistics loading_stats = ooc_cache->get_loading_statistics();
+            uint64_t ooc_hits = ooc_cache->num_hits() - last_ooc_hits;
+            uint64_t ooc_misses = ooc_cache->num_misses() - last_ooc_misses;
+            uint64_t gpu_hits = update_stats.gpu_cache_hits_ - last_update_stats.gpu_cache_hits_;
+            uint64_t gpu_misses = update_stats.gpu_cache_misses_ - last_update_stats.gpu_cache_misses_;
+
+            // the pool skips updates while the roots of all models are not resident yet
+            uint64_t cut_update_us = update_stats.num_cut_updates_ != last_update_stats.num_cut_updates_ ? update_stats.last_cut_update_in_us_ : 0;
+
+            output << camera_id << "," << update << ","
+                   << cut_update_us << ","
+                   << std::chrono::duration_cast<std::chrono::microseconds>(dispatch_end - dispatch_start).count() << ","
+                   << cut_nodes << ","
+                   << update_stats.nodes_transferred_ - last_update_stats.nodes_transferred_ << ","
+                   << loading_stats.nodes_loaded_ - last_loading_stats.nodes_loaded_ << ","
+                   << loading_stats.bytes_loaded_ - last_loading_stats.bytes_loaded_ << ","
+                   << loading_stats.syscalls_issued_ - last_loading_stats.syscalls_issued_ << ","
+                   << ooc_hits << "," << ooc_misses << "," << hit_rate(ooc_hits, ooc_misses) << ","
+                   << gpu_hits << "," << gpu_misses << "," << hit_rate(gpu_hits, gpu_misses) << std::endl;
+
+            total_cut_update_us += cut_update_us;
+            ++num_updates;
+
+            last_update_stats = update_stats;
+            last_loading_stats = loading_stats;
+            last_ooc_hits += ooc_hits;
+            last_ooc_misses += ooc_misses;
+        }
+    }
+
+    output.close();
+
+    std::cout << "cut updates: " << num_updates << std::endl;
+    std::cout << "average cut update (us): " << total_cut_update_us / num_updates << std::endl;
+    std::cout << "nodes loaded: " << last_loading_stats.nodes_loaded_ << std::endl;
+    std::cout << "megabytes loaded: " << last_loading_stats.bytes_loaded_ / 1024.0 / 1024.0 << std::endl;
+    std::cout << "results written to " << output_file_path << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+// compares the downsweep algorithms on a .bin file: sort and split of every
+// node along its longest axis against the hierarchy derived from one radix
+// sorted morton order. the split downsweep sorts the input in place, so every
+// run works on a copy of the input inside the working directory. besides the
+// time, the summed surface area of the leaf bounding boxes is reported as a
+// measure of how compact the leaves are.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <lamure/types.h>
+#include <lamure/pre/bvh.h>
+#include <lamure/pre/common.h>
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+struct benchmark_result {
+    double seconds_;
+    size_t num_surfels_;
+    size_t num_leaves_;
+    double leaf_surface_area_;
+};
+
+benchmark_result run_downsweep(const boost::filesystem::path& input_file,
+                               const boost::filesystem::path& working_directory,
+                               const std::string& name,
+                               const lamure::pre::downsweep_algorithm algorithm,
+                               const size_t memory_limit,
+                               const size_t buffer_size,
+                               const uint32_t max_fan_factor,
+                               const size_t surfels_per_node) {
+    namespace fs = boost::filesystem;
+
+    fs::path run_input = working_directory / (input_file.stem().string() + "_" + name + ".bin");
+    fs::copy_file(input_file, run_input, fs::copy_option::overwrite_if_exists);
+    fs::path base_path = working_directory / (input_file.stem().string() + "_" + name);
+
+    benchmark_result result = {0.0, 0, 0, 0.0};
+    {
+        lamure::pre::bvh tree(memory_limit, buffer_size, lamure::pre::rep_radius_algorithm::geometric_mean);
+        tree.init_tree(run_input.string(), max_fan_factor, surfels_per_node, base_path);
+
+        auto start = std::chrono::steady_clock::now();
+        tree.downsweep(true, run_input.string(), "", algorithm);
+        result.seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (lamure::node_id_type id = tree.first_leaf(); id < tree.nodes().size(); ++id) {
+            const lamure::pre::bvh_node& leaf = tree.nodes()[id];
+            lamure::vec3r extent = leaf.get_bounding_box().max() - leaf.get_bounding_box().min();
+            result.leaf_surface_area_ += 2.0 * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+            result.num_surfels_ += leaf.disk_array().length();
+            ++result.num_leaves_;
+        }
+    }
+
+    // the input copy and the leaf level file
+    std::vector<fs::path> run_files;
+    for (fs::directory_iterator it(working_directory); it != fs::directory_iterator(); ++it) {
+        if (it->path().stem() == base_path.filename()) {
+            run_files.push_back(it->path());
+        }
+    }
+    for (const auto& run_file : run_files) {
+        fs::remove(run_file);
+    }
+    return result;
+}
+
+void print_result(const std::string& name, const benchmark_result& result) {
+    std::cout << name << ":" << std::endl;
+    std::cout << "  seconds: " << result.seconds_ << std::endl;
+    std::cout << "  million surfels per second: " << result.num_surfels_ / result.seconds_ / 1000000.0 << std::endl;
+    std::cout << "  leaves: " << result.num_leaves_ << std::endl;
+    std::cout << "  leaf bounding box surface area: " << result.leaf_surface_area_ << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 1 ||
+        cmd_option_exists(argv, argv+argc, "-h") ||
+        !cmd_option_exists(argv, argv+argc, "-f")) {
+        std::cout << "Usage: " << argv[0] << " <flags> -f <input_file>\n" <<
+           "INFO: downsweep_benchmark\n" <<
+           "\t-f: .bin input file\n" <<
+           "\t-w: (optional) working directory for the copies of the input; default: directory of the input\n" <<
+           "\t-m: (optional) memory budget in gigabytes; default: 8\n" <<
+           "\t-b: (optional) buffer size in megabytes; default: 150\n" <<
+           "\t-d: (optional) desired surfels per node; default: 1000\n" <<
+           "\t-t: (optional) max fan-out factor; default: 2\n" <<
+           std::endl;
+        return 0;
+    }
+
+    namespace fs = boost::filesystem;
+
+    fs::path input_file = fs::canonical(get_cmd_option(argv, argv + argc, "-f"));
+    fs::path working_directory = input_file.parent_path();
+    double memory_budget = 8.0;
+    size_t buffer_size = 150;
+    size_t surfels_per_node = 1000;
+    uint32_t max_fan_factor = 2;
+
+    if (cmd_option_exists(argv, argv+argc, "-w")) {
+        working_directory = fs::canonical(get_cmd_option(argv, argv + argc, "-w"));
+    }
+    if (cmd_option_exists(argv, argv+argc, "-m")) {
+        memory_budget = std::max(0.001, atof(get_cmd_option(argv, argv + argc, "-m")));
+    }
+    if (cmd_option_exists(argv, argv+argc, "-b")) {
+        buffer_size = std::max(1l, atol(get_cmd_option(argv, argv + argc, "-b")));
+    }
+    if (cmd_option_exists(argv, argv+argc, "-d")) {
+        surfels_per_node = std::max(5l, atol(get_cmd_option(argv, argv + argc, "-d")));
+    }
+    if (cmd_option_exists(argv, argv+argc, "-t")) {
+        max_fan_factor = std::min(std::max(2, atoi(get_cmd_option(argv, argv + argc, "-t"))), 8);
+    }
+
+    const size_t memory_limit = size_t(memory_budget * 1024.0 * 1024.0 * 1024.0);
+    buffer_size *= 1024UL * 1024UL;
+
+    benchmark_result split = run_downsweep(input_file, working_directory, "split", lamure::pre::downsweep_algorithm::split,
+                                           memory_limit, buffer_size, max_fan_factor, surfels_per_node);
+    benchmark_result morton = run_downsweep(input_file, working_directory, "morton", lamure::pre::downsweep_algorithm::morton,
+                                            memory_limit, buffer_size, max_fan_factor, surfels_per_node);
+
+    print_result("split", split);
+    print_result("morton", morton);
+    std::cout << "speedup: " << split.seconds_ / morton.seconds_ << std::endl;
+
+    return 0;
+}
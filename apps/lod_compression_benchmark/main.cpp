@@ -0,0 +1,239 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+// measures whether compressed .lod files pay off for the out-of-core cache.
+// the nodes of an uncompressed .lod file are compressed into a copy per
+// compression level, which is then loaded in random order with pread and
+// decompressed by the loader threads, like the cut update does. the raw
+// file is loaded the same way as reference. drop the page cache between
+// runs to measure cold reads, e.g. "sync; echo 3 > /proc/sys/vm/drop_caches".
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lamure/types.h>
+#include <lamure/lod_block.h>
+#include <lamure/ren/bvh.h>
+#include <lamure/ren/lod_file.h>
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+struct benchmark_result {
+    double seconds_;
+    double decompression_seconds_;
+    size_t bytes_read_;
+    size_t bytes_delivered_;
+    size_t nodes_;
+    size_t failed_nodes_;
+};
+
+void print_result(const std::string& name, const size_t file_size, const benchmark_result& result) {
+    double megabytes_read = result.bytes_read_ / 1024.0 / 1024.0;
+    double megabytes_delivered = result.bytes_delivered_ / 1024.0 / 1024.0;
+    std::cout << name << ":" << std::endl;
+    std::cout << "  file size in megabytes: " << file_size / 1024.0 / 1024.0 << std::endl;
+    std::cout << "  compression ratio: " << (double)result.bytes_delivered_ / (double)result.bytes_read_ << std::endl;
+    std::cout << "  megabytes read: " << megabytes_read << std::endl;
+    std::cout << "  seconds: " << result.seconds_ << std::endl;
+    std::cout << "  decompression seconds (summed over threads): " << result.decompression_seconds_ << std::endl;
+    std::cout << "  megabytes per second (decompressed): " << megabytes_delivered / result.seconds_ << std::endl;
+    if (result.failed_nodes_ > 0) {
+        std::cout << "  failed nodes: " << result.failed_nodes_ << std::endl;
+    }
+}
+
+// writes every node of the raw .lod file as one lod_block and
+// returns the offsets of the blocks followed by the file size
+std::vector<uint64_t> compress_lod(const std::string& lod_filename,
+                                   const std::string& compressed_filename,
+                                   const lamure::ren::bvh& bvh,
+                                   const size_t stride_in_bytes,
+                                   const int level) {
+    std::ifstream input(lod_filename, std::ios::in | std::ios::binary);
+    std::ofstream output(compressed_filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!input.is_open() || !output.is_open()) {
+        throw std::runtime_error("lamure: lod_compression_benchmark::Unable to open " + compressed_filename);
+    }
+
+    std::vector<uint64_t> block_offsets(1, 0);
+    std::vector<char> node(stride_in_bytes);
+    std::vector<char> block;
+    for (uint32_t node_id = 0; node_id < bvh.get_num_nodes(); ++node_id) {
+        input.read(node.data(), stride_in_bytes);
+        block.clear();
+        lamure::lod_block::compress(node.data(), stride_in_bytes, level, block);
+        output.write(block.data(), block.size());
+        block_offsets.push_back(block_offsets.back() + block.size());
+    }
+
+    return block_offsets;
+}
+
+// block_offsets is empty for the raw file
+benchmark_result run_pread(const std::string& lod_filename,
+                           const std::vector<lamure::node_t>& requests,
+                           const std::vector<uint64_t>& block_offsets,
+                           const size_t stride_in_bytes,
+                           const uint32_t num_threads) {
+    std::atomic<size_t> next_request(0);
+    std::atomic<size_t> bytes_read(0);
+    std::atomic<size_t> failed_nodes(0);
+    std::atomic<uint64_t> decompression_nanoseconds(0);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t t = 0; t < num_threads; ++t) {
+        threads.push_back(std::thread([&] {
+            lamure::ren::lod_file access;
+            access.open(lod_filename);
+            std::vector<char> slot(stride_in_bytes);
+            std::vector<char> block(block_offsets.empty() ? 0 : lamure::lod_block::max_compressed_size(stride_in_bytes));
+            size_t local_bytes_read = 0;
+            std::chrono::steady_clock::duration local_decompression(0);
+
+            size_t i;
+            while ((i = next_request.fetch_add(1)) < requests.size()) {
+                lamure::node_t node_id = requests[i];
+                if (block_offsets.empty()) {
+                    access.read(slot.data(), node_id * stride_in_bytes, stride_in_bytes);
+                    local_bytes_read += stride_in_bytes;
+                    continue;
+                }
+
+                size_t block_size = block_offsets[node_id + 1] - block_offsets[node_id];
+                access.read(block.data(), block_offsets[node_id], block_size);
+                local_bytes_read += block_size;
+
+                auto decompression_start = std::chrono::steady_clock::now();
+                if (!lamure::lod_block::decompress(block.data(), block_size, slot.data(), stride_in_bytes)) {
+                    ++failed_nodes;
+                }
+                local_decompression += std::chrono::steady_clock::now() - decompression_start;
+            }
+            bytes_read += local_bytes_read;
+            decompression_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(local_decompression).count();
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return {std::chrono::duration<double>(end - start).count(), decompression_nanoseconds.load() / 1e9,
+            bytes_read.load(), requests.size() * stride_in_bytes, requests.size(), failed_nodes.load()};
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 1 ||
+        cmd_option_exists(argv, argv+argc, "-h") ||
+        !cmd_option_exists(argv, argv+argc, "-f")) {
+        std::cout << "Usage: " << argv[0] << " <flags> -f <input_file>\n" <<
+            "INFO: lod_compression_benchmark\n" <<
+            "\t-f: selects .bvh input file, the uncompressed .lod file is expected next to it\n" <<
+            "\t    (-f flag is required)\n" <<
+            "\t-l: comma separated compression levels 1-9 (default: 1,3,6,9)\n" <<
+            "\t-n: number of node requests (default: number of nodes)\n" <<
+            "\t-t: number of loader threads (default: 8)\n" <<
+            "\t-s: random seed (default: 0)\n" <<
+            "\t-k: keep the compressed copies next to the input\n" <<
+            std::endl;
+        return 0;
+    }
+
+    std::string bvh_filename = std::string(get_cmd_option(argv, argv + argc, "-f"));
+    std::string base_filename = bvh_filename.substr(0, bvh_filename.size() - 4);
+    std::string lod_filename = base_filename + ".lod";
+
+    std::vector<int> levels = {1, 3, 6, 9};
+    if (cmd_option_exists(argv, argv+argc, "-l")) {
+        levels.clear();
+        std::stringstream level_list(get_cmd_option(argv, argv + argc, "-l"));
+        std::string level;
+        while (std::getline(level_list, level, ',')) {
+            levels.push_back(std::min(std::max(lamure::lod_block::MIN_LEVEL, atoi(level.c_str())), lamure::lod_block::MAX_LEVEL));
+        }
+    }
+
+    uint32_t num_threads = 8;
+    if (cmd_option_exists(argv, argv+argc, "-t")) {
+        num_threads = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-t")));
+    }
+
+    uint32_t seed = 0;
+    if (cmd_option_exists(argv, argv+argc, "-s")) {
+        seed = atoi(get_cmd_option(argv, argv + argc, "-s"));
+    }
+
+    bool keep_files = cmd_option_exists(argv, argv+argc, "-k");
+
+    lamure::ren::bvh bvh(bvh_filename);
+    if (bvh.is_lod_compressed()) {
+        std::cout << "the .lod file of " << bvh_filename << " is already compressed" << std::endl;
+        return 1;
+    }
+    size_t stride_in_bytes = (size_t)bvh.get_size_of_primitive() * bvh.get_primitives_per_node();
+
+    size_t num_requests = bvh.get_num_nodes();
+    if (cmd_option_exists(argv, argv+argc, "-n")) {
+        num_requests = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-n")));
+    }
+
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<lamure::node_t> distribution(0, bvh.get_num_nodes() - 1);
+    std::vector<lamure::node_t> requests(num_requests);
+    for (auto& request : requests) {
+        request = distribution(generator);
+    }
+
+    std::cout << "nodes in file: " << bvh.get_num_nodes() << std::endl;
+    std::cout << "bytes per node: " << stride_in_bytes << std::endl;
+    std::cout << "requests: " << num_requests << ", threads: " << num_threads << std::endl;
+
+    print_result("raw", bvh.get_num_nodes() * stride_in_bytes,
+                 run_pread(lod_filename, requests, std::vector<uint64_t>(), stride_in_bytes, num_threads));
+
+    for (int level : levels) {
+        std::string compressed_filename = base_filename + "_z" + std::to_string(level) + ".lod";
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint64_t> block_offsets = compress_lod(lod_filename, compressed_filename, bvh, stride_in_bytes, level);
+        double compression_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "compressed level " << level << " in " << compression_seconds << " seconds" << std::endl;
+        print_result("level " + std::to_string(level), block_offsets.back(),
+                     run_pread(compressed_filename, requests, block_offsets, stride_in_bytes, num_threads));
+
+        if (!keep_files) {
+            std::remove(compressed_filename.c_str());
+        }
+    }
+
+    return 0;
+}
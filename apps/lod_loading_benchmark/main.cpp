@@ -0,0 +1,278 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+// compares the node loading backends of the out-of-core cache:
+// persistent descriptors with pread (lod_file), a shared memory
+// mapping (lod_mapping) and a single thread driving io_uring
+// (uring_queue). nodes are requested in random order,
+// like a cut update does. drop the page cache between runs to measure
+// cold reads, e.g. "sync; echo 3 > /proc/sys/vm/drop_caches".
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lamure/types.h>
+#include <lamure/ren/bvh.h>
+#include <lamure/ren/lod_file.h>
+#include <lamure/ren/lod_mapping.h>
+#include <lamure/ren/uring_queue.h>
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+struct benchmark_result {
+    double seconds_;
+    size_t bytes_;
+    size_t nodes_;
+    uint64_t syscalls_;
+};
+
+void print_result(const std::string& name, const benchmark_result& result) {
+    double megabytes = result.bytes_ / 1024.0 / 1024.0;
+    std::cout << name << ":" << std::endl;
+    std::cout << "  nodes loaded: " << result.nodes_ << std::endl;
+    std::cout << "  megabytes loaded: " << megabytes << std::endl;
+    std::cout << "  seconds: " << result.seconds_ << std::endl;
+    std::cout << "  megabytes per second: " << megabytes / result.seconds_ << std::endl;
+    std::cout << "  syscalls per node: " << (double)result.syscalls_ / (double)result.nodes_ << std::endl;
+}
+
+benchmark_result run_pread(const std::string& lod_filename,
+                           const std::vector<lamure::node_t>& requests,
+                           const size_t stride_in_bytes,
+                           const uint32_t num_threads) {
+    std::atomic<size_t> next_request(0);
+    std::atomic<uint64_t> syscalls(0);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t t = 0; t < num_threads; ++t) {
+        threads.push_back(std::thread([&] {
+            lamure::ren::lod_file access;
+            access.open(lod_filename);
+            std::vector<char> slot(stride_in_bytes);
+
+            size_t i;
+            while ((i = next_request.fetch_add(1)) < requests.size()) {
+                access.read(slot.data(), requests[i] * stride_in_bytes, stride_in_bytes);
+            }
+            syscalls += access.num_syscalls();
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return {std::chrono::duration<double>(end - start).count(),
+            requests.size() * stride_in_bytes, requests.size(), syscalls.load()};
+}
+
+benchmark_result run_mmap(const std::string& lod_filename,
+                          const std::vector<lamure::node_t>& requests,
+                          const size_t stride_in_bytes,
+                          const uint32_t num_threads,
+                          const size_t prefetch_ahead) {
+    lamure::ren::lod_mapping mapping;
+    mapping.open(lod_filename);
+
+    std::atomic<size_t> next_request(0);
+    std::atomic<size_t> next_prefetch(0);
+    std::atomic<uint64_t> syscalls(0);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t t = 0; t < num_threads; ++t) {
+        threads.push_back(std::thread([&] {
+            std::vector<char> slot(stride_in_bytes);
+            uint64_t local_syscalls = 0;
+
+            size_t i;
+            while ((i = next_request.fetch_add(1)) < requests.size()) {
+                // hint the requests that follow, each one only once
+                size_t prefetch_end = std::min(i + 1 + prefetch_ahead, requests.size());
+                size_t p = next_prefetch.load();
+                while (p < prefetch_end && !next_prefetch.compare_exchange_weak(p, prefetch_end)) {}
+                for (; p < prefetch_end; ++p) {
+                    mapping.will_need(requests[p] * stride_in_bytes, stride_in_bytes);
+                    ++local_syscalls;
+                }
+
+                mapping.read(slot.data(), requests[i] * stride_in_bytes, stride_in_bytes);
+            }
+            syscalls += local_syscalls;
+        }));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return {std::chrono::duration<double>(end - start).count(),
+            requests.size() * stride_in_bytes, requests.size(), syscalls.load()};
+}
+
+benchmark_result run_uring(const std::string& lod_filename,
+                           const std::vector<lamure::node_t>& requests,
+                           const size_t stride_in_bytes,
+                           const uint32_t depth) {
+    lamure::ren::uring_queue queue;
+    if (!queue.initialize(depth)) {
+        std::cout << "io_uring is not available" << std::endl;
+        return {0.0, 0, 0, 0};
+    }
+
+    lamure::ren::lod_file access;
+    access.open(lod_filename);
+
+    // one slot per queue entry, reused as reads complete
+    std::vector<char> slots(queue.depth() * stride_in_bytes);
+    std::vector<size_t> slot_requests(queue.depth());
+    std::vector<uint64_t> free_slots;
+    for (uint64_t slot = 0; slot < queue.depth(); ++slot) {
+        free_slots.push_back(slot);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t next_request = 0;
+    size_t num_completed = 0;
+    while (num_completed < requests.size()) {
+        while (next_request < requests.size() && !free_slots.empty()) {
+            uint64_t slot = free_slots.back();
+            if (!queue.push_read(access.descriptor(), slots.data() + slot * stride_in_bytes,
+                                 requests[next_request] * stride_in_bytes, stride_in_bytes, slot)) {
+                break;
+            }
+            free_slots.pop_back();
+            slot_requests[slot] = next_request++;
+        }
+
+        if (!queue.submit(1)) {
+            std::cout << "io_uring submission failed" << std::endl;
+            break;
+        }
+
+        uint64_t slot;
+        int32_t result;
+        size_t length_in_bytes;
+        while (queue.pop_completion(slot, result, length_in_bytes)) {
+            if (result < 0 || (size_t)result != length_in_bytes) {
+                access.read(slots.data() + slot * stride_in_bytes,
+                            requests[slot_requests[slot]] * stride_in_bytes, stride_in_bytes);
+            }
+            free_slots.push_back(slot);
+            ++num_completed;
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return {std::chrono::duration<double>(end - start).count(),
+            num_completed * stride_in_bytes, num_completed, queue.num_syscalls() + access.num_syscalls()};
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 1 ||
+        cmd_option_exists(argv, argv+argc, "-h") ||
+        !cmd_option_exists(argv, argv+argc, "-f")) {
+        std::cout << "Usage: " << argv[0] << " <flags> -f <input_file>\n" <<
+            "INFO: lod_loading_benchmark\n" <<
+            "\t-f: selects .bvh input file, the .lod file is expected next to it\n" <<
+            "\t    (-f flag is required)\n" <<
+            "\t-m: selects backend: pread, mmap, io_uring or all (default: all)\n" <<
+            "\t-n: number of node requests (default: number of nodes)\n" <<
+            "\t-t: number of loader threads (default: 8)\n" <<
+            "\t-p: mmap prefetch distance in requests (default: 16)\n" <<
+            "\t-d: io_uring queue depth (default: 64)\n" <<
+            "\t-s: random seed (default: 0)\n" <<
+            std::endl;
+        return 0;
+    }
+
+    std::string bvh_filename = std::string(get_cmd_option(argv, argv + argc, "-f"));
+    std::string lod_filename = bvh_filename.substr(0, bvh_filename.size() - 3) + "lod";
+
+    std::string mode = "all";
+    if (cmd_option_exists(argv, argv+argc, "-m")) {
+        mode = std::string(get_cmd_option(argv, argv + argc, "-m"));
+    }
+
+    uint32_t num_threads = 8;
+    if (cmd_option_exists(argv, argv+argc, "-t")) {
+        num_threads = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-t")));
+    }
+
+    size_t prefetch_ahead = 16;
+    if (cmd_option_exists(argv, argv+argc, "-p")) {
+        prefetch_ahead = std::max(0, atoi(get_cmd_option(argv, argv + argc, "-p")));
+    }
+
+    uint32_t depth = 64;
+    if (cmd_option_exists(argv, argv+argc, "-d")) {
+        depth = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-d")));
+    }
+
+    uint32_t seed = 0;
+    if (cmd_option_exists(argv, argv+argc, "-s")) {
+        seed = atoi(get_cmd_option(argv, argv + argc, "-s"));
+    }
+
+    lamure::ren::bvh bvh(bvh_filename);
+    size_t stride_in_bytes = (size_t)bvh.get_size_of_primitive() * bvh.get_primitives_per_node();
+
+    size_t num_requests = bvh.get_num_nodes();
+    if (cmd_option_exists(argv, argv+argc, "-n")) {
+        num_requests = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-n")));
+    }
+
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<lamure::node_t> distribution(0, bvh.get_num_nodes() - 1);
+    std::vector<lamure::node_t> requests(num_requests);
+    for (auto& request : requests) {
+        request = distribution(generator);
+    }
+
+    std::cout << "nodes in file: " << bvh.get_num_nodes() << std::endl;
+    std::cout << "bytes per node: " << stride_in_bytes << std::endl;
+    std::cout << "requests: " << num_requests << ", threads: " << num_threads << std::endl;
+
+    if (mode == "pread" || mode == "all") {
+        print_result("pread", run_pread(lod_filename, requests, stride_in_bytes, num_threads));
+    }
+    if (mode == "mmap" || mode == "all") {
+        print_result("mmap", run_mmap(lod_filename, requests, stride_in_bytes, num_threads, prefetch_ahead));
+    }
+    if (mode == "io_uring" || mode == "all") {
+        benchmark_result result = run_uring(lod_filename, requests, stride_in_bytes, depth);
+        if (result.nodes_ > 0) {
+            print_result("io_uring", result);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+// compares the batched closed form normal estimation with the iterative
+// jacobi path that plane fitting used before. the neighbourhoods are samples
+// of randomly oriented planes with gaussian noise, so both results can also
+// be compared with the true normal.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <lamure/types.h>
+#include <lamure/pre/normal_computation_plane_fitting.h>
+#include <lamure/pre/normal_estimation.h>
+
+#include <scm/core/math.h>
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+// angle between two unoriented normals in degrees
+double angle_in_degrees(const lamure::vec3f& a, const lamure::vec3f& b) {
+    double length_a = scm::math::length(a);
+    double length_b = scm::math::length(b);
+    if (length_a == 0.0 || length_b == 0.0) {
+        return 90.0;
+    }
+    double cosine = std::abs(scm::math::dot(a, b)) / (length_a * length_b);
+    return std::acos(std::min(1.0, cosine)) * 180.0 / M_PI;
+}
+
+struct error_statistics {
+    double sum_ = 0.0;
+    double max_ = 0.0;
+    size_t count_ = 0;
+
+    void add(double error) {
+        sum_ += error;
+        max_ = std::max(max_, error);
+        ++count_;
+    }
+
+    double mean() const { return count_ > 0 ? sum_ / count_ : 0.0; }
+};
+
+int main(int argc, char *argv[]) {
+
+    if (cmd_option_exists(argv, argv+argc, "-h")) {
+        std::cout << "Usage: " << argv[0] << " <flags>\n" <<
+           "INFO: normal_estimation_benchmark\n" <<
+           "\t-n: (optional) number of neighbourhoods; default: 200000\n" <<
+           "\t-k: (optional) positions per neighbourhood; default: 24\n" <<
+           "\t-s: (optional) noise relative to the neighbourhood extent; default: 0.01\n" <<
+           "\t-r: (optional) repetitions, the fastest run is reported; default: 3\n" <<
+           std::endl;
+        return 0;
+    }
+
+    size_t num_neighbourhoods = 200000;
+    uint32_t num_neighbours = 24;
+    double noise = 0.01;
+    uint32_t num_repetitions = 3;
+
+    if (cmd_option_exists(argv, argv+argc, "-n")) {
+        num_neighbourhoods = std::max(1l, atol(get_cmd_option(argv, argv + argc, "-n")));
+    }
+    if (cmd_option_exists(argv, argv+argc, "-k")) {
+        num_neighbours = std::max(3, atoi(get_cmd_option(argv, argv + argc, "-k")));
+    }
+    if (cmd_option_exists(argv, argv+argc, "-s")) {
+        noise = atof(get_cmd_option(argv, argv + argc, "-s"));
+    }
+    if (cmd_option_exists(argv, argv+argc, "-r")) {
+        num_repetitions = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-r")));
+    }
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::normal_distribution<double> gaussian(0.0, noise);
+
+    std::vector<lamure::vec3f> true_normals(num_neighbourhoods);
+    std::vector<lamure::vec3r> positions(num_neighbourhoods * num_neighbours);
+    std::vector<lamure::vec3r> origins(num_neighbourhoods);
+
+    for (size_t n = 0; n < num_neighbourhoods; ++n) {
+        lamure::vec3r normal;
+        do {
+            normal = lamure::vec3r(uniform(generator), uniform(generator), uniform(generator));
+        } while (scm::math::length(normal) < 0.1);
+        normal = scm::math::normalize(normal);
+
+        lamure::vec3r tangent = std::abs(normal.x) > 0.5 ? lamure::vec3r(0.0, 1.0, 0.0) : lamure::vec3r(1.0, 0.0, 0.0);
+        tangent = scm::math::normalize(scm::math::cross(normal, tangent));
+        lamure::vec3r bitangent = scm::math::cross(normal, tangent);
+
+        // far from the origin like real scans
+        origins[n] = lamure::vec3r(uniform(generator), uniform(generator), uniform(generator)) * 1000.0;
+        true_normals[n] = lamure::vec3f(normal.x, normal.y, normal.z);
+
+        for (uint32_t i = 0; i < num_neighbours; ++i) {
+            positions[n * num_neighbours + i] = origins[n]
+                + tangent * uniform(generator) + bitangent * uniform(generator) + normal * gaussian(generator);
+        }
+    }
+
+    // reference: scalar covariance and iterative jacobi rotation per neighbourhood
+    lamure::pre::normal_computation_plane_fitting plane_fitting(num_neighbours);
+    std::vector<lamure::vec3f> jacobi_normals(num_neighbourhoods);
+    double jacobi_seconds = std::numeric_limits<double>::max();
+
+    for (uint32_t repetition = 0; repetition < num_repetitions; ++repetition) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t n = 0; n < num_neighbourhoods; ++n) {
+            const lamure::vec3r* neighbourhood = &positions[n * num_neighbours];
+
+            lamure::vec3r centroid(0.0);
+            for (uint32_t i = 0; i < num_neighbours; ++i) {
+                centroid += neighbourhood[i];
+            }
+            centroid *= 1.0 / num_neighbours;
+
+            scm::math::mat3d covariance = scm::math::mat3d::zero();
+            for (uint32_t i = 0; i < num_neighbours; ++i) {
+                lamure::vec3r d = neighbourhood[i] - centroid;
+                covariance.m00 += d.x * d.x; covariance.m01 += d.x * d.y; covariance.m02 += d.x * d.z;
+                covariance.m03 += d.y * d.x; covariance.m04 += d.y * d.y; covariance.m05 += d.y * d.z;
+                covariance.m06 += d.z * d.x; covariance.m07 += d.z * d.y; covariance.m08 += d.z * d.z;
+            }
+
+            double* eigenvalues = new double[3];
+            double** eigenvectors = new double*[3];
+            for (int i = 0; i < 3; ++i) {
+                eigenvectors[i] = new double[3];
+            }
+
+            plane_fitting.jacobi_rotation(covariance, eigenvalues, eigenvectors);
+            jacobi_normals[n] = lamure::vec3f(eigenvectors[0][0], eigenvectors[1][0], eigenvectors[2][0]);
+
+            delete[] eigenvalues;
+            for (int i = 0; i < 3; ++i) {
+                delete[] eigenvectors[i];
+            }
+            delete[] eigenvectors;
+        }
+
+        jacobi_seconds = std::min(jacobi_seconds,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // batched closed form kernel, the batch is filled as plane fitting does it
+    lamure::pre::normal_estimation::neighbourhood_batch batch;
+    std::vector<lamure::vec3f> batch_normals;
+    double batch_seconds = std::numeric_limits<double>::max();
+
+    for (uint32_t repetition = 0; repetition < num_repetitions; ++repetition) {
+        auto start = std::chrono::steady_clock::now();
+
+        batch.clear();
+        for (size_t n = 0; n < num_neighbourhoods; ++n) {
+            batch.begin_neighbourhood(origins[n]);
+            for (uint32_t i = 0; i < num_neighbours; ++i) {
+                batch.add_position(positions[n * num_neighbours + i]);
+            }
+        }
+        lamure::pre::normal_estimation::compute_normals(batch, batch_normals);
+
+        batch_seconds = std::min(batch_seconds,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    error_statistics jacobi_error, batch_error, difference;
+    for (size_t n = 0; n < num_neighbourhoods; ++n) {
+        jacobi_error.add(angle_in_degrees(jacobi_normals[n], true_normals[n]));
+        batch_error.add(angle_in_degrees(batch_normals[n], true_normals[n]));
+        difference.add(angle_in_degrees(batch_normals[n], jacobi_normals[n]));
+    }
+
+    std::cout << "neighbourhoods: " << num_neighbourhoods << ", positions per neighbourhood: " << num_neighbours
+              << ", noise: " << noise << std::endl;
+    std::cout << "jacobi:      " << num_neighbourhoods / jacobi_seconds << " normals/s, error to true normal (deg): mean "
+              << jacobi_error.mean() << " max " << jacobi_error.max_ << std::endl;
+    std::cout << "closed form: " << num_neighbourhoods / batch_seconds << " normals/s, error to true normal (deg): mean "
+              << batch_error.mean() << " max " << batch_error.max_ << std::endl;
+    std::cout << "speedup: " << jacobi_seconds / batch_seconds
+              << ", deviation from jacobi (deg): mean " << difference.mean() << " max " << difference.max_ << std::endl;
+
+    return 0;
+}
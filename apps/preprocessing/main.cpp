@@ -63,6 +63,29 @@ int main(int argc, const char *argv[])
          "make sure the final stage number is equal or higher than the start stage,"
          "which is implicitly defined by INPUT")
 
+        ("quantize,q",
+         "write quantized surfels (12 instead of 32 bytes per surfel) in the "
+         "serialization stage. The output is a .bvhqz/.lodqz pair that the "
+         "renderer loads like the files of the point_cloud_compression_app")
+
+        ("compression-level,z",
+         po::value<int>()->default_value(0),
+         "zlib compression level (1-9) of the .lod written in the serialization "
+         "stage. Every node is compressed on its own and decompressed by the "
+         "loader threads of the renderer. 0 writes an uncompressed .lod")
+
+        ("insert-into",
+         po::value<std::string>(),
+         "insert INPUT into an existing, serialized .bvh/.lod pair instead of "
+         "building a new tree. Only the leaves that receive surfels and their "
+         "ancestors are rebuilt. Quantized and compressed trees are not supported")
+
+        ("insert-grow-tree",
+         "allow --insert-into to add leaf levels when the tree runs out of room. "
+         "A new level splits every leaf and rewrites the whole .lod, the cost "
+         "of each level is logged. Without it such an insertion fails and "
+         "leaves the tree unchanged")
+
         ("max-fanout",
          po::value<int>()->default_value(2),
          "maximum fan-out factor for tree properties computation. "
@@ -80,6 +103,12 @@ int main(int argc, const char *argv[])
          "the application tries to achieve a number of surfels per node close to "
          "this value")
 
+        ("leaf-fill",
+         po::value<float>()->default_value(1.0f, "1.0"),
+         "fraction (0.1-1.0) of the node size the leaves are filled to. A lower "
+         "value leaves room for --insert-into, so that later scans fit into the "
+         "leaves without new leaf levels")
+
         ("recompute,r",
          "recompute surfel normals and radii, even if they data is present in the "
          "input data")
@@ -158,6 +187,14 @@ int main(int argc, const char *argv[])
          "  gmean - geometric mean\n"
          "  hmean - harmonic mean")
 
+        ("downsweep-algo",
+         po::value<std::string>()->default_value("split"),
+         "Algorithm for building the tree hierarchy. Possible values:\n"
+         "  split - sort and split every node along its longest axis\n"
+         "  morton - derive all nodes from one radix sorted morton order\n"
+         "           (needs 32 bytes per surfel of the memory budget, falls\n"
+         "           back to split otherwise)")
+
         ("convert,c",
          "convert RAW point data from one format to another (see convertion mode description below).");
 
@@ -187,6 +224,8 @@ int main(int argc, const char *argv[])
                 "    .kdnd - stage 3: start from upsweep/LOD creation\n"
                 "    .kdnu - stage 4: start from serializer\n"
                 "  last two stages require intermediate files to be present in the working directory (-k option).\n"
+                "Insert mode (--insert-into option):\n"
+                "  INPUT: file in .xyz, .xyz_all, .ply, .xyz_bin, .bin or .bin_all format\n"
                 "Conversion mode (-c option):\n"
                 "  INPUT: file in either .xyz, .xyz_all, .ply or .xyz_bin format\n"
                 "  OUTPUT: file in either .xyz_all or .bin_all format\n";
@@ -279,6 +318,7 @@ int main(int argc, const char *argv[])
         std::string normal_computation_algo = vm["normal-computation-algo"].as<std::string>();
         std::string radius_computation_algo = vm["radius-computation-algo"].as<std::string>();
         std::string rep_radius_algo = vm["rep-radius-algo"].as<std::string>();
+        std::string downsweep_algo = vm["downsweep-algo"].as<std::string>();
 
         if (reduction_algo == "ndc") {
             desc.reduction_algo        = lamure::pre::reduction_algorithm::ndc;
@@ -350,14 +390,26 @@ int main(int argc, const char *argv[])
             return EXIT_FAILURE;
         }
 
+        if (downsweep_algo == "split")
+            desc.downsweep_algo        = lamure::pre::downsweep_algorithm::split;
+        else if (downsweep_algo == "morton")
+            desc.downsweep_algo        = lamure::pre::downsweep_algorithm::morton;
+        else {
+            std::cerr << "Unknown algorithm for building the tree hierarchy" << details_msg;
+            return EXIT_FAILURE;
+        }
+
         desc.input_file                   = fs::canonical(input_file).string();
         desc.working_directory            = fs::canonical(wd).string();
         desc.max_fan_factor               = std::min(std::max(vm["max-fanout"].as<int>(), 2), 8);
         desc.surfels_per_node             = vm["desired"].as<int>();
+        desc.leaf_fill_factor             = std::min(std::max(vm["leaf-fill"].as<float>(), 0.1f), 1.0f);
         desc.final_stage                  = vm["final-stage"].as<int>();
         desc.compute_normals_and_radii    = vm.count("recompute");
         desc.keep_intermediate_files      = vm.count("keep-interm");
         desc.resample                     = vm.count("resample");
+        desc.quantize_output              = vm.count("quantize");
+        desc.compression_level            = std::min(std::max(vm["compression-level"].as<int>(), 0), 9);
         // manual check because typed_value doenst support check whether default is used
 
         desc.memory_budget                = std::max(vm["memory-budget"].as<float>(), 1.0f);
@@ -372,6 +424,10 @@ int main(int argc, const char *argv[])
         //optional prov file
         desc.prov_file                    = vm["prov-file"].as<std::string>();
 
+        //optional tree to insert into
+        desc.insert_into                  = vm.count("insert-into") ? vm["insert-into"].as<std::string>() : "";
+        desc.insert_grow_tree             = vm.count("insert-grow-tree");
+
         if (desc.prov_file != "") {
             std::cout << "Provenance data found -> using --reduction-algo ndc_prov" << std::endl;
             desc.reduction_algo           = lamure::pre::reduction_algorithm::ndc_prov;
@@ -380,7 +436,11 @@ int main(int argc, const char *argv[])
 
         // preprocess
         lamure::pre::builder builder(desc);
-        if (!builder.construct())
+        if (desc.insert_into != "") {
+            if (!builder.insert())
+                return EXIT_FAILURE;
+        }
+        else if (!builder.construct())
             return EXIT_FAILURE;
     }
 
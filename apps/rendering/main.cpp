@@ -148,6 +148,7 @@ int main(int argc, char** argv)
 
     std::string pvs_file_path = "";
     bool pvs_culling = true;
+    std::string loading_mode = "pread";
 
     po::options_description desc("Usage: " + exec_name + " [OPTION]... INPUT\n\n"
                                "Allowed Options");
@@ -159,6 +160,7 @@ int main(int argc, char** argv)
       ("vram,v", po::value<unsigned>(&video_memory_budget)->default_value(2048), "specify graphics memory budget in MB (default=2048)")
       ("mem,m", po::value<unsigned>(&main_memory_budget)->default_value(4096), "specify main memory budget in MB (default=4096)")
       ("upload,u", po::value<unsigned>(&max_upload_budget)->default_value(64), "specify maximum video memory upload budget per frame in MB (default=64)")
+      ("loader", po::value<std::string>(&loading_mode)->default_value("pread"), "specify how nodes are loaded from lod files: pread, mmap or io_uring (default=pread)")
       ("measurement-file", po::value<std::string>(&measurement_file_path)->default_value(""), "specify camera session for quality measurement_file (default = \"\")")
       ("measurement-interpolate", po::value<bool>(&measurement_file_interpolation)->default_value(false), "allow interpolation between measurement transformations (default=false)")
       ("measurement-stepsize", po::value<float>(&measurement_interpolation_stepsize)->default_value(1.0f), "if interpolation is activated, this will be the stepsize in spatial units between interpolation points")
@@ -209,6 +211,11 @@ int main(int argc, char** argv)
       return 0;
     }
 
+    if (loading_mode != "pread" && loading_mode != "mmap" && loading_mode != "io_uring") {
+      std::cerr << "Error: Unknown loader '" << loading_mode << "', expected pread, mmap or io_uring.\n" << desc;
+      return 1;
+    }
+
     // set min and max
     window_width        = std::max(std::min(window_width, 4096), 1);
     window_height       = std::max(std::min(window_height, 2160), 1);
@@ -257,6 +264,15 @@ int main(int argc, char** argv)
     policy->set_max_upload_budget_in_mb(max_upload_budget); //8
     policy->set_render_budget_in_mb(video_memory_budget); //2048
     policy->set_out_of_core_budget_in_mb(main_memory_budget); //4096, 8192
+    if (loading_mode == "mmap") {
+      policy->set_loading_mode(lamure::ren::policy::LOADING_MODE_MMAP);
+    }
+    else if (loading_mode == "io_uring") {
+      policy->set_loading_mode(lamure::ren::policy::LOADING_MODE_IO_URING);
+    }
+    else {
+      policy->set_loading_mode(lamure::ren::policy::LOADING_MODE_PREAD);
+    }
     policy->set_window_width(window_width);
     policy->set_window_height(window_height);
 
@@ -194,9 +194,15 @@ int main(int argc, const char *argv[])
         desc.working_directory            = fs::canonical(wd).string();
         desc.max_fan_factor               = 2;
         desc.surfels_per_node             = 1024;
+        desc.leaf_fill_factor             = 1.0f;
         desc.translate_to_origin          = !vm.count("no-translate-to-origin");
+        desc.downsweep_algo               = lamure::pre::downsweep_algorithm::split;
         desc.resample                     = true;
+        desc.quantize_output              = false;
+        desc.compression_level            = 0;
         desc.outlier_ratio                = 0.0f;
+        desc.insert_into                  = "";
+        desc.insert_grow_tree             = false;
         // preprocess
         lamure::pre::builder builder(desc);
         if (!builder.resample())
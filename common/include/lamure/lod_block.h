@@ -0,0 +1,50 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef COMMON_LOD_BLOCK_H_
+#define COMMON_LOD_BLOCK_H_
+
+#include <lamure/platform.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lamure {
+
+// codec of the blocks of a compressed .lod file. every node is stored as
+// one independently decompressible zlib block, the offsets of the blocks
+// are kept in the .bvh, so a node is still served by a single read.
+class COMMON_DLL lod_block
+{
+public:
+    enum codec {
+        CODEC_NONE = 0,
+        CODEC_ZLIB = 1
+    };
+
+    static const int        MIN_LEVEL = 1;
+    static const int        MAX_LEVEL = 9;
+
+    static const size_t     max_compressed_size(const size_t node_size);
+
+    // appends the compressed node to block and returns the block size
+    static const size_t     compress(const char* node,
+                                     const size_t node_size,
+                                     const int level,
+                                     std::vector<char>& block);
+
+    // false if the block does not decompress to exactly node_size bytes
+    static const bool       decompress(const char* block,
+                                       const size_t block_size,
+                                       char* node,
+                                       const size_t node_size);
+};
+
+} // namespace lamure
+
+#endif // COMMON_LOD_BLOCK_H_
@@ -0,0 +1,52 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/lod_block.h>
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace lamure {
+
+const int lod_block::MIN_LEVEL;
+const int lod_block::MAX_LEVEL;
+
+const size_t lod_block::
+max_compressed_size(const size_t node_size) {
+    return compressBound(node_size);
+}
+
+const size_t lod_block::
+compress(const char* node, const size_t node_size, const int level, std::vector<char>& block) {
+    assert(level >= MIN_LEVEL && level <= MAX_LEVEL);
+
+    const size_t offset = block.size();
+    uLongf block_size = compressBound(node_size);
+    block.resize(offset + block_size);
+
+    int result = compress2((Bytef*)block.data() + offset, &block_size,
+                           (const Bytef*)node, node_size, level);
+    if (result != Z_OK) {
+        throw std::runtime_error("lamure: lod_block::Unable to compress node");
+    }
+
+    block.resize(offset + block_size);
+    return block_size;
+}
+
+const bool lod_block::
+decompress(const char* block, const size_t block_size, char* node, const size_t node_size) {
+    uLongf decompressed_size = node_size;
+    int result = uncompress((Bytef*)node, &decompressed_size,
+                            (const Bytef*)block, block_size);
+    return result == Z_OK && decompressed_size == node_size;
+}
+
+} // namespace lamure
@@ -35,6 +35,11 @@ public:
     template<class T>
     using splitted_array = std::vector<std::pair<T, bounding_box>>;
 
+    struct morton_entry {
+        uint64_t     key;
+        uint32_t     index;
+    };
+
     basic_algorithms() = delete;
 
     static bounding_box compute_aabb(const surfel_mem_array &sa,
@@ -62,14 +67,23 @@ public:
                                const uint8_t split_axis,
                                const uint8_t fan_factor,
                                const bool parallelize = false);
-/*
+
     static void sort_and_split(surfel_disk_array &sa,
                                splitted_array<surfel_disk_array> &out,
                                const bounding_box &box,
                                const uint8_t split_axis,
                                const uint8_t fan_factor,
                                const size_t memory_limit);
-*/
+
+    // 63 bit morton code of the position quantized to 21 bits per axis
+    // inside the cube of the largest extent of box
+    static uint64_t compute_morton_key(const vec3r &pos,
+                                       const bounding_box &box);
+
+    // least significant digit first, so entries with equal keys keep their
+    // order. digits which are the same for all keys are skipped
+    static void radix_sort(std::vector<morton_entry> &entries);
+
 private:
 
     template<class T>
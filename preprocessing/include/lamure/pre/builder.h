@@ -35,12 +35,17 @@ public:
         std::string input_file;
         std::string working_directory;
         std::string prov_file;
+        std::string insert_into;
+        bool insert_grow_tree;
         uint32_t max_fan_factor;
         size_t surfels_per_node;
+        float leaf_fill_factor;
         uint16_t final_stage;
         bool compute_normals_and_radii;
         bool keep_intermediate_files;
         bool resample;
+        bool quantize_output;
+        int compression_level;
         float memory_budget;
         float radius_multiplier;
         size_t buffer_size;
@@ -50,6 +55,7 @@ public:
         float outlier_ratio;
 
         rep_radius_algorithm rep_radius_algo;
+        downsweep_algorithm downsweep_algo;
         reduction_algorithm reduction_algo;
         radius_computation_algorithm radius_computation_algo;
         normal_computation_algorithm normal_computation_algo;
@@ -63,6 +69,8 @@ public:
 
     bool construct();
     bool resample();
+    // inserts input_file into the serialized tree insert_into
+    bool insert();
 
 private:
     reduction_strategy *get_reduction_strategy(reduction_algorithm algo) const;
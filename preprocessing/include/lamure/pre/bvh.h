@@ -12,12 +12,14 @@
 #include <lamure/pre/bvh_node.h>
 #include <lamure/pre/common.h>
 #include <lamure/pre/io/file.h>
+#include <lamure/pre/knn_index.h>
 #include <lamure/pre/logger.h>
 #include <lamure/pre/node_serializer.h>
 #include <lamure/pre/normal_computation_strategy.h>
 #include <lamure/pre/platform.h>
 #include <lamure/pre/radius_computation_strategy.h>
 #include <lamure/pre/reduction_strategy.h>
+#include <lamure/pre/task_scheduler.h>
 
 #include <lamure/pre/io/converter.h>
 
@@ -59,7 +61,10 @@ class PREPROCESSING_DLL bvh
     bvh(const bvh &other) = delete;
     bvh &operator=(const bvh &other) = delete;
 
-    void init_tree(const std::string &surfels_input_file, const uint32_t max_fan_factor, const size_t desired_surfels_per_node, const boost::filesystem::path &base_path);
+    // the leaves are filled to leaf_fill_factor of max_surfels_per_node(),
+    // a lower factor leaves room for insert() without new leaf levels
+    void init_tree(const std::string &surfels_input_file, const uint32_t max_fan_factor, const size_t desired_surfels_per_node, const boost::filesystem::path &base_path,
+                   const float leaf_fill_factor = 1.0f);
 
     bool load_tree(const std::string &kdn_input_file);
 
@@ -71,6 +76,10 @@ class PREPROCESSING_DLL bvh
 
     boost::filesystem::path base_path() const { return base_path_; }
 
+    // layout of the .lod of a serialized tree, known after load_tree()
+    bool lod_quantized() const { return lod_quantized_; }
+    bool lod_compressed() const { return lod_compressed_; }
+
     const std::vector<bvh_node> &nodes() const { return nodes_; }
     std::vector<bvh_node> &nodes() { return nodes_; }
 
@@ -107,21 +116,67 @@ class PREPROCESSING_DLL bvh
     const node_id_type first_leaf() const { return first_leaf_; }
 
     // processing functions
-    void downsweep(bool adjust_translation, const std::string &surfels_input_file, const std::string &prov_input_file);
+    void downsweep(bool adjust_translation, const std::string &surfels_input_file, const std::string &prov_input_file,
+                   const downsweep_algorithm downsweep_algo = downsweep_algorithm::split);
 
     void compute_normals_and_radii(const uint16_t number_of_neighbours);
 
     void compute_normal_and_radius(const bvh_node *source_node, const normal_computation_strategy &normal_computation_strategy, const radius_computation_strategy &radius_computation_strategy);
 
+    /**
+     * Reduces the leaves up to the root and computes normals and radii of
+     * every level.
+     *
+     * The tree is processed in blocks of subtrees that fit into the memory
+     * limit. Neighbours for normals and radii are searched within the block
+     * and a ring of neighbouring nodes one node wide, so they only differ
+     * from an upsweep with more memory if the neighbours of a surfel lie
+     * further away. Reductions that search neighbours through the tree
+     * always run on a single block.
+     */
     void upsweep(const reduction_strategy &reduction_strategy, const normal_computation_strategy &normal_comp_strategy, const radius_computation_strategy &radius_comp_strategy,
                  bool recompute_leaf_level = true, bool resample = false);
     void resample();
 
+    /**
+     * Inserts the surfels of a .bin file into a serialized tree and writes
+     * its .lod and .bvh again.
+     *
+     * Every surfel goes to the leaf it falls into. A leaf that overflows is
+     * rebuilt together with the leaves of its smallest enclosing subtree that
+     * still has room. Subtrees are limited by the memory budget, surfels that
+     * do not fit are inserted in a later pass. Afterwards only the changed
+     * leaves and their ancestors are reduced and written again, the ids of
+     * all other nodes stay the same.
+     *
+     * Trees built with a leaf fill factor below 1 have room in every leaf,
+     * see init_tree(). If no subtree has room the tree needs one more leaf
+     * level. Node ids are implicit in the complete tree, so a new level
+     * splits every leaf and rewrites the whole .lod. This is only done if
+     * allow_new_leaf_levels is set, each level is logged with its cost.
+     *
+     * The nodes are written into the .lod in place, every overwritten slot
+     * is saved to <base>.lod_journal first. The tree is written to
+     * <base>.bvh_insert, which replaces the .bvh once the insertion
+     * succeeded. On failure the journal is rolled back, the files of the
+     * tree are unchanged and the tree is left in state null and has to be
+     * loaded again. Otherwise it is left in state serialized. An insertion
+     * that was interrupted is rolled back by load_tree().
+     * Throws std::runtime_error for quantized or compressed trees, if the
+     * surfels need a new leaf level that is not allowed and if they do not
+     * fit after as many leaf levels as the input needs.
+     */
+    void insert(const std::string &surfels_input_file, const reduction_strategy &reduction_strategy, const normal_computation_strategy &normal_comp_strategy,
+                const radius_computation_strategy &radius_comp_strategy, bool recompute_leaf_level = true, bool allow_new_leaf_levels = false);
+
     surfel_vector remove_outliers_statistically(uint32_t num_outliers, uint16_t num_neighbours);
 
-    void serialize_tree_to_file(const std::string &output_file, bool write_intermediate_data);
+    void serialize_tree_to_file(const std::string &output_file, bool write_intermediate_data, const bool quantized = false,
+                                const std::vector<uint64_t> &lod_block_offsets = std::vector<uint64_t>());
 
-    void serialize_surfels_to_file(const std::string &lod_output_file, const std::string &prov_output_file, const size_t buffer_size) const;
+    // returns the block offsets of a compressed .lod, which belong into the .bvh
+    std::vector<uint64_t> serialize_surfels_to_file(const std::string &lod_output_file, const std::string &prov_output_file, const size_t buffer_size,
+                                                    const bool quantize = false, const int compression_level = 0) const;
 
     /* resets all nodes and deletes temp files
      */
@@ -143,31 +198,49 @@ class PREPROCESSING_DLL bvh
     void set_nodes(const std::vector<bvh_node> &nodes) { nodes_ = nodes; };
     void set_first_leaf(const node_id_type first_leaf) { first_leaf_ = first_leaf; };
     void set_state(const state_type state) { state_ = state; };
+    void set_lod_format(const bool quantized, const bool compressed)
+    {
+        lod_quantized_ = quantized;
+        lod_compressed_ = compressed;
+    };
 
-    void spawn_create_lod_jobs(const uint32_t first_node_of_level, const uint32_t last_node_of_level, const reduction_strategy &reduction_strgy, const bool resample);
     void spawn_compute_attribute_jobs(const uint32_t first_node_of_level, const uint32_t last_node_of_level, const normal_computation_strategy &normal_strategy,
                                       const radius_computation_strategy &radius_strategy, const bool is_leaf_level);
     void spawn_compute_bounding_boxes_downsweep_jobs(const uint32_t slice_left, const uint32_t slice_right);
-    void spawn_compute_bounding_boxes_upsweep_jobs(const uint32_t first_node_of_level, const uint32_t last_node_of_level, const int32_t level);
     void spawn_split_node_jobs(size_t &slice_left, size_t &slice_right, size_t &new_slice_left, size_t &new_slice_right, const uint32_t level);
 
     void thread_remove_outlier_jobs(const uint32_t start_marker, const uint32_t end_marker, const uint32_t num_outliers, const uint16_t num_neighbours,
                                     std::vector<std::pair<surfel_id_t, real>> &intermediate_outliers_for_thread);
     void thread_compute_attributes(const uint32_t start_marker, const uint32_t end_marker, const bool update_percentage, const normal_computation_strategy &normal_strategy,
                                    const radius_computation_strategy &radius_strategy, const bool is_leaf_level);
-    void thread_create_lod(const uint32_t start_marker, const uint32_t end_marker, const bool update_percentage, const reduction_strategy &reduction_strgy, const bool resample);
     void thread_compute_bounding_boxes_downsweep(const uint32_t slice_left, const uint32_t slice_right, const bool update_percentage, const uint32_t num_threads);
-    void thread_compute_bounding_boxes_upsweep(const uint32_t start_marker, const uint32_t end_marker, const bool update_percentage, const int32_t level, const uint32_t num_threads);
     void thread_split_node_jobs(size_t &slice_left, size_t &slice_right, size_t &new_slice_left, size_t &new_slice_right, const bool update_percentage, const int32_t level,
                                 const uint32_t num_threads);
     void thread_resample(const uint32_t start_marker, const uint32_t end_marker, const bool update_percentage);
 
+    // per node steps of the upsweep, scheduled as tasks
+    void create_lod(const uint32_t node_index, const reduction_strategy &reduction_strgy, const bool resample);
+    void compute_attributes(const uint32_t node_index, const normal_computation_strategy &normal_strategy, const radius_computation_strategy &radius_strategy, const bool is_leaf_level,
+                            const knn_index &index);
+    void compute_bounding_box_upsweep(const uint32_t node_index, const int32_t level);
+    void unload_children(const uint32_t node_index);
+
+    void compute_normal_and_radius(const bvh_node *source_node, const normal_computation_strategy &normal_computation_strategy, const radius_computation_strategy &radius_computation_strategy,
+                                   const knn_index &index);
+
   private:
     surfel_vector resampled_leaf_level_;
     std::mutex resample_mutex_;
 
+    // neighbourhood index over the level currently processed by the attribute
+    // and outlier jobs, empty otherwise
+    knn_index level_index_;
+
     atomic_counter<uint32_t> working_queue_head_counter_;
 
+    // workers of all parallel jobs, kept alive for the lifetime of the tree
+    task_scheduler scheduler_;
+
     state_type state_ = state_type::null;
 
     std::vector<bvh_node> nodes_;
@@ -189,13 +262,47 @@ class PREPROCESSING_DLL bvh
 
     vec3r translation_ = vec3r(0.0); ///< translation of surfels
 
+    bool lod_quantized_ = false;
+    bool lod_compressed_ = false;
+
     void downsweep_subtree_in_core(const bvh_node &node, size_t &disk_leaf_destination, uint32_t &processed_nodes, uint8_t &percent_processed, 
         shared_surfel_file leaf_level_access, shared_prov_file prov_leaf_level_access);
+    // builds the whole tree from one global morton order of the root surfels
+    void downsweep_morton(const vec3r &translation_on_load, size_t &disk_leaf_destination, shared_surfel_file leaf_level_access);
 
     void get_descendant_leaves(const node_id_type node, std::vector<node_id_type> &result, const node_id_type first_leaf, const std::unordered_set<size_t> &excluded_leaves) const;
     void get_descendant_nodes(const node_id_type node, std::vector<node_id_type> &result, const node_id_type desired_depth, const std::unordered_set<size_t> &excluded_nodes) const;
 
     surfel_mem_array resample_node(uint32_t node_id) const;
+
+    // upsweep of a subtree block, see upsweep()
+    struct upsweep_graph;
+    struct subtree_tasks
+    {
+        task_scheduler::task_id loads_done_;
+        task_scheduler::task_id done_;
+    };
+
+    uint32_t get_upsweep_block_depth(const bool with_leaf_halo) const;
+    // nodes of a level outside the block that lie within one node of it
+    std::vector<node_id_type> get_upsweep_halo(const node_id_type block_root, const uint32_t level) const;
+    void flush_upsweep_node(upsweep_graph &graph, const node_id_type node_index, const uint32_t level, const bool is_final, const bool dealloc_mem_array);
+
+    // incremental insertion, see insert()
+    void roll_back_insertion() const;
+    node_id_type find_insertion_leaf(const vec3r &position) const;
+    std::pair<node_id_type, node_id_type> get_leaf_range(const node_id_type node_id) const;
+    surfel_vector read_serialized_node(node_serializer &serializer, const node_id_type node_id) const;
+    void write_serialized_node(node_serializer &serializer, const node_id_type node_id) const;
+    size_t insert_batch(surfel_vector &batch, node_serializer &serializer, const reduction_strategy &reduction_strgy, const normal_computation_strategy &normal_strategy,
+                        const radius_computation_strategy &radius_strategy, const bool recompute_leaf_level, const size_t max_subtree_surfels);
+    void split_node(const node_id_type node_id, const bounding_box &box, const bool parallelize);
+    void add_leaf_level(node_serializer &serializer, const reduction_strategy &reduction_strgy, const normal_computation_strategy &normal_strategy,
+                        const radius_computation_strategy &radius_strategy);
+    subtree_tasks add_subtree_upsweep_tasks(upsweep_graph &graph, const node_id_type subtree_root, const uint32_t bottom_level,
+                                            const std::vector<task_scheduler::task_id> &load_dependencies, knn_index &index);
+    // the levels from the leaves up to the block roots, one level of all blocks after the other
+    void add_blocked_upsweep_tasks(upsweep_graph &graph, const uint32_t block_depth, std::vector<knn_index> &block_indices);
 };
 
 using bvh_ptr = std::shared_ptr<bvh>;
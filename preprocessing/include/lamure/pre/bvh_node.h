@@ -139,6 +139,18 @@ public:
      */
     void load_from_disk();
 
+    /**
+     * loads surfel data from the disk into compact storage.
+     *
+     * The positions are stored relative to the center of the node's bounding
+     * box, see surfel_soa. The data is read in chunks of buffer_size bytes.
+     *
+     * \param[in] buffer_size  Size of the read buffer in bytes.
+     * \param[in] translation  Added to the positions while they are loaded.
+     */
+    void load_from_disk_compact(const size_t buffer_size,
+                                const vec3r &translation = vec3r(0.0));
+
     /**
      * Activates out-of-core mode and saves surfel data to disk.
      *
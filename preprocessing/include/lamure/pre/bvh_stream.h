@@ -45,7 +45,11 @@ public:
     { return filename_; };
 
     void read_bvh(const std::string &filename, bvh &bvh);
-    void write_bvh(const std::string &filename, bvh &bvh, const bool intermediate);
+    // quantized trees are marked as BVH_POINTCLOUD_QZ for the renderer,
+    // lod_block_offsets are written for a compressed .lod
+    void write_bvh(const std::string &filename, bvh &bvh, const bool intermediate,
+                   const bool quantized = false,
+                   const std::vector<uint64_t> &lod_block_offsets = std::vector<uint64_t>());
 
 protected:
 
@@ -72,6 +76,12 @@ protected:
         uint64_t length_;
         std::string string_;
     };
+    enum bvh_primitive_type
+    {
+        BVH_POINTCLOUD = 0,
+        BVH_TRIMESH = 1,
+        BVH_POINTCLOUD_QZ = 2
+    };
     enum bvh_node_visibility
     {
         BVH_NODE_VISIBLE = 0,
@@ -259,7 +269,8 @@ protected:
 
         uint32_t max_surfels_per_node_;
         uint32_t serialized_surfel_size_;
-        uint64_t reserved_0_;
+        uint32_t primitive_;
+        uint32_t reserved_0_;
 
         bvh_tree_state state_;
         uint32_t reserved_1_;
@@ -297,7 +308,8 @@ protected:
             file.write((char *) &fan_factor_, 4);
             file.write((char *) &max_surfels_per_node_, 4);
             file.write((char *) &serialized_surfel_size_, 4);
-            file.write((char *) &reserved_0_, 8);
+            file.write((char *) &primitive_, 4);
+            file.write((char *) &reserved_0_, 4);
             file.write((char *) &state_, 4);
             file.write((char *) &reserved_1_, 4);
             file.write((char *) &reserved_2_, 8);
@@ -318,7 +330,8 @@ protected:
             file.read((char *) &fan_factor_, 4);
             file.read((char *) &max_surfels_per_node_, 4);
             file.read((char *) &serialized_surfel_size_, 4);
-            file.read((char *) &reserved_0_, 8);
+            file.read((char *) &primitive_, 4);
+            file.read((char *) &reserved_0_, 4);
             file.read((char *) &state_, 4);
             file.read((char *) &reserved_1_, 4);
             file.read((char *) &reserved_2_, 8);
@@ -582,6 +595,68 @@ protected:
 
     };
 
+    // offsets of the blocks of a compressed .lod, block i spans
+    // [block_offsets_[i], block_offsets_[i + 1])
+    class bvh_lod_block_seg: public bvh_serializable
+    {
+    public:
+        bvh_lod_block_seg()
+            : bvh_serializable()
+        {};
+        ~bvh_lod_block_seg()
+        {};
+
+        uint32_t segment_id_;
+        uint32_t codec_;
+        uint64_t reserved_;
+        uint64_t num_blocks_;
+        std::vector<uint64_t> block_offsets_;
+
+    protected:
+        friend class bvh_stream;
+        const size_t size() const
+        {
+            return 4 * sizeof(uint32_t) + 8 + (num_blocks_ + 1) * 8;
+        };
+        void signature(char *signature)
+        {
+            signature[0] = 'B';
+            signature[1] = 'V';
+            signature[2] = 'H';
+            signature[3] = 'X';
+            signature[4] = 'L';
+            signature[5] = 'O';
+            signature[6] = 'D';
+            signature[7] = 'B';
+        }
+        void serialize(std::fstream &file)
+        {
+            if (!file.is_open()) {
+                throw std::runtime_error(
+                    "PLOD: bvh_stream::Unable to serialize");
+            }
+            file.write((char *) &segment_id_, 4);
+            file.write((char *) &codec_, 4);
+            file.write((char *) &reserved_, 8);
+            file.write((char *) &num_blocks_, 8);
+            file.write((char *) block_offsets_.data(), (num_blocks_ + 1) * 8);
+        }
+        void deserialize(std::fstream &file)
+        {
+            if (!file.is_open()) {
+                throw std::runtime_error(
+                    "PLOD: bvh_stream::Unable to deserialize");
+            }
+            file.read((char *) &segment_id_, 4);
+            file.read((char *) &codec_, 4);
+            file.read((char *) &reserved_, 8);
+            file.read((char *) &num_blocks_, 8);
+            block_offsets_.resize(num_blocks_ + 1);
+            file.read((char *) block_offsets_.data(), (num_blocks_ + 1) * 8);
+        }
+
+    };
+
     void open_stream(const std::string &bvh_filename,
                      const bvh_stream_type type);
     void close_stream(const bool remove_file);
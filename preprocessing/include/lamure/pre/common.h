@@ -31,6 +31,12 @@ enum class radius_computation_algorithm
     natural_neighbours = 1
 };
 
+enum class downsweep_algorithm
+{
+    split = 0,
+    morton = 1
+};
+
 enum class reduction_algorithm
 {
     ndc = 0,
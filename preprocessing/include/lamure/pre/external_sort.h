@@ -1,7 +1,7 @@
 // Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
 // This Software is distributed under the Modified BSD License, see license.txt.
 //
-// Virtual Reality and Visualization Research Group 
+// Virtual Reality and Visualization Research Group
 // Faculty of Media, Bauhaus-Universitaet Weimar
 // http://www.uni-weimar.de/medien/vr
 
@@ -9,98 +9,122 @@
 #define PRE_EXTERNAL_SORT_H_
 
 #include <lamure/pre/surfel_disk_array.h>
-#include <vector>
 #include <lamure/pre/logger.h>
 
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace lamure
 {
 namespace pre
 {
 
+// sorts a surfel_disk_array along one axis of the surfel positions. runs
+// are read, sorted and written back in a pipeline, afterwards they are
+// merged through a loser tree. every run is read ahead into a second
+// buffer by a background thread, the merged output is written by another
+// one, so the merge itself never waits for the disk unless it is faster.
 class PREPROCESSING_DLL external_sort
 {
 public:
 
     static void sort(surfel_disk_array &array,
                      const size_t memory_limit,
-                     const surfel::compare_function &compare);
+                     const uint8_t axis);
 
 private:
-    explicit external_sort(const size_t memory_limit,
-                           const surfel::compare_function &compare);
+    explicit external_sort(const size_t memory_limit);
     external_sort(const external_sort &) = delete;
     external_sort &operator=(const external_sort &) = delete;
 
-    class buffer
+    // single thread which executes file operations in submission order
+    class io_thread
     {
     public:
-        surfel_disk_array run;
-        surfel_vector data;
-        size_t size;
-        size_t candidate_pos;
-        size_t file_offset;
-
-        buffer(const surfel_disk_array &array, const size_t buffer_size)
-            : run(array)
-        {
-            size = buffer_size;
-            candidate_pos = size;
-            file_offset = 0;
-            data = surfel_vector(size);
-        }
-
-        bool front(surfel &s)
-        {
-            invalidate();
-            if (size > 0) {
-                s = data[candidate_pos];
-                return true;
-            }
-            else
-                return false;
-        }
-
-        void pop_front()
-        {
-            assert(size > 0);
-            candidate_pos++;
-        }
+        io_thread();
+        ~io_thread();
+
+        io_thread(const io_thread &) = delete;
+        io_thread &operator=(const io_thread &) = delete;
+
+        std::future<void> submit(const std::function<void()> &operation);
 
     private:
-        void invalidate()
-        {
-            if (size > 0 && candidate_pos >= size) {
-                if (file_offset >= run.length()) {
-                    size = 0;
-                    return;
-                }
-
-                size = std::min(size, run.length() - file_offset);
-                run.get_file()->read(&data, 0, run.offset() + file_offset, size);
-                file_offset += size;
-                candidate_pos = 0;
-            }
-        }
+        void work();
+
+        std::mutex mutex_;
+        std::condition_variable operation_ready_;
+        std::deque<std::packaged_task<void()>> operations_;
+        bool shutdown_ = false;
+
+        // started last, after the state it works on is constructed
+        std::thread thread_;
     };
 
+    // sorted run with two buffers, one is consumed by the merge while
+    // the next block of the run is read into the other one
+    class run_reader
+    {
+    public:
+        run_reader(const surfel_disk_array &run, const size_t buffer_size, io_thread &reader);
+
+        ~run_reader();
+
+        run_reader(const run_reader &) = delete;
+        run_reader &operator=(const run_reader &) = delete;
+
+        const surfel *front() const
+        { return pos_ < current_length_ ? &current_[pos_] : nullptr; }
+
+        void pop_front(io_thread &reader);
+
+    private:
+        void prefetch(io_thread &reader);
+        void advance(io_thread &reader);
+
+        surfel_disk_array run_;
+        surfel_vector current_;
+        surfel_vector next_;
+        size_t current_length_;
+        size_t next_length_;
+        size_t pos_;
+        size_t file_offset_;
+        std::future<void> pending_read_;
+    };
+
+    template <class Compare>
+    void sort_in_core(surfel_disk_array &array, const Compare &compare);
+
+    template <class Compare>
     void create_runs(surfel_disk_array &array,
                      const size_t run_length,
-                     const uint32_t runs_count);
-    void merge(surfel_disk_array &array, const size_t buffer_size);
+                     const uint32_t runs_count,
+                     const Compare &compare);
 
-    size_t memory_limit_;
+    template <class Compare>
+    void merge(surfel_disk_array &array,
+               const size_t buffer_size,
+               const Compare &compare);
+
+    template <class Compare>
+    void sort(surfel_disk_array &array, const Compare &compare);
 
-    surfel::compare_function
-        compare_;
+    size_t memory_limit_;
 
     shared_surfel_file runs_file_;
 
     std::vector<surfel_disk_array>
         runs_;
+
+    io_thread reader_;
+    io_thread writer_;
 };
 
 }
 } // namespace lamure
 
 #endif // PRE_EXTERNAL_SORT_H_
-
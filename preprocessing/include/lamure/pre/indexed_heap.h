@@ -0,0 +1,133 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_INDEXED_HEAP_H_
+#define PRE_INDEXED_HEAP_H_
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace lamure
+{
+namespace pre
+{
+
+// binary heap over the ids 0 .. capacity - 1 which remembers where each id is
+// stored, so that ids can be removed or re-sifted in O(log n) after their key
+// changed outside of the heap. has_priority(a, b) is true if a has to leave
+// the heap before b and must be a strict weak ordering; ties are left in an
+// unspecified order, so callers that need determinism break them by id.
+template <typename priority_order>
+class indexed_heap
+{
+public:
+    explicit indexed_heap(const priority_order &has_priority = priority_order())
+        : has_priority_(has_priority)
+    {}
+
+    void reset(const size_t capacity)
+    {
+        heap_.clear();
+        position_.assign(capacity, npos);
+    }
+
+    const bool empty() const { return heap_.empty(); }
+    const size_t size() const { return heap_.size(); }
+    const bool contains(const uint32_t id) const { return id < position_.size() && position_[id] != npos; }
+    const uint32_t top() const { return heap_.front(); }
+
+    void push(const uint32_t id)
+    {
+        position_[id] = uint32_t(heap_.size());
+        heap_.push_back(id);
+        sift_up(position_[id]);
+    }
+
+    uint32_t pop()
+    {
+        const uint32_t id = heap_.front();
+        remove(id);
+        return id;
+    }
+
+    void remove(const uint32_t id)
+    {
+        const uint32_t position = position_[id];
+        position_[id] = npos;
+
+        const uint32_t last = heap_.back();
+        heap_.pop_back();
+        if (position == heap_.size())
+            return;
+
+        heap_[position] = last;
+        position_[last] = position;
+        restore(position);
+    }
+
+    // has to be called whenever the key of a contained id changed
+    void update(const uint32_t id) { restore(position_[id]); }
+
+private:
+    static const uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    void restore(const uint32_t position)
+    {
+        if (position > 0 && has_priority_(heap_[position], heap_[(position - 1) / 2]))
+            sift_up(position);
+        else
+            sift_down(position);
+    }
+
+    void sift_up(uint32_t position)
+    {
+        const uint32_t id = heap_[position];
+        while (position > 0) {
+            const uint32_t parent = (position - 1) / 2;
+            if (!has_priority_(id, heap_[parent]))
+                break;
+            heap_[position] = heap_[parent];
+            position_[heap_[position]] = position;
+            position = parent;
+        }
+        heap_[position] = id;
+        position_[id] = position;
+    }
+
+    void sift_down(uint32_t position)
+    {
+        const uint32_t id = heap_[position];
+        const uint32_t size = uint32_t(heap_.size());
+        while (true) {
+            uint32_t child = 2 * position + 1;
+            if (child >= size)
+                break;
+            if (child + 1 < size && has_priority_(heap_[child + 1], heap_[child]))
+                ++child;
+            if (!has_priority_(heap_[child], id))
+                break;
+            heap_[position] = heap_[child];
+            position_[heap_[position]] = position;
+            position = child;
+        }
+        heap_[position] = id;
+        position_[id] = position;
+    }
+
+    priority_order has_priority_;
+    std::vector<uint32_t> heap_;
+    std::vector<uint32_t> position_;
+};
+
+template <typename priority_order>
+const uint32_t indexed_heap<priority_order>::npos;
+
+} // namespace pre
+} // namespace lamure
+
+#endif // PRE_INDEXED_HEAP_H_
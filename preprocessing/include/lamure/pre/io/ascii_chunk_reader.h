@@ -0,0 +1,72 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_ASCII_CHUNK_READER_H_
+#define PRE_ASCII_CHUNK_READER_H_
+
+#include <lamure/pre/platform.h>
+#include <lamure/pre/io/ascii_parser.h>
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lamure
+{
+namespace pre
+{
+
+// reads a line based ascii file in large blocks, cut at line boundaries into
+// chunks. the chunks are parsed by a pool of threads and handed to the
+// callback in file order, so the records arrive exactly as a sequential
+// reader would produce them.
+template<typename T>
+class ascii_chunk_reader
+{
+public:
+    typedef std::vector<T> record_vector;
+
+    // parses all lines in [first, last) and appends the resulting records
+    typedef std::function<void(const char *first, const char *last, record_vector &records)> chunk_parser_function;
+    // the records may be moved out of the batch, the reader does not reuse them
+    typedef std::function<void(record_vector &records)> batch_callback_function;
+
+    explicit ascii_chunk_reader(const size_t chunk_size_in_bytes = 8 * 1024 * 1024,
+                                const uint32_t num_threads = 0);
+
+    void read(const std::string &filename,
+              const chunk_parser_function &parser,
+              const batch_callback_function &callback);
+
+    const size_t bytes_read() const { return bytes_read_; }
+    const double seconds() const { return seconds_; }
+
+private:
+    struct chunk
+    {
+        std::vector<char> text_;
+        record_vector records_;
+        bool parsed_;
+        // set if the parser threw, rethrown on the calling thread
+        std::exception_ptr error_;
+    };
+
+    size_t chunk_size_;
+    uint32_t num_threads_;
+
+    size_t bytes_read_;
+    double seconds_;
+};
+
+} // namespace pre
+} // namespace lamure
+
+#include <lamure/pre/io/ascii_chunk_reader.inl>
+
+#endif // PRE_ASCII_CHUNK_READER_H_
@@ -0,0 +1,198 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <lamure/pre/logger.h>
+
+namespace lamure {
+namespace pre {
+
+template<typename T>
+ascii_chunk_reader<T>::
+ascii_chunk_reader(const size_t chunk_size_in_bytes, const uint32_t num_threads)
+    : chunk_size_(std::max<size_t>(chunk_size_in_bytes, 4096)),
+      num_threads_(num_threads),
+      bytes_read_(0),
+      seconds_(0.0)
+{
+    if (num_threads_ == 0)
+        num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+template<typename T>
+void ascii_chunk_reader<T>::
+read(const std::string &filename,
+     const chunk_parser_function &parser,
+     const batch_callback_function &callback)
+{
+    std::ifstream file_stream(filename, std::ios::in | std::ios::binary);
+
+    if (!file_stream.is_open())
+        throw std::runtime_error("Unable to open input file: " +
+            filename);
+
+    file_stream.seekg(0, std::ios::end);
+    const size_t file_size = file_stream.tellg();
+    file_stream.seekg(0, std::ios::beg);
+
+    auto start = std::chrono::steady_clock::now();
+    bytes_read_ = 0;
+
+    // chunk i lives in slot i % num_slots until it has been handed to the callback
+    const size_t num_slots = 2 * num_threads_;
+    std::vector<chunk> slots(num_slots);
+
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable parsed_cv;
+    std::deque<size_t> work;
+    bool shutdown = false;
+
+    std::vector<std::thread> threads;
+
+    // the threads are stopped and joined on every exit, an exception must not
+    // unwind past them
+    auto stop_threads = [&]
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutdown = true;
+            work.clear();
+        }
+        work_cv.notify_all();
+        for (auto &thread : threads)
+            thread.join();
+    };
+
+    try {
+        for (uint32_t thread_id = 0; thread_id < num_threads_; ++thread_id) {
+            threads.push_back(std::thread([&]
+            {
+                while (true) {
+                    size_t chunk_id;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        work_cv.wait(lock, [&] { return shutdown || !work.empty(); });
+                        if (work.empty())
+                            return;
+                        chunk_id = work.front();
+                        work.pop_front();
+                    }
+
+                    chunk &current = slots[chunk_id % num_slots];
+                    current.records_.clear();
+                    try {
+                        parser(current.text_.data(), current.text_.data() + current.text_.size(), current.records_);
+                    }
+                    catch (...) {
+                        current.error_ = std::current_exception();
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        current.parsed_ = true;
+                    }
+                    parsed_cv.notify_all();
+                }
+            }));
+        }
+
+        std::vector<char> remainder;
+        bool end_of_file = false;
+        size_t num_chunks = 0;
+        size_t next_chunk = 0;
+        size_t bytes_processed = 0;
+        uint8_t percent_processed = 0;
+
+        while (true) {
+            if (!end_of_file && num_chunks - next_chunk < num_slots) {
+                // the new chunk starts with the incomplete line left over from the previous one
+                chunk &current = slots[num_chunks % num_slots];
+                current.text_.swap(remainder);
+                remainder.clear();
+
+                while (true) {
+                    const size_t offset = current.text_.size();
+                    current.text_.resize(offset + chunk_size_);
+                    file_stream.read(current.text_.data() + offset, chunk_size_);
+                    const size_t num_bytes = file_stream.gcount();
+                    current.text_.resize(offset + num_bytes);
+                    bytes_read_ += num_bytes;
+
+                    if (num_bytes < chunk_size_) {
+                        end_of_file = true;
+                        break;
+                    }
+
+                    auto last_newline = std::find(current.text_.rbegin(), current.text_.rend() - offset, '\n');
+                    if (last_newline != current.text_.rend() - offset) {
+                        remainder.assign(last_newline.base(), current.text_.end());
+                        current.text_.erase(last_newline.base(), current.text_.end());
+                        break;
+                    }
+                }
+
+                if (!current.text_.empty()) {
+                    current.parsed_ = false;
+                    current.error_ = nullptr;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        work.push_back(num_chunks);
+                    }
+                    work_cv.notify_one();
+                    ++num_chunks;
+                }
+                continue;
+            }
+
+            if (next_chunk == num_chunks)
+                break;
+
+            chunk &current = slots[next_chunk % num_slots];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                parsed_cv.wait(lock, [&] { return current.parsed_; });
+            }
+
+            if (current.error_)
+                std::rethrow_exception(current.error_);
+            callback(current.records_);
+            bytes_processed += current.text_.size();
+            ++next_chunk;
+
+            uint8_t new_percent_processed = file_size > 0 ? (bytes_processed * 100) / file_size : 100;
+            if (new_percent_processed > percent_processed) {
+                percent_processed = new_percent_processed;
+                std::cout << "\r" << (int) percent_processed << "% processed" << std::flush;
+            }
+        }
+    }
+    catch (...) {
+        stop_threads();
+        throw;
+    }
+    stop_threads();
+
+    file_stream.close();
+
+    seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::endl;
+    LOGGER_INFO("Parsed " << bytes_read_ / 1024 / 1024 << " MB with " << num_threads_ << " threads in "
+        << seconds_ << " s (" << (seconds_ > 0.0 ? bytes_read_ / 1024.0 / 1024.0 / seconds_ : 0.0) << " MB/s)");
+}
+
+} // namespace pre
+} // namespace lamure
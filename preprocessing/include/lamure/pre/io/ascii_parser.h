@@ -0,0 +1,211 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_ASCII_PARSER_H_
+#define PRE_ASCII_PARSER_H_
+
+#include <lamure/pre/platform.h>
+#include <lamure/types.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace lamure
+{
+namespace pre
+{
+
+// locale-free parsing of whitespace separated numbers in a range of
+// characters. every parse function skips leading blanks, advances the
+// iterator behind the parsed token and returns false for malformed tokens.
+// reals with at most 19 significant digits and a decimal exponent of at most
+// 22 are converted exactly (clinger's fast path), all others fall back to
+// strtod.
+class ascii_parser
+{
+public:
+
+    static const char *skip_blanks(const char *it, const char *last)
+    {
+        while (it != last && is_blank(*it))
+            ++it;
+        return it;
+    }
+
+    // end of the line starting at it, i.e. the position of its '\n' or last
+    static const char *line_end(const char *it, const char *last)
+    {
+        while (it != last && *it != '\n')
+            ++it;
+        return it;
+    }
+
+    static const bool is_blank_line(const char *it, const char *last)
+    {
+        return skip_blanks(it, last) == last;
+    }
+
+    static bool parse_real(const char *&it, const char *last, double &value)
+    {
+        it = skip_blanks(it, last);
+        const char *start = it;
+
+        bool negative = false;
+        if (it != last && (*it == '-' || *it == '+')) {
+            negative = *it == '-';
+            ++it;
+        }
+
+        uint64_t mantissa = 0;
+        int32_t exponent = 0;
+        uint32_t num_significant_digits = 0;
+        bool has_digits = false;
+        bool is_truncated = false;
+
+        for (; it != last && is_digit(*it); ++it) {
+            has_digits = true;
+            if (num_significant_digits < 19) {
+                mantissa = mantissa * 10 + (*it - '0');
+                if (mantissa != 0)
+                    ++num_significant_digits;
+            }
+            else {
+                ++exponent;
+                is_truncated = true;
+            }
+        }
+
+        if (it != last && *it == '.') {
+            ++it;
+            for (; it != last && is_digit(*it); ++it) {
+                has_digits = true;
+                if (num_significant_digits < 19) {
+                    mantissa = mantissa * 10 + (*it - '0');
+                    if (mantissa != 0)
+                        ++num_significant_digits;
+                    --exponent;
+                }
+                else {
+                    is_truncated = true;
+                }
+            }
+        }
+
+        if (!has_digits)
+            return false;
+
+        if (it != last && (*it == 'e' || *it == 'E')) {
+            ++it;
+            bool negative_exponent = false;
+            if (it != last && (*it == '-' || *it == '+')) {
+                negative_exponent = *it == '-';
+                ++it;
+            }
+            if (it == last || !is_digit(*it))
+                return false;
+
+            int32_t decimal_exponent = 0;
+            for (; it != last && is_digit(*it); ++it) {
+                if (decimal_exponent < 100000)
+                    decimal_exponent = decimal_exponent * 10 + (*it - '0');
+            }
+            exponent += negative_exponent ? -decimal_exponent : decimal_exponent;
+        }
+
+        if (it != last && !is_blank(*it) && *it != '\n')
+            return false;
+
+        if (!is_truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+            static const double powers_of_ten[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+            value = double(mantissa);
+            value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent];
+            if (negative)
+                value = -value;
+            return true;
+        }
+
+        std::string token(start, it);
+        value = std::strtod(token.c_str(), nullptr);
+        return true;
+    }
+
+    static bool parse_real(const char *&it, const char *last, float &value)
+    {
+        double result;
+        if (!parse_real(it, last, result))
+            return false;
+        value = float(result);
+        return true;
+    }
+
+    // colors and other integers, a fractional part like in "255.0" is ignored
+    static bool parse_uint(const char *&it, const char *last, uint32_t &value)
+    {
+        it = skip_blanks(it, last);
+
+        if (it != last && *it == '+')
+            ++it;
+        if (it == last || !is_digit(*it))
+            return false;
+
+        uint64_t result = 0;
+        for (; it != last && is_digit(*it); ++it) {
+            if (result <= UINT32_MAX)
+                result = result * 10 + (*it - '0');
+        }
+
+        if (it != last && *it == '.') {
+            ++it;
+            while (it != last && is_digit(*it))
+                ++it;
+        }
+
+        if (it != last && !is_blank(*it) && *it != '\n')
+            return false;
+
+        value = result > UINT32_MAX ? UINT32_MAX : uint32_t(result);
+        return true;
+    }
+
+    // one surfel line of an xyz file, "x y z r g b". lines without color
+    // columns get a white color. format_xyz and format_xyz_prov both use it,
+    // so the surfels and their provenance records stay aligned
+    static bool parse_xyz_rgb(const char *&it, const char *last, real (&pos)[3], uint32_t (&color)[3])
+    {
+        if (!parse_real(it, last, pos[0]) ||
+            !parse_real(it, last, pos[1]) ||
+            !parse_real(it, last, pos[2]))
+            return false;
+
+        if (is_blank_line(it, last)) {
+            color[0] = color[1] = color[2] = 255;
+            return true;
+        }
+
+        return parse_uint(it, last, color[0]) &&
+               parse_uint(it, last, color[1]) &&
+               parse_uint(it, last, color[2]);
+    }
+
+private:
+
+    static bool is_digit(const char c)
+    { return c >= '0' && c <= '9'; }
+
+    static bool is_blank(const char c)
+    { return c == ' ' || c == '\t' || c == '\r' || c == ','; }
+
+};
+
+} // namespace pre
+} // namespace lamure
+
+#endif // PRE_ASCII_PARSER_H_
@@ -8,8 +8,10 @@
 #ifndef PRE_CONVERTER_H_
 #define PRE_CONVERTER_H_
 
+#include <algorithm>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
 
 #include <lamure/pre/platform.h>
 #include <lamure/pre/io/format_abstract.h>
@@ -38,7 +40,9 @@ public:
           new_radius_(0.0),
           discarded_(0)
     {
-        surfels_in_buffer_ = buffer_size / sizeof(surfel);
+        // the ring holds twice the memory of one buffer_size, as the
+        // former single buffer plus the writer's copy of it did
+        surfels_in_buffer_ = std::max<size_t>(1, 2 * buffer_size / (num_buffers * sizeof(surfel)));
     }
 
     virtual             ~converter()
@@ -76,14 +80,31 @@ public:
 
 private:
 
-    bool flush_ready_ = false;
-    bool flush_done_ = false;
+    // surfels are moved through the pipeline in a ring of preallocated
+    // buffers: reader -> transform stage -> writer -> back to the reader
+    static const size_t num_buffers = 4;
 
-    std::mutex mtx_;
-    std::condition_variable cv_;
-
-    void append_surfel(const surfel &surfel);
-    void flush_buffer();
+    // blocking fifo of surfel buffers, buffers are moved in and out
+    class buffer_queue
+    {
+    public:
+        void push(surfel_vector &&buffer);
+        // returns false once the queue is closed and drained
+        bool pop(surfel_vector &buffer);
+        void close();
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<surfel_vector> buffers_;
+        bool closed_ = false;
+    };
+
+    typedef std::function<void(const format_abstract::surfel_batch_callback_function &)> batch_producer_function;
+
+    void run_pipeline(const std::string &output_filename,
+                      const batch_producer_function &producer);
+    void transform_buffer(surfel_vector &buffer);
     const bool is_degenerate(const surfel &s) const;
 
     format_abstract &in_format_;
@@ -96,8 +117,6 @@ private:
     real scale_factor_;
     surfel_modifier_function surfel_callback_;
 
-    surfel_vector buffer_;
-
     real new_radius_;
     vec3b new_color_;
     size_t discarded_;
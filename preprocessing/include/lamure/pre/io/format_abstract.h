@@ -29,6 +29,8 @@ public:
     &)>
     surfel_callback_funtion;
     typedef std::function<bool(surfel_vector & )> buffer_callback_function;
+    // receives a whole span of surfels, the callee may take over its contents
+    typedef std::function<void(surfel_vector &)> surfel_batch_callback_function;
 
     explicit format_abstract()
         : has_normals_(false),
@@ -51,6 +53,10 @@ protected:
     virtual void read(const std::string &filename, surfel_callback_funtion callback) = 0;
     virtual void write(const std::string &filename, buffer_callback_function callback) = 0;
 
+    // the default implementation collects the surfels passed to read() into
+    // batches, formats that can decode whole spans at once override it
+    virtual void read_batches(const std::string &filename, surfel_batch_callback_function callback);
+
     bool has_normals_;
     bool has_radii_;
     bool has_color_;
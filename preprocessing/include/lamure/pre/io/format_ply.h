@@ -33,6 +33,7 @@ public:
 protected:
     virtual void read(const std::string &filename, surfel_callback_funtion callback) override;
     virtual void write(const std::string &filename, buffer_callback_function callback) override;
+    virtual void read_batches(const std::string &filename, surfel_batch_callback_function callback) override;
 
 private:
     surfel current_surfel_;
@@ -27,6 +27,7 @@ public:
 protected:
     virtual void        read(const std::string& filename, surfel_callback_funtion callback);
     virtual void        write(const std::string& filename, buffer_callback_function callback);
+    virtual void        read_batches(const std::string& filename, surfel_batch_callback_function callback);
 
 };
 
@@ -0,0 +1,96 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_IO_PLY_PLY_BINARY_READER_H_
+#define PRE_IO_PLY_PLY_BINARY_READER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <lamure/pre/surfel.h>
+
+namespace lamure
+{
+namespace pre
+{
+namespace io
+{
+namespace ply
+{
+
+// bulk reader for binary little endian ply files on little endian hosts.
+// the header is inspected once and compiled into a fixed record layout, the
+// vertex block is then decoded from a memory mapped file by several threads
+// and handed out in file order as surfel batches.
+//
+// only files whose first element is "vertex" with scalar float/double/uchar
+// properties known to format_ply are accepted, open() returns false for all
+// others so that the caller can fall back to ply_parser.
+class ply_binary_reader
+{
+public:
+    typedef std::function<void(surfel_vector &)> batch_callback_type;
+
+    explicit ply_binary_reader(const size_t vertices_per_chunk = 256 * 1024,
+                               const uint32_t num_threads = 0);
+
+    bool open(const std::string &filename);
+    void read(const batch_callback_type &callback);
+
+    const size_t num_vertices() const
+    { return num_vertices_; }
+
+private:
+    enum scalar_kind
+    {
+        float32_kind,
+        float64_kind,
+        uint8_kind
+    };
+
+    struct field
+    {
+        bool present_;
+        size_t offset_;
+        scalar_kind kind_;
+    };
+
+    struct record_layout
+    {
+        size_t stride_;
+        field position_[3];
+        field normal_[3];
+        field color_[3];
+        bool has_normal_;
+        bool has_color_;
+    };
+
+    bool parse_header(const char *data, const size_t size);
+    void decode(const char *first, const size_t count, surfel_vector &surfels) const;
+
+    size_t vertices_per_chunk_;
+    uint32_t num_threads_;
+
+    std::unique_ptr<boost::interprocess::file_mapping> file_;
+    std::unique_ptr<boost::interprocess::mapped_region> region_;
+
+    record_layout layout_;
+    size_t header_size_;
+    size_t num_vertices_;
+};
+
+} // namespace ply
+} // namespace io
+} // namespace pre
+} // namespace lamure
+
+#endif // PRE_IO_PLY_PLY_BINARY_READER_H_
@@ -0,0 +1,108 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_KNN_INDEX_H_
+#define PRE_KNN_INDEX_H_
+
+#include <lamure/pre/bvh_node.h>
+#include <lamure/pre/platform.h>
+#include <lamure/types.h>
+
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace lamure
+{
+namespace pre
+{
+
+// exact k nearest neighbour queries over all surfels of a range of in-core
+// nodes, usually one level of the bvh. the positions are copied into a
+// kd-tree with small leaf buckets once; queries are const and may run
+// concurrently as long as every thread passes its own scratch space.
+class PREPROCESSING_DLL knn_index
+{
+public:
+    typedef std::pair<surfel_id_t, real> neighbour_type;
+    typedef std::vector<neighbour_type> neighbour_vector;
+
+    // called once per surfel of a node with its neighbours
+    typedef std::function<void(const size_t surfel_idx, const neighbour_vector &neighbours)> node_query_callback;
+
+    // per-thread buffers, reused by all queries of that thread
+    struct scratch
+    {
+        neighbour_vector candidates_;
+        std::vector<std::pair<uint32_t, real>> stack_;
+    };
+
+    knn_index();
+
+    // indexes all surfels of the nodes in [first_node, end_node) and of the
+    // halo nodes. halo surfels are found as neighbours, but only the nodes of
+    // the range can be queried, see contains().
+    void build(const std::vector<bvh_node> &nodes,
+               const node_id_type first_node,
+               const node_id_type end_node,
+               const std::vector<node_id_type> &halo_nodes = std::vector<node_id_type>());
+    // indexes all surfels of the given arrays, the node_idx of a surfel id
+    // is the position of its array in the vector
+    void build(const std::vector<surfel_mem_array *> &arrays);
+    void clear();
+
+    const size_t size() const { return entries_.size(); }
+    const bool contains(const node_id_type node_id) const
+    { return !tree_.empty() && node_id >= first_node_ && node_id < end_node_; }
+
+    // nearest neighbours of a position sorted by squared distance, the surfel
+    // excluded_surfel is skipped. max_distance_sqr may bound the search if an
+    // upper bound of the k-th distance is already known.
+    void find_nearest_neighbours(const vec3r &position,
+                                 const surfel_id_t excluded_surfel,
+                                 const uint32_t num_neighbours,
+                                 neighbour_vector &result,
+                                 scratch &scratch,
+                                 const real max_distance_sqr = std::numeric_limits<real>::max()) const;
+
+    // nearest neighbours of every surfel of an indexed node in one pass. the
+    // result of a surfel bounds the search radius of the next one, which is
+    // cheap since the surfels of a node are spatially coherent.
+    void find_nearest_neighbours(const bvh_node &node,
+                                 const uint32_t num_neighbours,
+                                 scratch &scratch,
+                                 const node_query_callback &callback) const;
+
+private:
+    struct entry
+    {
+        vec3r pos_;
+        surfel_id_t id_;
+    };
+
+    struct kd_node
+    {
+        uint32_t begin_;
+        uint32_t end_;
+        uint32_t right_child_; // 0 for leaves, the left child follows its parent
+        uint8_t axis_;
+        real split_;
+    };
+
+    uint32_t build_recursive(const uint32_t begin, const uint32_t end);
+
+    std::vector<kd_node> tree_;
+    std::vector<entry> entries_;
+
+    node_id_type first_node_;
+    node_id_type end_node_;
+};
+
+} // namespace pre
+} // namespace lamure
+
+#endif // PRE_KNN_INDEX_H_
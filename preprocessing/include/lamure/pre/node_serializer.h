@@ -10,12 +10,14 @@
 
 #include <lamure/pre/platform.h>
 #include <lamure/pre/surfel.h>
+#include <lamure/pre/serialized_surfel_qz.h>
 #include <lamure/pre/bvh_node.h>
 #include <lamure/pre/logger.h>
 
 #include <fstream>
 #include <string>
 #include <deque>
+#include <vector>
 
 
 namespace lamure
@@ -25,12 +27,18 @@ namespace pre
 
 /**
 * serializes nodes to a LOD file that can be used in rendering application.
+* in quantized mode the surfels are written as serialized_surfel_qz relative
+* to the bounding box and radius range of their node. with a compression
+* level every node is written as one lod_block, the offsets of the blocks
+* have to be stored in the .bvh.
 */
 class PREPROCESSING_DLL node_serializer
 {
 public:
     explicit node_serializer(const size_t surfels_per_node,
-                             const size_t buffer_size); // buffer_size - in bytes
+                             const size_t buffer_size, // buffer_size - in bytes
+                             const bool quantize = false,
+                             const int compression_level = 0);
 
     node_serializer(const node_serializer &) = delete;
     node_serializer &operator=(const node_serializer &) = delete;
@@ -40,7 +48,14 @@ public:
     void close();
     const bool is_open() const;
 
+    const bool is_quantized() const { return quantize_; }
+    const bool is_compressed() const { return compression_level_ > 0; }
+    const size_t serialized_surfel_size() const;
+
     void serialize_nodes(const std::vector<bvh_node> &nodes);
+
+    // block i of a compressed file spans [block_offsets()[i], block_offsets()[i + 1])
+    const std::vector<uint64_t> &block_offsets() const { return block_offsets_; }
     void serialize_prov(const std::vector<bvh_node> &nodes);
 
     void read_node_immediate(surfel_vector &surfels,
@@ -48,6 +63,18 @@ public:
     void write_node_immediate(const surfel_vector &surfels,
                               const size_t offset);
 
+    // undo journal of a file opened in read_write_mode. the first time
+    // write_node_immediate overwrites a node slot, the old slot is appended
+    // to the journal. slots behind the end of the file at this call are new
+    // and not saved. the journal is closed together with the file
+    void open_journal(const std::string &journal_file_name);
+
+    // writes the saved slots back and cuts the file to its size at
+    // open_journal, the file must not be open in a serializer.
+    // throws std::runtime_error if the journal cannot be read
+    static void roll_back_journal(const std::string &file_name,
+                                  const std::string &journal_file_name);
+
 private:
 
     void write_node_streamed(const bvh_node &node);
@@ -58,7 +85,15 @@ private:
     size_t surfels_per_node_;
 
     std::deque<surfel_vector *> surfel_buffer_;
+    std::deque<serialized_surfel_qz::node_range> range_buffer_;
     size_t max_nodes_in_buffer_;
+    bool quantize_;
+    int compression_level_;
+    std::vector<uint64_t> block_offsets_;
+
+    std::fstream journal_stream_;
+    std::string journal_file_name_;
+    std::vector<bool> journaled_slots_;
 };
 
 }
@@ -29,6 +29,8 @@ public:
         number_of_neighbours_ = number_of_neighbours;
     }
 
+    // iterative reference solver, the normals are computed in closed form by
+    // normal_estimation
     void eigsrt_jacobi(
         int dim,
         double *eigenvalues,
@@ -41,6 +43,11 @@ public:
     vec3f compute_normal(const bvh &tree,
                          const surfel_id_t surfel,
                          std::vector<std::pair<surfel_id_t, real>> const &nearest_neighbours) const override;
+
+    void compute_normals(const bvh &tree,
+                         std::vector<surfel_id_t> const &surfels,
+                         std::vector<std::vector<std::pair<surfel_id_t, real>>> const &nearest_neighbours,
+                         std::vector<vec3f> &normals) const override;
 };
 
 }// namespace pre
@@ -27,6 +27,19 @@ public:
     virtual vec3f compute_normal(const bvh &tree,
                                  const surfel_id_t surfel,
                                  std::vector<std::pair<surfel_id_t, real>> const &nearest_neighbours) const = 0;
+
+    // normals for a batch of surfels, nearest_neighbours[i] belongs to surfels[i].
+    // the default implementation calls compute_normal for every surfel
+    virtual void compute_normals(const bvh &tree,
+                                 std::vector<surfel_id_t> const &surfels,
+                                 std::vector<std::vector<std::pair<surfel_id_t, real>>> const &nearest_neighbours,
+                                 std::vector<vec3f> &normals) const
+    {
+        normals.resize(surfels.size());
+        for (size_t i = 0; i < surfels.size(); ++i)
+            normals[i] = compute_normal(tree, surfels[i], nearest_neighbours[i]);
+    }
+
     uint16_t const number_of_neighbours() const
     { return number_of_neighbours_; }
 
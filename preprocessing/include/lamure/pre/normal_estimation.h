@@ -0,0 +1,73 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_NORMAL_ESTIMATION_H_
+#define PRE_NORMAL_ESTIMATION_H_
+
+#include <lamure/pre/platform.h>
+#include <lamure/types.h>
+
+#include <scm/core/math.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace lamure
+{
+namespace pre
+{
+
+// allocation free eigen decomposition of symmetric 3x3 matrices and a plane
+// fitting kernel over a batch of neighbourhoods. the neighbourhoods are
+// processed one after another, the simd lanes run over the positions of one
+// neighbourhood, not across surfels.
+class PREPROCESSING_DLL normal_estimation
+{
+public:
+
+    // neighbourhoods stored back to back in SoA form, the positions of
+    // neighbourhood i are x_[offsets_[i]] .. x_[offsets_[i + 1] - 1]
+    struct neighbourhood_batch
+    {
+        std::vector<real> x_;
+        std::vector<real> y_;
+        std::vector<real> z_;
+        std::vector<uint32_t> offsets_;
+        // the positions are accumulated relative to this point for precision
+        std::vector<vec3r> origins_;
+        // the centroid is the sum of the positions divided by this count,
+        // 0 stands for the number of positions of the neighbourhood
+        std::vector<uint32_t> centroid_counts_;
+
+        void clear();
+        void begin_neighbourhood(const vec3r &origin, const uint32_t centroid_count = 0);
+        void add_position(const vec3r &position);
+        const size_t size() const { return origins_.size(); }
+    };
+
+    // closed form solution (trigonometric eigenvalues, eigenvectors from
+    // cross products of the shifted rows) for a symmetric matrix. the
+    // eigenvalues are sorted ascending, eigenvectors[i] is the unit
+    // eigenvector of eigenvalues[i]
+    static void solve_symmetric_3x3(const scm::math::mat3d &matrix,
+                                    real eigenvalues[3],
+                                    vec3r eigenvectors[3]);
+
+    // covariance matrix (not normalized) of every neighbourhood of the batch
+    static void compute_covariances(const neighbourhood_batch &batch,
+                                    std::vector<scm::math::mat3d> &covariances);
+
+    // normal of the least squares plane through each neighbourhood, i.e. the
+    // eigenvector of the smallest eigenvalue of its covariance matrix
+    static void compute_normals(const neighbourhood_batch &batch,
+                                std::vector<vec3f> &normals);
+};
+
+} // namespace pre
+} // namespace lamure
+
+#endif // PRE_NORMAL_ESTIMATION_H_
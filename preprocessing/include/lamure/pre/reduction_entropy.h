@@ -13,9 +13,9 @@
 #include <lamure/pre/reduction_strategy.h>
 #include <lamure/pre/bvh.h>
 #include <lamure/pre/surfel.h>
+#include <lamure/pre/indexed_heap.h>
 
 #include <vector>
-#include <queue>
 
 
 namespace lamure
@@ -25,70 +25,6 @@ namespace pre
 
 class bvh;
 
-struct entropy_surfel
-{
-    uint32_t surfel_id;
-    uint32_t node_id;
-    bool validity;
-    double entropy;
-    uint16_t level;
-    std::vector<std::shared_ptr<entropy_surfel> > neighbours;
-    std::shared_ptr<surfel> contained_surfel;
-
-    entropy_surfel(surfel const &in_surfel,
-                   uint32_t const in_surfel_id,
-                   uint32_t const in_node_id,
-                   bool in_validity = true,
-                   double in_entropy = 0.0)
-        :
-        surfel_id(in_surfel_id),
-        node_id(in_node_id),
-        validity(in_validity),
-        entropy(in_entropy),
-        level(0)
-    {
-        contained_surfel = std::make_shared<surfel>(in_surfel);
-    }
-};
-
-struct min_entropy_order
-{
-    bool operator()(std::shared_ptr<entropy_surfel> const entropy_first, std::shared_ptr<entropy_surfel> const entropy_second)
-    {
-
-        // true  : first goes to the front, second to the back
-        // false : first goes to the back, first to the front
-
-        // if first is not valid, sort it to the front
-
-        bool is_rightmost = false;
-        if (entropy_first->validity == false && entropy_second->validity == true) {
-
-            is_rightmost = true;
-        }
-        else if (entropy_first->validity == true && entropy_second->validity == true) {
-            if (entropy_first->entropy > entropy_second->entropy) {
-                is_rightmost = true;
-            }
-            else if (entropy_first->entropy == entropy_second->entropy) {
-                if (entropy_first->contained_surfel->radius() > entropy_second->contained_surfel->radius()) {
-                    is_rightmost = true;
-                    // both entropies are the same, but the one with the larger radius is considered later
-                }
-            }
-        }
-
-
-        // note that, since in the end we want to discard outlier surfels with minimal size, we not only sort according to entropy,
-        // but for ambiguous cases also according to radius
-        return is_rightmost;
-    }
-};
-
-
-using shared_entropy_surfel = std::shared_ptr<entropy_surfel>;
-using shared_entropy_surfel_vector = std::vector<shared_entropy_surfel>;
-
 class PREPROCESSING_DLL reduction_entropy: public reduction_strategy
 {
 public:
@@ -101,41 +37,93 @@ public:
                                 const uint32_t surfels_per_node,
                                 const bvh &tree,
                                 const size_t start_node_id) const override;
+
+    // flat state of one create_lod call, surfels are addressed by their
+    // index in surfels_ and all per-surfel attributes are parallel arrays
+    struct entropy_state
+    {
+        std::vector<surfel> surfels_;
+        std::vector<double> entropy_;
+        std::vector<uint16_t> level_;
+        std::vector<uint8_t> validity_;
+        std::vector<std::vector<uint32_t>> neighbours_;
+
+        // surfels added as neighbours during the current merge carry its stamp
+        std::vector<uint32_t> added_stamp_;
+        uint32_t current_stamp_;
+
+        // uniform grid over the centers of the valid surfels, every surfel
+        // overlapping a target lies within target radius + max_radius_
+        vec3r grid_min_;
+        vec3r cell_size_;
+        uint32_t grid_dims_[3];
+        std::vector<std::vector<uint32_t>> cells_;
+        std::vector<uint32_t> cell_of_;
+        real max_radius_;
+    };
+
+    // invalid surfels first, then by decreasing entropy and, for equal
+    // entropy, by decreasing radius, so outliers with a small radius are
+    // discarded first. the best merge candidate is the last element.
+    struct min_entropy_order
+    {
+        const entropy_state *state_;
+        bool operator()(const uint32_t first, const uint32_t second) const;
+    };
+
 private:
 
-    void add_neighbours(shared_entropy_surfel entropy_surfel_to_add_neighbours,
-                        shared_entropy_surfel_vector const &neighbour_ptrs_to_add) const;
-
-    vec3r compute_center_of_mass(shared_surfel current_surfel_ptr,
-                                 shared_entropy_surfel_vector const &neighbour_ptrs) const;
-    real compute_enclosing_sphere_radius(vec3r const &center_of_mass,
-                                         shared_surfel current_surfel,
-                                         shared_entropy_surfel_vector const neighbour_ptrs) const;
-
-    shared_entropy_surfel_vector const
-    get_locally_overlapping_neighbours(shared_entropy_surfel target_entropy_surfel_ptr,
-                                       shared_entropy_surfel_vector &entropy_surfel_ptr_array) const;
-
-    bool
-    merge(shared_entropy_surfel current_entropy_surfel,
-          shared_entropy_surfel_vector const &complete_entropy_surfel_array,
-          size_t &num_remaining_valid_surfel, size_t num_desired_surfel) const;
-
-    void update_color(shared_surfel current_surfel_ptr, shared_entropy_surfel_vector const &neighbour_ptrs) const;
-
-    void update_entropy(shared_entropy_surfel current_en_surfel,
-                        shared_entropy_surfel_vector const neighbour_ptrs) const;
-    void update_entropy_surfel_level(shared_entropy_surfel target_surfel_ptr,
-                                     shared_entropy_surfel_vector const &invalidated_neighbours) const;
-    void update_normal(shared_surfel current_surfel_ptr,
-                       shared_entropy_surfel_vector const neighbour_ptrs) const;
-    void update_position(shared_surfel current_surfel_ptr,
-                         shared_entropy_surfel_vector const neighbour_ptrs) const;
-    void update_radius(shared_surfel current_surfel_ptr,
-                       shared_entropy_surfel_vector const neighbour_ptrs) const;
-
-    void update_surfel_attributes(shared_surfel target_surfel_ptr,
-                                  shared_entropy_surfel_vector const invalidated_neighbours) const;
+    // heap order matching the back of a list sorted by min_entropy_order,
+    // exact ties are broken by surfel index
+    struct min_entropy_priority
+    {
+        const entropy_state *state_;
+        bool operator()(const uint32_t first, const uint32_t second) const;
+    };
+
+    typedef indexed_heap<min_entropy_priority> entropy_queue;
+
+    void build_grid(entropy_state &state) const;
+    uint32_t grid_cell(const entropy_state &state, const vec3r &position) const;
+    void insert_into_grid(entropy_state &state, const uint32_t surfel_idx) const;
+    void remove_from_grid(entropy_state &state, const uint32_t surfel_idx) const;
+
+    // appends all valid surfels that overlap the target and were not added
+    // during the current merge, in the order of their index
+    void add_overlapping_neighbours(entropy_state &state,
+                                    const uint32_t target_idx,
+                                    std::vector<uint32_t> &candidates) const;
+
+    void invalidate(entropy_state &state,
+                    entropy_queue &queue,
+                    const uint32_t surfel_idx) const;
+
+    bool merge(entropy_state &state,
+               entropy_queue &queue,
+               const uint32_t target_idx,
+               size_t &num_remaining_valid_surfel,
+               size_t num_desired_surfel) const;
+
+    vec3r compute_center_of_mass(const entropy_state &state,
+                                 const surfel &target_surfel,
+                                 const std::vector<uint32_t> &neighbours) const;
+    real compute_enclosing_sphere_radius(const entropy_state &state,
+                                         vec3r const &center_of_mass,
+                                         const surfel &target_surfel,
+                                         const std::vector<uint32_t> &neighbours) const;
+
+    void update_color(const entropy_state &state, surfel &target_surfel,
+                      const std::vector<uint32_t> &neighbours) const;
+    void update_entropy(entropy_state &state, const uint32_t target_idx) const;
+    void update_normal(const entropy_state &state, surfel &target_surfel,
+                       const std::vector<uint32_t> &neighbours) const;
+    void update_position(const entropy_state &state, surfel &target_surfel,
+                         const std::vector<uint32_t> &neighbours) const;
+    void update_radius(const entropy_state &state, surfel &target_surfel,
+                       const std::vector<uint32_t> &neighbours) const;
+
+    void update_surfel_attributes(const entropy_state &state, surfel &target_surfel,
+                                  const std::vector<uint32_t> &invalidated_neighbours) const;
 
 };
 
@@ -100,10 +100,6 @@ private:
 
     vec3r transform_color(const vec3b &color) const;
 
-    void jacobi_rotation(const scm::math::mat3d &_matrix, double *eigenvalues, double **eigenvectors) const;
-
-    void eigsrt_jacobi(int dim, double *eigenvalues, double **eigenvectors) const;
-
     int color_space_mode_;
 };
 
@@ -18,6 +18,9 @@ namespace lamure
 namespace pre
 {
 
+// iteratively contracts the cheapest edge of the k nearest neighbour graph of
+// the input surfels, the cost of an edge is the distance of the merged surfel
+// to the summed tangent planes of both end points.
 class PREPROCESSING_DLL reduction_pair_contraction: public reduction_strategy
 {
 public:
@@ -35,14 +38,6 @@ private:
     uint16_t number_of_neighbours_;
 };
 
-lamure::real quadric_error(const vec3r &p, const mat4r &quadric);
-mat4r edge_quadric(const vec3f &normal_p1, const vec3r &p1, const vec3r &p2);
-
-std::vector<std::pair<surfel_id_t, real>>
-get_local_nearest_neighbours(const std::vector<surfel_mem_array *> &input,
-                             size_t num_local_neighbours,
-                             surfel_id_t const &target_surfel);
-
 } // namespace pre
 } // namespace lamure
 
@@ -42,6 +42,9 @@ public:
                                 const uint32_t surfels_per_node,
                                 const bvh &tree,
                                 const size_t start_node_id) const override;
+
+    bool uses_tree_neighbours() const override { return true; }
+
 private:
 
     real
@@ -24,6 +24,10 @@ class reduction_strategy
 
     virtual surfel_mem_array create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, const uint32_t surfels_per_node, const bvh &tree, const size_t start_node_id) const = 0;
 
+    // true if create_lod() searches neighbours through the tree, which reads
+    // other nodes of the child level than its input
+    virtual bool uses_tree_neighbours() const { return false; }
+
     void interpolate_approx_natural_neighbours(surfel &surfel_to_update, std::vector<surfel> const &input_surfels, const bvh &tree, size_t const num_nearest_neighbours = 24) const;
 };
 
@@ -36,7 +36,7 @@ class reduction_strategy_provenance : public reduction_strategy
 
     surfel_mem_array create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, const uint32_t surfels_per_node, const bvh &tree, const size_t start_node_id) const override
     {
-        return surfel_mem_array(nullptr, 0, 0);
+        return surfel_mem_array(std::shared_ptr<surfel_vector>(), 0, 0);
     }
 
     virtual surfel_mem_array create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, std::vector<LoDMetaData> &deviations, const uint32_t surfels_per_node, const bvh &tree,
@@ -0,0 +1,98 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_SERIALIZED_SURFEL_QZ_H_
+#define PRE_SERIALIZED_SURFEL_QZ_H_
+
+#include <lamure/types.h>
+#include <lamure/bounding_box.h>
+#include <lamure/pre/platform.h>
+#include <lamure/pre/surfel.h>
+#include <cstring>
+
+namespace lamure
+{
+namespace pre
+{
+
+/**
+* 12 byte surfel of a POINTCLOUD_QZ tree. the position is quantized to
+* 16 bit per axis inside the bounding box of its node, the radius to 11 bit
+* inside the radius range of its node, the color to 7 bit per channel and
+* the normal to an enumeration of 104 * 105 points on every cube face.
+* the encoding is the inverse of attribute_dequantization_functions.glsl.
+*/
+class PREPROCESSING_DLL serialized_surfel_qz /*final*/
+{
+public:
+    // per node context of the quantization, stored in the .bvh
+    struct node_range
+    {
+        node_range() = default;
+        node_range(const bounding_box &bbox,
+                   const float avg_surfel_radius,
+                   const float max_surfel_radius_deviation);
+
+        vec3f min_vertex;
+        vec3f max_vertex;
+        float min_radius;
+        float max_radius;
+    };
+
+    // radius index of surfels with a radius of zero
+    static const uint32_t INVALID_RADIUS = 0x7FF;
+
+    serialized_surfel_qz()
+    {
+        data_ = {0u, 0u, 0u, 0u, INVALID_RADIUS};
+    }
+
+    serialized_surfel_qz(const surfel &surfel, const node_range &range)
+    {
+        set_surfel(surfel, range);
+    }
+
+    static const size_t get_size()
+    { return sizeof(data); };
+
+    void set_surfel(const surfel &surfel, const node_range &range);
+
+    surfel get_surfel(const node_range &range) const;
+
+    void serialize(char *data)
+    {
+        std::memcpy(data, raw_data_, get_size());
+    }
+
+    serialized_surfel_qz &Deserialize(char *data)
+    {
+        std::memcpy(raw_data_, data, get_size());
+        return *this;
+    }
+
+private:
+
+    struct data
+    {
+        uint16_t x, y, z;
+        uint16_t normal;
+        uint32_t color777_radius11;
+    };
+
+    union
+    {
+        data data_;
+        uint8_t raw_data_[sizeof(data)];
+    };
+
+};
+
+}
+} // namespace lamure
+
+
+#endif // PRE_SERIALIZED_SURFEL_QZ_H_
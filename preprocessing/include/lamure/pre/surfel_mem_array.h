@@ -10,6 +10,7 @@
 
 #include <lamure/pre/array_abstract.h>
 #include <lamure/pre/surfel.h>
+#include <lamure/pre/surfel_soa.h>
 #include <lamure/pre/prov.h>
 
 namespace lamure
@@ -63,7 +64,10 @@ public:
                               const size_t length)
         : array_abstract<surfel>(), has_provenance_(other.has_provenance_)
     {
-      if (has_provenance_) { 
+      if (other.is_compact()) {
+        reset(other.soa_mem_data_, offset, length);
+      }
+      else if (has_provenance_) { 
         reset(other.surfel_mem_data_, other.prov_mem_data_, offset, length);
       }
       else {
@@ -85,11 +89,22 @@ public:
         : array_abstract<surfel>(), has_provenance_(true)
     { reset(surfel_mem_data, prov_mem_data, offset, length); }
 
+    explicit surfel_mem_array(const std::shared_ptr<surfel_soa> &soa_mem_data,
+                              const size_t offset,
+                              const size_t length)
+        : array_abstract<surfel>(), has_provenance_(false)
+    { reset(soa_mem_data, offset, length); }
+
 
     surfel read_surfel(const size_t index) const override;
-    surfel const &read_surfel_ref(const size_t index) const;
     void write_surfel(const surfel &surfel, const size_t index) const override;
 
+    // position of a surfel, reads only the position streams of compact storage
+    vec3r position(const size_t index) const;
+
+    // only for surfel_vector storage, compact storage has no surfel to refer to
+    surfel const &read_surfel_ref(const size_t index) const;
+
     prov read_prov(const size_t index) const;
     prov const &read_prov_ref(const size_t index) const;
     void write_prov(const prov &surfel, const size_t index) const;
@@ -100,6 +115,15 @@ public:
     std::shared_ptr<std::vector<prov>> & prov_mem_data() { return prov_mem_data_; }
     const std::shared_ptr<std::vector<prov>> & prov_mem_data() const { return prov_mem_data_; }
 
+    std::shared_ptr<surfel_soa> & soa_mem_data() { return soa_mem_data_; }
+    const std::shared_ptr<surfel_soa> & soa_mem_data() const { return soa_mem_data_; }
+
+    // the surfels are kept in surfel_soa instead of surfel_mem_data
+    bool is_compact() const { return soa_mem_data_ != nullptr; }
+
+    // copies the surfels of the range into a new surfel_vector
+    std::shared_ptr<std::vector<surfel>> copy_surfels() const;
+
     void get(std::vector<surfel_ext>& data);
     void set(std::vector<surfel_ext>& data);
 
@@ -118,12 +142,17 @@ public:
                const size_t offset,
                const size_t length);
 
+    void reset(const std::shared_ptr<surfel_soa> &soa_mem_data,
+               const size_t offset,
+               const size_t length);
+
     bool has_provenance() const { return has_provenance_; }
 
 protected:
 
     std::shared_ptr<std::vector<surfel>> surfel_mem_data_;
     std::shared_ptr<std::vector<prov>> prov_mem_data_;
+    std::shared_ptr<surfel_soa> soa_mem_data_;
 
     bool has_provenance_;
 
@@ -0,0 +1,74 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_SURFEL_SOA_H_
+#define PRE_SURFEL_SOA_H_
+
+#include <lamure/pre/platform.h>
+#include <lamure/pre/surfel.h>
+
+#include <vector>
+
+namespace lamure
+{
+namespace pre
+{
+
+// compact in-core surfel storage with one stream per attribute. positions
+// are stored as float offsets to origin and radii as float, like in the
+// serialized format. a position p is read back with an error of at most
+// |p - origin| * 2^-24 per axis, a radius with a relative error of at most
+// 2^-24, so origin should be the center of the subtree built from it.
+//
+// surfel_mem_array reads and writes this storage through read_surfel and
+// position, see surfel_mem_array::is_compact.
+class PREPROCESSING_DLL surfel_soa
+{
+public:
+    static const size_t bytes_per_surfel = 4 * sizeof(float) + sizeof(vec3f) + sizeof(vec3b);
+
+    explicit surfel_soa(const vec3r &origin = vec3r(0.0))
+        : origin_(origin) {}
+
+    const vec3r &origin() const { return origin_; }
+    const size_t size() const { return radius_.size(); }
+
+    void reserve(const size_t size);
+    void clear();
+
+    // translation is added to the positions before they are stored
+    void append(const surfel_vector &surfels, const size_t offset, const size_t length,
+                const vec3r &translation = vec3r(0.0));
+
+    surfel read_surfel(const size_t index) const;
+    void write_surfel(const surfel &surfel, const size_t index);
+
+    vec3r position(const size_t index) const
+    { return origin_ + vec3r(pos_[0][index], pos_[1][index], pos_[2][index]); }
+
+    // offsets to origin along one axis
+    const std::vector<float> &coordinates(const uint8_t axis) const { return pos_[axis]; }
+
+    // reorders the surfels first .. first + order.size() - 1 so that
+    // surfel first + i is the former surfel first + order[i]
+    void permute(const size_t first, const std::vector<uint32_t> &order);
+
+private:
+    template <typename T>
+    static void permute_stream(std::vector<T> &stream, const size_t first, const std::vector<uint32_t> &order);
+
+    vec3r origin_;
+    std::vector<float> pos_[3];
+    std::vector<float> radius_;
+    std::vector<vec3f> normal_;
+    std::vector<vec3b> color_;
+};
+
+} // namespace pre
+} // namespace lamure
+
+#endif // PRE_SURFEL_SOA_H_
@@ -0,0 +1,82 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_TASK_SCHEDULER_H_
+#define PRE_TASK_SCHEDULER_H_
+
+#include <lamure/pre/platform.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lamure
+{
+namespace pre
+{
+
+// persistent pool of worker threads which executes a graph of tasks. a task
+// becomes ready as soon as all tasks it depends on have finished, ready tasks
+// are executed in the order they became ready. tasks may be added while
+// earlier ones are already running, wait() blocks until the whole graph is
+// done and then starts a new, empty graph.
+class PREPROCESSING_DLL task_scheduler
+{
+  public:
+    using task_id = uint32_t;
+    using task_function = std::function<void()>;
+
+    // 0 uses one thread per hardware thread
+    explicit task_scheduler(const uint32_t num_threads = 0);
+    ~task_scheduler();
+
+    task_scheduler(const task_scheduler &other) = delete;
+    task_scheduler &operator=(const task_scheduler &other) = delete;
+
+    uint32_t num_threads() const { return uint32_t(workers_.size()); }
+
+    // dependencies have to be ids returned by add_task since the last wait()
+    task_id add_task(const task_function &function, const std::vector<task_id> &dependencies = std::vector<task_id>());
+
+    // blocks until all added tasks are finished. once a task threw, the
+    // remaining tasks are skipped and the first exception is rethrown here
+    void wait();
+
+  private:
+    struct task
+    {
+        task_function function_;
+        uint32_t num_open_dependencies_;
+        bool finished_;
+        std::vector<task_id> dependents_;
+    };
+
+    void work();
+    void finish(const task_id id, std::unique_lock<std::mutex> &lock);
+
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::condition_variable graph_finished_;
+
+    std::vector<task> tasks_;
+    std::deque<task_id> ready_tasks_;
+    size_t num_finished_tasks_ = 0;
+    std::exception_ptr exception_;
+    bool shutdown_ = false;
+};
+
+} // namespace pre
+} // namespace lamure
+
+#endif // PRE_TASK_SCHEDULER_H_
@@ -16,7 +16,9 @@
   #include <parallel/algorithm>
 #endif
 
+#include <algorithm>
 #include <cstring>
+#include <stdexcept>
 
 namespace lamure {
 namespace pre 
@@ -29,9 +31,20 @@ compute_aabb(const surfel_mem_array& sa,
     assert(!sa.is_empty());
     assert(sa.length() > 0);
 
-    vec3r min = sa.read_surfel_ref(0).pos();
+    vec3r min = sa.position(0);
     vec3r max = min;
 
+    if (sa.is_compact()) {
+        for (size_t i = 1; i < sa.length(); ++i) {
+            const vec3r pos = sa.position(i);
+            for (uint8_t axis = 0; axis < 3; ++axis) {
+                if (pos[axis] < min[axis]) min[axis] = pos[axis];
+                if (pos[axis] > max[axis]) max[axis] = pos[axis];
+            }
+        }
+        return bounding_box(min, max);
+    }
+
     const auto begin = sa.surfel_mem_data()->begin() + sa.offset();
     const auto end = sa.surfel_mem_data()->begin() + sa.offset() + sa.length();
 
@@ -167,6 +180,15 @@ translate_surfels(surfel_mem_array& sa,
     assert(!sa.is_empty());
     assert(sa.length() > 0);
 
+    if (sa.is_compact()) {
+        for (size_t i = 0; i < sa.length(); ++i) {
+            surfel s = sa.read_surfel(i);
+            s.pos() += translation;
+            sa.write_surfel(s, i);
+        }
+        return;
+    }
+
     const auto begin = sa.surfel_mem_data()->begin() + sa.offset();
     const auto end = sa.surfel_mem_data()->begin() + sa.offset() + sa.length();
 
@@ -212,7 +234,37 @@ sort_and_split(surfel_mem_array& sa,
     assert(!sa.is_empty());
     assert(sa.length() > 0);
 
-  if (sa.has_provenance()) {
+  if (sa.is_compact()) {
+
+    // sorts the offsets along the split axis with the surfel order and
+    // permutes the attribute streams once, ties keep their order
+    const std::vector<float>& keys = sa.soa_mem_data()->coordinates(split_axis);
+
+    std::vector<std::pair<float, uint32_t>> sorted_keys(sa.length());
+    for (uint32_t i = 0; i < sa.length(); ++i) {
+      sorted_keys[i] = std::make_pair(keys[sa.offset() + i], i);
+    }
+
+    if (parallelize) {
+#if WIN32
+      Concurrency::parallel_sort(sorted_keys.begin(), sorted_keys.end());
+#else
+      __gnu_parallel::sort(sorted_keys.begin(), sorted_keys.end());
+#endif
+    }
+    else {
+      std::sort(sorted_keys.begin(), sorted_keys.end());
+    }
+
+    std::vector<uint32_t> order(sa.length());
+    for (uint32_t i = 0; i < sa.length(); ++i) {
+      order[i] = sorted_keys[i].second;
+    }
+    std::vector<std::pair<float, uint32_t>>().swap(sorted_keys);
+
+    sa.soa_mem_data()->permute(sa.offset(), order);
+  }
+  else if (sa.has_provenance()) {
 
     std::vector<surfel_ext> array;
     sa.get(array);
@@ -261,7 +313,6 @@ sort_and_split(surfel_mem_array& sa,
   split_surfel_array<surfel_mem_array>(sa, out, box, split_axis, fan_factor);
 }
 
-/*
 void basic_algorithms::
 sort_and_split(surfel_disk_array& sa,
              splitted_array<surfel_disk_array>& out,
@@ -270,10 +321,119 @@ sort_and_split(surfel_disk_array& sa,
              const uint8_t fan_factor,
              const size_t memory_limit)
 {
-    external_sort::sort(sa, memory_limit, surfel::compare(split_axis));
+    assert(!sa.is_empty());
+    assert(sa.length() > 0);
+
+    if (sa.has_provenance()) {
+        throw std::runtime_error("out-of-core sort_and_split to implement for PROVENANCE");
+    }
+
+    external_sort::sort(sa, memory_limit, split_axis);
     split_surfel_array<surfel_disk_array>(sa, out, box, split_axis, fan_factor);
 }
-*/
+
+namespace
+{
+
+// spreads the lower 21 bits of value so that two zero bits follow each bit
+uint64_t spread_bits(uint64_t value)
+{
+    value &= 0x1fffff;
+    value = (value | value << 32) & 0x1f00000000ffffull;
+    value = (value | value << 16) & 0x1f0000ff0000ffull;
+    value = (value | value << 8) & 0x100f00f00f00f00full;
+    value = (value | value << 4) & 0x10c30c30c30c30c3ull;
+    value = (value | value << 2) & 0x1249249249249249ull;
+    return value;
+}
+
+}
+
+uint64_t basic_algorithms::
+compute_morton_key(const vec3r& pos,
+                   const bounding_box& box)
+{
+    const real max_cell = real((1u << 21) - 1);
+
+    // cubic cells, so the curve does not favour the flat axes of a box
+    const vec3r extents = box.max() - box.min();
+    const real extent = std::max(extents.x, std::max(extents.y, extents.z));
+
+    uint64_t key = 0;
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        real cell = 0.0;
+        if (extent > 0.0) {
+            cell = (pos[axis] - box.min()[axis]) / extent * max_cell;
+            cell = std::min(std::max(cell, real(0.0)), max_cell);
+        }
+        key |= spread_bits(uint64_t(cell)) << (2 - axis);
+    }
+    return key;
+}
+
+void basic_algorithms::
+radix_sort(std::vector<morton_entry>& entries)
+{
+    const size_t radix_bits = 8;
+    const size_t radix = size_t(1) << radix_bits;
+    const size_t num_blocks = 64;
+
+    const size_t length = entries.size();
+    const size_t block_length = (length + num_blocks - 1) / num_blocks;
+    if (length < 2) {
+        return;
+    }
+
+    std::vector<morton_entry> buffer(length);
+    std::vector<size_t> offsets(num_blocks * radix);
+
+    for (size_t shift = 0; shift < 64; shift += radix_bits) {
+        // histogram per block
+        std::fill(offsets.begin(), offsets.end(), 0);
+#pragma omp parallel for
+        for (int64_t block = 0; block < int64_t(num_blocks); ++block) {
+            const size_t first = std::min(length, block * block_length);
+            const size_t last = std::min(length, first + block_length);
+            size_t *histogram = &offsets[block * radix];
+            for (size_t i = first; i < last; ++i) {
+                ++histogram[(entries[i].key >> shift) & (radix - 1)];
+            }
+        }
+
+        // a digit which is the same for all entries does not change the order
+        const size_t first_digit = (entries.front().key >> shift) & (radix - 1);
+        size_t num_first_digit = 0;
+        for (size_t block = 0; block < num_blocks; ++block) {
+            num_first_digit += offsets[block * radix + first_digit];
+        }
+        if (num_first_digit == length) {
+            continue;
+        }
+
+        // exclusive prefix sum over digits first, then blocks, so every
+        // block scatters into its own stable range of each bucket
+        size_t sum = 0;
+        for (size_t digit = 0; digit < radix; ++digit) {
+            for (size_t block = 0; block < num_blocks; ++block) {
+                const size_t count = offsets[block * radix + digit];
+                offsets[block * radix + digit] = sum;
+                sum += count;
+            }
+        }
+
+#pragma omp parallel for
+        for (int64_t block = 0; block < int64_t(num_blocks); ++block) {
+            const size_t first = std::min(length, block * block_length);
+            const size_t last = std::min(length, first + block_length);
+            size_t *destination = &offsets[block * radix];
+            for (size_t i = first; i < last; ++i) {
+                buffer[destination[(entries[i].key >> shift) & (radix - 1)]++] = entries[i];
+            }
+        }
+
+        entries.swap(buffer);
+    }
+}
 
 template <class T>
 void basic_algorithms::
@@ -357,7 +517,7 @@ compute_properties(const surfel_mem_array& sa,
     float min_radius = std::numeric_limits<float>::max();
 
     for (size_t i = 0; i < sa.length(); ++i) {
-        surfel s = sa.read_surfel_ref(i);
+        surfel s = sa.read_surfel(i);
         
         props.bbox.expand_by_disk(s.pos(), s.normal(), s.radius());
 
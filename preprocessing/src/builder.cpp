@@ -39,6 +39,7 @@
 #endif
 #include <cstdio>
 #include <fstream>
+#include <stdexcept>
 
 
 #define CPU_TIMER auto_timer timer("CPU time: %ws wall, usr+sys = %ts CPU (%p%)\n")
@@ -195,7 +196,8 @@ boost::filesystem::path builder::downsweep(boost::filesystem::path input_file, u
         bvh.init_tree(input_file.string(),
                       desc_.max_fan_factor,
                       desc_.surfels_per_node,
-                      base_path_);
+                      base_path_,
+                      desc_.leaf_fill_factor);
 
         bvh.print_tree_properties();
         std::cout << std::endl;
@@ -206,7 +208,7 @@ boost::filesystem::path builder::downsweep(boost::filesystem::path input_file, u
         LOGGER_TRACE("downsweep stage");
 
         CPU_TIMER;
-        bvh.downsweep(desc_.translate_to_origin, input_file.string(), desc_.prov_file);
+        bvh.downsweep(desc_.translate_to_origin, input_file.string(), desc_.prov_file, desc_.downsweep_algo);
 
         auto bvhd_file = add_to_path(base_path_, ".bvhd");
 
@@ -375,9 +377,10 @@ bool builder::reserialize(boost::filesystem::path const &input_file, uint16_t st
     }
 
     CPU_TIMER;
-    auto lod_file = add_to_path(base_path_, ".lod");
+    // quantized output uses the file names of the point_cloud_compression_app
+    auto lod_file = add_to_path(base_path_, desc_.quantize_output ? ".lodqz" : ".lod");
     auto prov_file = add_to_path(base_path_, ".prov");
-    auto kdn_file = add_to_path(base_path_, ".bvh");
+    auto kdn_file = add_to_path(base_path_, desc_.quantize_output ? ".bvhqz" : ".bvh");
     auto json_file = add_to_path(base_path_, ".json");
 
     if (bvh.nodes()[0].has_provenance()) {
@@ -386,10 +389,11 @@ bool builder::reserialize(boost::filesystem::path const &input_file, uint16_t st
     }
 
     std::cout << "serialize surfels to file" << std::endl;
-    bvh.serialize_surfels_to_file(lod_file.string(), prov_file.string(), desc_.buffer_size);
+    auto lod_block_offsets = bvh.serialize_surfels_to_file(lod_file.string(), prov_file.string(), desc_.buffer_size,
+                                                           desc_.quantize_output, desc_.compression_level);
 
     std::cout << "serialize bvh to file" << std::endl << std::endl;
-    bvh.serialize_tree_to_file(kdn_file.string(), false);
+    bvh.serialize_tree_to_file(kdn_file.string(), false, desc_.quantize_output, lod_block_offsets);
 
     if ((!desc_.keep_intermediate_files) && (start_stage < 3)) {
         std::remove(input_file.string().c_str());
@@ -408,15 +412,16 @@ size_t builder::calculate_memory_limit() const
     LOGGER_INFO("Memory budget: " << desc_.memory_budget << " GiB (use -m to choose memory budget in GiB)");
     if (get_total_memory() <= memory_budget) {
         LOGGER_ERROR("Not enough memory. Go buy more RAM");
-        return false;
+        return 0;
     }
     LOGGER_INFO("Precision for storing coordinates and radii: " << std::string((sizeof(real) == 8) ? "double" : "single"));
-    return desc_.memory_budget;
+    return memory_budget;
 }
 
 bool builder::resample()
 {
     memory_limit_ = calculate_memory_limit();
+    if (memory_limit_ == 0) return false;
 
     auto input_file = fs::canonical(fs::path(desc_.input_file));
     const std::string input_file_type = input_file.extension().string();
@@ -455,10 +460,93 @@ bool builder::resample()
     return resample_success;
 }
 
+bool builder::insert()
+{
+    memory_limit_ = calculate_memory_limit();
+    if (memory_limit_ == 0) return false;
+
+    auto input_file = fs::canonical(fs::path(desc_.input_file));
+    const std::string input_file_type = input_file.extension().string();
+
+    if (input_file_type == ".xyz" ||
+        input_file_type == ".ply" ||
+        input_file_type == ".xyz_grey" ||
+        input_file_type == ".bin")
+        desc_.compute_normals_and_radii = true;
+
+    bool is_converted = false;
+    if (input_file_type == ".xyz" ||
+        input_file_type == ".xyz_all" ||
+        input_file_type == ".xyz_grey" ||
+        input_file_type == ".xyz_bin" ||
+        input_file_type == ".ply") {
+        input_file = convert_to_binary(desc_.input_file, input_file_type);
+        if (input_file.empty()) return false;
+        is_converted = true;
+    }
+    else if (input_file_type != ".bin" && input_file_type != ".bin_all") {
+        LOGGER_ERROR("Unknown input file format");
+        return false;
+    }
+
+    std::cout << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+    std::cout << "insert" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+    LOGGER_TRACE("insert stage");
+
+    auto bvh_file = fs::canonical(fs::path(desc_.insert_into));
+    lamure::pre::bvh bvh(memory_limit_, desc_.buffer_size, desc_.rep_radius_algo);
+
+    if (!bvh.load_tree(bvh_file.string())) {
+        return false;
+    }
+
+    if (bvh.state() != bvh::state_type::serialized) {
+        LOGGER_ERROR("Wrong processing state!");
+        return false;
+    }
+
+    // only the plain .lod layout can be updated node by node
+    if (bvh.lod_quantized() || bvh.lod_compressed()) {
+        LOGGER_ERROR("Insertion into quantized or compressed trees is not supported");
+        return false;
+    }
+    if (fs::exists(add_to_path(bvh.base_path(), ".prov"))) {
+        LOGGER_ERROR("Insertion into trees with provenance data is not supported");
+        return false;
+    }
+
+    std::unique_ptr<reduction_strategy> reduction_strategy{get_reduction_strategy(desc_.reduction_algo)};
+    std::unique_ptr<normal_computation_strategy> normal_comp_strategy{get_normal_strategy(desc_.normal_computation_algo)};
+    std::unique_ptr<radius_computation_strategy> radius_comp_strategy{get_radius_strategy(desc_.radius_computation_algo)};
+
+    // writes the .lod and .bvh, on failure both stay as they were
+    try {
+        CPU_TIMER;
+        bvh.insert(input_file.string(),
+                   *reduction_strategy,
+                   *normal_comp_strategy,
+                   *radius_comp_strategy,
+                   desc_.compute_normals_and_radii,
+                   desc_.insert_grow_tree);
+    }
+    catch (const std::runtime_error &e) {
+        LOGGER_ERROR("Insertion failed, the tree is unchanged: " << e.what());
+        return false;
+    }
+
+    if (is_converted && !desc_.keep_intermediate_files) {
+        std::remove(input_file.string().c_str());
+    }
+    return true;
+}
+
 bool builder::
 construct()
 {
     memory_limit_ = calculate_memory_limit();
+    if (memory_limit_ == 0) return false;
 
     uint16_t start_stage = 0;
     uint16_t final_stage = desc_.final_stage;
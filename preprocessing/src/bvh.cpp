@@ -25,6 +25,7 @@
 #include <lamure/pre/normal_computation_plane_fitting.h>
 #include <lamure/pre/radius_computation_average_distance.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <limits>
@@ -32,6 +33,7 @@
 #include <math.h>
 #include <memory>
 #include <set>
+#include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
 #include <thread>
@@ -70,11 +72,13 @@ struct nni_sample_t
     scm::math::vec2f uv_;
 };
 
-void bvh::init_tree(const std::string &surfels_input_file, const uint32_t max_fan_factor, const size_t desired_surfels_per_node, const boost::filesystem::path &base_path)
+void bvh::init_tree(const std::string &surfels_input_file, const uint32_t max_fan_factor, const size_t desired_surfels_per_node, const boost::filesystem::path &base_path,
+                    const float leaf_fill_factor)
 {
     assert(state_ == state_type::null);
     assert(max_fan_factor >= 2);
     assert(desired_surfels_per_node >= 5);
+    assert(leaf_fill_factor > 0.f && leaf_fill_factor <= 1.f);
 
     base_path_ = base_path;
 
@@ -84,13 +88,15 @@ void bvh::init_tree(const std::string &surfels_input_file, const uint32_t max_fa
     size_t num_surfels = input.get_size();
     input.close();
 
-    // compute bvh properties
+    // compute bvh properties, the nodes are sized so that the leaves hold
+    // leaf_fill_factor of their capacity
+    const size_t num_filled_leaves = size_t(num_surfels / (desired_surfels_per_node * double(leaf_fill_factor)));
     size_t best = std::numeric_limits<size_t>::max();
     for(size_t i = 2; i <= max_fan_factor; ++i)
     {
-        size_t depth = std::round(std::log(num_surfels / desired_surfels_per_node) / std::log(i));
+        size_t depth = std::round(std::log(num_filled_leaves) / std::log(i));
         size_t num_leaves = std::round(std::exp(depth * std::log(i)));
-        int64_t temp_max_surfels_per_node = std::ceil(double(num_surfels) / double(num_leaves));
+        int64_t temp_max_surfels_per_node = std::ceil(double(num_surfels) / (double(num_leaves) * leaf_fill_factor));
 
         size_t diff = std::abs(int64_t(desired_surfels_per_node) - temp_max_surfels_per_node);
 
@@ -124,6 +130,11 @@ bool bvh::load_tree(const std::string &kdn_input_file)
     bvh_stream bvh_strm;
     bvh_strm.read_bvh(kdn_input_file, *this);
 
+    if(state_ == state_type::serialized)
+    {
+        roll_back_insertion();
+    }
+
     LOGGER_INFO("Load bvh: \"" << kdn_input_file << "\". state_type: " << state_to_string(state_));
     return true;
 }
@@ -194,12 +205,11 @@ void bvh::print_tree_properties() const
 void bvh::downsweep(
     bool adjust_translation, 
     const std::string &surfels_input_file, 
-    const std::string &prov_input_file)
+    const std::string &prov_input_file,
+    const downsweep_algorithm downsweep_algo)
 {
     assert(state_ == state_type::empty);
 
-    size_t in_core_surfel_capacity = memory_limit_ / sizeof(surfel);
-
     size_t disk_leaf_destination = 0, slice_left = 0, slice_right = 0;
 
     LOGGER_INFO("Build bvh for \"" << surfels_input_file << "\"");
@@ -237,22 +247,68 @@ void bvh::downsweep(
 
     LOGGER_INFO("Total number of surfels: " << input.length());
 
+    // subtrees without provenance are built in compact storage, which needs
+    // the sorted keys and one permuted attribute stream as scratch space.
+    // with provenance the in-core sort needs a scratch buffer of the same size
+    const bool compact_in_core = !input.has_provenance();
+    size_t bytes_per_surfel = surfel_soa::bytes_per_surfel + sizeof(std::pair<float, uint32_t>) + sizeof(uint32_t) + sizeof(vec3f);
+    if (!compact_in_core) {
+        bytes_per_surfel = 2 * sizeof(surfel) + 2 * sizeof(prov);
+    }
+    size_t in_core_surfel_capacity = std::max(size_t(1), memory_limit_ / bytes_per_surfel);
+
     // compute depth at which we can switch to in-core
-    uint32_t final_depth = std::max(0.0, std::ceil(std::log(input.length() / double(in_core_surfel_capacity)) / std::log(double(fan_factor_))));
+    uint32_t final_depth = 0;
+    for (size_t subtree_size = input.length(); subtree_size > in_core_surfel_capacity && final_depth < depth_; ++final_depth) {
+        subtree_size = (subtree_size + fan_factor_ - 1) / fan_factor_;
+    }
+
+    if (final_depth != 0 && input.has_provenance()) {
+        LOGGER_ERROR("The dataset does not fit in the specified memory budget and out-of-core downsweep is not supported for provenance data. Use flag -m and choose more gigabytes");
+        final_depth = 0;
+    }
 
-    assert(final_depth <= depth_);
-    if (final_depth != 0) {
-      LOGGER_ERROR("The dataset does not fit in the specified memory budget. Use flag -m and choose more gigabytes");
+    // the morton order needs the keys of all surfels and the scratch space
+    // of the radix sort in memory, the surfels themselves are gathered from disk
+    bool morton_order = false;
+    if (downsweep_algo == downsweep_algorithm::morton) {
+        const size_t morton_bytes = 2 * sizeof(basic_algorithms::morton_entry) * input.length();
+        if (input.has_provenance()) {
+            LOGGER_WARN("Morton order downsweep is not supported for provenance data, falling back to split");
+        }
+        else if (morton_bytes > memory_limit_ || input.length() > std::numeric_limits<uint32_t>::max()) {
+            LOGGER_WARN("Morton order downsweep needs " << morton_bytes << " bytes of the memory budget, falling back to split");
+        }
+        else {
+            morton_order = true;
+            final_depth = 0;
+        }
     }
 
-    //LOGGER_INFO("Tree depth to switch in-core: " << final_depth);
+    LOGGER_INFO("Tree depth to switch in-core: " << final_depth);
+
+    // the out-of-core levels are translated, sorted and split in place, so
+    // they work on a copy of the input inside the working directory
+    bool is_working_copy = false;
+    if(final_depth != 0)
+    {
+        boost::filesystem::path working_file = add_to_path(base_path_, ".bin_ooc");
+        LOGGER_TRACE("Copy input to working file: \"" << working_file.string() << "\"");
+
+        input_file_disk_access->close();
+        boost::filesystem::copy_file(surfels_input_file, working_file, boost::filesystem::copy_option::overwrite_if_exists);
+        input_file_disk_access->open(working_file.string());
+        input = surfel_disk_array(input_file_disk_access, 0, input_file_disk_access->get_size());
+        is_working_copy = true;
+    }
 
     // construct root node
     nodes_[0] = bvh_node(0, 0, bounding_box(), input);
     bounding_box input_bb;
 
-    // check if the root can be switched to in-core
-    if(final_depth == 0)
+    // check if the root can be switched to in-core, compact subtrees are
+    // loaded from disk once the bounding box and the translation are known
+    if(final_depth == 0 && !compact_in_core)
     {
         LOGGER_TRACE("Compute root bounding box in-core");
         nodes_[0].load_from_disk();
@@ -260,8 +316,8 @@ void bvh::downsweep(
     }
     else
     {
-        LOGGER_ERROR("Compute root bounding box out-of-core NOT SUPPORTED");
-        //input_bb = basic_algorithms::compute_aabb(nodes_[0].disk_array(), buffer_size_);
+        LOGGER_TRACE("Compute root bounding box out-of-core");
+        input_bb = basic_algorithms::compute_aabb(nodes_[0].disk_array(), buffer_size_);
     }
     LOGGER_TRACE("Root AABB: " << input_bb.min() << " - " << input_bb.max());
 
@@ -279,11 +335,11 @@ void bvh::downsweep(
         input_bb.min() -= translation;
         input_bb.max() -= translation;
 
-        if(final_depth == 0)
+        if(final_depth == 0 && !compact_in_core)
         {
             basic_algorithms::translate_surfels(nodes_[0].mem_array(), -translation);
         }
-        else
+        else if(final_depth != 0)
         {
             basic_algorithms::translate_surfels(nodes_[0].disk_array(), -translation, buffer_size_);
         }
@@ -301,10 +357,8 @@ void bvh::downsweep(
     uint32_t processed_nodes = 0;
     uint8_t percent_processed = 0;
 
-    if (final_depth != 0) {
-        LOGGER_ERROR("out-of-core NOT SUPPORTED");
-    }
-    /*
+    // the upper levels are sorted and split in place inside the working copy,
+    // so no node above final_depth ever holds its surfels in memory
     for(uint32_t level = 0; level < final_depth; ++level)
     {
         LOGGER_TRACE("Process out-of-core level: " << level);
@@ -337,7 +391,7 @@ void bvh::downsweep(
 
             // percent counter
             ++processed_nodes;
-            uint8_t new_percent_processed = (uint8_t)((float)(processed_nodes / first_leaf_ * 100));
+            uint8_t new_percent_processed = (uint8_t)(float(processed_nodes) / first_leaf_ * 100);
             if(percent_processed != new_percent_processed)
             {
                 percent_processed = new_percent_processed;
@@ -349,25 +403,41 @@ void bvh::downsweep(
         slice_left = new_slice_left;
         slice_right = new_slice_right;
     }
-*/
+
     // construct next level in-core
     for(size_t nid = slice_left; nid <= slice_right; ++nid)
     {
+        if(morton_order)
+        {
+            LOGGER_TRACE("Build bvh in morton order");
+            downsweep_morton(-translation_, disk_leaf_destination, leaf_level_access);
+            continue;
+        }
+
         bvh_node &current_node = nodes_[nid];
 
+        if(compact_in_core)
+        {
+            // the root is still untranslated on disk if it was not split out-of-core
+            vec3r translation_on_load = (final_depth == 0) ? -translation_ : vec3r(0.0);
+
+            assert(current_node.is_out_of_core());
+            current_node.load_from_disk_compact(buffer_size_, translation_on_load);
+        }
         // make sure that current node is out-of-core and switch to in-core (unless root node)
-        if(nid > 0)
+        else if(nid > 0)
         {
             assert(current_node.is_out_of_core());
             current_node.load_from_disk();
         }
         LOGGER_TRACE("Process subbvh in-core at node " << nid);
-        // process subbvh and save leafs
+        // process subbvh and save leafs; the leaves are flushed with
+        // dealloc_mem_array set, so the subtree is released before the next one is loaded
         downsweep_subtree_in_core(current_node, disk_leaf_destination, processed_nodes, percent_processed, leaf_level_access, prov_leaf_level_access);
     }
     // std::cout << std::endl << std::endl;
 
-    input_file_disk_access->close();
+    input_file_disk_access->close(is_working_copy);
     if (prov_file_disk_access && prov_file_disk_access->is_open()) {
         prov_file_disk_access->close();
     }
@@ -420,29 +490,193 @@ void bvh::downsweep_subtree_in_core(const bvh_node &node, size_t &disk_leaf_dest
     }
 }
 
+void bvh::downsweep_morton(const vec3r &translation_on_load, size_t &disk_leaf_destination, shared_surfel_file leaf_level_access)
+{
+    bvh_node &root = nodes_[0];
+    assert(root.is_out_of_core());
+
+    const surfel_disk_array input = root.disk_array();
+    const bounding_box &root_box = root.get_bounding_box();
+    const size_t num_surfels = input.length();
+    const size_t buffer_length = std::max(size_t(1), buffer_size_ / sizeof(surfel));
+    surfel_vector buffer(std::min(buffer_length, num_surfels));
+
+    LOGGER_TRACE("Compute morton keys");
+    std::vector<basic_algorithms::morton_entry> entries(num_surfels);
+    for(size_t first = 0; first < num_surfels; first += buffer.size())
+    {
+        size_t length = std::min(buffer.size(), num_surfels - first);
+        input.get_file()->read(&buffer, 0, input.offset() + first, length);
+#pragma omp parallel for
+        for(int64_t i = 0; i < int64_t(length); ++i)
+        {
+            entries[first + i].key = basic_algorithms::compute_morton_key(buffer[i].pos() + translation_on_load, root_box);
+            entries[first + i].index = uint32_t(first + i);
+        }
+    }
+
+    LOGGER_TRACE("Radix sort morton keys");
+    basic_algorithms::radix_sort(entries);
+
+    std::vector<uint32_t> ranks(num_surfels);
+    for(size_t rank = 0; rank < num_surfels; ++rank)
+    {
+        ranks[entries[rank].index] = uint32_t(rank);
+    }
+    std::vector<basic_algorithms::morton_entry>().swap(entries);
+
+    // the leaf level is the input in morton order. it is gathered in as few
+    // sequential passes over the input as the memory budget allows
+    LOGGER_TRACE("Gather surfels in morton order");
+    const size_t reserved_bytes = ranks.size() * sizeof(uint32_t) + buffer.size() * sizeof(surfel);
+    size_t gather_length = (memory_limit_ - std::min(memory_limit_, reserved_bytes)) / sizeof(surfel);
+    gather_length = std::min(num_surfels, std::max(size_t(1), gather_length));
+    {
+        surfel_vector sorted(gather_length);
+        for(size_t first_rank = 0; first_rank < num_surfels; first_rank += gather_length)
+        {
+            const size_t last_rank = std::min(num_surfels, first_rank + gather_length);
+            for(size_t first = 0; first < num_surfels; first += buffer.size())
+            {
+                size_t length = std::min(buffer.size(), num_surfels - first);
+                input.get_file()->read(&buffer, 0, input.offset() + first, length);
+#pragma omp parallel for
+                for(int64_t i = 0; i < int64_t(length); ++i)
+                {
+                    const size_t rank = ranks[first + i];
+                    if(rank >= first_rank && rank < last_rank)
+                    {
+                        sorted[rank - first_rank] = buffer[i];
+                        sorted[rank - first_rank].pos() += translation_on_load;
+                    }
+                }
+            }
+            leaf_level_access->write(&sorted, 0, disk_leaf_destination + first_rank, last_rank - first_rank);
+        }
+    }
+    std::vector<uint32_t>().swap(ranks);
+    surfel_vector().swap(buffer);
+    root.reset();
+
+    // node ranges follow the same balanced split as sort_and_split, the
+    // first length % fan_factor children get one surfel more
+    std::vector<std::pair<size_t, size_t>> ranges(nodes_.size());
+    ranges[0] = std::make_pair(disk_leaf_destination, num_surfels);
+    for(node_id_type nid = 0; nid < first_leaf_; ++nid)
+    {
+        size_t child_first = ranges[nid].first;
+        const size_t child_size = ranges[nid].second / fan_factor_;
+        size_t remainder = ranges[nid].second % fan_factor_;
+        for(uint32_t i = 0; i < fan_factor_; ++i)
+        {
+            size_t child_length = child_size;
+            if(remainder > 0)
+            {
+                ++child_length;
+                --remainder;
+            }
+            ranges[get_child_id(nid, i)] = std::make_pair(child_first, child_length);
+            child_first += child_length;
+        }
+    }
+    disk_leaf_destination += num_surfels;
+
+    LOGGER_TRACE("Compute node properties for leaves");
+    for(node_id_type nid = first_leaf_; nid < nodes_.size(); ++nid)
+    {
+        scheduler_.add_task([=, &ranges, &leaf_level_access] {
+            surfel_disk_array leaf_array(leaf_level_access, ranges[nid].first, ranges[nid].second);
+            surfel_mem_array leaf_surfels(leaf_array.read_all(), 0, ranges[nid].second);
+            auto props = basic_algorithms::compute_properties(leaf_surfels, rep_radius_algo_, false);
+
+            bvh_node &current_node = nodes_[nid];
+            current_node = bvh_node(nid, depth_, props.bbox, leaf_array);
+            current_node.set_avg_surfel_radius(props.rep_radius);
+            current_node.set_centroid(props.centroid);
+            current_node.set_max_surfel_radius_deviation(props.max_radius_deviation);
+        });
+    }
+    scheduler_.wait();
+
+    // inner nodes hold no surfels after the downsweep, their boxes enclose the children
+    for(node_id_type nid = first_leaf_; nid-- > 0;)
+    {
+        bounding_box box;
+        for(uint32_t i = 0; i < fan_factor_; ++i)
+        {
+            box.expand(nodes_[get_child_id(nid, i)].get_bounding_box());
+        }
+        nodes_[nid] = bvh_node(nid, get_depth_of_node(nid), box);
+    }
+}
+
 void bvh::compute_normal_and_radius(const bvh_node *source_node, const normal_computation_strategy &normal_computation_strategy, const radius_computation_strategy &radius_computation_strategy)
 {
-    for(size_t k = 0; k < max_surfels_per_node_; ++k)
+    compute_normal_and_radius(source_node, normal_computation_strategy, radius_computation_strategy, level_index_);
+}
+
+void bvh::compute_normal_and_radius(const bvh_node *source_node, const normal_computation_strategy &normal_computation_strategy, const radius_computation_strategy &radius_computation_strategy,
+                                    const knn_index &index)
+{
+    uint16_t num_nearest_neighbours_to_search = std::max(radius_computation_strategy.number_of_neighbours(), normal_computation_strategy.number_of_neighbours());
+
+    // normals are estimated for blocks of surfels at once
+    const size_t block_size = 64;
+    std::vector<surfel_id_t> block_surfels;
+    std::vector<std::vector<std::pair<surfel_id_t, real>>> block_neighbours(block_size);
+    std::vector<vec3f> block_normals;
+
+    auto flush_block = [&]()
     {
-        if(k < source_node->mem_array().length())
+        normal_computation_strategy.compute_normals(*this, block_surfels, block_neighbours, block_normals);
+
+        for(size_t i = 0; i < block_surfels.size(); ++i)
         {
+            size_t k = block_surfels[i].surfel_idx;
+
             // read surfel
             surfel surf = source_node->mem_array().read_surfel(k);
 
-            uint16_t num_nearest_neighbours_to_search = std::max(radius_computation_strategy.number_of_neighbours(), normal_computation_strategy.number_of_neighbours());
-
-            auto const &max_nearest_neighbours = get_nearest_neighbours(surfel_id_t(source_node->node_id(), k), num_nearest_neighbours_to_search);
             // compute radius
-            real radius = radius_computation_strategy.compute_radius(*this, surfel_id_t(source_node->node_id(), k), max_nearest_neighbours);
-
-            // compute normal
-            vec3f normal = normal_computation_strategy.compute_normal(*this, surfel_id_t(source_node->node_id(), k), max_nearest_neighbours);
+            real radius = radius_computation_strategy.compute_radius(*this, block_surfels[i], block_neighbours[i]);
 
             // write surfel
             surf.radius() = radius;
-            surf.normal() = normal;
+            surf.normal() = block_normals[i];
             source_node->mem_array().write_surfel(surf, k);
         }
+
+        block_surfels.clear();
+    };
+
+    auto add_surfel = [&](size_t k, std::vector<std::pair<surfel_id_t, real>> const &max_nearest_neighbours)
+    {
+        block_neighbours[block_surfels.size()] = max_nearest_neighbours;
+        block_surfels.emplace_back(source_node->node_id(), k);
+
+        if(block_surfels.size() == block_size)
+        {
+            flush_block();
+        }
+    };
+
+    if(index.contains(source_node->node_id()))
+    {
+        knn_index::scratch scratch;
+        index.find_nearest_neighbours(*source_node, num_nearest_neighbours_to_search, scratch, add_surfel);
+    }
+    else
+    {
+        for(size_t k = 0; k < source_node->mem_array().length(); ++k)
+        {
+            add_surfel(k, get_nearest_neighbours(surfel_id_t(source_node->node_id(), k), num_nearest_neighbours_to_search));
+        }
+    }
+
+    if(!block_surfels.empty())
+    {
+        block_neighbours.resize(block_surfels.size());
+        flush_block();
     }
 }
 
@@ -488,7 +722,7 @@ std::vector<std::pair<surfel_id_t, real>> bvh::get_nearest_neighbours(surfel_id_
 {
     node_id_type current_node = target_surfel.node_idx;
     std::unordered_set<size_t> processed_nodes;
-    vec3r center = nodes_[target_surfel.node_idx].mem_array().read_surfel_ref(target_surfel.surfel_idx).pos();
+    vec3r center = nodes_[target_surfel.node_idx].mem_array().position(target_surfel.surfel_idx);
 
     std::vector<std::pair<surfel_id_t, real>> candidates;
     real max_candidate_distance = std::numeric_limits<real>::max();
@@ -498,7 +732,7 @@ std::vector<std::pair<surfel_id_t, real>> bvh::get_nearest_neighbours(surfel_id_
     {
         if(i != target_surfel.surfel_idx)
         {
-            surfel const& current_surfel = nodes_[current_node].mem_array().read_surfel_ref(i);
+            surfel const current_surfel = nodes_[current_node].mem_array().read_surfel(i);
             real distance_to_center = scm::math::length_sqr(center - current_surfel.pos());
 
             if(candidates.size() < number_of_neighbours || (distance_to_center < max_candidate_distance))
@@ -553,7 +787,7 @@ std::vector<std::pair<surfel_id_t, real>> bvh::get_nearest_neighbours(surfel_id_
                 {
                     if(!(adjacent_node == target_surfel.node_idx && i == target_surfel.surfel_idx))
                     {
-                        const surfel &current_surfel = nodes_[adjacent_node].mem_array().read_surfel_ref(i);
+                        const surfel current_surfel = nodes_[adjacent_node].mem_array().read_surfel(i);
                         real distance_to_center = scm::math::length_sqr(center - current_surfel.pos());
 
                         if(candidates.size() < number_of_neighbours || (distance_to_center < max_candidate_distance))
@@ -593,7 +827,7 @@ std::vector<std::pair<surfel_id_t, real>> bvh::get_nearest_neighbours_in_nodes(c
                                                                                const uint32_t number_of_neighbours) const
 {
     node_id_type current_node = target_surfel.node_idx;
-    vec3r center = nodes_[target_surfel.node_idx].mem_array().read_surfel_ref(target_surfel.surfel_idx).pos();
+    vec3r center = nodes_[target_surfel.node_idx].mem_array().position(target_surfel.surfel_idx);
 
     std::vector<std::pair<surfel_id_t, real>> candidates;
     real max_candidate_distance = std::numeric_limits<real>::infinity();
@@ -603,7 +837,7 @@ std::vector<std::pair<surfel_id_t, real>> bvh::get_nearest_neighbours_in_nodes(c
     {
         if(i != target_surfel.surfel_idx)
         {
-            const surfel &current_surfel = nodes_[current_node].mem_array().read_surfel_ref(i);
+            const surfel current_surfel = nodes_[current_node].mem_array().read_surfel(i);
             real distance_to_center = scm::math::length_sqr(center - current_surfel.pos());
 
             if(candidates.size() < number_of_neighbours || (distance_to_center < max_candidate_distance))
@@ -642,7 +876,7 @@ std::vector<std::pair<surfel_id_t, real>> bvh::get_nearest_neighbours_in_nodes(c
                 {
                     if(!(adjacent_node == target_surfel.node_idx && i == target_surfel.surfel_idx))
                     {
-                        const surfel &current_surfel = nodes_[adjacent_node].mem_array().read_surfel_ref(i);
+                        const surfel current_surfel = nodes_[adjacent_node].mem_array().read_surfel(i);
                         real distance_to_center = scm::math::length_sqr(center - current_surfel.pos());
 
                         if(candidates.size() < number_of_neighbours || (distance_to_center < max_candidate_distance))
@@ -687,11 +921,11 @@ std::vector<std::pair<surfel_id_t, real>> bvh::get_natural_neighbours(surfel_id_
     std::size_t point_num = 0;
     for(auto const &near_neighbour : nearest_neighbours)
     {
-        nn_positions[point_num] = nodes_[near_neighbour.first.node_idx].mem_array().read_surfel_ref(near_neighbour.first.surfel_idx).pos();
+        nn_positions[point_num] = nodes_[near_neighbour.first.node_idx].mem_array().position(near_neighbour.first.surfel_idx);
         ++point_num;
     }
 
-    auto natural_neighbour_ids = extract_approximate_natural_neighbours(nodes_[target_surfel.node_idx].mem_array().read_surfel_ref(target_surfel.surfel_idx).pos(), nn_positions);
+    auto natural_neighbour_ids = extract_approximate_natural_neighbours(nodes_[target_surfel.node_idx].mem_array().position(target_surfel.surfel_idx), nn_positions);
 
     std::vector<std::pair<surfel_id_t, real>> natural_neighbours{};
     natural_neighbours.reserve(NUM_NATURAL_NEIGHBOURS);
@@ -834,61 +1068,40 @@ std::vector<std::pair<surfel, real>> bvh::get_locally_natural_neighbours(std::ve
     return nni_weight_pairs;
 }
 
-void bvh::spawn_create_lod_jobs(const uint32_t first_node_of_level, const uint32_t last_node_of_level, const reduction_strategy &reduction_strgy, const bool resample)
-{
-    uint32_t const num_threads = std::thread::hardware_concurrency();
-
-    working_queue_head_counter_.initialize(first_node_of_level); // let the threads fetch a node idx
-    std::vector<std::thread> threads;
-
-    for(uint32_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
-    {
-        bool update_percentage = (0 == thread_idx);
-        threads.push_back(std::thread(&bvh::thread_create_lod, this, first_node_of_level, last_node_of_level, update_percentage, std::cref(reduction_strgy), resample));
-    }
-
-    for(auto &thread : threads)
-    {
-        thread.join();
-    }
-}
-
 void bvh::spawn_compute_attribute_jobs(const uint32_t first_node_of_level, const uint32_t last_node_of_level, const normal_computation_strategy &normal_strategy,
                                        const radius_computation_strategy &radius_strategy, const bool is_leaf_level)
 {
-    uint32_t const num_threads = std::thread::hardware_concurrency();
+    // all nodes of the level are in core here, the neighbourhood queries of
+    // every surfel are answered by one index over the whole level
+    level_index_.build(nodes_, first_node_of_level, last_node_of_level);
+
+    uint32_t const num_threads = scheduler_.num_threads();
     working_queue_head_counter_.initialize(first_node_of_level); // let the threads fetch a node idx
-    std::vector<std::thread> threads;
 
     for(uint32_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
     {
         bool update_percentage = (0 == thread_idx);
-        threads.push_back(
-            std::thread(&bvh::thread_compute_attributes, this, first_node_of_level, last_node_of_level, update_percentage, std::cref(normal_strategy), std::cref(radius_strategy), is_leaf_level));
+        scheduler_.add_task(
+            std::bind(&bvh::thread_compute_attributes, this, first_node_of_level, last_node_of_level, update_percentage, std::cref(normal_strategy), std::cref(radius_strategy), is_leaf_level));
     }
 
-    for(auto &thread : threads)
-    {
-        thread.join();
-    }
+    scheduler_.wait();
+
+    level_index_.clear();
 }
 
 void bvh::spawn_compute_bounding_boxes_downsweep_jobs(const uint32_t slice_left, const uint32_t slice_right)
 {
-    uint32_t const num_threads = std::thread::hardware_concurrency();
+    uint32_t const num_threads = scheduler_.num_threads();
     working_queue_head_counter_.initialize(0); // let the threads fetch a local thread idx
-    std::vector<std::thread> threads;
 
     for(uint32_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
     {
         bool update_percentage = (0 == thread_idx);
-        threads.push_back(std::thread(&bvh::thread_compute_bounding_boxes_downsweep, this, slice_left, slice_right, update_percentage, num_threads));
+        scheduler_.add_task(std::bind(&bvh::thread_compute_bounding_boxes_downsweep, this, slice_left, slice_right, update_percentage, num_threads));
     }
 
-    for(auto &thread : threads)
-    {
-        thread.join();
-    }
+    scheduler_.wait();
 }
 
 void bvh::resample_based_on_overlap(surfel_mem_array const &joined_input, surfel_mem_array &output_mem_array, std::vector<surfel_id_t> const &resample_candidates) const
@@ -988,20 +1201,21 @@ std::vector<surfel_id_t> bvh::find_resample_candidates(const uint32_t node_idx)
     const uint16_t num_neighbours = 10;
     std::vector<surfel_id_t> surfel_id_vector;
 
-    for(size_t surfel_idx = 0; surfel_idx < node_mem_data->size(); ++surfel_idx)
+    // the candidates are searched among the surfels of the node only
+    knn_index node_index;
+    node_index.build(nodes_, node_idx, node_idx + 1);
+
+    knn_index::scratch scratch;
+    node_index.find_nearest_neighbours(nodes_.at(node_idx), num_neighbours, scratch,
+        [&](size_t surfel_idx, std::vector<std::pair<surfel_id_t, real>> const &nearest_neighbour_vector)
     {
-        std::vector<std::pair<surfel_id_t, real>> const nearest_neighbour_vector = get_nearest_neighbours(surfel_id_t(node_idx, surfel_idx), num_neighbours, true);
         int overlap_counter = 0;
 
         real current_radius = node_mem_data->at(surfel_idx).radius();
-        // vec3r current_position = node_mem_data->at(surfel_idx).pos();
-        for(int i = 0; i < num_neighbours; ++i)
+        for(auto const &nearest_neighbour : nearest_neighbour_vector)
         {
-            // surfel_id_t current_neighbour_id = nearest_neighbour_vector[i].first;
-            real squared_current_distance = nearest_neighbour_vector[i].second;
+            real squared_current_distance = nearest_neighbour.second;
 
-            // real computed_distance = scm::math::length(current_position - node_mem_data->at(current_neighbour_id.surfel_idx).pos());
-            // real neighbour_rad = node_mem_data->at(current_neighbour_id.surfel_idx).radius();
             if(std::sqrt(squared_current_distance) * 1.6 - current_radius < 0)
             {
                 ++overlap_counter;
@@ -1014,135 +1228,105 @@ std::vector<surfel_id_t> bvh::find_resample_candidates(const uint32_t node_idx)
         {
             surfel_id_vector.push_back(surfel_id_t(node_idx, surfel_idx));
         }
-    }
+    });
 
     return surfel_id_vector;
 }
 
-void bvh::spawn_compute_bounding_boxes_upsweep_jobs(const uint32_t first_node_of_level, const uint32_t last_node_of_level, const int32_t level)
-{
-    uint32_t const num_threads = std::thread::hardware_concurrency();
-    working_queue_head_counter_.initialize(0); // let the threads fetch a local thread idx
-    std::vector<std::thread> threads;
-
-    for(uint32_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
-    {
-        bool update_percentage = (0 == thread_idx);
-        threads.push_back(std::thread(&bvh::thread_compute_bounding_boxes_upsweep, this, first_node_of_level, last_node_of_level, update_percentage, level, num_threads));
-    }
-
-    for(auto &thread : threads)
-    {
-        thread.join();
-    }
-}
-
 void bvh::spawn_split_node_jobs(size_t &slice_left, size_t &slice_right, size_t &new_slice_left, size_t &new_slice_right, const uint32_t level)
 {
-    uint32_t const num_threads = std::thread::hardware_concurrency();
+    uint32_t const num_threads = scheduler_.num_threads();
     working_queue_head_counter_.initialize(0); // let the threads fetch a local thread idx
-    std::vector<std::thread> threads;
 
     for(uint32_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
     {
         bool update_percentage = (0 == thread_idx);
-        threads.push_back(
-            std::thread(&bvh::thread_split_node_jobs, this, std::ref(slice_left), std::ref(slice_right), std::ref(new_slice_left), std::ref(new_slice_right), update_percentage, level, num_threads));
+        scheduler_.add_task(
+            std::bind(&bvh::thread_split_node_jobs, this, std::ref(slice_left), std::ref(slice_right), std::ref(new_slice_left), std::ref(new_slice_right), update_percentage, level, num_threads));
     }
 
-    for(auto &thread : threads)
-    {
-        thread.join();
-    }
+    scheduler_.wait();
 }
 
-void bvh::thread_create_lod(const uint32_t start_marker, const uint32_t end_marker, const bool update_percentage, const reduction_strategy &reduction_strgy, const bool do_resample)
+void bvh::create_lod(const uint32_t node_index, const reduction_strategy &reduction_strgy, const bool do_resample)
 {
-    uint32_t node_index = working_queue_head_counter_.increment_head();
-
-    while(node_index < end_marker)
+    bvh_node *current_node = &nodes_.at(node_index);
+    // If a node has no data yet, calculate it based on child nodes.
+    if(!current_node->is_in_core() && !current_node->is_out_of_core())
     {
-        bvh_node *current_node = &nodes_.at(node_index);
-        // If a node has no data yet, calculate it based on child nodes.
-        if(!current_node->is_in_core() && !current_node->is_out_of_core())
-        {
-            std::vector<surfel_mem_array> resampled_arrays;
-            std::vector<surfel_mem_array *> input_mem_arrays;
+        std::vector<surfel_mem_array> resampled_arrays;
+        std::vector<surfel_mem_array *> input_mem_arrays;
 
-            // simplified data will be stored here
-            surfel_mem_array reduction_result = surfel_mem_array(std::make_shared<surfel_vector>(surfel_vector()), 0, 0);
+        // simplified data will be stored here
+        surfel_mem_array reduction_result = surfel_mem_array(std::make_shared<surfel_vector>(surfel_vector()), 0, 0);
 
-            if(do_resample)
-            {
-                if (current_node->has_provenance()) {
-                    throw std::runtime_error("resampling not supported for PROVENANCE");
-                }
-                for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
-                {
-                    size_t child_id = this->get_child_id(current_node->node_id(), child_index);
-                    resampled_arrays.push_back(resample_node(child_id));
-                }
-                for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
-                {
-                    input_mem_arrays.push_back(&resampled_arrays[child_index]);
-                }
+        if(do_resample)
+        {
+            if (current_node->has_provenance()) {
+                throw std::runtime_error("resampling not supported for PROVENANCE");
             }
-            else
+            for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
             {
-                bool child_has_provenance = false;
-                for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
-                {
-                    size_t child_id = this->get_child_id(current_node->node_id(), child_index);
-                    bvh_node *child_node = &nodes_.at(child_id);
-
-                    input_mem_arrays.push_back(&child_node->mem_array());
-                    child_has_provenance = child_node->has_provenance();
-                }                
-                if (child_has_provenance) {
-                    reduction_result = surfel_mem_array(
-                        std::make_shared<surfel_vector>(surfel_vector()),
-                        std::make_shared<prov_vector>(prov_vector()), 0, 0);
-                }
+                size_t child_id = this->get_child_id(current_node->node_id(), child_index);
+                resampled_arrays.push_back(resample_node(child_id));
             }
-
-            real reduction_error;
-
-            reduction_strategy *p_reduction_strgy = (reduction_strategy *)&reduction_strgy;
-            if(reduction_strategy_provenance *cast = dynamic_cast<reduction_strategy_provenance *>(p_reduction_strgy))
+            for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
             {
-                std::vector<reduction_strategy_provenance::LoDMetaData> deviations;
-                reduction_result = cast->create_lod(reduction_error, input_mem_arrays, deviations, max_surfels_per_node_, (*this), get_child_id(current_node->node_id(), 0));
-                //cast->output_lod(deviations, node_index);
+                input_mem_arrays.push_back(&resampled_arrays[child_index]);
             }
-            else
+        }
+        else
+        {
+            bool child_has_provenance = false;
+            for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
             {
-                if (reduction_result.has_provenance()) {
-                    std::cout << "ERROR: Only reduction_strategy_provenance supported for PROVENANCE" << std::endl;
-                    throw std::runtime_error("Only reduction_strategy_provenance supported for PROVENANCE");
-                }
-                reduction_result = reduction_strgy.create_lod(reduction_error, input_mem_arrays, max_surfels_per_node_, (*this), get_child_id(current_node->node_id(), 0));
-            }
+                size_t child_id = this->get_child_id(current_node->node_id(), child_index);
+                bvh_node *child_node = &nodes_.at(child_id);
 
-            current_node->reset(reduction_result);
-            current_node->set_reduction_error(reduction_error);
+                input_mem_arrays.push_back(&child_node->mem_array());
+                child_has_provenance = child_node->has_provenance();
+            }                
+            if (child_has_provenance) {
+                reduction_result = surfel_mem_array(
+                    std::make_shared<surfel_vector>(surfel_vector()),
+                    std::make_shared<prov_vector>(prov_vector()), 0, 0);
+            }
+        }
 
-            // Unload all child nodes, if not in leaf level
-            if(get_depth_of_node(current_node->node_id()) != depth())
-            {
-                for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
-                {
-                    size_t child_id = get_child_id(current_node->node_id(), child_index);
-                    bvh_node &child_node = nodes_.at(child_id);
+        real reduction_error;
 
-                    if(child_node.is_in_core())
-                    {
-                        child_node.mem_array().reset();
-                    }
-                }
+        reduction_strategy *p_reduction_strgy = (reduction_strategy *)&reduction_strgy;
+        if(reduction_strategy_provenance *cast = dynamic_cast<reduction_strategy_provenance *>(p_reduction_strgy))
+        {
+            std::vector<reduction_strategy_provenance::LoDMetaData> deviations;
+            reduction_result = cast->create_lod(reduction_error, input_mem_arrays, deviations, max_surfels_per_node_, (*this), get_child_id(current_node->node_id(), 0));
+            //cast->output_lod(deviations, node_index);
+        }
+        else
+        {
+            if (reduction_result.has_provenance()) {
+                std::cout << "ERROR: Only reduction_strategy_provenance supported for PROVENANCE" << std::endl;
+                throw std::runtime_error("Only reduction_strategy_provenance supported for PROVENANCE");
             }
+            reduction_result = reduction_strgy.create_lod(reduction_error, input_mem_arrays, max_surfels_per_node_, (*this), get_child_id(current_node->node_id(), 0));
         }
 
-        node_index = working_queue_head_counter_.increment_head();
+        current_node->reset(reduction_result);
+        current_node->set_reduction_error(reduction_error);
+    }
+}
+
+void bvh::unload_children(const uint32_t node_index)
+{
+    for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
+    {
+        size_t child_id = get_child_id(node_index, child_index);
+        bvh_node &child_node = nodes_.at(child_id);
+
+        if(child_node.is_in_core())
+        {
+            child_node.mem_array().reset();
+        }
     }
 }
 
@@ -1199,20 +1383,7 @@ void bvh::thread_compute_attributes(const uint32_t start_marker, const uint32_t
 
     while(node_index < end_marker)
     {
-        bvh_node *current_node = &nodes_.at(node_index);
-
-        // Calculate and set node properties.
-        if(is_leaf_level)
-        {
-            uint16_t number_of_neighbours = 100;
-            auto normal_comp_algo = normal_computation_plane_fitting(number_of_neighbours);
-            auto radius_comp_algo = radius_computation_average_distance(number_of_neighbours, 1.0f);
-            compute_normal_and_radius(current_node, normal_comp_algo, radius_comp_algo);
-        }
-        else
-        {
-            compute_normal_and_radius(current_node, normal_strategy, radius_strategy);
-        }
+        compute_attributes(node_index, normal_strategy, radius_strategy, is_leaf_level, level_index_);
 
         if(update_percentage)
         {
@@ -1227,6 +1398,25 @@ void bvh::thread_compute_attributes(const uint32_t start_marker, const uint32_t
     }
 };
 
+void bvh::compute_attributes(const uint32_t node_index, const normal_computation_strategy &normal_strategy, const radius_computation_strategy &radius_strategy, const bool is_leaf_level,
+                             const knn_index &index)
+{
+    bvh_node *current_node = &nodes_.at(node_index);
+
+    // Calculate and set node properties.
+    if(is_leaf_level)
+    {
+        uint16_t number_of_neighbours = 100;
+        auto normal_comp_algo = normal_computation_plane_fitting(number_of_neighbours);
+        auto radius_comp_algo = radius_computation_average_distance(number_of_neighbours, 1.0f);
+        compute_normal_and_radius(current_node, normal_comp_algo, radius_comp_algo, index);
+    }
+    else
+    {
+        compute_normal_and_radius(current_node, normal_strategy, radius_strategy, index);
+    }
+}
+
 void bvh::thread_compute_bounding_boxes_downsweep(const uint32_t slice_left, const uint32_t slice_right, const bool update_percentage, const uint32_t num_threads)
 {
     uint32_t thread_idx = working_queue_head_counter_.increment_head();
@@ -1254,70 +1444,53 @@ void bvh::thread_compute_bounding_boxes_downsweep(const uint32_t slice_left, con
     }
 }
 
-void bvh::thread_compute_bounding_boxes_upsweep(const uint32_t start_marker, const uint32_t end_marker, const bool update_percentage, const int32_t level, const uint32_t num_threads)
+void bvh::compute_bounding_box_upsweep(const uint32_t node_index, const int32_t level)
 {
-    uint32_t thread_idx = working_queue_head_counter_.increment_head();
-
-    uint32_t total_num_nodes = (end_marker - start_marker) + 1;
-    uint32_t num_nodes_per_thread = std::ceil(float(total_num_nodes) / num_threads);
-
-    uint32_t local_start_index = start_marker + thread_idx * num_nodes_per_thread;
-    uint32_t local_end_index = start_marker + (thread_idx + 1) * num_nodes_per_thread;
-
-    for(uint32_t node_index = local_start_index; node_index < local_end_index; ++node_index)
-    {
-        // early termination if number of nodes could not be evenly divided
-        if(node_index >= end_marker)
-        {
-            break;
-        }
+    bvh_node *current_node = &nodes_.at(node_index);
 
-        bvh_node *current_node = &nodes_.at(node_index);
-
-        basic_algorithms::surfel_group_properties props = basic_algorithms::compute_properties(current_node->mem_array(), rep_radius_algo_);
+    basic_algorithms::surfel_group_properties props = basic_algorithms::compute_properties(current_node->mem_array(), rep_radius_algo_);
 
-        current_node->set_max_surfel_radius_deviation(props.max_radius_deviation);
+    current_node->set_max_surfel_radius_deviation(props.max_radius_deviation);
 
-        bounding_box node_bounding_box;
-        node_bounding_box.expand(props.bbox);
+    bounding_box node_bounding_box;
+    node_bounding_box.expand(props.bbox);
 
-        if(level < int32_t(depth_))
+    if(level < int32_t(depth_))
+    {
+        for(int32_t child_index = 0; child_index < fan_factor_; ++child_index)
         {
-            for(int32_t child_index = 0; child_index < fan_factor_; ++child_index)
-            {
-                uint32_t child_id = this->get_child_id(current_node->node_id(), child_index);
-                bvh_node *child_node = &nodes_.at(child_id);
+            uint32_t child_id = this->get_child_id(current_node->node_id(), child_index);
+            bvh_node *child_node = &nodes_.at(child_id);
 
-                node_bounding_box.expand(child_node->get_bounding_box());
-            }
+            node_bounding_box.expand(child_node->get_bounding_box());
         }
+    }
 
-        current_node->set_avg_surfel_radius(props.rep_radius);
-        current_node->set_centroid(props.centroid);
+    current_node->set_avg_surfel_radius(props.rep_radius);
+    current_node->set_centroid(props.centroid);
 
-        current_node->set_bounding_box(node_bounding_box);
-        current_node->calculate_statistics();
+    current_node->set_bounding_box(node_bounding_box);
+    current_node->calculate_statistics();
 
-        if (node_index == 0) {
-            std::cout << "min: " << node_bounding_box.min() << std::endl;
-            std::cout << "max: " << node_bounding_box.max() << std::endl;
-        }
+    if (node_index == 0) {
+        std::cout << "min: " << node_bounding_box.min() << std::endl;
+        std::cout << "max: " << node_bounding_box.max() << std::endl;
     }
 }
 
 void bvh::thread_remove_outlier_jobs(const uint32_t start_marker, const uint32_t end_marker, const uint32_t num_outliers, const uint16_t num_neighbours,
                                      std::vector<std::pair<surfel_id_t, real>> &intermediate_outliers_for_thread)
 {
+    knn_index::scratch scratch;
     uint32_t node_idx = working_queue_head_counter_.increment_head();
 
     while(node_idx < end_marker)
     {
         bvh_node *current_node = &nodes_.at(node_idx);
 
-        for(size_t surfel_idx = 0; surfel_idx < current_node->mem_array().length(); ++surfel_idx)
+        level_index_.find_nearest_neighbours(*current_node, num_neighbours, scratch,
+            [&](size_t surfel_idx, std::vector<std::pair<surfel_id_t, real>> const &nearest_neighbour_vector)
         {
-            std::vector<std::pair<surfel_id_t, real>> const nearest_neighbour_vector = get_nearest_neighbours(surfel_id_t(node_idx, surfel_idx), num_neighbours);
-
             double avg_dist = 0.0;
 
             if(nearest_neighbour_vector.size())
@@ -1355,7 +1528,7 @@ void bvh::thread_remove_outlier_jobs(const uint32_t start_marker, const uint32_t
                         break;
                 }
             }
-        }
+        });
 
         node_idx = working_queue_head_counter_.increment_head();
     }
@@ -1407,214 +1580,1399 @@ void bvh::thread_split_node_jobs(size_t &slice_left, size_t &slice_right, size_t
     }
 }
 
-void bvh::upsweep(const reduction_strategy &reduction_strgy, const normal_computation_strategy &normal_strategy, const radius_computation_strategy &radius_strategy, bool recompute_leaf_level,
-                  bool resample)
+struct bvh::upsweep_graph
 {
+    upsweep_graph(const reduction_strategy &reduction_strgy, const normal_computation_strategy &normal_strategy, const radius_computation_strategy &radius_strategy,
+                  const bool recompute_leaf_level, const bool resample, const size_t num_nodes, const uint32_t num_levels)
+        : reduction_strgy_(reduction_strgy), normal_strategy_(normal_strategy), radius_strategy_(radius_strategy),
+          recompute_leaf_level_(recompute_leaf_level), resample_(resample), level_synchronous_(reduction_strgy.uses_tree_neighbours()),
+          bounding_box_tasks_(num_nodes, no_task), flush_tasks_(num_nodes, no_task), neighbourhood_tasks_(num_nodes, no_task),
+          halo_loaded_(num_nodes, 0), level_flush_tasks_(num_levels), num_flushed_nodes_(0)
+    {}
+
+    static const task_scheduler::task_id no_task = std::numeric_limits<task_scheduler::task_id>::max();
+
+    const reduction_strategy &reduction_strgy_;
+    const normal_computation_strategy &normal_strategy_;
+    const radius_computation_strategy &radius_strategy_;
+    const bool recompute_leaf_level_;
+    const bool resample_;
+
+    // reductions that search neighbours through the tree run once the whole
+    // child level of the subtree is done and unloading waits for all of them
+    const bool level_synchronous_;
+
+    std::vector<shared_surfel_file> level_temp_files_;
+    std::vector<shared_prov_file> prov_temp_files_;
+
+    // per node; neighbourhood_tasks_ is done once no neighbour search reads the node anymore
+    std::vector<task_scheduler::task_id> bounding_box_tasks_;
+    std::vector<task_scheduler::task_id> flush_tasks_;
+    std::vector<task_scheduler::task_id> neighbourhood_tasks_;
+
+    // per node, set while a block loaded the node for its halo only
+    std::vector<uint8_t> halo_loaded_;
+
+    std::vector<std::vector<task_scheduler::task_id>> level_flush_tasks_;
+    std::atomic<uint32_t> num_flushed_nodes_;
+};
 
-    
-    uint64_t num_nodes_with_provenance = 0;
-    for (const auto& node : nodes_) {
-      if (node.has_provenance()) {
-        ++num_nodes_with_provenance;
-      }
-    }
-    if (num_nodes_with_provenance > 0) {
-        LOGGER_TRACE("Upsweep: provenance disk arrays found");
-    }
+const task_scheduler::task_id bvh::upsweep_graph::no_task;
 
-    std::cout << "num_nodes: " << nodes_.size() << std::endl;
-    std::cout << "num_nodes_with_provenance: " << num_nodes_with_provenance << std::endl;
+uint32_t bvh::get_upsweep_block_depth(const bool with_leaf_halo) const
+{
+    // two blocks are in flight at once, each with its leaves and their halo,
+    // their reductions and the neighbourhood index of one level
+    size_t bytes_per_surfel = 2 * (2 * sizeof(surfel) + sizeof(vec3r) + sizeof(surfel_id_t));
+    if(nodes_.at(first_leaf_).has_provenance())
+    {
+        bytes_per_surfel += 2 * 2 * sizeof(prov);
+    }
+    size_t block_surfel_capacity = std::max(size_t(1), memory_limit_ / bytes_per_surfel);
 
-    // Create level temp files
-    std::vector<shared_surfel_file> level_temp_files;
-    std::vector<shared_prov_file> prov_temp_files;
-    for(uint32_t level = 0; level <= depth_; ++level)
+    // surfels of the largest subtree per depth, leaves of a subtree are consecutive
+    std::vector<size_t> leaf_sizes;
+    for(node_id_type node_index = first_leaf_; node_index < nodes_.size(); ++node_index)
     {
-        level_temp_files.push_back(std::make_shared<surfel_file>());
-        std::string ext = ".lv" + std::to_string(level);
-        level_temp_files.back()->open(add_to_path(base_path_, ext).string(), level != depth_);
+        const bvh_node &leaf = nodes_.at(node_index);
+        leaf_sizes.push_back(leaf.is_in_core() ? leaf.mem_array().length() : leaf.disk_array().length());
+    }
+    std::vector<size_t> subtree_sizes = leaf_sizes;
 
-        if (num_nodes_with_provenance > 0) {
-            prov_temp_files.push_back(std::make_shared<prov_file>());
-            std::string prov_ext = ".plv" + std::to_string(level);
-            prov_temp_files.back()->open(add_to_path(base_path_, prov_ext).string(), level != depth_);
-            LOGGER_INFO("Input WITH PROVENANCE: " << prov_temp_files.back()->file_name());
+    uint32_t block_depth = depth_;
+    while(block_depth > 0)
+    {
+        std::vector<size_t> parent_sizes(subtree_sizes.size() / fan_factor_, 0);
+        for(size_t subtree_idx = 0; subtree_idx < subtree_sizes.size(); ++subtree_idx)
+        {
+            parent_sizes[subtree_idx / fan_factor_] += subtree_sizes[subtree_idx];
+        }
+        if(*std::max_element(parent_sizes.begin(), parent_sizes.end()) > block_surfel_capacity)
+        {
+            break;
         }
+        subtree_sizes.swap(parent_sizes);
+        --block_depth;
     }
 
-
-    // Start at bottom level and move up towards root.
-    for(int32_t level = depth_; level >= 0; --level)
+    if(block_depth == 0 || !with_leaf_halo)
     {
-        LOGGER_TRACE("Entering level: " << level);
-
-        uint32_t first_node_of_level = get_first_node_id_of_depth(level);
-        uint32_t last_node_of_level = get_first_node_id_of_depth(level) + get_length_of_depth(level);
+        return block_depth;
+    }
 
+    // smaller blocks have a smaller halo of leaves
+    for(; block_depth < depth_; ++block_depth)
+    {
+        size_t max_block_surfels = 0;
+        const node_id_type first_block = get_first_node_id_of_depth(block_depth);
+        for(node_id_type block_root = first_block; block_root < first_block + get_length_of_depth(block_depth); ++block_root)
+        {
+            size_t block_surfels = 0;
+            const std::vector<node_id_type> halo = get_upsweep_halo(block_root, depth_);
+            for(const node_id_type node_index : halo)
+            {
+                block_surfels += leaf_sizes[node_index - first_leaf_];
+            }
+            std::vector<node_id_type> leaves;
+            get_descendant_leaves(block_root, leaves, first_leaf_, std::unordered_set<size_t>());
+            for(const node_id_type node_index : leaves)
+            {
+                block_surfels += leaf_sizes[node_index - first_leaf_];
+            }
+            max_block_surfels = std::max(max_block_surfels, block_surfels);
+        }
+        if(max_block_surfels <= block_surfel_capacity)
+        {
+            break;
+        }
+    }
+
+    return block_depth;
+}
+
+bvh::subtree_tasks bvh::add_subtree_upsweep_tasks(upsweep_graph &graph, const node_id_type subtree_root, const uint32_t bottom_level,
+                                                  const std::vector<task_scheduler::task_id> &load_dependencies, knn_index &index)
+{
+    using task_id = task_scheduler::task_id;
+    const task_id no_task = upsweep_graph::no_task;
+
+    // the nodes of a subtree on one level are consecutive
+    const uint32_t top_level = get_depth_of_node(subtree_root);
+    std::vector<std::pair<node_id_type, node_id_type>> level_ranges(bottom_level + 1);
+    level_ranges[top_level] = std::make_pair(subtree_root, subtree_root + 1);
+    for(uint32_t level = top_level + 1; level <= bottom_level; ++level)
+    {
+        level_ranges[level] = std::make_pair(get_child_id(level_ranges[level - 1].first, 0), get_child_id(level_ranges[level - 1].second - 1, fan_factor_ - 1) + 1);
+    }
+
+    subtree_tasks result = {no_task, no_task};
+    std::vector<task_id> done_dependencies;
+
+    if(bottom_level == depth_)
+    {
+        std::vector<task_id> load_tasks;
+        for(node_id_type node_index = level_ranges[depth_].first; node_index < level_ranges[depth_].second; ++node_index)
+        {
+            load_tasks.push_back(scheduler_.add_task([=] {
+                bvh_node &leaf = nodes_.at(node_index);
+                if(!leaf.is_in_core() && leaf.is_out_of_core())
+                {
+                    leaf.load_from_disk();
+                }
+            }, load_dependencies));
+        }
+        result.loads_done_ = scheduler_.add_task([] {}, load_tasks);
+    }
+
+    task_id attributes_done = no_task;
+    for(int32_t level = bottom_level; level >= int32_t(top_level); --level)
+    {
+        const node_id_type first_node = level_ranges[level].first;
+        const node_id_type last_node = level_ranges[level].second;
+        const bool is_leaf_level = (level == int32_t(depth_));
+
+        // First apply reduction strategy, since calculation of attributes might depend on surfel data of nodes in same level.
+        std::vector<task_id> lod_tasks;
+        task_id lods_done = no_task;
+        if(!is_leaf_level)
+        {
+            std::vector<task_id> child_level_tasks;
+            if(graph.level_synchronous_)
+            {
+                for(node_id_type child_id = get_child_id(first_node, 0); child_id <= get_child_id(last_node - 1, fan_factor_ - 1); ++child_id)
+                {
+                    child_level_tasks.push_back(graph.bounding_box_tasks_[child_id]);
+                }
+            }
+            const task_id child_level_done = graph.level_synchronous_ ? scheduler_.add_task([] {}, child_level_tasks) : no_task;
+
+            for(node_id_type node_index = first_node; node_index < last_node; ++node_index)
+            {
+                std::vector<task_id> children_tasks;
+                if(graph.level_synchronous_)
+                {
+                    children_tasks.push_back(child_level_done);
+                }
+                else
+                {
+                    for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
+                    {
+                        children_tasks.push_back(graph.bounding_box_tasks_[get_child_id(node_index, child_index)]);
+                    }
+                }
+                lod_tasks.push_back(scheduler_.add_task([=, &graph] { create_lod(node_index, graph.reduction_strgy_, graph.resample_); }, children_tasks));
+            }
+            if(graph.level_synchronous_)
+            {
+                lods_done = scheduler_.add_task([] {}, lod_tasks);
+            }
+        }
+
+        // skip the leaf level attribute computation if it was not requested or necessary.
+        // the index of the level below is rebuilt once all its searches are done
+        std::vector<task_id> attribute_tasks;
+        if(!is_leaf_level || graph.recompute_leaf_level_)
+        {
+            std::vector<task_id> index_dependencies = lod_tasks;
+            if(is_leaf_level)
+            {
+                index_dependencies.push_back(result.loads_done_);
+            }
+            if(attributes_done != no_task)
+            {
+                index_dependencies.push_back(attributes_done);
+            }
+            task_id index_task = scheduler_.add_task([=, &index] { index.build(nodes_, first_node, last_node); }, index_dependencies);
+
+            for(node_id_type node_index = first_node; node_index < last_node; ++node_index)
+            {
+                attribute_tasks.push_back(scheduler_.add_task([=, &graph, &index] {
+                    compute_attributes(node_index, graph.normal_strategy_, graph.radius_strategy_, false, index);
+                }, {index_task}));
+            }
+            attributes_done = scheduler_.add_task([] {}, attribute_tasks);
+        }
+        else
+        {
+            attributes_done = no_task;
+        }
+
+        for(node_id_type node_index = first_node; node_index < last_node; ++node_index)
+        {
+            graph.neighbourhood_tasks_[node_index] = attributes_done;
+
+            // leaves are only flushed once the whole block is loaded, see upsweep()
+            std::vector<task_id> bounding_box_dependencies;
+            if(!attribute_tasks.empty())
+            {
+                bounding_box_dependencies.push_back(attribute_tasks[node_index - first_node]);
+            }
+            else if(!is_leaf_level)
+            {
+                bounding_box_dependencies.push_back(lod_tasks[node_index - first_node]);
+            }
+            else
+            {
+                bounding_box_dependencies.push_back(result.loads_done_);
+            }
+            graph.bounding_box_tasks_[node_index] = scheduler_.add_task([=] { compute_bounding_box_upsweep(node_index, level); }, bounding_box_dependencies);
+
+            graph.flush_tasks_[node_index] = scheduler_.add_task([=, &graph] { flush_upsweep_node(graph, node_index, level, true, false); }, {graph.bounding_box_tasks_[node_index]});
+            graph.level_flush_tasks_[level].push_back(graph.flush_tasks_[node_index]);
+
+            // Unload all child nodes once nothing reads them anymore
+            if(!is_leaf_level)
+            {
+                std::vector<task_id> unload_dependencies = {lod_tasks[node_index - first_node]};
+                if(lods_done != no_task)
+                {
+                    unload_dependencies.push_back(lods_done);
+                }
+                for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
+                {
+                    node_id_type child_id = get_child_id(node_index, child_index);
+                    unload_dependencies.push_back(graph.flush_tasks_[child_id]);
+                    if(graph.neighbourhood_tasks_[child_id] != no_task)
+                    {
+                        unload_dependencies.push_back(graph.neighbourhood_tasks_[child_id]);
+                    }
+                }
+                done_dependencies.push_back(scheduler_.add_task([=] { unload_children(node_index); }, unload_dependencies));
+            }
+        }
+    }
+
+    // the subtree root stays in core for the levels above
+    done_dependencies.push_back(graph.flush_tasks_[subtree_root]);
+    if(attributes_done != no_task)
+    {
+        done_dependencies.push_back(attributes_done);
+    }
+    result.done_ = scheduler_.add_task([&index] { index.clear(); }, done_dependencies);
+
+    return result;
+}
+
+void bvh::flush_upsweep_node(upsweep_graph &graph, const node_id_type node_index, const uint32_t level, const bool is_final, const bool dealloc_mem_array)
+{
+    bvh_node *current_node = &nodes_.at(node_index);
+
+    // compute node offset in file
+    int32_t nid = current_node->node_id();
+    for(uint32_t write_level = 0; write_level < level; ++write_level)
+        nid -= uint32_t(pow(fan_factor_, write_level));
+    nid = std::max(0, nid);
+
+    // save computed node to disk
+    if(current_node->has_provenance())
+    {
+        current_node->flush_to_disk(graph.level_temp_files_[level], graph.prov_temp_files_[level], size_t(nid) * max_surfels_per_node_, dealloc_mem_array);
+    }
+    else
+    {
+        current_node->flush_to_disk(graph.level_temp_files_[level], size_t(nid) * max_surfels_per_node_, dealloc_mem_array);
+    }
+
+    if(!is_final)
+    {
+        return;
+    }
+
+    const uint64_t num_nodes = nodes_.size();
+    const uint64_t num_flushed = ++graph.num_flushed_nodes_;
+    if((num_flushed * 100) / num_nodes != ((num_flushed - 1) * 100) / num_nodes)
+    {
+        std::cout << "\r" << (num_flushed * 100) / num_nodes << "% processed" << std::flush;
+    }
+}
+
+std::vector<node_id_type> bvh::get_upsweep_halo(const node_id_type block_root, const uint32_t level) const
+{
+    std::vector<node_id_type> halo;
+
+    // the nodes of the block on this level are consecutive
+    node_id_type first_node = block_root;
+    node_id_type end_node = block_root + 1;
+    for(uint32_t node_level = get_depth_of_node(block_root); node_level < level; ++node_level)
+    {
+        first_node = get_child_id(first_node, 0);
+        end_node = get_child_id(end_node - 1, fan_factor_ - 1) + 1;
+    }
+
+    // the ring is as wide as the largest node of the block on this level
+    bounding_box block_box;
+    vec3r ring_width(0.0);
+    for(node_id_type node_index = first_node; node_index < end_node; ++node_index)
+    {
+        const bounding_box &box = nodes_.at(node_index).get_bounding_box();
+        if(box.is_invalid())
+        {
+            continue;
+        }
+        block_box.expand(box);
+        for(uint8_t axis = 0; axis < 3; ++axis)
+        {
+            ring_width[axis] = std::max(ring_width[axis], box.get_dimensions()[axis]);
+        }
+    }
+    if(block_box.is_invalid())
+    {
+        return halo;
+    }
+    const bounding_box ring_box(block_box.min() - ring_width, block_box.max() + ring_width);
+
+    // boxes of inner nodes enclose their children
+    std::vector<node_id_type> stack(1, 0);
+    while(!stack.empty())
+    {
+        const node_id_type node_index = stack.back();
+        stack.pop_back();
+
+        const bounding_box &box = nodes_.at(node_index).get_bounding_box();
+        if(node_index == block_root || box.is_invalid() || !box.intersects(ring_box))
+        {
+            continue;
+        }
+        if(get_depth_of_node(node_index) == level)
+        {
+            halo.push_back(node_index);
+            continue;
+        }
+        for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
+        {
+            stack.push_back(get_child_id(node_index, child_index));
+        }
+    }
+
+    std::sort(halo.begin(), halo.end());
+    return halo;
+}
+
+void bvh::add_blocked_upsweep_tasks(upsweep_graph &graph, const uint32_t block_depth, std::vector<knn_index> &block_indices)
+{
+    using task_id = task_scheduler::task_id;
+    const task_id no_task = upsweep_graph::no_task;
+
+    const node_id_type first_block = get_first_node_id_of_depth(block_depth);
+    const node_id_type num_blocks = get_length_of_depth(block_depth);
+
+    // blocks run from the last leaf down, see upsweep()
+    std::vector<node_id_type> block_roots;
+    for(node_id_type block = 0; block < num_blocks; ++block)
+    {
+        block_roots.push_back(first_block + num_blocks - 1 - block);
+    }
+
+    // node ranges and halos of every block and level. they are taken before
+    // any task runs, since the tasks update the bounding boxes.
+    std::vector<std::vector<std::pair<node_id_type, node_id_type>>> ranges(depth_ + 1, std::vector<std::pair<node_id_type, node_id_type>>(num_blocks));
+    std::vector<std::vector<std::vector<node_id_type>>> halos(depth_ + 1, std::vector<std::vector<node_id_type>>(num_blocks));
+    for(node_id_type block = 0; block < num_blocks; ++block)
+    {
+        ranges[block_depth][block] = std::make_pair(block_roots[block], block_roots[block] + 1);
+        for(uint32_t level = block_depth + 1; level <= depth_; ++level)
+        {
+            const auto &parent_range = ranges[level - 1][block];
+            ranges[level][block] = std::make_pair(get_child_id(parent_range.first, 0), get_child_id(parent_range.second - 1, fan_factor_ - 1) + 1);
+        }
+        for(uint32_t level = block_depth; level <= depth_; ++level)
+        {
+            if(level < depth_ || graph.recompute_leaf_level_)
+            {
+                halos[level][block] = get_upsweep_halo(block_roots[block], level);
+            }
+        }
+    }
+
+    // two blocks that load the same node must not be in memory at once
+    auto share_nodes = [&](const uint32_t level, const node_id_type block, const node_id_type other_block)
+    {
+        std::vector<node_id_type> nodes = halos[level][block];
+        for(node_id_type node_index = ranges[level][block].first; node_index < ranges[level][block].second; ++node_index)
+        {
+            nodes.push_back(node_index);
+        }
+        std::sort(nodes.begin(), nodes.end());
+
+        const auto &other_range = ranges[level][other_block];
+        for(const node_id_type node_index : nodes)
+        {
+            if((node_index >= other_range.first && node_index < other_range.second) ||
+               std::binary_search(halos[level][other_block].begin(), halos[level][other_block].end(), node_index))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    task_id level_ready = no_task;
+    std::vector<task_id> blocks_done;
+    for(int32_t level = depth_; level >= int32_t(block_depth); --level)
+    {
+        const bool is_leaf_level = (level == int32_t(depth_));
+        const bool has_attributes = !is_leaf_level || graph.recompute_leaf_level_;
+
+        std::vector<task_id> parents_flushed;
+        task_id previous_loads_done = no_task;
+        blocks_done.clear();
+
+        for(node_id_type block = 0; block < num_blocks; ++block)
+        {
+            const node_id_type first_node = ranges[level][block].first;
+            const node_id_type last_node = ranges[level][block].second;
+            const std::vector<node_id_type> &halo = halos[level][block];
+            knn_index &index = block_indices[block];
+
+            // at most two blocks are in memory, and loads are chained so no
+            // leaf is overwritten before it was loaded
+            std::vector<task_id> load_dependencies;
+            if(level_ready != no_task)
+            {
+                load_dependencies.push_back(level_ready);
+            }
+            if(previous_loads_done != no_task)
+            {
+                load_dependencies.push_back(previous_loads_done);
+            }
+            if(block >= 2)
+            {
+                load_dependencies.push_back(blocks_done[block - 2]);
+            }
+            if(block >= 1 && share_nodes(level, block, block - 1))
+            {
+                load_dependencies.push_back(blocks_done[block - 1]);
+            }
+
+            std::vector<task_id> load_tasks;
+            for(node_id_type node_index = first_node; node_index < last_node; ++node_index)
+            {
+                load_tasks.push_back(scheduler_.add_task([=] {
+                    bvh_node &node = nodes_.at(node_index);
+                    if(!node.is_in_core() && node.is_out_of_core())
+                    {
+                        node.load_from_disk();
+                    }
+                }, load_dependencies));
+            }
+            for(const node_id_type node_index : halo)
+            {
+                load_tasks.push_back(scheduler_.add_task([=, &graph] {
+                    bvh_node &node = nodes_.at(node_index);
+                    if(!node.is_in_core() && node.is_out_of_core())
+                    {
+                        node.load_from_disk();
+                        graph.halo_loaded_[node_index] = 1;
+                    }
+                }, load_dependencies));
+            }
+            const task_id loads_done = scheduler_.add_task([] {}, load_tasks);
+            previous_loads_done = loads_done;
+
+            std::vector<task_id> attribute_tasks;
+            task_id attributes_done = no_task;
+            if(has_attributes)
+            {
+                task_id index_task = scheduler_.add_task([=, &index] { index.build(nodes_, first_node, last_node, halo); }, {loads_done});
+                for(node_id_type node_index = first_node; node_index < last_node; ++node_index)
+                {
+                    attribute_tasks.push_back(scheduler_.add_task([=, &graph, &index] {
+                        compute_attributes(node_index, graph.normal_strategy_, graph.radius_strategy_, false, index);
+                    }, {index_task}));
+                }
+                attributes_done = scheduler_.add_task([] {}, attribute_tasks);
+            }
+
+            std::vector<task_id> done_dependencies;
+            for(node_id_type node_index = first_node; node_index < last_node; ++node_index)
+            {
+                graph.neighbourhood_tasks_[node_index] = attributes_done;
+
+                const task_id bounding_box_dependency = attribute_tasks.empty() ? loads_done : attribute_tasks[node_index - first_node];
+                graph.bounding_box_tasks_[node_index] = scheduler_.add_task([=] { compute_bounding_box_upsweep(node_index, level); }, {bounding_box_dependency});
+                graph.flush_tasks_[node_index] = scheduler_.add_task([=, &graph] { flush_upsweep_node(graph, node_index, level, true, false); }, {graph.bounding_box_tasks_[node_index]});
+                graph.level_flush_tasks_[level].push_back(graph.flush_tasks_[node_index]);
+            }
+
+            if(level > int32_t(block_depth))
+            {
+                // the parents are reduced and stored until their level runs
+                for(node_id_type parent_index = get_parent_id(first_node); parent_index <= get_parent_id(last_node - 1); ++parent_index)
+                {
+                    std::vector<task_id> children_tasks;
+                    std::vector<task_id> unload_dependencies;
+                    for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
+                    {
+                        const node_id_type child_id = get_child_id(parent_index, child_index);
+                        children_tasks.push_back(graph.bounding_box_tasks_[child_id]);
+                        unload_dependencies.push_back(graph.flush_tasks_[child_id]);
+                    }
+                    const task_id lod_task = scheduler_.add_task([=, &graph] { create_lod(parent_index, graph.reduction_strgy_, graph.resample_); }, children_tasks);
+                    const task_id parent_flushed = scheduler_.add_task([=, &graph] { flush_upsweep_node(graph, parent_index, level - 1, false, true); }, {lod_task});
+                    parents_flushed.push_back(parent_flushed);
+
+                    unload_dependencies.push_back(lod_task);
+                    if(attributes_done != no_task)
+                    {
+                        unload_dependencies.push_back(attributes_done);
+                    }
+                    done_dependencies.push_back(scheduler_.add_task([=] { unload_children(parent_index); }, unload_dependencies));
+                    done_dependencies.push_back(parent_flushed);
+                }
+            }
+            else
+            {
+                // the block root stays in core for the levels above
+                done_dependencies.push_back(graph.flush_tasks_[first_node]);
+            }
+
+            if(!halo.empty())
+            {
+                done_dependencies.push_back(scheduler_.add_task([=, &graph] {
+                    for(const node_id_type node_index : halo)
+                    {
+                        if(graph.halo_loaded_[node_index])
+                        {
+                            nodes_.at(node_index).mem_array().reset();
+                            graph.halo_loaded_[node_index] = 0;
+                        }
+                    }
+                }, {attributes_done}));
+            }
+            if(attributes_done != no_task)
+            {
+                done_dependencies.push_back(attributes_done);
+            }
+            blocks_done.push_back(scheduler_.add_task([&index] { index.clear(); }, done_dependencies));
+        }
+
+        if(level > int32_t(block_depth))
+        {
+            level_ready = scheduler_.add_task([] {}, parents_flushed);
+        }
+    }
+
+    // other blocks may read a block root as halo, it is unloaded once all are done
+    const task_id roots_done = scheduler_.add_task([] {}, blocks_done);
+    for(const node_id_type block_root : block_roots)
+    {
+        graph.neighbourhood_tasks_[block_root] = roots_done;
+    }
+}
+
+void bvh::upsweep(const reduction_strategy &reduction_strgy, const normal_computation_strategy &normal_strategy, const radius_computation_strategy &radius_strategy, bool recompute_leaf_level,
+                  bool resample)
+{
+
+    
+    uint64_t num_nodes_with_provenance = 0;
+    for (const auto& node : nodes_) {
+      if (node.has_provenance()) {
+        ++num_nodes_with_provenance;
+      }
+    }
+    if (num_nodes_with_provenance > 0) {
+        LOGGER_TRACE("Upsweep: provenance disk arrays found");
+    }
+
+    std::cout << "num_nodes: " << nodes_.size() << std::endl;
+    std::cout << "num_nodes_with_provenance: " << num_nodes_with_provenance << std::endl;
+
+    // Create level temp files
+    std::vector<shared_surfel_file> level_temp_files;
+    std::vector<shared_prov_file> prov_temp_files;
+    for(uint32_t level = 0; level <= depth_; ++level)
+    {
+        level_temp_files.push_back(std::make_shared<surfel_file>());
+        std::string ext = ".lv" + std::to_string(level);
+        level_temp_files.back()->open(add_to_path(base_path_, ext).string(), level != depth_);
+
+        if (num_nodes_with_provenance > 0) {
+            prov_temp_files.push_back(std::make_shared<prov_file>());
+            std::string prov_ext = ".plv" + std::to_string(level);
+            prov_temp_files.back()->open(add_to_path(base_path_, prov_ext).string(), level != depth_);
+            LOGGER_INFO("Input WITH PROVENANCE: " << prov_temp_files.back()->file_name());
+        }
+    }
+
+
+    upsweep_graph graph(reduction_strgy, normal_strategy, radius_strategy, recompute_leaf_level, resample, nodes_.size(), depth_ + 1);
+    graph.level_temp_files_ = level_temp_files;
+    graph.prov_temp_files_ = prov_temp_files;
+
+    // The tree is processed in blocks of subtrees that fit into the memory
+    // budget. Every step is a task of one graph. With a single block, a
+    // parent is reduced as soon as its children are done and the attributes
+    // of a level wait for all its nodes, since their neighbour search spans
+    // the whole level. With several blocks the levels below the block roots
+    // run one after the other: a block loads its nodes of the level together
+    // with a ring of neighbouring nodes of the same level, see
+    // get_upsweep_halo(). The ring is only read by the neighbour search, so
+    // normals and radii do not depend on the block size as long as the
+    // neighbours of a surfel lie within one node of its block. The block
+    // then reduces its parents and stores them until their level runs. The
+    // levels above the blocks are processed at the end on the block roots,
+    // which stay in core. Reductions that search neighbours through the tree
+    // may reach any node of the child level, they get the whole tree as a
+    // single block regardless of the budget.
+    uint32_t block_depth = get_upsweep_block_depth(recompute_leaf_level);
+    if(reduction_strgy.uses_tree_neighbours() && block_depth > 0)
+    {
+        LOGGER_WARN("The reduction searches neighbours through the tree, the upsweep holds all " << get_length_of_depth(depth_)
+                    << " leaves at once and exceeds the memory limit of " << memory_limit_ << " bytes");
+        block_depth = 0;
+    }
+    node_id_type num_blocks = get_length_of_depth(block_depth);
+    LOGGER_INFO("Upsweep in " << num_blocks << " blocks of subtrees at depth " << block_depth);
+
+    // Leaves are flushed to their final offset in the leaf level file, which
+    // may overlap the downsweep location of leaves with higher ids. Blocks
+    // are therefore processed from the last leaf down and loaded one after
+    // the other, so no leaf is overwritten before it was loaded.
+    std::vector<knn_index> block_indices(num_blocks + 1);
+
+    if(block_depth == 0)
+    {
+        add_subtree_upsweep_tasks(graph, 0, depth_, {}, block_indices[0]);
+    }
+    else
+    {
+        add_blocked_upsweep_tasks(graph, block_depth, block_indices);
+        add_subtree_upsweep_tasks(graph, 0, block_depth - 1, {}, block_indices[num_blocks]);
+    }
+
+    for(int32_t level = depth_; level >= 0; --level)
+    {
+        uint32_t first_node_of_level = get_first_node_id_of_depth(level);
+        uint32_t last_node_of_level = get_first_node_id_of_depth(level) + get_length_of_depth(level);
+
+        scheduler_.add_task([=] {
+            real mean_radius_sd = 0.0;
+            unsigned counter = 1;
+            for(uint32_t node_index = first_node_of_level; node_index < last_node_of_level; ++node_index)
+            {
+                mean_radius_sd = mean_radius_sd + nodes_.at(node_index).node_stats().radius_sd();
+                counter++;
+            }
+            mean_radius_sd = mean_radius_sd / counter;
+            std::cout << std::endl << "average radius deviation pro level " << level << ": " << mean_radius_sd << "\n";
+        }, graph.level_flush_tasks_[level]);
+    }
+
+    scheduler_.wait();
+
+    // TODO: Inject a call to provenance method, collecting level data into one file
+    /*
+    reduction_strategy *p_reduction_strgy = (reduction_strategy *)&reduction_strgy;
+    if(reduction_strategy_provenance *cast = dynamic_cast<reduction_strategy_provenance *>(p_reduction_strgy))
+    {
+        uint16_t w_level = 0;
+
+        while(w_level <= depth_)
+        {
+            std::cout << "Entering w_level: " << w_level << std::endl;
+
+            const uint32_t first_node_of_level = get_first_node_id_of_depth(w_level);
+            const uint32_t last_node_of_level = get_first_node_id_of_depth(w_level) + get_length_of_depth(w_level) - 1;
+
+            uint16_t percentage = 0;
+
+            uint32_t w_node = first_node_of_level;
+
+            while(w_node <= last_node_of_level)
+            {
+                // std::cout << "Entering w_node: " << w_node << std::endl;
+
+                if(w_level < depth_)
+                {
+                    bvh_node *current_node = &nodes_.at(w_node);
+                    cast->pack_node(w_node, max_surfels_per_node_, (*current_node).disk_array().length());
+                }
+                else
+                {
+                    cast->pack_empties(max_surfels_per_node_);
+                }
+
+                w_node++;
+            }
+
+            uint16_t new_percentage = (uint16_t)int16_t(float(w_level) / (depth_)*100);
+            if(percentage < new_percentage)
+            {
+                percentage = new_percentage;
+                std::cout << "\r" << percentage << "% processed" << std::flush;
+            }
+
+            w_level++;
+        }
+    }
+    */
+
+    state_ = state_type::after_upsweep;
+}
+
+void bvh::resample()
+{
+    uint32_t first_node_of_level = get_first_node_id_of_depth(depth_);
+    uint32_t last_node_of_level = get_first_node_id_of_depth(depth_) + get_length_of_depth(depth_);
+
+    // Loading is not thread-safe, so load everything before starting parallel operations.
+    for(uint32_t node_index = first_node_of_level; node_index < last_node_of_level; ++node_index)
+    {
+        bvh_node *current_node = &nodes_.at(node_index);
+        // if necessary, load leaf-depth_ nodes from disk
+        if(depth_ == int32_t(depth_) && current_node->is_out_of_core())
+        {
+            current_node->load_from_disk();
+        }
+    }
+
+    uint16_t number_of_neighbours = 175;
+    auto normal_comp_algo = normal_computation_plane_fitting(number_of_neighbours);
+    auto radius_comp_algo = radius_computation_average_distance(number_of_neighbours, 1.0f);
+    spawn_compute_attribute_jobs(first_node_of_level, last_node_of_level, normal_comp_algo, radius_comp_algo, false);
+
+    // spawn_resample jobs directly instead of calling another function
+    uint32_t const num_threads = scheduler_.num_threads();
+
+    working_queue_head_counter_.initialize(first_node_of_level); // let the threads fetch a node idx
+
+    for(uint32_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
+    {
+        bool update_percentage = (0 == thread_idx);
+        scheduler_.add_task(std::bind(&bvh::thread_resample, this, first_node_of_level, last_node_of_level, update_percentage));
+    }
+
+    scheduler_.wait();
+
+    real mean_radius_sd = 0.0;
+    unsigned counter = 1;
+    for(uint32_t node_index = first_node_of_level; node_index < last_node_of_level; ++node_index)
+    {
+        bvh_node *current_node = &nodes_.at(node_index);
+
+        mean_radius_sd = mean_radius_sd + (*current_node).node_stats().radius_sd();
+        counter++;
+    }
+    mean_radius_sd = mean_radius_sd / counter;
+    std::cout << "average radius deviation pro level: " << mean_radius_sd << "\n";
+
+    state_ = state_type::after_upsweep;
+}
+
+void bvh::insert(const std::string &surfels_input_file, const reduction_strategy &reduction_strgy, const normal_computation_strategy &normal_strategy,
+                 const radius_computation_strategy &radius_strategy, bool recompute_leaf_level, bool allow_new_leaf_levels)
+{
+    assert(state_ == state_type::serialized);
 
-        // Loading is not thread-safe, so load everything before starting parallel operations.
-        for(uint32_t node_index = first_node_of_level; node_index < last_node_of_level; ++node_index)
+    // only the plain .lod layout can be updated node by node
+    if(lod_quantized_ || lod_compressed_)
+    {
+        throw std::runtime_error("insertion into quantized or compressed trees is not supported");
+    }
+
+    // the nodes are updated in place, every slot of the .lod is saved to an
+    // undo journal before it is overwritten. the tree is written to a new
+    // .bvh, which replaces the old one only after the insertion succeeded
+    const fs::path lod_file = add_to_path(base_path_, ".lod");
+    const fs::path bvh_file = add_to_path(base_path_, ".bvh");
+    const fs::path journal_file = add_to_path(base_path_, ".lod_journal");
+    const fs::path new_bvh_file = add_to_path(base_path_, ".bvh_insert");
+
+    node_serializer serializer(max_surfels_per_node_, buffer_size_);
+    surfel_file input;
+
+    try
+    {
+        // while the .bvh_insert exists the journal belongs to an unfinished insertion
+        std::ofstream(new_bvh_file.string(), std::ios::out | std::ios::binary | std::ios::trunc);
+        serializer.open(lod_file.string(), true);
+        serializer.open_journal(journal_file.string());
+        input.open(surfels_input_file);
+        const size_t num_surfels = input.get_size();
+
+        // a rebuilt subtree has to fit into the memory budget, but it can always
+        // hold the children of one full leaf. batches stay well below it, so the
+        // surfels of a batch that land in one full leaf fit after one leaf level
+        const size_t max_subtree_surfels = std::max(size_t(fan_factor_) * max_surfels_per_node_, memory_limit_ / (4 * sizeof(surfel)));
+        const size_t batch_size = std::max(size_t(1), max_subtree_surfels / 2);
+
+        // enough leaf levels to make room for all surfels next to one full leaf,
+        // plus one for surfels that are spread over several subtrees
+        uint32_t max_added_levels = 2;
+        for(size_t num_leaves = fan_factor_; num_leaves * max_surfels_per_node_ < num_surfels + max_surfels_per_node_; num_leaves *= fan_factor_)
+        {
+            ++max_added_levels;
+        }
+        uint32_t num_added_levels = 0;
+
+        LOGGER_INFO("Insert " << num_surfels << " surfels into a tree of depth " << depth_);
+
+        for(size_t offset = 0; offset < num_surfels; offset += batch_size)
         {
-            bvh_node *current_node = &nodes_.at(node_index);
-            // if necessary, load leaf-level nodes from disk
-            if(level == int32_t(depth_) && current_node->is_out_of_core())
+            const size_t length = std::min(batch_size, num_surfels - offset);
+            surfel_vector batch(length);
+            input.read(&batch, 0, offset, length);
+            for(auto &surfel : batch)
+            {
+                surfel.pos() -= translation_;
+            }
+
+            // surfels that do not fit into any subtree stay in the batch for the
+            // next pass, more leaves are only added if none of them fit
+            while(!batch.empty())
             {
-                current_node->load_from_disk();   
+                if(insert_batch(batch, serializer, reduction_strgy, normal_strategy, radius_strategy, recompute_leaf_level, max_subtree_surfels) > 0)
+                {
+                    continue;
+                }
+                if(num_added_levels == max_added_levels)
+                {
+                    throw std::runtime_error("insertion of " + std::to_string(num_surfels) + " surfels needs more than " + std::to_string(max_added_levels) + " additional leaf levels");
+                }
+
+                // a new level splits every leaf of the tree, not only the full ones
+                const size_t num_leaves = get_length_of_depth(depth_);
+                const size_t num_written_bytes = (fan_factor_ + 1) * num_leaves * max_surfels_per_node_ * serialized_surfel::get_size();
+                if(!allow_new_leaf_levels)
+                {
+                    throw std::runtime_error(std::to_string(batch.size()) + " surfels do not fit into the tree without a new leaf level, which rewrites all " +
+                                             std::to_string(num_leaves) + " leaves (" + std::to_string(num_written_bytes) + " bytes of the .lod). " +
+                                             "Trees built with a leaf fill factor below 1 leave room in their leaves");
+                }
+                LOGGER_WARN("Add a leaf level for " << batch.size() << " surfels, this rewrites all " << num_leaves << " leaves (" << num_written_bytes << " bytes of the .lod)");
+
+                add_leaf_level(serializer, reduction_strgy, normal_strategy, radius_strategy);
+                ++num_added_levels;
             }
         }
 
-        // Iterate over nodes of current tree level.
-        // First apply reduction strategy, since calculation of attributes might depend on surfel data of nodes in same level.
-        if(level != int32_t(depth_))
+        input.close();
+        serializer.close();
+
+        state_ = state_type::after_upsweep;
+        serialize_tree_to_file(new_bvh_file.string(), false);
+    }
+    catch(...)
+    {
+        // the nodes in memory no longer match the files, the tree has to be loaded again
+        state_ = state_type::null;
+        try
+        {
+            input.close();
+            serializer.close();
+        }
+        catch(...) {}
+        try
+        {
+            roll_back_insertion();
+        }
+        catch(const std::exception &e)
+        {
+            LOGGER_ERROR("Failed to roll back the insertion, it is rolled back when the tree is loaded again. " << e.what());
+        }
+        throw;
+    }
+
+    // replacing the .bvh commits the insertion, the journal is obsolete then
+    fs::rename(new_bvh_file, bvh_file);
+    fs::remove(journal_file);
+}
+
+void bvh::roll_back_insertion() const
+{
+    const fs::path journal_file = add_to_path(base_path_, ".lod_journal");
+    const fs::path new_bvh_file = add_to_path(base_path_, ".bvh_insert");
+
+    // without the .bvh_insert the new .bvh is already in place
+    if(fs::exists(journal_file) && fs::exists(new_bvh_file))
+    {
+        LOGGER_WARN("Roll back an unfinished insertion into " << add_to_path(base_path_, ".lod"));
+        node_serializer::roll_back_journal(add_to_path(base_path_, ".lod").string(), journal_file.string());
+    }
+    fs::remove(journal_file);
+    fs::remove(new_bvh_file);
+}
+
+node_id_type bvh::find_insertion_leaf(const vec3r &position) const
+{
+    // descend into the child with the closest bounding box, so surfels
+    // outside of the tree end up in the leaf next to them
+    node_id_type node_id = 0;
+    while(node_id < first_leaf_)
+    {
+        node_id_type closest_child = get_child_id(node_id, 0);
+        real closest_distance_sqr = std::numeric_limits<real>::max();
+        for(uint32_t child_index = 0; child_index < fan_factor_; ++child_index)
         {
-            spawn_create_lod_jobs(first_node_of_level, last_node_of_level, reduction_strgy, resample);
+            const node_id_type child_id = get_child_id(node_id, child_index);
+            const bounding_box &box = nodes_[child_id].get_bounding_box();
+            if(box.is_invalid())
+            {
+                continue;
+            }
+
+            real distance_sqr = 0.0;
+            for(uint8_t axis = 0; axis < 3; ++axis)
+            {
+                const real outside = std::max(real(0.0), std::max(box.min()[axis] - position[axis], position[axis] - box.max()[axis]));
+                distance_sqr += outside * outside;
+            }
+            if(distance_sqr < closest_distance_sqr)
+            {
+                closest_distance_sqr = distance_sqr;
+                closest_child = child_id;
+            }
         }
+        node_id = closest_child;
+    }
+    return node_id;
+}
+
+std::pair<node_id_type, node_id_type> bvh::get_leaf_range(const node_id_type node_id) const
+{
+    node_id_type first = node_id;
+    node_id_type last = node_id;
+    while(first < first_leaf_)
+    {
+        first = get_child_id(first, 0);
+        last = get_child_id(last, fan_factor_ - 1);
+    }
+    return std::make_pair(first, last + 1);
+}
 
-        // skip the leaf level attribute computation if it was not requested or necessary
-        if((level != int32_t(depth_) || recompute_leaf_level))
+surfel_vector bvh::read_serialized_node(node_serializer &serializer, const node_id_type node_id) const
+{
+    surfel_vector surfels;
+    serializer.read_node_immediate(surfels, node_id);
+
+    // padding of the node slot and discarded surfels have a radius of zero
+    surfels.erase(std::remove_if(surfels.begin(), surfels.end(), [](const surfel &s) { return s.radius() <= 0.0; }), surfels.end());
+    return surfels;
+}
+
+void bvh::write_serialized_node(node_serializer &serializer, const node_id_type node_id) const
+{
+    const bvh_node &node = nodes_[node_id];
+    assert(node.mem_array().length() <= max_surfels_per_node_);
+
+    surfel_vector surfels(max_surfels_per_node_);
+    if(node.is_in_core())
+    {
+        for(size_t i = 0; i < std::min(node.mem_array().length(), max_surfels_per_node_); ++i)
         {
-            spawn_compute_attribute_jobs(first_node_of_level, last_node_of_level, normal_strategy, radius_strategy, false);
+            surfels[i] = node.mem_array().read_surfel(i);
         }
+    }
+    serializer.write_node_immediate(surfels, node_id);
+}
 
-        spawn_compute_bounding_boxes_upsweep_jobs(first_node_of_level, last_node_of_level, level);
+size_t bvh::insert_batch(surfel_vector &batch, node_serializer &serializer, const reduction_strategy &reduction_strgy, const normal_computation_strategy &normal_strategy,
+                         const radius_computation_strategy &radius_strategy, const bool recompute_leaf_level, const size_t max_subtree_surfels)
+{
+    std::vector<node_id_type> batch_leaves(batch.size());
+#pragma omp parallel for
+    for(size_t i = 0; i < batch.size(); ++i)
+    {
+        batch_leaves[i] = find_insertion_leaf(batch[i].pos());
+    }
 
-        std::cout << std::endl;
+    std::map<node_id_type, surfel_vector> inserted;
+    for(size_t i = 0; i < batch.size(); ++i)
+    {
+        inserted[batch_leaves[i]].push_back(batch[i]);
+    }
+    std::vector<node_id_type>().swap(batch_leaves);
+    surfel_vector().swap(batch);
 
-        real mean_radius_sd = 0.0;
-        unsigned counter = 1;
-        for(uint32_t node_index = first_node_of_level; node_index < last_node_of_level; ++node_index)
+    // serialized surfels of all leaves looked at so far
+    std::map<node_id_type, surfel_vector> existing;
+    auto load_leaf = [&](const node_id_type leaf_id) -> size_t {
+        auto it = existing.find(leaf_id);
+        if(it == existing.end())
         {
-            bvh_node *current_node = &nodes_.at(node_index);
+            it = existing.emplace(leaf_id, read_serialized_node(serializer, leaf_id)).first;
+        }
+        return it->second.size();
+    };
 
-            mean_radius_sd = mean_radius_sd + (*current_node).node_stats().radius_sd();
-            counter++;
+    // every leaf is rebuilt as part of the smallest enclosing subtree which
+    // can hold the existing and the inserted surfels of all its leaves. if
+    // no subtree within the budget can hold all of them, the subtree with
+    // the most room takes as many as fit and the rest stays in the batch
+    std::set<node_id_type> subtree_roots;
+    for(const auto &leaf_surfels : inserted)
+    {
+        bool is_covered = false;
+        for(node_id_type ancestor = leaf_surfels.first; !is_covered; ancestor = get_parent_id(ancestor))
+        {
+            is_covered = subtree_roots.count(ancestor) > 0;
+            if(ancestor == 0)
+                break;
+        }
+        if(is_covered)
+        {
+            continue;
+        }
 
-            // compute node offset in file
-            int32_t nid = current_node->node_id();
-            for(uint32_t write_level = 0; write_level < uint32_t(level); ++write_level)
-                nid -= uint32_t(pow(fan_factor_, write_level));
-            nid = std::max(0, nid);
+        node_id_type root = leaf_surfels.first;
+        node_id_type best_root = root;
+        size_t best_room = 0;
+        while(true)
+        {
+            const auto leaf_range = get_leaf_range(root);
+            size_t num_existing = 0;
+            for(node_id_type leaf_id = leaf_range.first; leaf_id < leaf_range.second; ++leaf_id)
+            {
+                num_existing += load_leaf(leaf_id);
+            }
+            size_t num_inserted = 0;
+            for(auto it = inserted.lower_bound(leaf_range.first); it != inserted.end() && it->first < leaf_range.second; ++it)
+            {
+                num_inserted += it->second.size();
+            }
 
-            // save computed node to disk
-            if (current_node->has_provenance()) {
-                current_node->flush_to_disk(level_temp_files[level], prov_temp_files[level], size_t(nid) * max_surfels_per_node_, false);
+            const size_t capacity = std::min(size_t(leaf_range.second - leaf_range.first) * max_surfels_per_node_, max_subtree_surfels);
+            if(num_existing + num_inserted <= capacity)
+            {
+                best_root = root;
+                best_room = num_inserted;
+                break;
             }
-            else {
-                current_node->flush_to_disk(level_temp_files[level], size_t(nid) * max_surfels_per_node_, false);
+            if(num_existing < capacity && capacity - num_existing > best_room)
+            {
+                best_root = root;
+                best_room = capacity - num_existing;
+            }
+            if(root == 0 || num_existing >= max_subtree_surfels)
+            {
+                break;
             }
+            root = get_parent_id(root);
+        }
+
+        if(best_room == 0)
+        {
+            continue;
+        }
+
+        // keep what fits into the subtree, the remaining surfels are not
+        // inserted in this pass
+        const auto leaf_range = get_leaf_range(best_root);
+        size_t room = best_room;
+        for(auto it = inserted.lower_bound(leaf_range.first); it != inserted.end() && it->first < leaf_range.second; ++it)
+        {
+            const size_t num_kept = std::min(room, it->second.size());
+            batch.insert(batch.end(), it->second.begin() + num_kept, it->second.end());
+            it->second.resize(num_kept);
+            room -= num_kept;
         }
-        mean_radius_sd = mean_radius_sd / counter;
-        std::cout << "average radius deviation pro level: " << mean_radius_sd << "\n";
+        subtree_roots.insert(best_root);
     }
 
-    // TODO: Inject a call to provenance method, collecting level data into one file
-    /*
-    reduction_strategy *p_reduction_strgy = (reduction_strategy *)&reduction_strgy;
-    if(reduction_strategy_provenance *cast = dynamic_cast<reduction_strategy_provenance *>(p_reduction_strgy))
+    // a subtree may contain roots that were found before it
+    std::vector<node_id_type> rebuilt_roots;
+    for(const node_id_type root : subtree_roots)
     {
-        uint16_t w_level = 0;
+        bool is_nested = false;
+        for(node_id_type ancestor = root; ancestor != 0 && !is_nested;)
+        {
+            ancestor = get_parent_id(ancestor);
+            is_nested = subtree_roots.count(ancestor) > 0;
+        }
+        if(!is_nested)
+        {
+            rebuilt_roots.push_back(root);
+        }
+    }
 
-        while(w_level <= depth_)
+    // surfels of leaves outside of all subtrees wait for the next pass
+    size_t num_inserted = 0;
+    for(auto &leaf_surfels : inserted)
+    {
+        bool is_rebuilt = false;
+        for(node_id_type ancestor = leaf_surfels.first; !is_rebuilt; ancestor = get_parent_id(ancestor))
         {
-            std::cout << "Entering w_level: " << w_level << std::endl;
+            is_rebuilt = subtree_roots.count(ancestor) > 0;
+            if(ancestor == 0)
+                break;
+        }
+        if(is_rebuilt)
+        {
+            num_inserted += leaf_surfels.second.size();
+        }
+        else
+        {
+            batch.insert(batch.end(), leaf_surfels.second.begin(), leaf_surfels.second.end());
+            surfel_vector().swap(leaf_surfels.second);
+        }
+    }
 
-            const uint32_t first_node_of_level = get_first_node_id_of_depth(w_level);
-            const uint32_t last_node_of_level = get_first_node_id_of_depth(w_level) + get_length_of_depth(w_level) - 1;
+    // split the surfels of every subtree down to its leaves again
+    std::vector<node_id_type> changed_leaves;
+    for(const node_id_type root : rebuilt_roots)
+    {
+        const auto leaf_range = get_leaf_range(root);
+        auto surfels = std::make_shared<surfel_vector>();
+        for(node_id_type leaf_id = leaf_range.first; leaf_id < leaf_range.second; ++leaf_id)
+        {
+            const surfel_vector &leaf_surfels = existing[leaf_id];
+            surfels->insert(surfels->end(), leaf_surfels.begin(), leaf_surfels.end());
+            auto it = inserted.find(leaf_id);
+            if(it != inserted.end())
+            {
+                surfels->insert(surfels->end(), it->second.begin(), it->second.end());
+            }
+            changed_leaves.push_back(leaf_id);
+        }
 
-            uint16_t percentage = 0;
+        const uint32_t root_depth = get_depth_of_node(root);
+        surfel_mem_array root_array(surfels, 0, surfels->size());
+        nodes_[root] = bvh_node(root, root_depth, basic_algorithms::compute_aabb(root_array), root_array);
 
-            uint32_t w_node = first_node_of_level;
+        node_id_type slice_left = root;
+        node_id_type slice_right = root;
+        for(uint32_t level = root_depth; level < depth_; ++level)
+        {
+            for(node_id_type node_id = slice_left; node_id <= slice_right; ++node_id)
+            {
+                bvh_node &current_node = nodes_[node_id];
+                split_node(node_id, current_node.get_bounding_box(), true);
+                current_node.reset();
+            }
+            slice_left = get_child_id(slice_left, 0);
+            slice_right = get_child_id(slice_right, fan_factor_ - 1);
+        }
+    }
+    std::map<node_id_type, surfel_vector>().swap(existing);
+    std::map<node_id_type, surfel_vector>().swap(inserted);
 
-            while(w_node <= last_node_of_level)
+    if(changed_leaves.empty())
+    {
+        return 0;
+    }
+
+    // subtrees of different depth do not list their leaves in id order
+    std::sort(changed_leaves.begin(), changed_leaves.end());
+
+    LOGGER_INFO("Rebuild " << rebuilt_roots.size() << " subtrees with " << changed_leaves.size() << " leaves");
+
+    if(recompute_leaf_level)
+    {
+        knn_index index;
+        index.build(nodes_, changed_leaves.front(), changed_leaves.back() + 1);
+        for(const node_id_type leaf_id : changed_leaves)
+        {
+            if(nodes_[leaf_id].is_in_core())
             {
-                // std::cout << "Entering w_node: " << w_node << std::endl;
+                scheduler_.add_task([=, &index, &normal_strategy, &radius_strategy] { compute_attributes(leaf_id, normal_strategy, radius_strategy, false, index); });
+            }
+        }
+        scheduler_.wait();
+    }
 
-                if(w_level < depth_)
-                {
-                    bvh_node *current_node = &nodes_.at(w_node);
-                    cast->pack_node(w_node, max_surfels_per_node_, (*current_node).disk_array().length());
-                }
-                else
+    for(const node_id_type leaf_id : changed_leaves)
+    {
+        if(nodes_[leaf_id].is_in_core() && nodes_[leaf_id].mem_array().length() > 0)
+        {
+            compute_bounding_box_upsweep(leaf_id, depth_);
+        }
+        write_serialized_node(serializer, leaf_id);
+    }
+
+    // ancestors of the changed leaves, level by level
+    std::vector<std::vector<node_id_type>> affected_levels(depth_);
+    std::set<node_id_type> affected_nodes;
+    for(const node_id_type leaf_id : changed_leaves)
+    {
+        for(node_id_type node_id = leaf_id; node_id != 0;)
+        {
+            node_id = get_parent_id(node_id);
+            if(!affected_nodes.insert(node_id).second)
+                break;
+        }
+    }
+    for(const node_id_type node_id : affected_nodes)
+    {
+        affected_levels[get_depth_of_node(node_id)].push_back(node_id);
+    }
+
+    for(int32_t level = int32_t(depth_) - 1; level >= 0; --level)
+    {
+        const std::vector<node_id_type> &level_nodes = affected_levels[level];
+
+        // unchanged children are reduced from their serialized surfels,
+        // nodes above empty leaves only stay empty
+        std::vector<node_id_type> reduced_nodes;
+        for(const node_id_type node_id : level_nodes)
+        {
+            size_t num_child_surfels = 0;
+            for(uint32_t child_index = 0; child_index < fan_factor_; ++child_index)
+            {
+                bvh_node &child_node = nodes_[get_child_id(node_id, child_index)];
+                if(!child_node.is_in_core())
                 {
-                    cast->pack_empties(max_surfels_per_node_);
+                    auto surfels = std::make_shared<surfel_vector>(read_serialized_node(serializer, child_node.node_id()));
+                    child_node.reset(surfel_mem_array(surfels, 0, surfels->size()));
                 }
-
-                w_node++;
+                num_child_surfels += child_node.mem_array().length();
+            }
+            nodes_[node_id].reset();
+            if(num_child_surfels > 0)
+            {
+                reduced_nodes.push_back(node_id);
+            }
+            else
+            {
+                nodes_[node_id].set_bounding_box(bounding_box());
             }
+        }
 
-            uint16_t new_percentage = (uint16_t)int16_t(float(w_level) / (depth_)*100);
-            if(percentage < new_percentage)
+        for(const node_id_type node_id : reduced_nodes)
+        {
+            scheduler_.add_task([=, &reduction_strgy] { create_lod(node_id, reduction_strgy, false); });
+        }
+        scheduler_.wait();
+
+        if(!reduced_nodes.empty())
+        {
+            knn_index index;
+            index.build(nodes_, reduced_nodes.front(), reduced_nodes.back() + 1);
+            for(const node_id_type node_id : reduced_nodes)
             {
-                percentage = new_percentage;
-                std::cout << "\r" << percentage << "% processed" << std::flush;
+                scheduler_.add_task([=, &index, &normal_strategy, &radius_strategy] { compute_attributes(node_id, normal_strategy, radius_strategy, false, index); });
             }
+            scheduler_.wait();
+        }
 
-            w_level++;
+        for(const node_id_type node_id : level_nodes)
+        {
+            if(nodes_[node_id].mem_array().length() > 0)
+            {
+                compute_bounding_box_upsweep(node_id, level);
+            }
+            write_serialized_node(serializer, node_id);
+            unload_children(node_id);
         }
     }
-    */
+    nodes_[0].reset();
 
-    state_ = state_type::after_upsweep;
+    return num_inserted;
 }
 
-void bvh::resample()
+void bvh::split_node(const node_id_type node_id, const bounding_box &box, const bool parallelize)
 {
-    uint32_t first_node_of_level = get_first_node_id_of_depth(depth_);
-    uint32_t last_node_of_level = get_first_node_id_of_depth(depth_) + get_length_of_depth(depth_);
+    bvh_node &current_node = nodes_[node_id];
+    const uint32_t child_depth = current_node.depth() + 1;
 
-    // Loading is not thread-safe, so load everything before starting parallel operations.
-    for(uint32_t node_index = first_node_of_level; node_index < last_node_of_level; ++node_index)
+    // a node with fewer surfels than children is not split, its first
+    // children take one surfel each and the others stay empty
+    basic_algorithms::splitted_array<surfel_mem_array> surfel_arrays;
+    const size_t length = current_node.mem_array().length();
+    if(length >= fan_factor_)
     {
-        bvh_node *current_node = &nodes_.at(node_index);
-        // if necessary, load leaf-depth_ nodes from disk
-        if(depth_ == int32_t(depth_) && current_node->is_out_of_core())
+        basic_algorithms::sort_and_split(current_node.mem_array(), surfel_arrays, box, box.get_longest_axis(), fan_factor_, parallelize);
+    }
+    else
+    {
+        for(size_t i = 0; i < length; ++i)
         {
-            current_node->load_from_disk();
+            const surfel_mem_array child_array(current_node.mem_array(), current_node.mem_array().offset() + i, 1);
+            surfel_arrays.push_back(std::make_pair(child_array, basic_algorithms::compute_aabb(child_array, false)));
         }
     }
 
-    uint16_t number_of_neighbours = 175;
-    auto normal_comp_algo = normal_computation_plane_fitting(number_of_neighbours);
-    auto radius_comp_algo = radius_computation_average_distance(number_of_neighbours, 1.0f);
-    spawn_compute_attribute_jobs(first_node_of_level, last_node_of_level, normal_comp_algo, radius_comp_algo, false);
+    for(uint32_t child_index = 0; child_index < fan_factor_; ++child_index)
+    {
+        const node_id_type child_id = get_child_id(node_id, child_index);
+        if(child_index < surfel_arrays.size())
+        {
+            nodes_[child_id] = bvh_node(child_id, child_depth, surfel_arrays[child_index].second, surfel_arrays[child_index].first);
+        }
+        else
+        {
+            nodes_[child_id] = bvh_node(child_id, child_depth, bounding_box());
+        }
+    }
+}
 
-    // spawn_resample jobs directly instead of calling another function
-    uint32_t const num_threads = std::thread::hardware_concurrency();
+void bvh::add_leaf_level(node_serializer &serializer, const reduction_strategy &reduction_strgy, const normal_computation_strategy &normal_strategy,
+                         const radius_computation_strategy &radius_strategy)
+{
+    const node_id_type old_first_leaf = first_leaf_;
+    const node_id_type old_num_nodes = nodes_.size();
 
-    working_queue_head_counter_.initialize(first_node_of_level); // let the threads fetch a node idx
-    std::vector<std::thread> threads;
+    ++depth_;
+    nodes_.resize(old_num_nodes + get_length_of_depth(depth_));
+    first_leaf_ = old_num_nodes;
 
-    for(uint32_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
-    {
-        bool update_percentage = (0 == thread_idx);
-        threads.push_back(std::thread(&bvh::thread_resample, this, first_node_of_level, last_node_of_level, update_percentage));
-    }
+    LOGGER_INFO("Add leaf level " << depth_ << ", the tree has " << nodes_.size() << " nodes now");
 
-    for(auto &thread : threads)
-    {
-        thread.join();
-    }
+    // the children of the old leaves are appended to the .lod file in order
+    const size_t chunk_size = std::max(size_t(1), memory_limit_ / (4 * max_surfels_per_node_ * fan_factor_ * sizeof(surfel)));
 
-    real mean_radius_sd = 0.0;
-    unsigned counter = 1;
-    for(uint32_t node_index = first_node_of_level; node_index < last_node_of_level; ++node_index)
+    for(node_id_type chunk_begin = old_first_leaf; chunk_begin < old_num_nodes; chunk_begin += chunk_size)
     {
-        bvh_node *current_node = &nodes_.at(node_index);
+        const node_id_type chunk_end = node_id_type(std::min(size_t(chunk_begin) + chunk_size, size_t(old_num_nodes)));
 
-        mean_radius_sd = mean_radius_sd + (*current_node).node_stats().radius_sd();
-        counter++;
-    }
-    mean_radius_sd = mean_radius_sd / counter;
-    std::cout << "average radius deviation pro level: " << mean_radius_sd << "\n";
+        for(node_id_type node_id = chunk_begin; node_id < chunk_end; ++node_id)
+        {
+            auto surfels = std::make_shared<surfel_vector>(read_serialized_node(serializer, node_id));
+            nodes_[node_id].reset(surfel_mem_array(surfels, 0, surfels->size()));
+        }
 
-    state_ = state_type::after_upsweep;
+        for(node_id_type node_id = chunk_begin; node_id < chunk_end; ++node_id)
+        {
+            scheduler_.add_task([=, &reduction_strgy, &normal_strategy, &radius_strategy] {
+                bvh_node &current_node = nodes_[node_id];
+                const int32_t level = depth_ - 1;
+
+                if(current_node.mem_array().length() == 0)
+                {
+                    split_node(node_id, bounding_box(), false);
+                    current_node.reset();
+                    return;
+                }
+
+                split_node(node_id, basic_algorithms::compute_aabb(current_node.mem_array(), false), false);
+                for(uint32_t child_index = 0; child_index < fan_factor_; ++child_index)
+                {
+                    const node_id_type child_id = get_child_id(node_id, child_index);
+                    if(nodes_[child_id].mem_array().length() > 0)
+                    {
+                        compute_bounding_box_upsweep(child_id, depth_);
+                    }
+                }
+
+                current_node.reset();
+                create_lod(node_id, reduction_strgy, false);
+
+                knn_index index;
+                index.build(nodes_, node_id, node_id + 1);
+                compute_attributes(node_id, normal_strategy, radius_strategy, false, index);
+                compute_bounding_box_upsweep(node_id, level);
+            });
+        }
+        scheduler_.wait();
+
+        for(node_id_type node_id = chunk_begin; node_id < chunk_end; ++node_id)
+        {
+            for(uint32_t child_index = 0; child_index < fan_factor_; ++child_index)
+            {
+                write_serialized_node(serializer, get_child_id(node_id, child_index));
+            }
+            write_serialized_node(serializer, node_id);
+            unload_children(node_id);
+            nodes_[node_id].reset();
+        }
+    }
 }
 
 surfel_vector bvh::remove_outliers_statistically(uint32_t num_outliers, uint16_t num_neighbours)
 {
     std::vector<std::vector<std::pair<surfel_id_t, real>>> intermediate_outliers;
 
-    uint32_t const num_threads = std::thread::hardware_concurrency();
+    uint32_t const num_threads = scheduler_.num_threads();
     intermediate_outliers.resize(num_threads);
     // already_resized.resize(omp_get_max_threads())
 
@@ -1628,21 +2986,21 @@ surfel_vector bvh::remove_outliers_statistically(uint32_t num_outliers, uint16_t
         }
     }
 
+    level_index_.build(nodes_, first_leaf_, nodes_.size());
+
     working_queue_head_counter_.initialize(first_leaf_);
-    std::vector<std::thread> threads;
 
     for(uint32_t thread_idx = 0; thread_idx < num_threads; ++thread_idx)
     {
-        //start thread to remove outliers on subset of surfels
-        threads.push_back(std::thread(&bvh::thread_remove_outlier_jobs, this, 
-                                       first_leaf_, nodes_.size(), num_outliers, num_neighbours, 
-                                       std::ref(intermediate_outliers[thread_idx])));
+        //start job to remove outliers on subset of surfels
+        scheduler_.add_task(std::bind(&bvh::thread_remove_outlier_jobs, this, 
+                                      first_leaf_, nodes_.size(), num_outliers, num_neighbours, 
+                                      std::ref(intermediate_outliers[thread_idx])));
     }
 
-    for(auto& thread : threads)
-    {
-        thread.join();
-    }
+    scheduler_.wait();
+
+    level_index_.clear();
 
     std::vector<std::pair<surfel_id_t, real>> final_outliers;
 
@@ -1711,7 +3069,8 @@ surfel_vector bvh::remove_outliers_statistically(uint32_t num_outliers, uint16_t
     return cleaned_surfels;
 }
 
-void bvh::serialize_tree_to_file(const std::string &output_file, bool write_intermediate_data)
+void bvh::serialize_tree_to_file(const std::string &output_file, bool write_intermediate_data, const bool quantized,
+                                 const std::vector<uint64_t> &lod_block_offsets)
 {
     LOGGER_TRACE("Serialize bvh to file: \"" << output_file << "\"");
 
@@ -1722,21 +3081,29 @@ void bvh::serialize_tree_to_file(const std::string &output_file, bool write_inte
     }
 
     bvh_stream bvh_strm;
-    bvh_strm.write_bvh(output_file, *this, write_intermediate_data);
+    bvh_strm.write_bvh(output_file, *this, write_intermediate_data, quantized, lod_block_offsets);
 }
 
-void bvh::serialize_surfels_to_file(const std::string &lod_output_file, const std::string &prov_output_file, const size_t buffer_size) const
+std::vector<uint64_t> bvh::serialize_surfels_to_file(const std::string &lod_output_file, const std::string &prov_output_file, const size_t buffer_size,
+                                                     const bool quantize, const int compression_level) const
 {
     LOGGER_TRACE("Serialize surfels to file: \"" << lod_output_file << "\"");
-    node_serializer serializer(max_surfels_per_node_, buffer_size);
+    node_serializer serializer(max_surfels_per_node_, buffer_size, quantize, compression_level);
     serializer.open(lod_output_file);
     serializer.serialize_nodes(nodes_);
     serializer.close();
+
+    std::vector<uint64_t> lod_block_offsets;
+    if (serializer.is_compressed()) {
+      lod_block_offsets = serializer.block_offsets();
+    }
+
     if (nodes_[0].has_provenance()) {
       serializer.open(prov_output_file);
       serializer.serialize_prov(nodes_);
       serializer.close();
     }
+    return lod_block_offsets;
 }
 
 void bvh::reset_nodes()
@@ -7,6 +7,8 @@
 
 #include <lamure/pre/bvh_node.h>
 
+#include <algorithm>
+
 namespace lamure
 {
 namespace pre
@@ -91,6 +93,27 @@ load_from_disk()
     }
 }
 
+void bvh_node::
+load_from_disk_compact(const size_t buffer_size,
+                       const vec3r &translation)
+{
+    assert(is_out_of_core());
+    assert(!has_provenance());
+
+    const size_t length = disk_array_.length();
+    surfel_vector buffer(std::min(std::max(size_t(1), buffer_size / sizeof(surfel)), length));
+
+    auto soa_mem_data = std::make_shared<surfel_soa>(bounding_box_.get_center());
+    soa_mem_data->reserve(length);
+    for (size_t first = 0; first < length; first += buffer.size()) {
+        const size_t chunk_length = std::min(buffer.size(), length - first);
+        disk_array_.get_file()->read(&buffer, 0, disk_array_.offset() + first, chunk_length);
+        soa_mem_data->append(buffer, 0, chunk_length, translation);
+    }
+
+    mem_array_.reset(soa_mem_data, 0, length);
+}
+
 void bvh_node::
 flush_to_disk(const shared_surfel_file &file,
               const size_t offset_in_file,
@@ -99,7 +122,12 @@ flush_to_disk(const shared_surfel_file &file,
     assert(is_in_core());
 
     disk_array_.reset(file, offset_in_file, mem_array_.length());
-    disk_array_.write_all(mem_array_.surfel_mem_data(), mem_array_.offset());
+    if (mem_array_.is_compact()) {
+        disk_array_.write_all(mem_array_.copy_surfels(), 0);
+    }
+    else {
+        disk_array_.write_all(mem_array_.surfel_mem_data(), mem_array_.offset());
+    }
 
 
     if (dealloc_mem_array)
@@ -131,6 +159,9 @@ flush_to_disk(const bool dealloc_mem_array)
       disk_array_.write_all(mem_array_.surfel_mem_data(), mem_array_.prov_mem_data(), mem_array_.offset());
 
     }
+    else if (mem_array_.is_compact()) {
+      disk_array_.write_all(mem_array_.copy_surfels(), 0);
+    }
     else {
       disk_array_.write_all(mem_array_.surfel_mem_data(), mem_array_.offset());
     }
@@ -8,6 +8,8 @@
 #include <lamure/pre/bvh_stream.h>
 
 #include <lamure/pre/serialized_surfel.h>
+#include <lamure/pre/serialized_surfel_qz.h>
+#include <lamure/lod_block.h>
 
 namespace lamure
 {
@@ -151,6 +153,7 @@ read_bvh(const std::string &filename, bvh &bvh)
     uint32_t tree_ext_id = 0;
     uint32_t node_id = 0;
     uint32_t node_ext_id = 0;
+    bool lod_compressed = false;
 
 
     //go through entire stream and fetch the segments
@@ -226,6 +229,11 @@ read_bvh(const std::string &filename, bvh &bvh)
                 }
                 break;
             }
+            case 'L': { //"BVHXLODB"
+                //block offsets of a compressed .lod, only used by the renderer
+                lod_compressed = true;
+                break;
+            }
             default: {
                 throw std::runtime_error(
                     "PLOD: bvh_stream::file corrupt -- Invalid segment encountered");
@@ -372,12 +380,14 @@ read_bvh(const std::string &filename, bvh &bvh)
 
     bvh.set_first_leaf(tree.num_nodes_ - std::pow(tree.fan_factor_, tree.depth_));
     bvh.set_state(current_state);
+    bvh.set_lod_format(tree.primitive_ == BVH_POINTCLOUD_QZ, lod_compressed);
     bvh.set_nodes(bvh_nodes);
 
 }
 
 void bvh_stream::
-write_bvh(const std::string& filename, bvh& bvh, const bool intermediate) {
+write_bvh(const std::string& filename, bvh& bvh, const bool intermediate, const bool quantized,
+          const std::vector<uint64_t>& lod_block_offsets) {
 
    open_stream(filename, bvh_stream_type::BVH_STREAM_OUT);
 
@@ -407,7 +417,8 @@ write_bvh(const std::string& filename, bvh& bvh, const bool intermediate) {
    tree.num_nodes_ = bvh.nodes().size();
    tree.fan_factor_ = bvh.fan_factor();
    tree.max_surfels_per_node_ = bvh.max_surfels_per_node();
-   tree.serialized_surfel_size_ = serialized_surfel::get_size();
+   tree.serialized_surfel_size_ = quantized ? serialized_surfel_qz::get_size() : serialized_surfel::get_size();
+   tree.primitive_ = quantized ? BVH_POINTCLOUD_QZ : BVH_POINTCLOUD;
    tree.reserved_0_ = 0;
    tree.state_ = (bvh_stream::bvh_tree_state)bvh.state();
    tree.reserved_1_ = 0;
@@ -537,6 +548,19 @@ write_bvh(const std::string& filename, bvh& bvh, const bool intermediate) {
        }
    }
 
+   if (!lod_block_offsets.empty()) {
+       assert(lod_block_offsets.size() == bvh_nodes.size() + 1);
+
+       bvh_lod_block_seg lod_blocks;
+       lod_blocks.segment_id_ = num_segments_++;
+       lod_blocks.codec_ = lod_block::CODEC_ZLIB;
+       lod_blocks.reserved_ = 0;
+       lod_blocks.num_blocks_ = bvh_nodes.size();
+       lod_blocks.block_offsets_ = lod_block_offsets;
+
+       write(lod_blocks);
+   }
+
    close_stream(false);
 
    std::cout << "BVH serialization successful" << std::endl;
@@ -1,7 +1,7 @@
 // Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
 // This Software is distributed under the Modified BSD License, see license.txt.
 //
-// Virtual Reality and Visualization Research Group 
+// Virtual Reality and Visualization Research Group
 // Faculty of Media, Bauhaus-Universitaet Weimar
 // http://www.uni-weimar.de/medien/vr
 
@@ -13,6 +13,8 @@
 #include <parallel/algorithm>
 #endif
 
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 
 namespace lamure
@@ -26,31 +28,173 @@ const size_t MIN_MERGE_BUFFER_SIZE = 3;
 
 const std::string TEMP_FILE_EXT = ".runs";
 
+namespace
+{
+
+template <uint8_t axis>
+struct position_less
+{
+    bool operator()(const surfel &left, const surfel &right) const
+    { return left.pos()[axis] < right.pos()[axis]; }
+};
+
+}
+
+external_sort::io_thread::
+io_thread()
+    : thread_(&io_thread::work, this)
+{}
+
+external_sort::io_thread::
+~io_thread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    operation_ready_.notify_one();
+    thread_.join();
+}
+
+std::future<void> external_sort::io_thread::
+submit(const std::function<void()> &operation)
+{
+    std::packaged_task<void()> task(operation);
+    std::future<void> result = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        operations_.push_back(std::move(task));
+    }
+    operation_ready_.notify_one();
+    return result;
+}
+
+void external_sort::io_thread::
+work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        operation_ready_.wait(lock, [this] { return shutdown_ || !operations_.empty(); });
+        if (operations_.empty()) {
+            return;
+        }
+
+        std::packaged_task<void()> operation = std::move(operations_.front());
+        operations_.pop_front();
+
+        lock.unlock();
+        operation();
+        lock.lock();
+    }
+}
+
+external_sort::run_reader::
+run_reader(const surfel_disk_array &run, const size_t buffer_size, io_thread &reader)
+    : run_(run),
+      current_(std::min(buffer_size, run.length())),
+      next_(std::min(buffer_size, run.length())),
+      current_length_(0),
+      next_length_(0),
+      pos_(0),
+      file_offset_(0)
+{
+    prefetch(reader);
+    advance(reader);
+}
+
+external_sort::run_reader::
+~run_reader()
+{
+    // the background read must not outlive the buffer it fills
+    if (pending_read_.valid()) {
+        pending_read_.wait();
+    }
+}
+
+void external_sort::run_reader::
+pop_front(io_thread &reader)
+{
+    assert(pos_ < current_length_);
+
+    if (++pos_ == current_length_) {
+        advance(reader);
+    }
+}
+
+void external_sort::run_reader::
+prefetch(io_thread &reader)
+{
+    next_length_ = std::min(next_.size(), run_.length() - file_offset_);
+    if (next_length_ == 0) {
+        return;
+    }
+
+    const size_t offset_in_file = run_.offset() + file_offset_;
+    const size_t length = next_length_;
+    file_offset_ += length;
+
+    pending_read_ = reader.submit([this, offset_in_file, length]
+    {
+        run_.get_file()->read(&next_, 0, offset_in_file, length);
+    });
+}
+
+void external_sort::run_reader::
+advance(io_thread &reader)
+{
+    pos_ = 0;
+    current_length_ = 0;
+
+    if (pending_read_.valid()) {
+        pending_read_.get();
+        std::swap(current_, next_);
+        current_length_ = next_length_;
+        prefetch(reader);
+    }
+}
+
 external_sort::
-external_sort(const size_t memory_limit,
-              const surfel::compare_function &compare)
+external_sort(const size_t memory_limit)
     : memory_limit_(memory_limit),
-      compare_(compare),
       runs_file_(std::make_shared<surfel_file>())
 {}
 
 void external_sort::
 sort(surfel_disk_array &array,
      const size_t memory_limit,
-     const surfel::compare_function &compare)
+     const uint8_t axis)
 {
     assert(!array.is_empty());
     assert(array.get_file());
+    assert(axis <= 2);
 
     if (!array.length())
         return;
 
-    external_sort es(memory_limit, compare);
+    external_sort es(memory_limit);
 
-    // compute sort parameters
-    const size_t run_length = memory_limit / sizeof(surfel) / 3u;
+    // the comparator is resolved once per sort instead of once per comparison
+    switch (axis) {
+        case 0: es.sort(array, position_less<0>());
+            break;
+        case 1: es.sort(array, position_less<1>());
+            break;
+        case 2: es.sort(array, position_less<2>());
+            break;
+    }
+}
+
+template <class Compare>
+void external_sort::
+sort(surfel_disk_array &array, const Compare &compare)
+{
+    // three runs are in memory during run creation: one is read,
+    // one is sorted and one is written. during the merge every run and
+    // the output own two buffers
+    const size_t run_length = memory_limit_ / sizeof(surfel) / 3u;
     const uint32_t runs_count = std::ceil(array.length() / double(run_length));
-    const size_t merge_buffer_size = memory_limit / sizeof(surfel) / (runs_count + 1u);
+    size_t merge_buffer_size = memory_limit_ / sizeof(surfel) / (2u * (runs_count + 1u));
 
     LOGGER_INFO("External sort. Length: " << array.length());
     LOGGER_INFO("Max run length: " << run_length <<
@@ -64,39 +208,50 @@ sort(surfel_disk_array &array,
                                                                   MAX_RUNS_COUNT << " runs.");
     }
 
-    if (merge_buffer_size < MIN_MERGE_BUFFER_SIZE)
+    if (merge_buffer_size < MIN_MERGE_BUFFER_SIZE) {
         LOGGER_WARN("External sort has been called with an inadequate "
                         "memory limit, which forces merge algorithm to allocate "
                         "buffers that store less than " <<
                                                         MIN_MERGE_BUFFER_SIZE << " surfels.");
+        merge_buffer_size = MIN_MERGE_BUFFER_SIZE;
+    }
 
     if (runs_count > 1u) {
         // external sort
-        es.runs_file_->open(array.get_file()->file_name() + TEMP_FILE_EXT, true);
+        runs_file_->open(array.get_file()->file_name() + TEMP_FILE_EXT, true);
         LOGGER_TRACE("create runs");
-        es.create_runs(array, run_length, runs_count);
+        create_runs(array, run_length, runs_count, compare);
         LOGGER_TRACE("merge");
-        es.merge(array, merge_buffer_size);
-        es.runs_file_->close(true);
-        es.runs_.clear();
+        merge(array, merge_buffer_size, compare);
+        runs_file_->close(true);
+        runs_.clear();
     }
     else {
         // internal sort for a single run
-        shared_surfel_vector data = array.read_all();
+        sort_in_core(array, compare);
+    }
+}
+
+template <class Compare>
+void external_sort::
+sort_in_core(surfel_disk_array &array, const Compare &compare)
+{
+    shared_surfel_vector data = array.read_all();
 
 #if WIN32
-        Concurrency::parallel_sort(data->begin(), data->end(), es.compare_);
+    Concurrency::parallel_sort(data->begin(), data->end(), compare);
 #else
-        __gnu_parallel::sort(data->begin(), data->end(), es.compare_);
+    __gnu_parallel::sort(data->begin(), data->end(), compare);
 #endif
-        array.write_all(data, 0);
-    }
+    array.write_all(data, 0);
 }
 
+template <class Compare>
 void external_sort::
 create_runs(surfel_disk_array &array,
             const size_t run_length,
-            const uint32_t runs_count)
+            const uint32_t runs_count,
+            const Compare &compare)
 {
     // construct runs' surfel_disk_arrays
     size_t offset = 0;
@@ -107,99 +262,152 @@ create_runs(surfel_disk_array &array,
     runs_.push_back(surfel_disk_array(array, array.offset() + offset,
                                       array.length() - offset));
 
-    assert(std::accumulate(runs_.begin(), runs_.end(), 0u,
+    assert(std::accumulate(runs_.begin(), runs_.end(), size_t(0),
                            [](const size_t &a,
                               const surfel_disk_array &b)
                            { return a + b.length(); }) ==
         array.length());
-    // sort the runs
+
+    // run i is sorted while run i + 1 is read and run i - 1 is written
     shared_surfel_vector next_data;
+    std::future<void> pending_read = reader_.submit([this, &next_data]
+    {
+        next_data = runs_.front().read_all();
+    });
+    std::future<void> pending_write;
 
     for (uint32_t i = 0; i < runs_.size(); ++i) {
+        pending_read.get();
+        shared_surfel_vector data = next_data;
 
-        shared_surfel_vector data;
-
-        if (next_data) {
-            data = next_data;
-            next_data.reset();
-        }
-        else {
-            LOGGER_TRACE("read run " << i);
-            data = runs_[i].read_all();
+        if (i + 1 < runs_.size()) {
+            LOGGER_TRACE("read run " << i + 1);
+            pending_read = reader_.submit([this, &next_data, i]
+            {
+                next_data = runs_[i + 1].read_all();
+            });
         }
 
-#pragma omp parallel sections
-        {
-            {
-                LOGGER_TRACE("sort run " << i);
+        LOGGER_TRACE("sort run " << i);
 #if WIN32
-                Concurrency::parallel_sort(data->begin(), data->end(), compare_);
+        Concurrency::parallel_sort(data->begin(), data->end(), compare);
 #else
-                __gnu_parallel::sort(data->begin(), data->end(), compare_);
+        __gnu_parallel::sort(data->begin(), data->end(), compare);
 #endif
-            }
-#pragma omp section
-            {
-                if (i + 1 < runs_.size()) {
-                    LOGGER_TRACE("read run " << i + 1);
-                    next_data = runs_[i + 1].read_all();
-                }
-            }
+
+        if (pending_write.valid()) {
+            pending_write.get();
         }
         LOGGER_TRACE("Save run " << i);
-        runs_file_->append(&(*data));
+        pending_write = writer_.submit([this, data]
+        {
+            runs_file_->append(&(*data));
+        });
         runs_[i].reset(runs_file_, runs_[i].offset() - array.offset(),
                        runs_[i].length());
     }
+
+    pending_write.get();
 }
 
+template <class Compare>
 void external_sort::
-merge(surfel_disk_array &array, const size_t buffer_size)
+merge(surfel_disk_array &array,
+      const size_t buffer_size,
+      const Compare &compare)
 {
-    size_t file_offset = 0;
-    surfel_vector output;
-    output.reserve(buffer_size);
+    const size_t runs_count = runs_.size();
 
-    std::vector<buffer> buffers;
-    for (auto r: runs_)
-        buffers.push_back(buffer(r, buffer_size));
+    std::vector<std::unique_ptr<run_reader>> readers;
+    readers.reserve(runs_count);
+    for (const auto &r : runs_) {
+        readers.emplace_back(new run_reader(r, buffer_size, reader_));
+    }
 
-    surfel least;
-    int least_idx;
+    // exhausted runs compare greater than every surfel, ties are broken
+    // by the run index
+    auto run_less = [&](const size_t left_run, const size_t right_run)
+    {
+        const surfel *left = readers[left_run]->front();
+        const surfel *right = readers[right_run]->front();
+        if (!left || !right) {
+            return !right && (left || left_run < right_run);
+        }
+        if (compare(*left, *right)) {
+            return true;
+        }
+        if (compare(*right, *left)) {
+            return false;
+        }
+        return left_run < right_run;
+    };
+
+    // loser tree: leaf of run r is node runs_count + r, the inner nodes
+    // 1 .. runs_count - 1 hold the loser of their match and node 0 the winner
+    std::vector<size_t> tree(runs_count);
+    {
+        std::vector<size_t> winners(2 * runs_count);
+        for (size_t r = 0; r < runs_count; ++r) {
+            winners[runs_count + r] = r;
+        }
+        for (size_t node = runs_count - 1; node > 0; --node) {
+            const size_t left = winners[2 * node];
+            const size_t right = winners[2 * node + 1];
+            const bool left_wins = run_less(left, right);
+            winners[node] = left_wins ? left : right;
+            tree[node] = left_wins ? right : left;
+        }
+        tree[0] = winners[1];
+    }
 
-    do {
-        least_idx = -1;
-        for (size_t i = 0; i < buffers.size(); ++i) {
-            surfel current_surfel;
+    surfel_vector output(buffer_size);
+    surfel_vector written_output(buffer_size);
+    size_t output_length = 0;
+    size_t file_offset = 0;
+    std::future<void> pending_write;
 
-            if (buffers[i].front(current_surfel) && (least_idx == -1 ||
-                compare_(current_surfel, least))) {
-                least = current_surfel;
-                least_idx = i;
-            }
+    auto flush = [&]()
+    {
+        if (pending_write.valid()) {
+            pending_write.get();
         }
-        if (least_idx != -1) {
-            buffers[least_idx].pop_front();
-            output.push_back(least);
-            if (output.size() >= buffer_size) {
-                array.get_file()->write(&output, 0, array.offset() + file_offset,
-                                    output.size());
-                file_offset += output.size();
-                output.clear();
+        std::swap(output, written_output);
+        const size_t offset_in_file = array.offset() + file_offset;
+        const size_t length = output_length;
+        pending_write = writer_.submit([&array, &written_output, offset_in_file, length]
+        {
+            array.get_file()->write(&written_output, 0, offset_in_file, length);
+        });
+        file_offset += output_length;
+        output_length = 0;
+    };
+
+    while (const surfel *least = readers[tree[0]]->front()) {
+        size_t winner = tree[0];
+        output[output_length++] = *least;
+        readers[winner]->pop_front(reader_);
+
+        if (output_length == buffer_size) {
+            flush();
+        }
+
+        // replay the matches on the path from the leaf of the winner
+        for (size_t node = (runs_count + winner) / 2; node > 0; node /= 2) {
+            if (run_less(tree[node], winner)) {
+                std::swap(tree[node], winner);
             }
         }
+        tree[0] = winner;
     }
-    while (least_idx != -1);
 
-    if (output.size() > 0) {
-        array.get_file()->write(&output, 0, array.offset() + file_offset,
-                            output.size());
-        file_offset += output.size();
-        output.clear();
+    if (output_length > 0) {
+        flush();
+    }
+    if (pending_write.valid()) {
+        pending_write.get();
     }
     assert(file_offset == array.length());
 }
 
 }
 } // namespace lamure
-
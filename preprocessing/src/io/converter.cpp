@@ -14,102 +14,159 @@ namespace lamure
 namespace pre
 {
 
-void converter::
-convert(const std::string &input_filename,
-        const std::string &output_filename)
+void converter::buffer_queue::
+push(surfel_vector &&buffer)
 {
-    discarded_ = 0;
-    flush_ready_ = false;
-    flush_done_ = false;
-
-    auto buf_callback = [&](surfel_vector &surfels)
-    {
-        std::unique_lock<std::mutex> lk(mtx_);
-        cv_.wait(lk, [this]
-        { return flush_ready_; });
-
-        surfels = buffer_;
-        flush_ready_ = false;
-        bool has_data = !buffer_.empty();
-
-        // notify main thread
-        flush_done_ = true;
-        lk.unlock();
-        cv_.notify_one();
-        return has_data;
-    };
-
-    // output thread
-    std::thread tr([&]
-                   {
-                       out_format_.write(output_filename, buf_callback);
-                   });
-
-    // read input
-    in_format_.read(input_filename,
-                    [&](const surfel &s)
-                    { this->append_surfel(s); });
-
-    flush_buffer();
     {
-        std::lock_guard<std::mutex> lk(mtx_);
-        flush_ready_ = true;
+        std::lock_guard<std::mutex> lk(mutex_);
+        buffers_.push_back(std::move(buffer));
     }
     cv_.notify_one();
-    tr.join();
+}
 
-    if (discarded_ > 0) {
-        LOGGER_WARN("Discarded degenerate surfels: " <<
-                                                     discarded_);
+bool converter::buffer_queue::
+pop(surfel_vector &buffer)
+{
+    std::unique_lock<std::mutex> lk(mutex_);
+    cv_.wait(lk, [this]
+    { return closed_ || !buffers_.empty(); });
+
+    if (buffers_.empty())
+        return false;
+
+    buffer = std::move(buffers_.front());
+    buffers_.pop_front();
+    return true;
+}
+
+void converter::buffer_queue::
+close()
+{
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        closed_ = true;
     }
+    cv_.notify_all();
+}
+
+void converter::
+convert(const std::string &input_filename,
+        const std::string &output_filename)
+{
+    run_pipeline(output_filename,
+                 [&](const format_abstract::surfel_batch_callback_function &callback)
+                 {
+                     in_format_.read_batches(input_filename, callback);
+                 });
 }
 
 void converter::
 write_in_core_surfels_out(const surfel_vector &surf_vec,
                           const std::string &output_filename)
+{
+    run_pipeline(output_filename,
+                 [&](const format_abstract::surfel_batch_callback_function &callback)
+                 {
+                     surfel_vector batch;
+                     batch.reserve(std::min(surf_vec.size(), surfels_in_buffer_));
+
+                     for (auto const &surf : surf_vec) {
+                         batch.push_back(surfel(surf.pos(), surf.color()));
+                         if (batch.size() >= surfels_in_buffer_) {
+                             callback(batch);
+                             batch.clear();
+                         }
+                     }
+
+                     if (!batch.empty())
+                         callback(batch);
+                 });
+}
+
+void converter::
+run_pipeline(const std::string &output_filename,
+             const batch_producer_function &producer)
 {
     discarded_ = 0;
-    flush_ready_ = false;
-    flush_done_ = false;
 
-    std::string extended_output_filename = output_filename;
+    buffer_queue free_buffers;
+    buffer_queue read_buffers;
+    buffer_queue transformed_buffers;
 
-    auto buf_callback = [&](surfel_vector &surfels)
-    {
-        std::unique_lock<std::mutex> lk(mtx_);
-        cv_.wait(lk, [this]
-        { return flush_ready_; });
-
-        surfels = buffer_;
-        flush_ready_ = false;
-        bool has_data = !buffer_.empty();
-
-        // notify main thread
-        flush_done_ = true;
-        lk.unlock();
-        cv_.notify_one();
-        return has_data;
-    };
-
-    // output thread
-    std::thread tr([&]
-                   {
-                       out_format_.write(extended_output_filename, buf_callback);
-                   });
-
-    // read input
-    for (auto const &surf : surf_vec) {
-        this->append_surfel(surfel(surf.pos(), surf.color()));
+    for (size_t i = 0; i < num_buffers; ++i) {
+        surfel_vector buffer;
+        buffer.reserve(surfels_in_buffer_);
+        free_buffers.push(std::move(buffer));
     }
 
-
-    flush_buffer();
-    {
-        std::lock_guard<std::mutex> lk(mtx_);
-        flush_ready_ = true;
+    // transform stage
+    std::thread transformer([&]
+                            {
+                                surfel_vector buffer;
+                                while (read_buffers.pop(buffer)) {
+                                    transform_buffer(buffer);
+                                    if (buffer.empty())
+                                        free_buffers.push(std::move(buffer));
+                                    else
+                                        transformed_buffers.push(std::move(buffer));
+                                }
+                                transformed_buffers.close();
+                            });
+
+    // output thread, the buffer handed out on the previous call goes back to the ring
+    std::thread writer([&]
+                       {
+                           out_format_.write(output_filename, [&](surfel_vector &surfels)
+                           {
+                               surfel_vector next;
+                               if (!transformed_buffers.pop(next))
+                                   return false;
+
+                               LOGGER_TRACE("Flush buffer to disk. buffer size: " <<
+                                                                                  next.size() << " surfels");
+                               std::swap(surfels, next);
+                               if (next.capacity() > 0) {
+                                   next.clear();
+                                   free_buffers.push(std::move(next));
+                               }
+                               return true;
+                           });
+                       });
+
+    // read input on the calling thread
+    surfel_vector current;
+    free_buffers.pop(current);
+
+    try {
+        producer([&](surfel_vector &batch)
+                 {
+                     size_t first = 0;
+                     while (first < batch.size()) {
+                         const size_t count = std::min(batch.size() - first,
+                                                       surfels_in_buffer_ - current.size());
+                         current.insert(current.end(), batch.begin() + first, batch.begin() + first + count);
+                         first += count;
+
+                         if (current.size() >= surfels_in_buffer_) {
+                             read_buffers.push(std::move(current));
+                             free_buffers.pop(current);
+                         }
+                     }
+                 });
     }
-    cv_.notify_one();
-    tr.join();
+    catch (...) {
+        read_buffers.close();
+        transformer.join();
+        writer.join();
+        throw;
+    }
+
+    if (!current.empty())
+        read_buffers.push(std::move(current));
+    read_buffers.close();
+
+    transformer.join();
+    writer.join();
 
     if (discarded_ > 0) {
         LOGGER_WARN("Discarded degenerate surfels: " <<
@@ -118,64 +175,43 @@ write_in_core_surfels_out(const surfel_vector &surf_vec,
 }
 
 void converter::
-append_surfel(const surfel &surf)
+transform_buffer(surfel_vector &buffer)
 {
-    if (is_degenerate(surf)) {
-        ++discarded_;
-        return;
-    }
-
-    surfel s(surf);
-    bool keep = true;
+    size_t num_kept = 0;
 
-    if (surfel_callback_)
-        surfel_callback_(s, keep);
-
-    if (keep) {
-        if (scale_factor_ != 1.0) {
-            s.pos() *= scale_factor_;
-            s.radius() *= scale_factor_;
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        if (is_degenerate(buffer[i])) {
+            ++discarded_;
+            continue;
         }
 
-        if (translation_ != vec3r(0.0)) {
-            s.pos() += translation_;
-        }
+        surfel s(buffer[i]);
+        bool keep = true;
 
-        if (override_radius_)
-            s.radius() = new_radius_;
+        if (surfel_callback_)
+            surfel_callback_(s, keep);
 
-        if (override_color_)
-            s.color() = new_color_;
+        if (keep) {
+            if (scale_factor_ != 1.0) {
+                s.pos() *= scale_factor_;
+                s.radius() *= scale_factor_;
+            }
 
-        //LOGGER_DEBUG("Pos: " << s.pos());
+            if (translation_ != vec3r(0.0)) {
+                s.pos() += translation_;
+            }
 
-        buffer_.push_back(s);
+            if (override_radius_)
+                s.radius() = new_radius_;
 
-        if (buffer_.size() > surfels_in_buffer_)
-            flush_buffer();
-    }
-}
+            if (override_color_)
+                s.color() = new_color_;
 
-void converter::
-flush_buffer()
-{
-    if (!buffer_.empty()) {
-        LOGGER_TRACE("Flush buffer to disk. buffer size: " <<
-                                                           buffer_.size() << " surfels");
-        {
-            std::lock_guard<std::mutex> lk(mtx_);
-            flush_ready_ = true;
-        }
-        cv_.notify_one();
-        {
-            std::unique_lock<std::mutex> lk(mtx_);
-            // get back result
-            cv_.wait(lk, [this]
-            { return flush_done_; });
-            flush_done_ = false;
-            buffer_.clear();
+            buffer[num_kept++] = s;
         }
     }
+
+    buffer.resize(num_kept);
 }
 
 const bool converter::
@@ -12,5 +12,29 @@ namespace lamure
 namespace pre
 {
 
+namespace
+{
+const size_t surfels_per_batch = 64 * 1024;
+}
+
+void format_abstract::
+read_batches(const std::string &filename, surfel_batch_callback_function callback)
+{
+    surfel_vector batch;
+    batch.reserve(surfels_per_batch);
+
+    read(filename, [&](const surfel &s)
+    {
+        batch.push_back(s);
+        if (batch.size() >= surfels_per_batch) {
+            callback(batch);
+            batch.clear();
+        }
+    });
+
+    if (!batch.empty())
+        callback(batch);
+}
+
 } // namespace pre
 } // namespace lamure
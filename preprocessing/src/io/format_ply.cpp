@@ -9,6 +9,7 @@
 
 #include <lamure/pre/io/ply/ply.h>
 #include <lamure/pre/io/ply/ply_parser.h>
+#include <lamure/pre/io/ply/ply_binary_reader.h>
 
 #include <boost/filesystem.hpp>
 #include <stdexcept>
@@ -76,6 +77,21 @@ read(const std::string &filename, surfel_callback_funtion callback)
     ply_parser.parse(filename);
 }
 
+void format_ply::
+read_batches(const std::string &filename, surfel_batch_callback_function callback)
+{
+    // binary little endian files with a plain vertex layout are decoded in bulk,
+    // everything else goes through the callback based parser
+    io::ply::ply_binary_reader reader;
+    if (reader.open(filename)) {
+        LOGGER_TRACE("Bulk reading " << reader.num_vertices() << " vertices from " << filename);
+        reader.read(callback);
+    }
+    else {
+        format_abstract::read_batches(filename, callback);
+    }
+}
+
 void format_ply::
 write(const std::string &filename, buffer_callback_function callback)
 {
@@ -7,6 +7,8 @@
 
 #include <lamure/pre/io/format_xyz_all.h>
 
+#include <lamure/pre/io/ascii_chunk_reader.h>
+
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
@@ -20,54 +22,50 @@ namespace pre
 void format_xyzall::
 read(const std::string &filename, surfel_callback_funtion callback)
 {
-    std::ifstream xyz_file_stream(filename);
-
-    if (!xyz_file_stream.is_open())
-        throw std::runtime_error("Unable to open input file: " +
-            filename);
-
-    std::string line;
-
-    real pos[3];
-    float norm[3];
-    unsigned int color[3];
-    real radius;
-
-    xyz_file_stream.seekg(0, std::ios::end);
-    std::streampos end_pos = xyz_file_stream.tellg();
-    xyz_file_stream.seekg(0, std::ios::beg);
-    uint8_t percent_processed = 0;
-
-    while (getline(xyz_file_stream, line)) {
-
-        uint8_t new_percent_processed = (xyz_file_stream.tellg() / float(end_pos)) * 100;
-        if (percent_processed + 1 == new_percent_processed) {
-            percent_processed = new_percent_processed;
-            std::cout << "\r" << (int) percent_processed << "% processed" << std::flush;
-        }
-
-        std::stringstream sstream;
-
-        sstream << line;
-
-        sstream >> std::setprecision(LAMURE_STREAM_PRECISION) >> pos[0];
-        sstream >> std::setprecision(LAMURE_STREAM_PRECISION) >> pos[1];
-        sstream >> std::setprecision(LAMURE_STREAM_PRECISION) >> pos[2];
-        sstream >> std::setprecision(LAMURE_STREAM_PRECISION) >> norm[0];
-        sstream >> std::setprecision(LAMURE_STREAM_PRECISION) >> norm[1];
-        sstream >> std::setprecision(LAMURE_STREAM_PRECISION) >> norm[2];
-        sstream >> color[0];
-        sstream >> color[1];
-        sstream >> color[2];
-        sstream >> std::setprecision(LAMURE_STREAM_PRECISION) >> radius;
-
-        callback(surfel(vec3r(pos[0], pos[1], pos[2]),
-                        vec3b(color[0], color[1], color[2]),
-                        radius,
-                        vec3f(norm[0], norm[1], norm[2])));
-    }
+    read_batches(filename, [&](surfel_vector &surfels)
+    {
+        for (const auto &s : surfels)
+            callback(s);
+    });
+}
 
-    xyz_file_stream.close();
+void format_xyzall::
+read_batches(const std::string &filename, surfel_batch_callback_function callback)
+{
+    ascii_chunk_reader<surfel> reader;
+
+    reader.read(filename,
+        [](const char *first, const char *last, surfel_vector &surfels)
+        {
+            real pos[3];
+            float norm[3];
+            uint32_t color[3];
+            real radius;
+
+            while (first != last) {
+                const char *end = ascii_parser::line_end(first, last);
+                const char *it = first;
+
+                if (ascii_parser::parse_real(it, end, pos[0]) &&
+                    ascii_parser::parse_real(it, end, pos[1]) &&
+                    ascii_parser::parse_real(it, end, pos[2]) &&
+                    ascii_parser::parse_real(it, end, norm[0]) &&
+                    ascii_parser::parse_real(it, end, norm[1]) &&
+                    ascii_parser::parse_real(it, end, norm[2]) &&
+                    ascii_parser::parse_uint(it, end, color[0]) &&
+                    ascii_parser::parse_uint(it, end, color[1]) &&
+                    ascii_parser::parse_uint(it, end, color[2]) &&
+                    ascii_parser::parse_real(it, end, radius)) {
+                    surfels.push_back(surfel(vec3r(pos[0], pos[1], pos[2]),
+                                             vec3b(color[0], color[1], color[2]),
+                                             radius,
+                                             vec3f(norm[0], norm[1], norm[2])));
+                }
+
+                first = end == last ? last : end + 1;
+            }
+        },
+        callback);
 }
 
 void format_xyzall::
@@ -7,48 +7,75 @@
 
 #include <lamure/pre/io/format_xyz_bin.h>
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <exception>
 
 namespace lamure {
 namespace pre {
 
+namespace {
+const size_t record_size = 32; //sizeof surfel in xyz_bin
+const size_t surfels_per_block = 64 * 1024;
+}
+
 void format_xyz_bin::
 read(const std::string& filename, surfel_callback_funtion callback)
+{
+  read_batches(filename, [&](surfel_vector& surfels) {
+    for (const auto& s : surfels)
+      callback(s);
+  });
+}
+
+void format_xyz_bin::
+read_batches(const std::string& filename, surfel_batch_callback_function callback)
 {
   std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
   if (!file.is_open()) {
     throw std::runtime_error("unable to open file " + filename);
   }
 
-  file.seekg(std::ios::beg, std::ios::end);
+  file.seekg(0, std::ios::end);
   size_t file_size = file.tellg();
-  file.seekg(std::ios::beg, std::ios::beg);
-  size_t num_surfels = file_size / 32; //sizeof surfel in xyz_bin
+  file.seekg(0, std::ios::beg);
+  size_t num_surfels = file_size / record_size;
+
+  //records are decoded from blocks instead of issuing a read per field
+  std::vector<char> block(surfels_per_block * record_size);
+  surfel_vector surfels;
+
+  for (uint64_t first = 0; first < num_surfels; first += surfels_per_block) {
+    const size_t count = std::min<uint64_t>(surfels_per_block, num_surfels - first);
+    file.read(block.data(), count * record_size);
+    if (size_t(file.gcount()) != count * record_size) {
+      throw std::runtime_error("unexpected end of file " + filename);
+    }
+
+    surfels.clear();
+    surfels.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+      const char* record = block.data() + i * record_size;
 
-  for (uint64_t i = 0; i < num_surfels; ++i) {
-    
-    vec3f pos;
-    file.read((char*)&pos.x, 4);
-    file.read((char*)&pos.y, 4);
-    file.read((char*)&pos.z, 4);
+      //pos (3 x float), color (4 x uint8), radius (float), normal (3 x float)
+      float values[3];
+      std::memcpy(values, record, 12);
+      vec3r pos(values[0], values[1], values[2]);
 
-    vec3b color; char alpha;
-    file.read((char*)&color.x, 1);
-    file.read((char*)&color.y, 1);
-    file.read((char*)&color.z, 1);
-    file.read((char*)&alpha, 1);
+      vec3b color((uint8_t)record[12], (uint8_t)record[13], (uint8_t)record[14]);
 
-    float radius;
-    file.read((char*)&radius, 4);
+      float radius;
+      std::memcpy(&radius, record + 16, 4);
 
-    vec3f normal;
-    file.read((char*)&normal.x, 4);
-    file.read((char*)&normal.y, 4);
-    file.read((char*)&normal.z, 4);
+      std::memcpy(values, record + 20, 12);
+      vec3f normal(values[0], values[1], values[2]);
 
-    callback(surfel(vec3r(pos.x, pos.y, pos.z), color, (real)radius, normal));
+      surfels.push_back(surfel(pos, color, (real)radius, normal));
+    }
 
+    callback(surfels);
   }
 
   file.close();
@@ -8,6 +8,7 @@
 #include <lamure/pre/io/format_xyz_prov.h>
 
 #include <lamure/pre/io/file.h>
+#include <lamure/pre/io/ascii_chunk_reader.h>
 
 #include <iostream>
 #include <stdexcept>
@@ -20,39 +21,44 @@ void format_xyz_prov::
 convert(const std::string& in_file, const std::string& out_file, bool xyz_rgb) {
   //only in-core
 
-  std::ifstream input(in_file.c_str(), std::ios::in);
-  if (!input.is_open()) {
-    throw std::runtime_error("unable to open file " + in_file);
-  }
-
   std::vector<prov> data;
 
-  std::string line_buffer;
-  uint64_t num_points = 0;
-
-  while (getline(input, line_buffer)) {
-    std::istringstream line(line_buffer);
-    if (xyz_rgb) {
-      //ignore surfels
-      real pos[3];
-      uint32_t color[3];
-
-      line >> std::setprecision(LAMURE_STREAM_PRECISION) >> pos[0];
-      line >> std::setprecision(LAMURE_STREAM_PRECISION) >> pos[1];
-      line >> std::setprecision(LAMURE_STREAM_PRECISION) >> pos[2];
-      line >> color[0];
-      line >> color[1];
-      line >> color[2];
-    }
-    prov v;
-    line >> std::setprecision(LAMURE_STREAM_PRECISION) >> v.value_3_;
-    line >> std::setprecision(LAMURE_STREAM_PRECISION) >> v.value_4_;
-    line >> std::setprecision(LAMURE_STREAM_PRECISION) >> v.value_5_;
-    line >> std::setprecision(LAMURE_STREAM_PRECISION) >> v.value_6_;
-    data.push_back(v);
-  }
-
-  input.close();
+  ascii_chunk_reader<prov> reader;
+
+  reader.read(in_file,
+    [xyz_rgb](const char* first, const char* last, std::vector<prov>& records) {
+      while (first != last) {
+        const char* end = ascii_parser::line_end(first, last);
+        const char* it = first;
+
+        //a surfel line is accepted exactly like format_xyz does, plain
+        //.prov files carry one record per non-blank line
+        bool is_record = !ascii_parser::is_blank_line(first, end);
+        if (xyz_rgb) {
+          //ignore surfels
+          real pos[3];
+          uint32_t color[3];
+          is_record = ascii_parser::parse_xyz_rgb(it, end, pos, color);
+        }
+
+        //values that cannot be parsed are left at zero
+        if (is_record) {
+          prov v;
+          float* values[] = {&v.value_3_, &v.value_4_, &v.value_5_, &v.value_6_};
+          for (float* value : values) {
+            if (!ascii_parser::parse_real(it, end, *value)) {
+              break;
+            }
+          }
+          records.push_back(v);
+        }
+
+        first = end == last ? last : end + 1;
+      }
+    },
+    [&](const std::vector<prov>& records) {
+      data.insert(data.end(), records.begin(), records.end());
+    });
 
   prov_file output;
   output.open(out_file, true);
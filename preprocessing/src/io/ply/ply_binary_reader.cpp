@@ -0,0 +1,304 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/pre/io/ply/ply_binary_reader.h>
+
+#include <lamure/pre/io/ply/byte_order.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace lamure
+{
+namespace pre
+{
+namespace io
+{
+namespace ply
+{
+
+namespace
+{
+
+bool scalar_size(const std::string &type_name, size_t &size)
+{
+    if (type_name == "char" || type_name == "int8" || type_name == "uchar" || type_name == "uint8")
+        size = 1;
+    else if (type_name == "short" || type_name == "int16" || type_name == "ushort" || type_name == "uint16")
+        size = 2;
+    else if (type_name == "int" || type_name == "int32" || type_name == "uint" || type_name == "uint32"
+        || type_name == "float" || type_name == "float32")
+        size = 4;
+    else if (type_name == "double" || type_name == "float64")
+        size = 8;
+    else
+        return false;
+    return true;
+}
+
+}
+
+ply_binary_reader::
+ply_binary_reader(const size_t vertices_per_chunk, const uint32_t num_threads)
+    : vertices_per_chunk_(std::max<size_t>(vertices_per_chunk, 1)),
+      num_threads_(num_threads),
+      header_size_(0),
+      num_vertices_(0)
+{
+    if (num_threads_ == 0)
+        num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool ply_binary_reader::
+open(const std::string &filename)
+{
+    if (host_byte_order != little_endian_byte_order)
+        return false;
+
+    region_.reset();
+    file_.reset();
+
+    try {
+        file_.reset(new boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only));
+        region_.reset(new boost::interprocess::mapped_region(*file_, boost::interprocess::read_only));
+    }
+    catch (const boost::interprocess::interprocess_exception &) {
+        region_.reset();
+        file_.reset();
+        return false;
+    }
+
+    const char *data = static_cast<const char *>(region_->get_address());
+    const size_t size = region_->get_size();
+
+    if (!parse_header(data, size) || header_size_ + num_vertices_ * layout_.stride_ > size) {
+        region_.reset();
+        file_.reset();
+        return false;
+    }
+
+    region_->advise(boost::interprocess::mapped_region::advice_sequential);
+    return true;
+}
+
+bool ply_binary_reader::
+parse_header(const char *data, const size_t size)
+{
+    static const std::string end_header = "end_header";
+
+    layout_ = record_layout();
+    num_vertices_ = 0;
+
+    bool has_format = false;
+    bool in_vertex = false;
+    bool has_vertex = false;
+    size_t line_number = 0;
+    size_t position = 0;
+
+    while (position < size) {
+        const char *line_begin = data + position;
+        const char *line_end = static_cast<const char *>(std::memchr(line_begin, '\n', size - position));
+        if (line_end == nullptr)
+            return false;
+        position = line_end - data + 1;
+
+        std::string line(line_begin, line_end);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (line_number++ == 0) {
+            if (line != "ply")
+                return false;
+            continue;
+        }
+
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+
+        if (keyword == "format") {
+            std::string format, version;
+            stream >> format >> version;
+            if (format != "binary_little_endian" || version != "1.0")
+                return false;
+            has_format = true;
+        }
+        else if (keyword == "comment" || keyword == "obj_info" || keyword.empty()) {
+            continue;
+        }
+        else if (keyword == "element") {
+            std::string name;
+            size_t count;
+            if (!(stream >> name >> count))
+                return false;
+
+            if (!has_vertex) {
+                // the vertex block has to start right behind the header
+                if (name != "vertex")
+                    return false;
+                has_vertex = true;
+                in_vertex = true;
+                num_vertices_ = count;
+            }
+            else {
+                // everything behind the vertices is skipped, other element
+                // names are reported by the generic parser
+                if (name != "face")
+                    return false;
+                in_vertex = false;
+            }
+        }
+        else if (keyword == "property") {
+            if (!in_vertex)
+                continue;
+
+            std::string type_name, name;
+            size_t size_in_bytes;
+            if (!(stream >> type_name >> name) || !scalar_size(type_name, size_in_bytes))
+                return false;
+
+            scalar_kind kind;
+            if (type_name == "float" || type_name == "float32")
+                kind = float32_kind;
+            else if (type_name == "double" || type_name == "float64")
+                kind = float64_kind;
+            else if (type_name == "uchar" || type_name == "uint8")
+                kind = uint8_kind;
+            else
+                return false;
+
+            const field f = {true, layout_.stride_, kind};
+            const bool is_real = kind != uint8_kind;
+
+            if (is_real && (name == "x" || name == "y" || name == "z"))
+                layout_.position_[name[0] - 'x'] = f;
+            else if (is_real && (name == "nx" || name == "ny" || name == "nz")) {
+                layout_.normal_[name[1] - 'x'] = f;
+                layout_.has_normal_ = true;
+            }
+            else if (!is_real && (name == "red" || name == "diffuse_red")) {
+                layout_.color_[0] = f;
+                layout_.has_color_ = true;
+            }
+            else if (!is_real && (name == "green" || name == "diffuse_green")) {
+                layout_.color_[1] = f;
+                layout_.has_color_ = true;
+            }
+            else if (!is_real && (name == "blue" || name == "diffuse_blue")) {
+                layout_.color_[2] = f;
+                layout_.has_color_ = true;
+            }
+            else if (!(is_real && (name == "scalar_C2C_absolute_distances" || name == "psz"))
+                && !(!is_real && name == "alpha"))
+                return false;
+
+            layout_.stride_ += size_in_bytes;
+        }
+        else if (keyword == end_header) {
+            header_size_ = position;
+            return has_format && has_vertex && layout_.stride_ > 0;
+        }
+        else {
+            return false;
+        }
+    }
+
+    return false;
+}
+
+void ply_binary_reader::
+read(const batch_callback_type &callback)
+{
+    const char *vertices = static_cast<const char *>(region_->get_address()) + header_size_;
+
+    std::vector<surfel_vector> batches(num_threads_);
+
+    for (size_t first = 0; first < num_vertices_; first += vertices_per_chunk_ * num_threads_) {
+        std::vector<std::thread> threads;
+        size_t num_batches = 0;
+
+        for (uint32_t thread_id = 0; thread_id < num_threads_; ++thread_id) {
+            const size_t begin = first + thread_id * vertices_per_chunk_;
+            if (begin >= num_vertices_)
+                break;
+            const size_t count = std::min(vertices_per_chunk_, num_vertices_ - begin);
+            surfel_vector &batch = batches[thread_id];
+            ++num_batches;
+
+            if (thread_id + 1 == num_threads_ || begin + count >= num_vertices_) {
+                // the calling thread decodes the last chunk of the round itself
+                decode(vertices + begin * layout_.stride_, count, batch);
+            }
+            else {
+                threads.push_back(std::thread([this, vertices, begin, count, &batch]
+                {
+                    decode(vertices + begin * layout_.stride_, count, batch);
+                }));
+            }
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        for (size_t batch_id = 0; batch_id < num_batches; ++batch_id)
+            callback(batches[batch_id]);
+    }
+
+    region_.reset();
+    file_.reset();
+}
+
+void ply_binary_reader::
+decode(const char *first, const size_t count, surfel_vector &surfels) const
+{
+    surfels.clear();
+    surfels.resize(count);
+
+    auto read_real = [](const char *record, const field &f) -> real
+    {
+        if (f.kind_ == float32_kind) {
+            float value;
+            std::memcpy(&value, record + f.offset_, sizeof(float));
+            return value;
+        }
+        double value;
+        std::memcpy(&value, record + f.offset_, sizeof(double));
+        return value;
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        const char *record = first + i * layout_.stride_;
+        surfel &s = surfels[i];
+
+        for (uint32_t c = 0; c < 3; ++c) {
+            if (layout_.position_[c].present_)
+                s.pos()[c] = read_real(record, layout_.position_[c]);
+        }
+
+        if (layout_.has_normal_) {
+            for (uint32_t c = 0; c < 3; ++c) {
+                if (layout_.normal_[c].present_)
+                    s.normal()[c] = read_real(record, layout_.normal_[c]);
+            }
+        }
+
+        if (layout_.has_color_) {
+            for (uint32_t c = 0; c < 3; ++c) {
+                if (layout_.color_[c].present_)
+                    s.color()[c] = uint8_t(record[layout_.color_[c].offset_]);
+            }
+        }
+    }
+}
+
+} // namespace ply
+} // namespace io
+} // namespace pre
+} // namespace lamure
@@ -71,7 +71,10 @@ bool ply_parser::parse(std::istream &istream)
             if (keyword == "format") {
                 std::string format_string, version;
                 char space_format_format_string, space_format_string_version;
-                stringstream >> space_format_format_string >> std::ws >> format_string >> space_format_string_version >> std::ws >> version >> std::ws;
+                stringstream >> space_format_format_string >> std::ws >> format_string >> space_format_string_version >> std::ws >> version;
+                if (!stringstream.eof()) {
+                    stringstream >> std::ws;
+                }
                 if (!stringstream || !stringstream.eof() || !std::isspace(space_format_format_string, loc) || !std::isspace(space_format_string_version, loc)) {
                     if (error_callback_) {
                         error_callback_(line_number_, "parse error");
@@ -116,7 +119,10 @@ bool ply_parser::parse(std::istream &istream)
                 std::string name;
                 std::size_t count;
                 char space_element_name, space_name_count;
-                stringstream >> space_element_name >> std::ws >> name >> space_name_count >> std::ws >> count >> std::ws;
+                stringstream >> space_element_name >> std::ws >> name >> space_name_count >> std::ws >> count;
+                if (!stringstream.eof()) {
+                    stringstream >> std::ws;
+                }
                 if (!stringstream || !stringstream.eof() || !std::isspace(space_element_name, loc) || !std::isspace(space_name_count, loc)) {
                     if (error_callback_) {
                         error_callback_(line_number_, "parse error");
@@ -161,7 +167,10 @@ bool ply_parser::parse(std::istream &istream)
                     std::string name;
                     std::string &type = type_or_list;
                     char space_type_name;
-                    stringstream >> space_type_name >> std::ws >> name >> std::ws;
+                    stringstream >> space_type_name >> std::ws >> name;
+                    if (!stringstream.eof()) {
+                        stringstream >> std::ws;
+                    }
                     if (!stringstream || !std::isspace(space_type_name, loc)) {
                         if (error_callback_) {
                             error_callback_(line_number_, "parse error");
@@ -223,8 +232,10 @@ bool ply_parser::parse(std::istream &istream)
                     std::string name;
                     std::string size_type_string, scalar_type_string;
                     char space_list_size_type, space_size_type_scalar_type, space_scalar_type_name;
-                    stringstream >> space_list_size_type >> std::ws >> size_type_string >> space_size_type_scalar_type >> std::ws >> scalar_type_string >> space_scalar_type_name >> std::ws >> name
-                                 >> std::ws;
+                    stringstream >> space_list_size_type >> std::ws >> size_type_string >> space_size_type_scalar_type >> std::ws >> scalar_type_string >> space_scalar_type_name >> std::ws >> name;
+                    if (!stringstream.eof()) {
+                        stringstream >> std::ws;
+                    }
                     if (!stringstream || !std::isspace(space_list_size_type, loc) || !std::isspace(space_size_type_scalar_type, loc) || !std::isspace(space_scalar_type_name, loc)) {
                         if (error_callback_) {
                             error_callback_(line_number_, "parse error");
@@ -0,0 +1,255 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/pre/knn_index.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace lamure
+{
+namespace pre
+{
+
+namespace
+{
+const uint32_t max_bucket_size = 16;
+
+bool is_closer(const knn_index::neighbour_type &lhs, const knn_index::neighbour_type &rhs)
+{
+    return lhs.second < rhs.second;
+}
+}
+
+knn_index::
+knn_index()
+    : first_node_(0),
+      end_node_(0)
+{
+}
+
+void knn_index::
+clear()
+{
+    tree_.clear();
+    entries_.clear();
+    first_node_ = 0;
+    end_node_ = 0;
+}
+
+void knn_index::
+build(const std::vector<bvh_node> &nodes,
+      const node_id_type first_node,
+      const node_id_type end_node,
+      const std::vector<node_id_type> &halo_nodes)
+{
+    clear();
+
+    std::vector<node_id_type> node_ids;
+    node_ids.reserve(end_node - first_node + halo_nodes.size());
+    for (node_id_type node_id = first_node; node_id < end_node; ++node_id)
+        node_ids.push_back(node_id);
+    node_ids.insert(node_ids.end(), halo_nodes.begin(), halo_nodes.end());
+
+    size_t num_surfels = 0;
+    for (const node_id_type node_id : node_ids)
+        num_surfels += nodes[node_id].mem_array().length();
+
+    if (num_surfels == 0)
+        return;
+
+    entries_.reserve(num_surfels);
+    for (const node_id_type node_id : node_ids) {
+        const surfel_mem_array &mem_array = nodes[node_id].mem_array();
+        for (size_t surfel_idx = 0; surfel_idx < mem_array.length(); ++surfel_idx)
+            entries_.push_back(entry{mem_array.position(surfel_idx), surfel_id_t(node_id, surfel_idx)});
+    }
+
+    first_node_ = first_node;
+    end_node_ = end_node;
+
+    tree_.reserve(2 * (entries_.size() / max_bucket_size + 1));
+    build_recursive(0, uint32_t(entries_.size()));
+}
+
+void knn_index::
+build(const std::vector<surfel_mem_array *> &arrays)
+{
+    clear();
+
+    size_t num_surfels = 0;
+    for (const auto *mem_array : arrays)
+        num_surfels += mem_array->length();
+
+    if (num_surfels == 0)
+        return;
+
+    entries_.reserve(num_surfels);
+    for (size_t array_idx = 0; array_idx < arrays.size(); ++array_idx) {
+        const surfel_mem_array &mem_array = *arrays[array_idx];
+        for (size_t surfel_idx = 0; surfel_idx < mem_array.length(); ++surfel_idx)
+            entries_.push_back(entry{mem_array.position(surfel_idx), surfel_id_t(array_idx, surfel_idx)});
+    }
+
+    tree_.reserve(2 * (entries_.size() / max_bucket_size + 1));
+    build_recursive(0, uint32_t(entries_.size()));
+}
+
+uint32_t knn_index::
+build_recursive(const uint32_t begin, const uint32_t end)
+{
+    const uint32_t kd_node_id = uint32_t(tree_.size());
+    tree_.push_back(kd_node{begin, end, 0, 0, 0.0});
+
+    if (end - begin <= max_bucket_size)
+        return kd_node_id;
+
+    vec3r min_pos = entries_[begin].pos_;
+    vec3r max_pos = entries_[begin].pos_;
+    for (uint32_t i = begin + 1; i < end; ++i) {
+        for (uint8_t axis = 0; axis < 3; ++axis) {
+            min_pos[axis] = std::min(min_pos[axis], entries_[i].pos_[axis]);
+            max_pos[axis] = std::max(max_pos[axis], entries_[i].pos_[axis]);
+        }
+    }
+
+    const vec3r extent = max_pos - min_pos;
+    uint8_t axis = 0;
+    if (extent[1] > extent[axis]) axis = 1;
+    if (extent[2] > extent[axis]) axis = 2;
+
+    // entries left of the median are <= split, entries right of it >= split
+    const uint32_t median = begin + (end - begin) / 2;
+    std::nth_element(entries_.begin() + begin, entries_.begin() + median, entries_.begin() + end,
+                     [axis](const entry &lhs, const entry &rhs)
+                     { return lhs.pos_[axis] < rhs.pos_[axis]; });
+
+    tree_[kd_node_id].axis_ = axis;
+    tree_[kd_node_id].split_ = entries_[median].pos_[axis];
+
+    build_recursive(begin, median);
+    const uint32_t right_child = build_recursive(median, end);
+    tree_[kd_node_id].right_child_ = right_child;
+
+    return kd_node_id;
+}
+
+void knn_index::
+find_nearest_neighbours(const vec3r &position,
+                        const surfel_id_t excluded_surfel,
+                        const uint32_t num_neighbours,
+                        neighbour_vector &result,
+                        scratch &scratch,
+                        const real max_distance_sqr) const
+{
+    result.clear();
+    if (tree_.empty() || num_neighbours == 0)
+        return;
+
+    // max-heap of the best candidates so far, its front is the current k-th distance
+    neighbour_vector &candidates = scratch.candidates_;
+    candidates.clear();
+    real bound = max_distance_sqr;
+
+    auto &stack = scratch.stack_;
+    stack.clear();
+    stack.emplace_back(0, real(0.0));
+
+    while (!stack.empty()) {
+        const uint32_t kd_node_id = stack.back().first;
+        const real plane_distance_sqr = stack.back().second;
+        stack.pop_back();
+
+        if (plane_distance_sqr > bound)
+            continue;
+
+        const kd_node &current = tree_[kd_node_id];
+
+        if (current.right_child_ == 0) {
+            for (uint32_t i = current.begin_; i < current.end_; ++i) {
+                const entry &e = entries_[i];
+                const real distance_sqr = scm::math::length_sqr(position - e.pos_);
+
+                if (candidates.size() < num_neighbours) {
+                    if (distance_sqr > bound || e.id_ == excluded_surfel)
+                        continue;
+                    candidates.emplace_back(e.id_, distance_sqr);
+                    std::push_heap(candidates.begin(), candidates.end(), is_closer);
+                    if (candidates.size() == num_neighbours)
+                        bound = std::min(bound, candidates.front().second);
+                }
+                else if (distance_sqr < bound && !(e.id_ == excluded_surfel)) {
+                    std::pop_heap(candidates.begin(), candidates.end(), is_closer);
+                    candidates.back() = neighbour_type(e.id_, distance_sqr);
+                    std::push_heap(candidates.begin(), candidates.end(), is_closer);
+                    bound = candidates.front().second;
+                }
+            }
+            continue;
+        }
+
+        const real difference = position[current.axis_] - current.split_;
+        const uint32_t left_child = kd_node_id + 1;
+
+        // visit the near side first, the far side is only entered if the
+        // splitting plane is closer than the current k-th neighbour
+        if (difference < 0.0) {
+            stack.emplace_back(current.right_child_, difference * difference);
+            stack.emplace_back(left_child, real(0.0));
+        }
+        else {
+            stack.emplace_back(left_child, difference * difference);
+            stack.emplace_back(current.right_child_, real(0.0));
+        }
+    }
+
+    std::sort_heap(candidates.begin(), candidates.end(), is_closer);
+    result.assign(candidates.begin(), candidates.end());
+}
+
+void knn_index::
+find_nearest_neighbours(const bvh_node &node,
+                        const uint32_t num_neighbours,
+                        scratch &scratch,
+                        const node_query_callback &callback) const
+{
+    const surfel_mem_array &mem_array = node.mem_array();
+    const size_t expected = std::min<size_t>(num_neighbours, entries_.empty() ? 0 : entries_.size() - 1);
+
+    neighbour_vector neighbours;
+    neighbours.reserve(num_neighbours);
+
+    vec3r previous_position;
+    real previous_distance = -1.0;
+
+    for (size_t surfel_idx = 0; surfel_idx < mem_array.length(); ++surfel_idx) {
+        const vec3r position = mem_array.position(surfel_idx);
+        const surfel_id_t surfel_id(node.node_id(), surfel_idx);
+
+        real max_distance_sqr = std::numeric_limits<real>::max();
+        if (previous_distance >= 0.0) {
+            // the k neighbours of the previous surfel together with the previous
+            // surfel itself lie within this radius around the current one
+            const real radius = previous_distance + scm::math::length(position - previous_position);
+            max_distance_sqr = radius * radius * (1.0 + 1e-9) + std::numeric_limits<real>::min();
+        }
+
+        find_nearest_neighbours(position, surfel_id, num_neighbours, neighbours, scratch, max_distance_sqr);
+
+        if (neighbours.size() < expected)
+            find_nearest_neighbours(position, surfel_id, num_neighbours, neighbours, scratch);
+
+        previous_position = position;
+        previous_distance = neighbours.size() == expected && expected == num_neighbours && !neighbours.empty()
+            ? std::sqrt(neighbours.back().second) : -1.0;
+
+        callback(surfel_idx, neighbours);
+    }
+}
+
+} // namespace pre
+} // namespace lamure
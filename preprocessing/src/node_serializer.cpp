@@ -8,7 +8,11 @@
 #include <lamure/pre/node_serializer.h>
 
 #include <lamure/pre/serialized_surfel.h>
+#include <lamure/lod_block.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
 #include <cstring>
+#include <stdexcept>
 
 namespace lamure
 {
@@ -17,9 +21,16 @@ namespace pre
 
 node_serializer::
 node_serializer(const size_t surfels_per_node,
-                const size_t buffer_size)
-    : surfels_per_node_(surfels_per_node)
+                const size_t buffer_size,
+                const bool quantize,
+                const int compression_level)
+    : surfels_per_node_(surfels_per_node),
+      quantize_(quantize),
+      compression_level_(compression_level)
 {
+    assert(compression_level_ == 0 ||
+           (compression_level_ >= lod_block::MIN_LEVEL && compression_level_ <= lod_block::MAX_LEVEL));
+
     max_nodes_in_buffer_ = buffer_size / sizeof(surfel) / surfels_per_node;
 }
 
@@ -37,6 +48,8 @@ open(const std::string &file_name, const bool read_write_mode)
 {
     file_name_ = file_name;
     surfel_buffer_.clear();
+    range_buffer_.clear();
+    block_offsets_.assign(1, 0);
 
     if (read_write_mode)
         stream_.open(file_name, std::ios::in | std::ios::out | std::ios::binary);
@@ -57,6 +70,7 @@ close()
     if (is_open()) {
         flush_surfel_buffer();
         surfel_buffer_.clear();
+        range_buffer_.clear();
         stream_.close();
         if (stream_.fail()) {
             LOGGER_ERROR("Failed to close file: \"" << file_name_ <<
@@ -65,6 +79,16 @@ close()
         stream_.exceptions(std::ifstream::failbit);
         file_name_ = "";
     }
+    if (journal_stream_.is_open()) {
+        journal_stream_.close();
+        if (journal_stream_.fail()) {
+            LOGGER_ERROR("Failed to close file: \"" << journal_file_name_ <<
+                                                    "\". " << strerror(errno));
+        }
+        journal_stream_.exceptions(std::ifstream::failbit);
+        journal_file_name_ = "";
+        journaled_slots_.clear();
+    }
 }
 
 const bool node_serializer::
@@ -73,10 +97,18 @@ is_open() const
     return stream_.is_open();
 }
 
+const size_t node_serializer::
+serialized_surfel_size() const
+{
+    return quantize_ ? serialized_surfel_qz::get_size() : serialized_surfel::get_size();
+}
+
 void node_serializer::
 read_node_immediate(surfel_vector &surfels,
                     const size_t offset)
 {
+    assert(!quantize_ && !is_compressed());
+
     surfels.clear();
     const size_t buffer_size = serialized_surfel::get_size() * surfels_per_node_;
     char *buffer = new char[buffer_size];
@@ -101,9 +133,23 @@ void node_serializer::
 write_node_immediate(const surfel_vector &surfels,
                      const size_t offset)
 {
+    assert(!quantize_ && !is_compressed());
+
     const size_t buffer_size = serialized_surfel::get_size() * surfels_per_node_;
     char *buffer = new char[buffer_size];
 
+    // save the slot before it is overwritten for the first time
+    if (journal_stream_.is_open() && offset < journaled_slots_.size() && !journaled_slots_[offset]) {
+        stream_.seekg(buffer_size * offset);
+        stream_.read(buffer, buffer_size);
+
+        const uint64_t slot = offset;
+        journal_stream_.write((const char *)&slot, sizeof(slot));
+        journal_stream_.write(buffer, buffer_size);
+        journal_stream_.flush();
+        journaled_slots_[offset] = true;
+    }
+
     for (size_t i = 0; i < surfels_per_node_; ++i) {
         size_t pos = i * serialized_surfel::get_size();
         serialized_surfel(surfels[i]).serialize(buffer + pos);
@@ -119,6 +165,64 @@ write_node_immediate(const surfel_vector &surfels,
 
 }
 
+void node_serializer::
+open_journal(const std::string &journal_file_name)
+{
+    assert(is_open());
+    assert(!quantize_ && !is_compressed());
+
+    journal_file_name_ = journal_file_name;
+    journal_stream_.open(journal_file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!journal_stream_.is_open()) {
+        throw std::runtime_error("lamure: node_serializer::Unable to create journal: \"" + journal_file_name + "\"");
+    }
+    journal_stream_.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    // the header holds the size of the file and of one slot
+    stream_.seekg(0, stream_.end);
+    const uint64_t file_size = stream_.tellg();
+    const uint64_t slot_size = serialized_surfel::get_size() * surfels_per_node_;
+    journal_stream_.write((const char *)&file_size, sizeof(file_size));
+    journal_stream_.write((const char *)&slot_size, sizeof(slot_size));
+    journal_stream_.flush();
+
+    journaled_slots_.assign(file_size / slot_size, false);
+}
+
+void node_serializer::
+roll_back_journal(const std::string &file_name,
+                  const std::string &journal_file_name)
+{
+    std::ifstream journal(journal_file_name, std::ios::in | std::ios::binary);
+    uint64_t file_size = 0;
+    uint64_t slot_size = 0;
+    journal.read((char *)&file_size, sizeof(file_size));
+    journal.read((char *)&slot_size, sizeof(slot_size));
+    if (!journal.good() || slot_size == 0) {
+        throw std::runtime_error("lamure: node_serializer::Unable to read journal: \"" + journal_file_name + "\"");
+    }
+
+    std::fstream file(file_name, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("lamure: node_serializer::Unable to open file: \"" + file_name + "\"");
+    }
+
+    // a slot is saved before it is overwritten, so an incomplete last
+    // record belongs to a slot that is still unchanged
+    std::vector<char> buffer(slot_size);
+    uint64_t slot;
+    while (journal.read((char *)&slot, sizeof(slot)) && journal.read(buffer.data(), slot_size)) {
+        file.seekp(slot * slot_size);
+        file.write(buffer.data(), slot_size);
+    }
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("lamure: node_serializer::Unable to restore file: \"" + file_name + "\"");
+    }
+
+    boost::filesystem::resize_file(file_name, file_size);
+}
+
 void node_serializer::
 serialize_nodes(const std::vector<bvh_node> &nodes)
 {
@@ -175,6 +279,11 @@ write_node_streamed(const bvh_node &node)
                                    node.disk_array().offset(),
                                    read_length);
     surfel_buffer_.push_back(surfel_buffer);
+    if (quantize_) {
+        range_buffer_.push_back(serialized_surfel_qz::node_range(node.get_bounding_box(),
+                                                                 node.avg_surfel_radius(),
+                                                                 node.max_surfel_radius_deviation()));
+    }
 
     if (surfel_buffer_.size() >= max_nodes_in_buffer_)
         flush_surfel_buffer();
@@ -184,9 +293,17 @@ void node_serializer::
 flush_surfel_buffer()
 {
     if (surfel_buffer_.size()) {
-        const size_t output_buffer_size = serialized_surfel::get_size() * surfels_per_node_ * surfel_buffer_.size();
+        const size_t surfel_size = serialized_surfel_size();
+        const size_t node_size = surfel_size * surfels_per_node_;
+        const size_t output_buffer_size = node_size * surfel_buffer_.size();
         char *output_buffer = new char[output_buffer_size];
 
+        // every node is compressed on its own, so that it can be
+        // decompressed without its neighbours
+        std::vector<std::vector<char>> blocks(is_compressed() ? surfel_buffer_.size() : 0);
+        // exceptions must not leave the parallel loop, failures are thrown after it
+        std::vector<char> compression_failed(blocks.size(), false);
+
         LOGGER_INFO("Flush buffer to disk. buffer size: " <<
                                                            surfel_buffer_.size() << " nodes (" <<
                                                            output_buffer_size / 1024 / 1024 << " MiB)");
@@ -194,23 +311,56 @@ flush_surfel_buffer()
 #pragma omp parallel for
         for (size_t k = 0; k < surfel_buffer_.size(); ++k) {
             for (size_t i = 0; i < surfels_per_node_; ++i) {
-                char *buf = output_buffer + k * serialized_surfel::get_size() * surfels_per_node_ +
-                    i * serialized_surfel::get_size();
-                if (i < surfel_buffer_[k]->size())
-                    serialized_surfel(surfel_buffer_[k]->at(i)).serialize(buf);
-                else
-                    serialized_surfel().serialize(buf);
+                char *buf = output_buffer + k * node_size + i * surfel_size;
+                if (quantize_) {
+                    if (i < surfel_buffer_[k]->size())
+                        serialized_surfel_qz(surfel_buffer_[k]->at(i), range_buffer_[k]).serialize(buf);
+                    else
+                        serialized_surfel_qz().serialize(buf);
+                }
+                else {
+                    if (i < surfel_buffer_[k]->size())
+                        serialized_surfel(surfel_buffer_[k]->at(i)).serialize(buf);
+                    else
+                        serialized_surfel().serialize(buf);
+                }
             }
             delete surfel_buffer_[k];
+
+            if (is_compressed()) {
+                blocks[k].reserve(lod_block::max_compressed_size(node_size));
+                try {
+                    lod_block::compress(output_buffer + k * node_size, node_size, compression_level_, blocks[k]);
+                }
+                catch (const std::exception &) {
+                    compression_failed[k] = true;
+                }
+            }
+        }
+
+        if (std::find(compression_failed.begin(), compression_failed.end(), true) != compression_failed.end()) {
+            surfel_buffer_.clear();
+            range_buffer_.clear();
+            delete[] output_buffer;
+            throw std::runtime_error("lamure: node_serializer::Unable to compress node. file: \"" + file_name_ + "\"");
         }
 
         stream_.seekp(0, stream_.end);
-        stream_.write(output_buffer, output_buffer_size);
+        if (is_compressed()) {
+            for (const auto &block : blocks) {
+                stream_.write(block.data(), block.size());
+                block_offsets_.push_back(block_offsets_.back() + block.size());
+            }
+        }
+        else {
+            stream_.write(output_buffer, output_buffer_size);
+        }
         if (stream_.fail() || stream_.bad()) {
             LOGGER_ERROR("write failed. file: \"" << file_name_ <<
                                                   "\". " << strerror(errno));
         }
         surfel_buffer_.clear();
+        range_buffer_.clear();
         delete[] output_buffer;
         stream_.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     }
@@ -33,10 +33,10 @@ calculate_statistics(surfel_mem_array const &mem_array)
 
     size_t num_contributed_surfels(0);
 
-    for (size_t j = mem_array.offset();
-         j < mem_array.offset() + mem_array.length();
+    for (size_t j = 0;
+         j < mem_array.length();
          ++j) {
-        surfel const &current_surfel = mem_array.surfel_mem_data()->at(j);
+        surfel const current_surfel = mem_array.read_surfel(j);
         if (current_surfel.radius() != 0.0) {
 
             vec3b const &surfel_color = current_surfel.color();
@@ -88,10 +88,10 @@ calculate_statistics(surfel_mem_array const &mem_array)
     real temp_normal_sd = 0.0;
     real temp_radius_sd = 0.0;
     if (num_contributed_surfels) {
-        for (size_t j = mem_array.offset();
-             j < mem_array.offset() + mem_array.length();
+        for (size_t j = 0;
+             j < mem_array.length();
              ++j) {
-            surfel const &current_surfel = mem_array.surfel_mem_data()->at(j);
+            surfel const current_surfel = mem_array.read_surfel(j);
 
             temp_sd += std::pow(scm::math::length(temp_mean - current_surfel.pos()), 2);
             temp_color_sd += std::pow(scm::math::length(temp_mean_color - current_surfel.color()), 2);
@@ -9,6 +9,7 @@
 
 #include <lamure/pre/bvh.h>
 #include <lamure/pre/normal_computation_plane_fitting.h>
+#include <lamure/pre/normal_estimation.h>
 
 namespace lamure
 {
@@ -154,99 +155,53 @@ compute_normal(const bvh &tree,
                const surfel_id_t target_surfel,
                std::vector<std::pair<surfel_id_t, real>> const &nearest_neighbours) const
 {
+    std::vector<vec3f> normals;
+    compute_normals(tree, std::vector<surfel_id_t>(1, target_surfel),
+                    std::vector<std::vector<std::pair<surfel_id_t, real>>>(1, nearest_neighbours), normals);
+    return normals.front();
+}
 
-    // find nearest neighbours
-    std::vector<std::pair<surfel_id_t, real>> nearest_neighbours_ids;// = tree.get_nearest_neighbours(target_surfel, num);
-
-
-    unsigned processed_neighbour_counter = 0;
-    // compute radius
-    for (auto const &neighbour : nearest_neighbours) {
-        if (processed_neighbour_counter++ < number_of_neighbours_) {
-            nearest_neighbours_ids.emplace_back(nearest_neighbours[processed_neighbour_counter - 1]);
-        }
-        else {
-            break;
-        }
-    }
-
-
+void normal_computation_plane_fitting::
+compute_normals(const bvh &tree,
+                std::vector<surfel_id_t> const &surfels,
+                std::vector<std::vector<std::pair<surfel_id_t, real>>> const &nearest_neighbours,
+                std::vector<vec3f> &normals) const
+{
     auto &bvh_nodes = (tree.nodes());
-    vec3r poi = bvh_nodes[target_surfel.node_idx].mem_array().read_surfel_ref(target_surfel.surfel_idx).pos();
 
-    uint32_t num_neighbours = nearest_neighbours_ids.size();
-    if (num_neighbours < 3) {
-        return vec3f(0.0, 0.0, 0.0);
-    }
-
-    double summed_distance = 0.0f;
-    double max_distance = 0.0f;
-    vec3r cen = vec3r(0.0, 0.0, 0.0);
+    normal_estimation::neighbourhood_batch batch;
+    std::vector<size_t> batch_index(surfels.size(), 0);
 
-    for (const auto &neighbour_ids : nearest_neighbours_ids) {
-        vec3r neighbour_pos = bvh_nodes[neighbour_ids.first.node_idx].mem_array().read_surfel_ref(neighbour_ids.first.surfel_idx).pos();
-        if (neighbour_pos == poi) {
+    for (size_t i = 0; i < surfels.size(); ++i) {
+        size_t num_neighbours = std::min<size_t>(nearest_neighbours[i].size(), number_of_neighbours_);
+        if (num_neighbours < 3) {
             continue;
         }
 
-        cen += neighbour_pos;
-
-        real distance = scm::math::length(poi - neighbour_pos);
-        summed_distance += distance;
-        max_distance = std::max(distance, max_distance);
-    }
-
-    scm::math::vec3d centroid = cen * (1.0 / (real) num_neighbours);
-
-    if (max_distance >= 0.01) {
-        //    return false;
-    }
+        vec3r poi = bvh_nodes[surfels[i].node_idx].mem_array().position(surfels[i].surfel_idx);
 
-    //produce covariance matrix
-    scm::math::mat3d covariance_mat = scm::math::mat3d::zero();
+        // like the former jacobi based fitting, the centroid divides by all
+        // considered neighbours, including those at the point of interest
+        batch_index[i] = batch.size() + 1;
+        batch.begin_neighbourhood(poi, uint32_t(num_neighbours));
 
-    for (const auto &neighbour_ids : nearest_neighbours_ids) {
-        vec3r neighbour_pos = bvh_nodes[neighbour_ids.first.node_idx].mem_array().read_surfel_ref(neighbour_ids.first.surfel_idx).pos();
-        if (neighbour_pos == poi) {
-            continue;
+        for (size_t n = 0; n < num_neighbours; ++n) {
+            surfel_id_t const &neighbour_id = nearest_neighbours[i][n].first;
+            vec3r neighbour_pos = bvh_nodes[neighbour_id.node_idx].mem_array().position(neighbour_id.surfel_idx);
+            if (neighbour_pos == poi) {
+                continue;
+            }
+            batch.add_position(neighbour_pos);
         }
-
-        covariance_mat.m00 += std::pow(neighbour_pos.x - centroid.x, 2);
-        covariance_mat.m01 += (neighbour_pos.x - centroid.x) * (neighbour_pos.y - centroid.y);
-        covariance_mat.m02 += (neighbour_pos.x - centroid.x) * (neighbour_pos.z - centroid.z);
-
-        covariance_mat.m03 += (neighbour_pos.y - centroid.y) * (neighbour_pos.x - centroid.x);
-        covariance_mat.m04 += std::pow(neighbour_pos.y - centroid.y, 2);
-        covariance_mat.m05 += (neighbour_pos.y - centroid.y) * (neighbour_pos.z - centroid.z);
-
-        covariance_mat.m06 += (neighbour_pos.z - centroid.z) * (neighbour_pos.x - centroid.x);
-        covariance_mat.m07 += (neighbour_pos.z - centroid.z) * (neighbour_pos.y - centroid.y);
-        covariance_mat.m08 += std::pow(neighbour_pos.z - centroid.z, 2);
-
     }
 
-    //solve for eigenvectors
-    real *eigenvalues = new real[3];
-    real **eigenvectors = new real *[3];
-    for (int i = 0; i < 3; ++i) {
-        eigenvectors[i] = new real[3];
-    }
+    std::vector<vec3f> batch_normals;
+    normal_estimation::compute_normals(batch, batch_normals);
 
-    jacobi_rotation(covariance_mat, eigenvalues, eigenvectors);
-
-    scm::math::vec3f normal = scm::math::vec3f(eigenvectors[0][0],
-                                               eigenvectors[1][0],
-                                               eigenvectors[2][0]);
-    //scm::math::vec3f binormal = scm::math::vec3f(eigenvectors[0][1], eigenvectors[1][1], eigenvectors[2][1]);
-    //scm::math::vec3f tangent = scm::math::vec3f(eigenvectors[0][2], eigenvectors[1][2], eigenvectors[2][2]);
-
-    delete[] eigenvalues;
-    for (int i = 0; i < 3; ++i) {
-        delete[] eigenvectors[i];
+    normals.resize(surfels.size());
+    for (size_t i = 0; i < surfels.size(); ++i) {
+        normals[i] = batch_index[i] == 0 ? vec3f(0.0, 0.0, 0.0) : batch_normals[batch_index[i] - 1];
     }
-    delete[] eigenvectors;
-
-    return normal;
 }
 
 }// namespace pre
@@ -0,0 +1,393 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/pre/normal_estimation.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+  #include <immintrin.h>
+  #define LAMURE_NORMAL_ESTIMATION_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define LAMURE_NORMAL_ESTIMATION_SSE
+#endif
+
+namespace lamure
+{
+namespace pre
+{
+
+namespace
+{
+
+// sums of the shifted positions and their products, in the order
+// n, x, y, z, xx, xy, xz, yy, yz, zz
+struct moments
+{
+    real sum_[10];
+};
+
+void accumulate_moments(const real *x, const real *y, const real *z,
+                        const size_t count, const vec3r &origin, moments &result)
+{
+    for (uint32_t i = 0; i < 10; ++i)
+        result.sum_[i] = 0.0;
+
+    size_t i = 0;
+
+#if defined(LAMURE_NORMAL_ESTIMATION_AVX)
+
+    __m256d sum[9];
+    for (uint32_t k = 0; k < 9; ++k)
+        sum[k] = _mm256_setzero_pd();
+
+    const __m256d origin_x = _mm256_set1_pd(origin.x);
+    const __m256d origin_y = _mm256_set1_pd(origin.y);
+    const __m256d origin_z = _mm256_set1_pd(origin.z);
+
+    for (; i + 4 <= count; i += 4) {
+        const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), origin_x);
+        const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), origin_y);
+        const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + i), origin_z);
+
+        sum[0] = _mm256_add_pd(sum[0], dx);
+        sum[1] = _mm256_add_pd(sum[1], dy);
+        sum[2] = _mm256_add_pd(sum[2], dz);
+        sum[3] = _mm256_add_pd(sum[3], _mm256_mul_pd(dx, dx));
+        sum[4] = _mm256_add_pd(sum[4], _mm256_mul_pd(dx, dy));
+        sum[5] = _mm256_add_pd(sum[5], _mm256_mul_pd(dx, dz));
+        sum[6] = _mm256_add_pd(sum[6], _mm256_mul_pd(dy, dy));
+        sum[7] = _mm256_add_pd(sum[7], _mm256_mul_pd(dy, dz));
+        sum[8] = _mm256_add_pd(sum[8], _mm256_mul_pd(dz, dz));
+    }
+
+    for (uint32_t k = 0; k < 9; ++k) {
+        double lanes[4];
+        _mm256_storeu_pd(lanes, sum[k]);
+        result.sum_[k + 1] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+#elif defined(LAMURE_NORMAL_ESTIMATION_SSE)
+
+    __m128d sum[9];
+    for (uint32_t k = 0; k < 9; ++k)
+        sum[k] = _mm_setzero_pd();
+
+    const __m128d origin_x = _mm_set1_pd(origin.x);
+    const __m128d origin_y = _mm_set1_pd(origin.y);
+    const __m128d origin_z = _mm_set1_pd(origin.z);
+
+    for (; i + 2 <= count; i += 2) {
+        const __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + i), origin_x);
+        const __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + i), origin_y);
+        const __m128d dz = _mm_sub_pd(_mm_loadu_pd(z + i), origin_z);
+
+        sum[0] = _mm_add_pd(sum[0], dx);
+        sum[1] = _mm_add_pd(sum[1], dy);
+        sum[2] = _mm_add_pd(sum[2], dz);
+        sum[3] = _mm_add_pd(sum[3], _mm_mul_pd(dx, dx));
+        sum[4] = _mm_add_pd(sum[4], _mm_mul_pd(dx, dy));
+        sum[5] = _mm_add_pd(sum[5], _mm_mul_pd(dx, dz));
+        sum[6] = _mm_add_pd(sum[6], _mm_mul_pd(dy, dy));
+        sum[7] = _mm_add_pd(sum[7], _mm_mul_pd(dy, dz));
+        sum[8] = _mm_add_pd(sum[8], _mm_mul_pd(dz, dz));
+    }
+
+    for (uint32_t k = 0; k < 9; ++k) {
+        double lanes[2];
+        _mm_storeu_pd(lanes, sum[k]);
+        result.sum_[k + 1] = lanes[0] + lanes[1];
+    }
+
+#endif
+
+    //scalar path for targets without sse and for the remainder of the neighbourhood
+    for (; i < count; ++i) {
+        const real dx = x[i] - origin.x;
+        const real dy = y[i] - origin.y;
+        const real dz = z[i] - origin.z;
+
+        result.sum_[1] += dx;
+        result.sum_[2] += dy;
+        result.sum_[3] += dz;
+        result.sum_[4] += dx * dx;
+        result.sum_[5] += dx * dy;
+        result.sum_[6] += dx * dz;
+        result.sum_[7] += dy * dy;
+        result.sum_[8] += dy * dz;
+        result.sum_[9] += dz * dz;
+    }
+
+    result.sum_[0] = real(count);
+}
+
+scm::math::mat3d covariance_of_neighbourhood(const normal_estimation::neighbourhood_batch &batch, const size_t n)
+{
+    const uint32_t first = batch.offsets_[n];
+    const uint32_t count = batch.offsets_[n + 1] - first;
+
+    scm::math::mat3d covariance = scm::math::mat3d::zero();
+    if (count == 0)
+        return covariance;
+
+    moments m;
+    accumulate_moments(batch.x_.data() + first, batch.y_.data() + first, batch.z_.data() + first,
+                       count, batch.origins_[n], m);
+
+    // sum of (p - c)(p - c)^T over the positions, with the centroid c being
+    // their sum divided by the centroid count k. relative to the origin o this
+    // is c = (s - (k - n) o) / k for n positions and expands to
+    // q - s c^T - c s^T + n c c^T
+    const real position_count = m.sum_[0];
+    const real centroid_count = batch.centroid_counts_[n] == 0 ? position_count : real(batch.centroid_counts_[n]);
+    const vec3r &origin = batch.origins_[n];
+    const real sx = m.sum_[1], sy = m.sum_[2], sz = m.sum_[3];
+    const real cx = (sx - (centroid_count - position_count) * origin.x) / centroid_count;
+    const real cy = (sy - (centroid_count - position_count) * origin.y) / centroid_count;
+    const real cz = (sz - (centroid_count - position_count) * origin.z) / centroid_count;
+
+    covariance.m00 = m.sum_[4] - 2.0 * sx * cx + position_count * cx * cx;
+    covariance.m04 = m.sum_[7] - 2.0 * sy * cy + position_count * cy * cy;
+    covariance.m08 = m.sum_[9] - 2.0 * sz * cz + position_count * cz * cz;
+    covariance.m01 = covariance.m03 = m.sum_[5] - sx * cy - cx * sy + position_count * cx * cy;
+    covariance.m02 = covariance.m06 = m.sum_[6] - sx * cz - cx * sz + position_count * cx * cz;
+    covariance.m05 = covariance.m07 = m.sum_[8] - sy * cz - cy * sz + position_count * cy * cz;
+
+    return covariance;
+}
+
+vec3r cross_product(const vec3r &a, const vec3r &b)
+{
+    return vec3r(a.y * b.z - a.z * b.y,
+                 a.z * b.x - a.x * b.z,
+                 a.x * b.y - a.y * b.x);
+}
+
+real dot_product(const vec3r &a, const vec3r &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// eigenvector of an eigenvalue with multiplicity one: the rows of A - lambda * I
+// span a plane, the longest cross product of two rows is its normal
+vec3r compute_eigenvector_0(const real a[6], const real eigenvalue)
+{
+    const vec3r row0(a[0] - eigenvalue, a[1], a[2]);
+    const vec3r row1(a[1], a[3] - eigenvalue, a[4]);
+    const vec3r row2(a[2], a[4], a[5] - eigenvalue);
+
+    const vec3r r0xr1 = cross_product(row0, row1);
+    const vec3r r0xr2 = cross_product(row0, row2);
+    const vec3r r1xr2 = cross_product(row1, row2);
+    const real d0 = dot_product(r0xr1, r0xr1);
+    const real d1 = dot_product(r0xr2, r0xr2);
+    const real d2 = dot_product(r1xr2, r1xr2);
+
+    if (d0 >= d1 && d0 >= d2)
+        return r0xr1 / std::sqrt(d0);
+    if (d1 >= d2)
+        return r0xr2 / std::sqrt(d1);
+    return r1xr2 / std::sqrt(d2);
+}
+
+// eigenvector of the second eigenvalue within the plane orthogonal to the first one
+vec3r compute_eigenvector_1(const real a[6], const vec3r &eigenvector_0, const real eigenvalue)
+{
+    vec3r u;
+    if (std::abs(eigenvector_0.x) > std::abs(eigenvector_0.y)) {
+        const real inv_length = 1.0 / std::sqrt(eigenvector_0.x * eigenvector_0.x + eigenvector_0.z * eigenvector_0.z);
+        u = vec3r(-eigenvector_0.z * inv_length, 0.0, eigenvector_0.x * inv_length);
+    }
+    else {
+        const real inv_length = 1.0 / std::sqrt(eigenvector_0.y * eigenvector_0.y + eigenvector_0.z * eigenvector_0.z);
+        u = vec3r(0.0, eigenvector_0.z * inv_length, -eigenvector_0.y * inv_length);
+    }
+    const vec3r v = cross_product(eigenvector_0, u);
+
+    const vec3r au(a[0] * u.x + a[1] * u.y + a[2] * u.z,
+                   a[1] * u.x + a[3] * u.y + a[4] * u.z,
+                   a[2] * u.x + a[4] * u.y + a[5] * u.z);
+    const vec3r av(a[0] * v.x + a[1] * v.y + a[2] * v.z,
+                   a[1] * v.x + a[3] * v.y + a[4] * v.z,
+                   a[2] * v.x + a[4] * v.y + a[5] * v.z);
+
+    real m00 = dot_product(u, au) - eigenvalue;
+    real m01 = dot_product(u, av);
+    real m11 = dot_product(v, av) - eigenvalue;
+
+    const real abs_m00 = std::abs(m00);
+    const real abs_m01 = std::abs(m01);
+    const real abs_m11 = std::abs(m11);
+
+    if (abs_m00 >= abs_m11) {
+        if (std::max(abs_m00, abs_m01) > 0.0) {
+            if (abs_m00 >= abs_m01) {
+                m01 /= m00;
+                m00 = 1.0 / std::sqrt(1.0 + m01 * m01);
+                m01 *= m00;
+            }
+            else {
+                m00 /= m01;
+                m01 = 1.0 / std::sqrt(1.0 + m00 * m00);
+                m00 *= m01;
+            }
+            return u * m01 - v * m00;
+        }
+    }
+    else {
+        if (std::max(abs_m11, abs_m01) > 0.0) {
+            if (abs_m11 >= abs_m01) {
+                m01 /= m11;
+                m11 = 1.0 / std::sqrt(1.0 + m01 * m01);
+                m01 *= m11;
+            }
+            else {
+                m11 /= m01;
+                m01 = 1.0 / std::sqrt(1.0 + m11 * m11);
+                m11 *= m01;
+            }
+            return u * m11 - v * m01;
+        }
+    }
+
+    // the eigenvalue has multiplicity two, every vector of the plane qualifies
+    return u;
+}
+
+}
+
+void normal_estimation::neighbourhood_batch::
+clear()
+{
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    offsets_.clear();
+    origins_.clear();
+    centroid_counts_.clear();
+}
+
+void normal_estimation::neighbourhood_batch::
+begin_neighbourhood(const vec3r &origin, const uint32_t centroid_count)
+{
+    if (offsets_.empty())
+        offsets_.push_back(0);
+    offsets_.push_back(offsets_.back());
+    origins_.push_back(origin);
+    centroid_counts_.push_back(centroid_count);
+}
+
+void normal_estimation::neighbourhood_batch::
+add_position(const vec3r &position)
+{
+    x_.push_back(position.x);
+    y_.push_back(position.y);
+    z_.push_back(position.z);
+    ++offsets_.back();
+}
+
+void normal_estimation::
+solve_symmetric_3x3(const scm::math::mat3d &matrix,
+                    real eigenvalues[3],
+                    vec3r eigenvectors[3])
+{
+    // upper triangle a00, a01, a02, a11, a12, a22 (the matrix is symmetric)
+    real a[6] = {matrix.m00, matrix.m03, matrix.m06, matrix.m04, matrix.m07, matrix.m08};
+
+    // scale into [-1, 1] to avoid over- and underflow
+    real max_element = 0.0;
+    for (uint32_t i = 0; i < 6; ++i)
+        max_element = std::max(max_element, std::abs(a[i]));
+
+    if (max_element == 0.0) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            eigenvalues[i] = 0.0;
+            eigenvectors[i] = vec3r(i == 0, i == 1, i == 2);
+        }
+        return;
+    }
+
+    for (uint32_t i = 0; i < 6; ++i)
+        a[i] /= max_element;
+
+    const real q = (a[0] + a[3] + a[5]) / 3.0;
+    const real b00 = a[0] - q;
+    const real b11 = a[3] - q;
+    const real b22 = a[5] - q;
+    const real off_diagonal = a[1] * a[1] + a[2] * a[2] + a[4] * a[4];
+    const real p = std::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2.0 * off_diagonal) / 6.0);
+
+    if (p == 0.0) {
+        // multiple of the identity
+        for (uint32_t i = 0; i < 3; ++i) {
+            eigenvalues[i] = q * max_element;
+            eigenvectors[i] = vec3r(i == 0, i == 1, i == 2);
+        }
+        return;
+    }
+
+    // eigenvalues of B = (A - q * I) / p are 2 * cos(angle + 2 * pi * k / 3)
+    const real c00 = b11 * b22 - a[4] * a[4];
+    const real c01 = a[1] * b22 - a[4] * a[2];
+    const real c02 = a[1] * a[4] - b11 * a[2];
+    const real half_det = std::max(-1.0, std::min(1.0, (b00 * c00 - a[1] * c01 + a[2] * c02) / (2.0 * p * p * p)));
+
+    const real angle = std::acos(half_det) / 3.0;
+    const real two_thirds_pi = 2.09439510239319549;
+    const real beta2 = 2.0 * std::cos(angle);
+    const real beta0 = 2.0 * std::cos(angle + two_thirds_pi);
+    const real beta1 = -(beta0 + beta2);
+
+    eigenvalues[0] = q + p * beta0;
+    eigenvalues[1] = q + p * beta1;
+    eigenvalues[2] = q + p * beta2;
+
+    // start with the eigenvalue that is best separated from the other two
+    if (half_det >= 0.0) {
+        eigenvectors[2] = compute_eigenvector_0(a, eigenvalues[2]);
+        eigenvectors[1] = compute_eigenvector_1(a, eigenvectors[2], eigenvalues[1]);
+        eigenvectors[0] = cross_product(eigenvectors[1], eigenvectors[2]);
+    }
+    else {
+        eigenvectors[0] = compute_eigenvector_0(a, eigenvalues[0]);
+        eigenvectors[1] = compute_eigenvector_1(a, eigenvectors[0], eigenvalues[1]);
+        eigenvectors[2] = cross_product(eigenvectors[0], eigenvectors[1]);
+    }
+
+    for (uint32_t i = 0; i < 3; ++i)
+        eigenvalues[i] *= max_element;
+}
+
+void normal_estimation::
+compute_covariances(const neighbourhood_batch &batch,
+                    std::vector<scm::math::mat3d> &covariances)
+{
+    covariances.resize(batch.size());
+
+    for (size_t n = 0; n < batch.size(); ++n)
+        covariances[n] = covariance_of_neighbourhood(batch, n);
+}
+
+void normal_estimation::
+compute_normals(const neighbourhood_batch &batch,
+                std::vector<vec3f> &normals)
+{
+    normals.resize(batch.size());
+
+    real eigenvalues[3];
+    vec3r eigenvectors[3];
+
+    for (size_t n = 0; n < batch.size(); ++n) {
+        solve_symmetric_3x3(covariance_of_neighbourhood(batch, n), eigenvalues, eigenvectors);
+        normals[n] = vec3f(eigenvectors[0].x, eigenvectors[0].y, eigenvectors[0].z);
+    }
+}
+
+} // namespace pre
+} // namespace lamure
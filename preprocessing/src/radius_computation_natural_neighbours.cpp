@@ -37,10 +37,10 @@ compute_radius(const bvh &tree,
     for (auto const &surf_id_pair : natural_neighbour_ids) {
 
         auto const &current_node = tree.nodes()[surf_id_pair.first.node_idx];
-        natural_neighbours.emplace_back(current_node.mem_array().read_surfel_ref(surf_id_pair.first.surfel_idx).pos());
+        natural_neighbours.emplace_back(current_node.mem_array().position(surf_id_pair.first.surfel_idx));
     }
 
-    vec3r point_of_interest = ((tree.nodes()[target_surfel.node_idx]).mem_array().read_surfel_ref(target_surfel.surfel_idx)).pos();
+    vec3r point_of_interest = (tree.nodes()[target_surfel.node_idx]).mem_array().position(target_surfel.surfel_idx);
 
     //determine most distant natural neighbour
     real max_distance = 0.f;
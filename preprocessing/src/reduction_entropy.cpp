@@ -1,7 +1,7 @@
 // Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
 // This Software is distributed under the Modified BSD License, see license.txt.
 //
-// Virtual Reality and Visualization Research Group 
+// Virtual Reality and Visualization Research Group
 // Faculty of Media, Bauhaus-Universitaet Weimar
 // http://www.uni-weimar.de/medien/vr
 
@@ -9,19 +9,52 @@
 
 #include <lamure/pre/reduction_entropy.h>
 
-//#include <math.h>
-#include <functional>
-#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
-#include <queue>
-#include <map>
-#include <set>
 
 namespace lamure
 {
 namespace pre
 {
 
+bool reduction_entropy::min_entropy_order::
+operator()(const uint32_t first, const uint32_t second) const
+{
+    // true  : first goes to the front, second to the back
+    // false : first goes to the back, second to the front
+
+    if (!state_->validity_[first]) {
+        return state_->validity_[second] != 0;
+    }
+    if (!state_->validity_[second]) {
+        return false;
+    }
+
+    double const first_entropy = state_->entropy_[first];
+    double const second_entropy = state_->entropy_[second];
+    if (first_entropy != second_entropy) {
+        return first_entropy > second_entropy;
+    }
+
+    // both entropies are the same, but the one with the larger radius is considered later
+    return state_->surfels_[first].radius() > state_->surfels_[second].radius();
+}
+
+bool reduction_entropy::min_entropy_priority::
+operator()(const uint32_t first, const uint32_t second) const
+{
+    min_entropy_order const order{state_};
+    if (order(second, first)) {
+        return true;
+    }
+    if (order(first, second)) {
+        return false;
+    }
+    return first < second;
+}
+
 surfel_mem_array reduction_entropy::
 create_lod(real &reduction_error,
            const std::vector<surfel_mem_array *> &input,
@@ -36,129 +69,85 @@ create_lod(real &reduction_error,
     //create output array
     surfel_mem_array mem_array(std::make_shared<surfel_vector>(surfel_vector()), 0, 0);
 
-    //container for all input surfels including entropy (entropy_surfel_array = ESA)
-    shared_entropy_surfel_vector entropy_surfel_array;
-    //priority queue as vector with min entropy surfels at the back
-    shared_entropy_surfel_vector min_entropy_surfel_ptr_queue;
-
-    //final surfels
-    shared_entropy_surfel_vector finalized_surfels;
+    entropy_state state;
 
-    // wrap all surfels of the input array to entropy_surfels and push them in the ESA
+    // copy all surfels of the input arrays into the flat state
     for (size_t node_id = 0; node_id < input.size(); ++node_id) {
-        for (size_t surfel_id = input[node_id]->offset();
-             surfel_id < input[node_id]->offset() + input[node_id]->length();
+        for (size_t surfel_id = 0;
+             surfel_id < input[node_id]->length();
              ++surfel_id) {
 
-            //this surfel will be referenced in the entropy surfel
-            auto current_surfel = input[node_id]->surfel_mem_data()->at(input[node_id]->offset() + surfel_id);
+            auto const current_surfel = input[node_id]->read_surfel(surfel_id);
 
             // ignore outlier radii of any kind
             if (current_surfel.radius() == 0.0) {
                 continue;
             }
-            //create new entropy surfel
-            entropy_surfel current_entropy_surfel(current_surfel, surfel_id, node_id);
-
-            // only place where shared pointers should be created
-            entropy_surfel_array.push_back(std::make_shared<entropy_surfel>(current_entropy_surfel));
-        }
-    }
-
-    // iterate all wrapped surfels 
-    for (auto &current_entropy_surfel_ptr : entropy_surfel_array) {
 
-        shared_entropy_surfel_vector overlapping_neighbour_ptrs
-            = get_locally_overlapping_neighbours(current_entropy_surfel_ptr, entropy_surfel_array);
-
-        //assign/compute missing attributes
-        current_entropy_surfel_ptr->neighbours = overlapping_neighbour_ptrs;
-        update_entropy(current_entropy_surfel_ptr, overlapping_neighbour_ptrs);
-
-        //if overlapping neighbours were found, put the entropy surfel back into the priority_queue
-        if (!overlapping_neighbour_ptrs.empty()) {
-            min_entropy_surfel_ptr_queue.push_back(current_entropy_surfel_ptr);
-        }
-        else { //otherwise, consider this surfel to be finalized
-            //std::cout << "**Pushing into finalized surfels (size so far: "<<finalized_surfels.size() << "): " << (int)current_entropy_surfel_ptr->contained_surfel->color()[0] << "\n";
-            finalized_surfels.push_back(current_entropy_surfel_ptr);
-            //std::cout << "did not find any Neighbours!!!!\n";
-            //std::cout << current_entropy_surfel_ptr->contained_surfel->pos() << " -- " << current_entropy_surfel_ptr->contained_surfel->radius() << " ------\n";
+            state.surfels_.push_back(current_surfel);
         }
     }
 
-    // the queue was modified, therefore it is resorted
-    std::sort(min_entropy_surfel_ptr_queue.begin(), min_entropy_surfel_ptr_queue.end(), min_entropy_order());
+    uint32_t const num_surfels = uint32_t(state.surfels_.size());
 
-    size_t num_valid_surfels = min_entropy_surfel_ptr_queue.size() + finalized_surfels.size();
+    state.entropy_.assign(num_surfels, 0.0);
+    state.level_.assign(num_surfels, 0);
+    state.validity_.assign(num_surfels, 1);
+    state.neighbours_.assign(num_surfels, std::vector<uint32_t>());
+    state.added_stamp_.assign(num_surfels, 0);
+    state.current_stamp_ = 1;
 
+    build_grid(state);
 
-    while (true) {
-
-        if (!min_entropy_surfel_ptr_queue.empty()) {
-            shared_entropy_surfel current_entropy_surfel = min_entropy_surfel_ptr_queue.back();
-
-            min_entropy_surfel_ptr_queue.pop_back();
-
-            //the back element is still valid, so we still got something to do
-            if (current_entropy_surfel->validity) {
-                //std::cout << "Working on the surfel\n";
-                // if merge returns true, the surfel still has neighbours
-
-
-                if (merge(current_entropy_surfel, entropy_surfel_array, num_valid_surfels, surfels_per_node)) {
-                    min_entropy_surfel_ptr_queue.push_back(current_entropy_surfel);
-                    /*min_entropy_surfel_ptr_queue.insert(min_entropy_surfel_ptr_queue.end(),
-                                                        finalized_surfels.begin(),
-                                                        finalized_surfels.end());
-                    */
-                    //finalized_surfels.clear();
-
-                }
-                else { //otherwise we can push it directly into the finalized surfel list
-                    finalized_surfels.push_back(current_entropy_surfel);
-                }
-
+    //priority queue with the min entropy surfel on top
+    entropy_queue min_entropy_surfel_queue(min_entropy_priority{&state});
+    min_entropy_surfel_queue.reset(num_surfels);
 
-                std::sort(min_entropy_surfel_ptr_queue.begin(), min_entropy_surfel_ptr_queue.end(), min_entropy_order());
+    //final surfels
+    std::vector<uint32_t> finalized_surfels;
 
+    for (uint32_t surfel_idx = 0; surfel_idx < num_surfels; ++surfel_idx) {
 
-                if (num_valid_surfels <= surfels_per_node) {
-                    break;
-                }
-                else {
-                    //break
-                }
-            }
+        add_overlapping_neighbours(state, surfel_idx, state.neighbours_[surfel_idx]);
+        update_entropy(state, surfel_idx);
 
+        //if overlapping neighbours were found, put the surfel into the queue
+        if (!state.neighbours_[surfel_idx].empty()) {
+            min_entropy_surfel_queue.push(surfel_idx);
         }
-        else {
-            break;
+        else { //otherwise, consider this surfel to be finalized
+            finalized_surfels.push_back(surfel_idx);
         }
-
     }
 
+    size_t num_valid_surfels = num_surfels;
 
-    // put valid surfels into final array
+    // invalidated surfels leave the queue immediately, so the top is always valid
+    while (!min_entropy_surfel_queue.empty()) {
+        uint32_t const current_surfel_idx = min_entropy_surfel_queue.pop();
 
-    //end of entropy simplification
-    while ((!min_entropy_surfel_ptr_queue.empty())) {
-        shared_entropy_surfel en_surfel_to_push = min_entropy_surfel_ptr_queue.back();
-
-        if (en_surfel_to_push->validity == true) {
-            finalized_surfels.push_back(en_surfel_to_push);
+        // if merge returns true, the surfel still has neighbours
+        if (merge(state, min_entropy_surfel_queue, current_surfel_idx, num_valid_surfels, surfels_per_node)) {
+            min_entropy_surfel_queue.push(current_surfel_idx);
+        }
+        else { //otherwise we can push it directly into the finalized surfel list
+            finalized_surfels.push_back(current_surfel_idx);
         }
 
-        min_entropy_surfel_ptr_queue.pop_back();
+        if (num_valid_surfels <= surfels_per_node) {
+            break;
+        }
     }
 
+    //end of entropy simplification, put valid surfels into final array
+    while (!min_entropy_surfel_queue.empty()) {
+        finalized_surfels.push_back(min_entropy_surfel_queue.pop());
+    }
 
-    std::sort(finalized_surfels.begin(), finalized_surfels.end(), min_entropy_order());
+    std::sort(finalized_surfels.begin(), finalized_surfels.end(), min_entropy_order{&state});
 
     while (num_valid_surfels > surfels_per_node) {
-        auto const &min_entropy_surfel = finalized_surfels.back();
-
-        if (min_entropy_surfel->validity) {
+        if (state.validity_[finalized_surfels.back()]) {
             --num_valid_surfels;
         }
 
@@ -166,11 +155,11 @@ create_lod(real &reduction_error,
     }
 
     size_t chosen_surfels = 0;
-    for (auto const &en_surf : finalized_surfels) {
+    for (auto const surfel_idx : finalized_surfels) {
 
-        if (en_surf->validity) {
+        if (state.validity_[surfel_idx]) {
             if (chosen_surfels++ < surfels_per_node) {
-                mem_array.surfel_mem_data()->push_back(*(en_surf->contained_surfel));
+                mem_array.surfel_mem_data()->push_back(state.surfels_[surfel_idx]);
             }
             else {
                 break;
@@ -185,55 +174,184 @@ create_lod(real &reduction_error,
 };
 
 void reduction_entropy::
-add_neighbours(shared_entropy_surfel entropy_surfel_to_add_neighbours,
-               shared_entropy_surfel_vector const &neighbour_ptrs_to_add) const
+build_grid(entropy_state &state) const
+{
+    uint32_t const num_surfels = uint32_t(state.surfels_.size());
+
+    vec3r min_pos(std::numeric_limits<real>::max());
+    vec3r max_pos(std::numeric_limits<real>::lowest());
+    state.max_radius_ = 0.0;
+
+    for (auto const &current_surfel : state.surfels_) {
+        for (uint8_t axis = 0; axis < 3; ++axis) {
+            min_pos[axis] = std::min(min_pos[axis], current_surfel.pos()[axis]);
+            max_pos[axis] = std::max(max_pos[axis], current_surfel.pos()[axis]);
+        }
+        state.max_radius_ = std::max(state.max_radius_, current_surfel.radius());
+    }
+
+    // cells about as large as the biggest surfel, but not many more cells than surfels
+    real const cell_edge = 2.0 * state.max_radius_;
+    uint32_t const max_cells_per_axis = std::max(1u, uint32_t(2.0 * std::cbrt(real(num_surfels))));
+
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        real const extent = num_surfels > 0 ? max_pos[axis] - min_pos[axis] : 0.0;
+        real cells = cell_edge > 0.0 ? std::ceil(extent / cell_edge) : 1.0;
+        cells = std::min(real(max_cells_per_axis), std::max(1.0, cells));
+
+        state.grid_dims_[axis] = uint32_t(cells);
+        state.grid_min_[axis] = num_surfels > 0 ? min_pos[axis] : 0.0;
+        state.cell_size_[axis] = extent > 0.0 ? extent / cells : 1.0;
+    }
+
+    state.cells_.assign(size_t(state.grid_dims_[0]) * state.grid_dims_[1] * state.grid_dims_[2],
+                        std::vector<uint32_t>());
+    state.cell_of_.resize(num_surfels);
+
+    for (uint32_t surfel_idx = 0; surfel_idx < num_surfels; ++surfel_idx) {
+        insert_into_grid(state, surfel_idx);
+    }
+}
+
+namespace
+{
+// cell coordinate along one axis, clamped to the grid. values outside of the
+// grid (and nan) end up in a border cell.
+uint32_t cell_coordinate(const real value, const real grid_min, const real cell_size, const uint32_t dim)
+{
+    real const cell = std::floor((value - grid_min) / cell_size);
+    return uint32_t(std::min(real(dim - 1), std::max(real(0.0), cell)));
+}
+}
+
+uint32_t reduction_entropy::
+grid_cell(const entropy_state &state, const vec3r &position) const
+{
+    uint32_t coords[3];
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        coords[axis] = cell_coordinate(position[axis], state.grid_min_[axis],
+                                       state.cell_size_[axis], state.grid_dims_[axis]);
+    }
+    return (coords[2] * state.grid_dims_[1] + coords[1]) * state.grid_dims_[0] + coords[0];
+}
+
+void reduction_entropy::
+insert_into_grid(entropy_state &state, const uint32_t surfel_idx) const
+{
+    uint32_t const cell = grid_cell(state, state.surfels_[surfel_idx].pos());
+    state.cell_of_[surfel_idx] = cell;
+    state.cells_[cell].push_back(surfel_idx);
+}
+
+void reduction_entropy::
+remove_from_grid(entropy_state &state, const uint32_t surfel_idx) const
+{
+    auto &cell = state.cells_[state.cell_of_[surfel_idx]];
+    auto const it = std::find(cell.begin(), cell.end(), surfel_idx);
+    *it = cell.back();
+    cell.pop_back();
+}
+
+void reduction_entropy::
+add_overlapping_neighbours(entropy_state &state,
+                           const uint32_t target_idx,
+                           std::vector<uint32_t> &neighbours) const
 {
+    surfel const &target_surfel = state.surfels_[target_idx];
+
+    // surfels whose bounding spheres do not touch the target cannot
+    // intersect it; one cell of slack covers the rounding of the range
+    real const range = target_surfel.radius() + state.max_radius_;
+
+    uint32_t lower[3], upper[3];
+    for (uint8_t axis = 0; axis < 3; ++axis) {
+        lower[axis] = cell_coordinate(target_surfel.pos()[axis] - range, state.grid_min_[axis],
+                                      state.cell_size_[axis], state.grid_dims_[axis]);
+        upper[axis] = cell_coordinate(target_surfel.pos()[axis] + range, state.grid_min_[axis],
+                                      state.cell_size_[axis], state.grid_dims_[axis]);
+        lower[axis] = lower[axis] > 0 ? lower[axis] - 1 : 0;
+        upper[axis] = std::min(upper[axis] + 1, state.grid_dims_[axis] - 1);
+    }
+
+    std::vector<uint32_t> candidates;
+    for (uint32_t z = lower[2]; z <= upper[2]; ++z) {
+        for (uint32_t y = lower[1]; y <= upper[1]; ++y) {
+            for (uint32_t x = lower[0]; x <= upper[0]; ++x) {
+                auto const &cell = state.cells_[(z * state.grid_dims_[1] + y) * state.grid_dims_[0] + x];
+                for (auto const surfel_idx : cell) {
+                    // avoid overlaps with the surfel itself
+                    if (surfel_idx != target_idx && state.added_stamp_[surfel_idx] != state.current_stamp_) {
+                        candidates.push_back(surfel_idx);
+                    }
+                }
+            }
+        }
+    }
+
+    // keep the neighbours in the order of the input surfels
+    std::sort(candidates.begin(), candidates.end());
 
-    entropy_surfel_to_add_neighbours->neighbours.insert(std::end(entropy_surfel_to_add_neighbours->neighbours),
-                                                        std::begin(neighbour_ptrs_to_add),
-                                                        std::end(neighbour_ptrs_to_add));
+    for (auto const surfel_idx : candidates) {
+        if (surfel::intersect(target_surfel, state.surfels_[surfel_idx])) {
+            neighbours.push_back(surfel_idx);
+        }
+    }
 }
 
 void reduction_entropy::
-update_color(shared_surfel target_surfel,
-             shared_entropy_surfel_vector const &neighbour_ptrs) const
+invalidate(entropy_state &state,
+           entropy_queue &queue,
+           const uint32_t surfel_idx) const
+{
+    state.validity_[surfel_idx] = 0;
+    remove_from_grid(state, surfel_idx);
+    if (queue.contains(surfel_idx)) {
+        queue.remove(surfel_idx);
+    }
+}
+
+void reduction_entropy::
+update_color(const entropy_state &state,
+             surfel &target_surfel,
+             const std::vector<uint32_t> &neighbours) const
 {
 
     vec3r accumulated_color(0.0, 0.0, 0.0);
     double accumulated_weight = 0.0;
 
-    accumulated_color = target_surfel->color();
+    accumulated_color = target_surfel.color();
     accumulated_weight = 1.0;
 
-    for (auto const curr_neighbour_ptr : neighbour_ptrs) {
+    for (auto const neighbour_idx : neighbours) {
         accumulated_weight += 1.0;
-        accumulated_color += curr_neighbour_ptr->contained_surfel->color();
+        accumulated_color += state.surfels_[neighbour_idx].color();
     }
 
     vec3b normalized_color = vec3b(accumulated_color[0] / accumulated_weight,
                                    accumulated_color[1] / accumulated_weight,
                                    accumulated_color[2] / accumulated_weight);
-    target_surfel->color() = normalized_color;
+    target_surfel.color() = normalized_color;
 }
 
 void reduction_entropy::
-update_normal(shared_surfel target_surfel_ptr,
-              shared_entropy_surfel_vector const neighbour_ptrs) const
+update_normal(const entropy_state &state,
+              surfel &target_surfel,
+              const std::vector<uint32_t> &neighbours) const
 {
     vec3f new_normal(0.0, 0.0, 0.0);
 
     real weight_sum = 0.f;
 
-    new_normal = target_surfel_ptr->normal();
+    new_normal = target_surfel.normal();
     weight_sum = 1.0;
 
-    for (auto const neighbour_ptr : neighbour_ptrs) {
-        shared_surfel target_surfel_ptr = neighbour_ptr->contained_surfel;
+    for (auto const neighbour_idx : neighbours) {
+        surfel const &neighbour_surfel = state.surfels_[neighbour_idx];
 
-        real weight = target_surfel_ptr->radius();
+        real weight = neighbour_surfel.radius();
         weight_sum += weight;
 
-        new_normal += weight * target_surfel_ptr->normal();
+        new_normal += weight * neighbour_surfel.normal();
     }
 
     if (weight_sum != 0.0) {
@@ -243,34 +361,35 @@ update_normal(shared_surfel target_surfel_ptr,
         new_normal = vec3r(0.0, 0.0, 0.0);
     }
 
-    target_surfel_ptr->normal() = scm::math::normalize(new_normal);
+    target_surfel.normal() = scm::math::normalize(new_normal);
 }
 
 // to verify: the center of mass is the point that allows for the minimal enclosing sphere
 vec3r reduction_entropy::
-compute_center_of_mass(shared_surfel target_surfel_ptr,
-                       shared_entropy_surfel_vector const &neighbour_ptrs) const
+compute_center_of_mass(const entropy_state &state,
+                       const surfel &target_surfel,
+                       const std::vector<uint32_t> &neighbours) const
 {
 
     //volume of a sphere (4/3) * pi * r^3
-    real target_surfel_radius = target_surfel_ptr->radius();
+    real target_surfel_radius = target_surfel.radius();
     real rad_pow_3 = target_surfel_radius * target_surfel_radius * target_surfel_radius;
     real target_surfel_mass = (4.0 / 3.0) * M_PI * rad_pow_3;
 
-    vec3r center_of_mass_enumerator = target_surfel_mass * target_surfel_ptr->pos();
+    vec3r center_of_mass_enumerator = target_surfel_mass * target_surfel.pos();
     real center_of_mass_denominator = target_surfel_mass;
 
     //center of mass equation: c_o_m = ( sum_of( m_i*x_i) ) / ( sum_of(m_i) )
-    for (auto const curr_neighbour_ptr : neighbour_ptrs) {
+    for (auto const neighbour_idx : neighbours) {
 
-        shared_surfel current_neighbour_surfel = curr_neighbour_ptr->contained_surfel;
+        surfel const &current_neighbour_surfel = state.surfels_[neighbour_idx];
 
-        real neighbour_radius = current_neighbour_surfel->radius();
+        real neighbour_radius = current_neighbour_surfel.radius();
 
         real neighbour_mass = (4.0 / 3.0) * M_PI *
             neighbour_radius * neighbour_radius * neighbour_radius;
 
-        center_of_mass_enumerator += neighbour_mass * current_neighbour_surfel->pos();
+        center_of_mass_enumerator += neighbour_mass * current_neighbour_surfel.pos();
 
         center_of_mass_denominator += neighbour_mass;
     }
@@ -279,19 +398,20 @@ compute_center_of_mass(shared_surfel target_surfel_ptr,
 }
 
 real reduction_entropy::
-compute_enclosing_sphere_radius(vec3r const &center_of_mass,
-                                shared_surfel target_surfel_ptr,
-                                std::vector<shared_entropy_surfel> const neighbour_ptrs) const
+compute_enclosing_sphere_radius(const entropy_state &state,
+                                vec3r const &center_of_mass,
+                                const surfel &target_surfel,
+                                const std::vector<uint32_t> &neighbours) const
 {
 
     real enclosing_radius = 0.0;
 
-    enclosing_radius = scm::math::length(center_of_mass - target_surfel_ptr->pos()) + target_surfel_ptr->radius();
+    enclosing_radius = scm::math::length(center_of_mass - target_surfel.pos()) + target_surfel.radius();
 
-    for (auto const curr_neighbour_ptr : neighbour_ptrs) {
+    for (auto const neighbour_idx : neighbours) {
 
-        shared_surfel current_neighbour_surfel = curr_neighbour_ptr->contained_surfel;
-        real neighbour_enclosing_radius = scm::math::length(center_of_mass - current_neighbour_surfel->pos()) + current_neighbour_surfel->radius();
+        surfel const &current_neighbour_surfel = state.surfels_[neighbour_idx];
+        real neighbour_enclosing_radius = scm::math::length(center_of_mass - current_neighbour_surfel.pos()) + current_neighbour_surfel.radius();
 
         if (neighbour_enclosing_radius > enclosing_radius) {
             enclosing_radius = neighbour_enclosing_radius;
@@ -301,169 +421,108 @@ compute_enclosing_sphere_radius(vec3r const &center_of_mass,
     return enclosing_radius;
 }
 
-shared_entropy_surfel_vector const reduction_entropy::
-get_locally_overlapping_neighbours(shared_entropy_surfel target_entropy_surfel_ptr,
-                                   shared_entropy_surfel_vector &entropy_surfel_ptr_array
-) const
-{
-    shared_surfel target_surfel = target_entropy_surfel_ptr->contained_surfel;
-
-    std::vector<shared_entropy_surfel> overlapping_neighbour_ptrs;
-
-    for (auto const array_entr_surfel_ptr : entropy_surfel_ptr_array) {
-
-        // avoid overlaps with the surfel itself
-        if (target_entropy_surfel_ptr->surfel_id != array_entr_surfel_ptr->surfel_id ||
-            target_entropy_surfel_ptr->node_id != array_entr_surfel_ptr->node_id) {
-
-            shared_surfel contained_surfel_ptr = array_entr_surfel_ptr->contained_surfel;
-
-            if (surfel::intersect(*target_surfel, *contained_surfel_ptr)) {
-                overlapping_neighbour_ptrs.push_back(array_entr_surfel_ptr);
-            }
-
-        }
-
-    }
-
-    return overlapping_neighbour_ptrs;
-}
-
 void reduction_entropy::
-update_entropy(shared_entropy_surfel target_en_surfel,
-               shared_entropy_surfel_vector const neighbour_ptrs) const
+update_entropy(entropy_state &state, const uint32_t target_idx) const
 {
     // base entropy for surfel
-    //double entropy = target_en_surfel->contained_surfel->radius();
     double entropy = 0.0;
 
-    vec3b const &target_surfel_color = target_en_surfel->contained_surfel->color();
+    surfel const &target_surfel = state.surfels_[target_idx];
 
     size_t num_surfels_considered = 1;
 
-    for (auto const curr_neighbour_ptr : neighbour_ptrs) {
-
-        if (curr_neighbour_ptr->validity) {
-            shared_surfel current_neighbour_surfel = curr_neighbour_ptr->contained_surfel;
-
-            vec3f const &neighbour_normal = current_neighbour_surfel->normal();
+    for (auto const neighbour_idx : state.neighbours_[target_idx]) {
 
-            vec3b const &neighbour_color = current_neighbour_surfel->color();
+        if (state.validity_[neighbour_idx]) {
+            vec3f const &neighbour_normal = state.surfels_[neighbour_idx].normal();
 
-            float normal_angle = std::fabs(scm::math::dot(target_en_surfel->contained_surfel->normal(), neighbour_normal));
-            entropy += (1 + target_en_surfel->level) / (1.0 + normal_angle);
-/*
-            real color_diff = scm::math::length( vec3r((target_surfel_color[0] - neighbour_color[0]),
-                                                       (target_surfel_color[1] - neighbour_color[1]),
-                                                       (target_surfel_color[2] - neighbour_color[2]) ) ) ;
-*/
-            //entropy += (1 + target_en_surfel->level) * (1 + (color_diff));
-
-            //entropy += current_neighbour_surfel->radius();
+            float normal_angle = std::fabs(scm::math::dot(target_surfel.normal(), neighbour_normal));
+            entropy += (1 + state.level_[target_idx]) / (1.0 + normal_angle);
 
             ++num_surfels_considered;
         }
     };
 
-    target_en_surfel->entropy = entropy / num_surfels_considered;
-    //target_en_surfel->entropy = entropy;
-}
-
-void reduction_entropy::
-update_entropy_surfel_level(shared_entropy_surfel target_en_surfel_ptr,
-                            shared_entropy_surfel_vector const &invalidated_neighbours) const
-{
-    //target_en_surfel_ptr->level += 1;
-    target_en_surfel_ptr->level += invalidated_neighbours.size() * 1000;
+    state.entropy_[target_idx] = entropy / num_surfels_considered;
 }
 
 void reduction_entropy::
-update_position(shared_surfel target_surfel_ptr,
-                shared_entropy_surfel_vector const neighbour_ptrs) const
+update_position(const entropy_state &state,
+                surfel &target_surfel,
+                const std::vector<uint32_t> &neighbours) const
 {
-    target_surfel_ptr->pos() = compute_center_of_mass(target_surfel_ptr,
-                                                      neighbour_ptrs);
+    target_surfel.pos() = compute_center_of_mass(state, target_surfel, neighbours);
 }
 
 void reduction_entropy::
-update_radius(shared_surfel target_surfel_ptr,
-              shared_entropy_surfel_vector const neighbour_ptrs) const
+update_radius(const entropy_state &state,
+              surfel &target_surfel,
+              const std::vector<uint32_t> &neighbours) const
 {
-    target_surfel_ptr->radius()
-        = compute_enclosing_sphere_radius(target_surfel_ptr->pos(),
-                                          target_surfel_ptr,
-                                          neighbour_ptrs);
+    target_surfel.radius()
+        = compute_enclosing_sphere_radius(state,
+                                          target_surfel.pos(),
+                                          target_surfel,
+                                          neighbours);
 }
 
 void reduction_entropy::
-update_surfel_attributes(shared_surfel target_surfel_ptr,
-                         shared_entropy_surfel_vector const invalidated_neighbours) const
+update_surfel_attributes(const entropy_state &state,
+                         surfel &target_surfel,
+                         const std::vector<uint32_t> &invalidated_neighbours) const
 {
 
-    update_normal(target_surfel_ptr, invalidated_neighbours);
-    update_color(target_surfel_ptr, invalidated_neighbours);
+    update_normal(state, target_surfel, invalidated_neighbours);
+    update_color(state, target_surfel, invalidated_neighbours);
 
     // position needs to be updated before the radius is updated
-    update_position(target_surfel_ptr, invalidated_neighbours);
-    update_radius(target_surfel_ptr, invalidated_neighbours);
+    update_position(state, target_surfel, invalidated_neighbours);
+    update_radius(state, target_surfel, invalidated_neighbours);
 }
 
 bool reduction_entropy::
-merge(shared_entropy_surfel target_entropy_surfel,
-      shared_entropy_surfel_vector const &complete_entropy_surfel_array,
-      size_t &num_remaining_valid_surfel, size_t num_desired_surfel) const
+merge(entropy_state &state,
+      entropy_queue &queue,
+      const uint32_t target_idx,
+      size_t &num_remaining_valid_surfel,
+      size_t num_desired_surfel) const
 {
 
     size_t num_invalidated_surfels = 0;
 
-    shared_entropy_surfel_vector neighbours_to_merge;
-
-    //**replace own invalid neighbours by valid neighbours of invalid neighbours**
-    std::map<size_t, std::set<size_t> > added_neighbours_during_merge;
-
-    auto min_distance_ordering = [&target_entropy_surfel](shared_entropy_surfel const &left_entropy_surfel,
-                                                          shared_entropy_surfel const &right_entropy_surfel)
-    {
-
-
-        double left_en_surfel_distance_measure =
-            (target_entropy_surfel->contained_surfel->radius() +
-                left_entropy_surfel->contained_surfel->radius()) -
-                scm::math::length(target_entropy_surfel->contained_surfel->pos() -
-                    left_entropy_surfel->contained_surfel->pos());
-
-        double right_en_surfel_distance_measure =
-            (target_entropy_surfel->contained_surfel->radius() +
-                right_entropy_surfel->contained_surfel->radius()) -
-                scm::math::length(target_entropy_surfel->contained_surfel->pos() -
-                    right_entropy_surfel->contained_surfel->pos());
-
-        if (
-            left_en_surfel_distance_measure
-                <
-                    right_en_surfel_distance_measure
-            ) {
-            return true;
-        }
-        else {
-            return false;
-        }
-    };
+    // a fresh stamp marks the neighbours added during this merge
+    ++state.current_stamp_;
+
+    surfel &target_surfel = state.surfels_[target_idx];
+    std::vector<uint32_t> &neighbours = state.neighbours_[target_idx];
+
+    //sort neighbours by increasing overlap with the target surfel
+    std::vector<std::pair<double, uint32_t>> ordered_neighbours;
+    ordered_neighbours.reserve(neighbours.size());
+    for (auto const neighbour_idx : neighbours) {
+        surfel const &neighbour_surfel = state.surfels_[neighbour_idx];
+        double const distance_measure =
+            (target_surfel.radius() + neighbour_surfel.radius()) -
+                scm::math::length(target_surfel.pos() - neighbour_surfel.pos());
+        ordered_neighbours.emplace_back(distance_measure, neighbour_idx);
+    }
 
-    //sort neighbours by increasing entropy to current neighbour
-    std::sort(target_entropy_surfel->neighbours.begin(),
-              target_entropy_surfel->neighbours.end(),
-              min_distance_ordering);
+    std::sort(ordered_neighbours.begin(), ordered_neighbours.end(),
+              [](std::pair<double, uint32_t> const &left, std::pair<double, uint32_t> const &right)
+              { return left.first < right.first; });
 
+    for (size_t i = 0; i < ordered_neighbours.size(); ++i) {
+        neighbours[i] = ordered_neighbours[i].second;
+    }
 
-    shared_entropy_surfel_vector invalidated_neighbours;
+    std::vector<uint32_t> invalidated_neighbours;
 
-    for (auto const actual_neighbour_ptr : target_entropy_surfel->neighbours) {
+    for (auto const neighbour_idx : neighbours) {
 
-        if (actual_neighbour_ptr->validity) {
-            actual_neighbour_ptr->validity = false;
+        if (state.validity_[neighbour_idx]) {
+            invalidate(state, queue, neighbour_idx);
 
-            invalidated_neighbours.push_back(actual_neighbour_ptr);
+            invalidated_neighbours.push_back(neighbour_idx);
 
             ++num_invalidated_surfels;
             if (--num_remaining_valid_surfel == num_desired_surfel) {
@@ -474,75 +533,41 @@ merge(shared_entropy_surfel target_entropy_surfel,
 
     }
 
-    for (auto const actual_neighbour_ptr : invalidated_neighbours) {
+    //**replace own invalid neighbours by valid neighbours of invalid neighbours**
+    for (auto const neighbour_idx : invalidated_neighbours) {
 
         //iterate the neighbours of the invalid neighbour
-        for (auto const second_neighbour_ptr : actual_neighbour_ptr->neighbours) {
+        for (auto const second_neighbour_idx : state.neighbours_[neighbour_idx]) {
 
             // we only have to consider valid neighbours, all the others are also our own neighbours and already invalid
-            if (second_neighbour_ptr->validity) {
-                size_t n_id = second_neighbour_ptr->node_id;
-                size_t s_id = second_neighbour_ptr->surfel_id;
-
-                //avoid getting the surfel itself as neighbour
-                if (n_id != target_entropy_surfel->node_id ||
-                    s_id != target_entropy_surfel->surfel_id) {
-                    //ignore 2nd neighbours which we found already at another neighbour
-                    if ((added_neighbours_during_merge[n_id]).find(s_id) == added_neighbours_during_merge[n_id].end()) {
-                        (added_neighbours_during_merge[n_id]).insert(s_id);
-                        neighbours_to_merge.push_back(second_neighbour_ptr);
-                    }
-                }
+            // avoid getting the surfel itself as neighbour and ignore 2nd neighbours which we found already at another neighbour
+            if (state.validity_[second_neighbour_idx] &&
+                second_neighbour_idx != target_idx &&
+                state.added_stamp_[second_neighbour_idx] != state.current_stamp_) {
+                state.added_stamp_[second_neighbour_idx] = state.current_stamp_;
+                neighbours.push_back(second_neighbour_idx);
             }
         }
 
     }
 
-    add_neighbours(target_entropy_surfel, neighbours_to_merge);
-
     //recompute values for merged surfel
-    //target_entropy_surfel->level += 1;
-    update_entropy_surfel_level(target_entropy_surfel, invalidated_neighbours);
-    update_surfel_attributes(target_entropy_surfel->contained_surfel, invalidated_neighbours);
-
-
-    // now that we , we also have to look for neighbours that we suddenly overlap due to the higher radius
-    shared_entropy_surfel_vector additional_surfels_to_test_for_overlap;
-
-
-    for (auto const surfel_ptr : complete_entropy_surfel_array) {
-
-        if (surfel_ptr->validity) {
-            if (surfel_ptr->node_id != target_entropy_surfel->node_id ||
-                surfel_ptr->surfel_id != target_entropy_surfel->surfel_id) {
-
-                if (added_neighbours_during_merge[surfel_ptr->node_id].find(surfel_ptr->surfel_id) ==
-                    added_neighbours_during_merge[surfel_ptr->node_id].end()) {
-                    // we did not consider this surfel, we can check for an overlap.
-                    additional_surfels_to_test_for_overlap.push_back(surfel_ptr);
-
-                }
-
-            }
-        }
-    }
-
-    auto const additional_overlapping_neighbours
-        = get_locally_overlapping_neighbours(target_entropy_surfel,
-                                             additional_surfels_to_test_for_overlap);
-
-    //if(additional_overlapping_neighbours.size() != 0)
-    //    std::cout << "Found something!\n";
+    state.level_[target_idx] += invalidated_neighbours.size() * 1000;
+    update_surfel_attributes(state, target_surfel, invalidated_neighbours);
 
-    add_neighbours(target_entropy_surfel, additional_overlapping_neighbours);
+    state.max_radius_ = std::max(state.max_radius_, target_surfel.radius());
+    remove_from_grid(state, target_idx);
+    insert_into_grid(state, target_idx);
 
+    // we also have to look for neighbours that we suddenly overlap due to the higher radius
+    add_overlapping_neighbours(state, target_idx, neighbours);
 
-    update_entropy(target_entropy_surfel, target_entropy_surfel->neighbours);
+    update_entropy(state, target_idx);
 
 
     if (num_invalidated_surfels == 0)
         return false;
-    if (!target_entropy_surfel->neighbours.empty()) {
+    if (!neighbours.empty()) {
         return true;
     }
     else {
@@ -553,4 +578,4 @@ merge(shared_entropy_surfel target_entropy_surfel,
 } // namespace pre
 } // namespace lamure
 
-#endif // CMAKE_OPTION_ENABLE_ALTERNATIVE_STRATEGIES
\ No newline at end of file
+#endif // CMAKE_OPTION_ENABLE_ALTERNATIVE_STRATEGIES
@@ -30,11 +30,11 @@ create_lod(real &reduction_error,
 
     //create lod from input
     for (size_t i = 0; i < input.size(); ++i) {
-        for (size_t j = input[i]->offset() + i;
-             j < input[i]->offset() + input[i]->length();
+        for (size_t j = i;
+             j < input[i]->length();
              j += input.size()) {
 
-            auto surfel = input[i]->surfel_mem_data()->at(j);
+            auto surfel = input[i]->read_surfel(j);
 
             real new_rad = mult * surfel.radius();
             surfel.radius() = new_rad;
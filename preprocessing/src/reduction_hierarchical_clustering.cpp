@@ -8,6 +8,7 @@
 #ifdef CMAKE_OPTION_ENABLE_ALTERNATIVE_STRATEGIES
 
 #include <lamure/pre/reduction_hierarchical_clustering.h>
+#include <lamure/pre/normal_estimation.h>
 #include <queue>
 
 
@@ -33,14 +34,18 @@ create_lod(real &reduction_error,
     }
 
     // Create a single surfel vector to sample from.
-    std::vector<surfel *> surfels_to_sample;
+    surfel_vector input_surfels;
     for (uint32_t child_mem_array_index = 0; child_mem_array_index < input.size(); ++child_mem_array_index) {
         surfel_mem_array *child_mem_array = input.at(child_mem_array_index);
 
         for (uint32_t surfel_index = 0; surfel_index < child_mem_array->length(); ++surfel_index) {
-            surfels_to_sample.push_back(&child_mem_array->surfel_mem_data()->at(surfel_index));
+            input_surfels.push_back(child_mem_array->read_surfel(surfel_index));
         }
     }
+    std::vector<surfel *> surfels_to_sample;
+    for (auto &input_surfel : input_surfels) {
+        surfels_to_sample.push_back(&input_surfel);
+    }
 
     // Set initial parameters depending on input parameters.
     // These splitting thresholds adapt during the execution of the algorithm.
@@ -171,34 +176,14 @@ real reduction_hierarchical_clustering::
 calculate_variation(const scm::math::mat3d &covariance_matrix, vec3f &normal) const
 {
     //solve for eigenvectors
-    real *eigenvalues = new real[3];
-    real **eigenvectors = new real *[3];
-    for (int i = 0; i < 3; ++i) {
-        eigenvectors[i] = new real[3];
-    }
-
-    jacobi_rotation(covariance_matrix, eigenvalues, eigenvectors);
+    real eigenvalues[3];
+    vec3r eigenvectors[3];
+    normal_estimation::solve_symmetric_3x3(covariance_matrix, eigenvalues, eigenvectors);
 
     real variation = eigenvalues[0] / (eigenvalues[0] + eigenvalues[1] + eigenvalues[2]);
 
     // Use eigenvector with highest magnitude as splitting plane normal.
-    normal = scm::math::vec3f(eigenvectors[0][2], eigenvectors[1][2], eigenvectors[2][2]);
-
-    /*for(uint32_t eigen_index = 1; eigen_index <= 2; ++eigen_index)
-    {
-    	vec3f other_normal = scm::math::vec3f(eigenvectors[0][eigen_index], eigenvectors[1][eigen_index], eigenvectors[2][eigen_index]);
-    	
-    	if(scm::math::length(normal) < scm::math::length(other_normal))
-    	{
-    		normal = other_normal;
-    	}
-    }*/
-
-    delete[] eigenvalues;
-    for (int i = 0; i < 3; ++i) {
-        delete[] eigenvectors[i];
-    }
-    delete[] eigenvectors;
+    normal = scm::math::vec3f(eigenvectors[2].x, eigenvectors[2].y, eigenvectors[2].z);
 
     return variation;
 }
@@ -273,135 +258,6 @@ point_plane_distance(const vec3r &centroid, const vec3f &normal, const vec3r &po
     return distance;
 }
 
-void reduction_hierarchical_clustering::
-jacobi_rotation(const scm::math::mat3d &_matrix, double *eigenvalues, double **eigenvectors) const
-{
-    unsigned int max_iterations = 10;
-    double max_error = 0.00000001;
-    unsigned int dim = 3;
-
-    double iR1[3][3];
-    iR1[0][0] = _matrix[0];
-    iR1[0][1] = _matrix[1];
-    iR1[0][2] = _matrix[2];
-    iR1[1][0] = _matrix[3];
-    iR1[1][1] = _matrix[4];
-    iR1[1][2] = _matrix[5];
-    iR1[2][0] = _matrix[6];
-    iR1[2][1] = _matrix[7];
-    iR1[2][2] = _matrix[8];
-
-
-    for (uint32_t i = 0; i <= dim - 1; ++i) {
-        eigenvectors[i][i] = 1.0;
-        for (uint32_t j = 0; j <= dim - 1; ++j) {
-            if (i != j) {
-                eigenvectors[i][j] = 0.0;
-            }
-        }
-    }
-
-    uint32_t iteration = 0;
-    uint32_t p, q;
-
-    while (iteration < max_iterations) {
-
-        double max_diff = 0.0;
-
-        for (uint32_t i = 0; i < dim - 1; ++i) {
-            for (uint32_t j = i + 1; j < dim; ++j) {
-                long double diff = std::abs(iR1[i][j]);
-                if (i != j && diff >= max_diff) {
-                    max_diff = diff;
-                    p = i;
-                    q = j;
-                }
-            }
-        }
-
-        if (max_diff < max_error) {
-            for (uint32_t i = 0; i < dim; ++i) {
-                eigenvalues[i] = iR1[i][i];
-            }
-            break;
-        }
-
-        long double x = -iR1[p][q];
-        long double y = (iR1[q][q] - iR1[p][p]) / 2.0;
-        long double omega = x / sqrt(x * x + y * y);
-
-        if (y < 0.0) {
-            omega = -omega;
-        }
-
-        long double sn = 1.0 + sqrt(1.0 - omega * omega);
-        sn = omega / sqrt(2.0 * sn);
-        long double cn = sqrt(1.0 - sn * sn);
-
-        max_diff = iR1[p][p];
-
-        iR1[p][p] = max_diff * cn * cn + iR1[q][q] * sn * sn + iR1[p][q] * omega;
-        iR1[q][q] = max_diff * sn * sn + iR1[q][q] * cn * cn - iR1[p][q] * omega;
-        iR1[p][q] = 0.0;
-        iR1[q][p] = 0.0;
-
-        for (uint32_t j = 0; j <= dim - 1; ++j) {
-            if (j != p && j != q) {
-                max_diff = iR1[p][j];
-                iR1[p][j] = max_diff * cn + iR1[q][j] * sn;
-                iR1[q][j] = -max_diff * sn + iR1[q][j] * cn;
-            }
-        }
-
-        for (uint32_t i = 0; i <= dim - 1; ++i) {
-            if (i != p && i != q) {
-                max_diff = iR1[i][p];
-                iR1[i][p] = max_diff * cn + iR1[i][q] * sn;
-                iR1[i][q] = -max_diff * sn + iR1[i][q] * cn;
-            }
-        }
-
-        for (uint32_t i = 0; i <= dim - 1; ++i) {
-            max_diff = eigenvectors[i][p];
-            eigenvectors[i][p] = max_diff * cn + eigenvectors[i][q] * sn;
-            eigenvectors[i][q] = -max_diff * sn + eigenvectors[i][q] * cn;
-        }
-
-        ++iteration;
-    }
-
-
-    eigsrt_jacobi(dim, eigenvalues, eigenvectors);
-}
-
-void reduction_hierarchical_clustering::
-eigsrt_jacobi(int dim, double *eigenvalues, double **eigenvectors) const
-{
-    for (int i = 0; i < dim; ++i) {
-        int k = i;
-        double v = eigenvalues[k];
-
-        for (int j = i + 1; j < dim; ++j) {
-            if (eigenvalues[j] < v) // eigenvalues[j] <= v ?
-            {
-                k = j;
-                v = eigenvalues[k];
-            }
-        }
-
-        if (k != i) {
-            eigenvalues[k] = eigenvalues[i];
-            eigenvalues[i] = v;
-
-            for (int j = 0; j < dim; ++j) {
-                v = eigenvectors[j][i];
-                eigenvectors[j][i] = eigenvectors[j][k];
-                eigenvectors[j][k] = v;
-            }
-        }
-    }
-}
-
 } // namespace pre
 } // namespace lamure
 
@@ -208,7 +208,7 @@ std::pair<vec3ui, vec3b> reduction_normal_deviation_clustering_provenance::compu
             {
                 for(uint32_t j = 0; j < input[i]->length(); ++j)
                 {
-                    vec3r surfel_pos = input[i]->read_surfel_ref(j).pos() - bounding_box.min();
+                    vec3r surfel_pos = input[i]->position(j) - bounding_box.min();
                     if(surfel_pos.x < 0.f)
                         surfel_pos.x = 0.f;
                     if(surfel_pos.y < 0.f)
@@ -346,7 +346,7 @@ surfel_mem_array reduction_normal_deviation_clustering_provenance::create_lod(re
     {
         for(uint32_t j = 0; j < input[i]->length(); ++j)
         {
-            vec3r surfel_pos = input[i]->read_surfel_ref(j).pos() - bbox.min();
+            vec3r surfel_pos = input[i]->position(j) - bbox.min();
             if(surfel_pos.x < 0.f)
                 surfel_pos.x = 0.f;
             if(surfel_pos.y < 0.f)
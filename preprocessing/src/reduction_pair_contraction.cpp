@@ -1,234 +1,205 @@
 // Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
 // This Software is distributed under the Modified BSD License, see license.txt.
 //
-// Virtual Reality and Visualization Research Group 
+// Virtual Reality and Visualization Research Group
 // Faculty of Media, Bauhaus-Universitaet Weimar
 // http://www.uni-weimar.de/medien/vr
 
 #ifdef CMAKE_OPTION_ENABLE_ALTERNATIVE_STRATEGIES
 
 #include <lamure/pre/reduction_pair_contraction.h>
+#include <lamure/pre/indexed_heap.h>
+#include <lamure/pre/knn_index.h>
 #include <lamure/pre/surfel.h>
-#include <set>
-#include <functional>
-#include <queue>
-#include <deque>
-#include <map>
-#include <cmath>
-#include <array>
-#include <unordered_map>
 
-// #define DEBUG
-// #define ERROR_COLOR
-// #define LEAF_REMOVAL
-#define LIMIT_NEIGHBOURS
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 namespace lamure
 {
-
 namespace pre
 {
-struct quadric_t
-{
-    quadric_t()
-        : hess{0.0}
-    {}
-    quadric_t(vec4r const &hessian)
-        : hess{hessian}
-    {}
-
-    real error(vec3r const &p) const
-    {
-        real a = dot(hess, vec4r{p, 1});
-        return a * a;
-    }
 
-    quadric_t &operator+=(const quadric_t &q2)
-    {
-        // prevent cancelling out when quadrics point in opposite direction
-        real coeff = (dot(vec3r{hess}, vec3r{q2.hess}) < 0) ? -1.0 : 1.0;
-        hess += coeff * q2.hess;
-        return *this;
-    }
-
-    vec4r hess;
-};
-
-quadric_t operator+(const quadric_t &q1, const quadric_t &q2)
+namespace
 {
-    quadric_t q;
-    // prevent cancelling out when quadrics point in opposite direction
-    real coeff = (dot(vec3r{q1.hess}, vec3r{q2.hess}) < 0) ? -1.0 : 1.0;
-    q.hess = q1.hess + coeff * q2.hess;
-    return q;
-}
 
-struct edge_t
+// the quadric of a surfel is a single plane in hessian form
+real quadric_error(const vec4r &quadric, const vec3r &p)
 {
-    edge_t(surfel_id_t p1, surfel_id_t p2)
-        : a{p1 < p2 ? p1 : p2}, b{p1 < p2 ? p2 : p1}
-    {};
-
-    surfel_id_t a;
-    surfel_id_t b;
-};
+    real a = dot(quadric, vec4r{p, 1});
+    return a * a;
+}
 
-bool operator==(const edge_t &e1, const edge_t &e2)
+vec4r add_quadrics(const vec4r &q1, const vec4r &q2)
 {
-    if (e1.a == e2.a) {
-        return e1.b == e2.b;
-    }
-    return false;
+    // prevent cancelling out when quadrics point in opposite direction
+    real coeff = (dot(vec3r{q1}, vec3r{q2}) < 0) ? -1.0 : 1.0;
+    return q1 + coeff * q2;
 }
 
-bool operator<(const edge_t &e1, const edge_t &e2)
+vec4r edge_quadric(const vec3f &normal_p1, const vec3f &normal_p2, const vec3r &p1, const vec3r &p2)
 {
-    if (e1.a < e2.a) {
-        return true;
+    vec3r edge_dir = p2 - p1;
+    vec3r tangent = cross(vec3r(normal_p1 + (dot(normal_p1, normal_p2) < 0.0 ? -1.0 : 1.0f) * normal_p2), edge_dir);
+
+    vec3r normal = cross(tangent, edge_dir);
+    // check for degenerate surfels on same position to prevent NaN values
+    if (normal.x == 0 && normal.y == 0 && normal.z == 0) {
+        normal = vec3r{0.0};
     }
     else {
-        if (e1.a == e2.a) {
-            return e1.b < e2.b;
-        }
-        else return false;
+        // dont take root for more smooth result
+        normal /= normal.x * normal.x + normal.y * normal.y + normal.z * normal.z;
     }
-}
 
-std::ostream &operator<<(std::ostream &os, const edge_t &e)
-{
-    os << "<" << e.a << "--" << e.b << ">";
-    return os;
+    return vec4r{normal, -dot(p1, normal)};
 }
 
-struct contraction_op;
-
-struct contraction
+// edge indices of one surfel, a slice of the arena of the workspace
+struct adjacency_list
 {
-    contraction(edge_t e, quadric_t quad, real err, surfel surf)
-        : edge{e}, quadric{quad}, error{err}, new_surfel{surf}
-    {}
-
-    edge_t edge;
-    quadric_t quadric;
-    real error;
-    surfel new_surfel;
-
-    contraction_op *cont_op;
+    uint32_t offset_;
+    uint32_t size_;
+    uint32_t capacity_;
 };
 
-bool operator<(const contraction &c1, const contraction &c2)
-{
-    return c1.error < c2.error;
-}
-
-struct contraction_op
+struct cheapest_contraction
 {
-    contraction_op(contraction *c)
-        : cont{c}
-    {};
+    const std::vector<real> *errors_;
 
-    contraction *cont;
+    bool operator()(const uint32_t first, const uint32_t second) const
+    {
+        const real first_error = (*errors_)[first];
+        const real second_error = (*errors_)[second];
+        return first_error < second_error || (first_error == second_error && first < second);
+    }
 };
 
-bool operator>(const contraction_op &c1, const contraction_op &c2)
+// all state of one create_lod call in flat arrays indexed by surfel or edge.
+// the workspace lives only for that call, so its memory is released before
+// the scheduler thread moves on and never outlasts the memory budget.
+struct contraction_workspace
 {
-    // invalid op -> must return false to form strict-weak ordering
-    // otherwise undefined behaviour for sort
-    return c1.cont->error > c2.cont->error;
-}
+    // input surfels followed by the surfels created by contractions, the
+    // radius of contracted surfels is set to -1
+    std::vector<surfel> surfels_;
+    std::vector<vec4r> quadrics_;
 
-quadric_t edge_quadric(const vec3f &normal_p1, const vec3f &normal_p2, const vec3r &p1, const vec3r &p2);
+    // edges of the knn graph, when a surfel is contracted its remaining
+    // edges are reconnected to the new surfel
+    std::vector<uint32_t> edge_first_;
+    std::vector<uint32_t> edge_second_;
+    std::vector<real> edge_error_;
 
-}
-}
+    std::vector<adjacency_list> adjacency_;
+    std::vector<uint32_t> arena_;
 
-const size_t num_surfels_per_node = 3000;
+    // surfels connected to the current new surfel carry the current stamp
+    std::vector<uint32_t> stamp_;
+    uint32_t current_stamp_;
 
-const size_t num_nodes_per_level = 14348907;
+    std::vector<uint32_t> first_surfel_of_array_;
+    std::vector<std::pair<uint32_t, uint32_t>> pairs_;
+    std::vector<std::pair<uint32_t, uint32_t>> neighbours_;
 
-namespace std
-{
-template<>
-struct hash<lamure::pre::edge_t>
-{
-    size_t operator()(lamure::pre::edge_t const &e) const noexcept
+    knn_index index_;
+    knn_index::scratch knn_scratch_;
+    knn_index::neighbour_vector knn_result_;
+
+    void clear()
     {
-        uint16_t h1 = e.a.node_idx * num_surfels_per_node + e.a.surfel_idx;
-        uint16_t h2 = e.b.node_idx * num_surfels_per_node + e.b.surfel_idx;
-        size_t hash = h1;
-        hash += h2 >> 16;
-        return hash;
+        surfels_.clear();
+        quadrics_.clear();
+        edge_first_.clear();
+        edge_second_.clear();
+        edge_error_.clear();
+        adjacency_.clear();
+        arena_.clear();
+        stamp_.clear();
+        current_stamp_ = 0;
+        first_surfel_of_array_.clear();
+        pairs_.clear();
     }
-};
-template<>
-struct hash<lamure::surfel_id_t>
-{
-    size_t operator()(lamure::surfel_id_t const &s) const noexcept
+
+    void add_to_adjacency(const uint32_t surfel_idx, const uint32_t edge_idx)
     {
-        return s.node_idx * num_surfels_per_node + s.surfel_idx;
+        adjacency_list &list = adjacency_[surfel_idx];
+        if (list.size_ == list.capacity_) {
+            // move the list to the end of the arena with twice the capacity
+            const uint32_t new_capacity = std::max(4u, 2 * list.capacity_);
+            const uint32_t new_offset = uint32_t(arena_.size());
+            arena_.resize(new_offset + new_capacity);
+            std::copy(arena_.begin() + list.offset_, arena_.begin() + list.offset_ + list.size_,
+                      arena_.begin() + new_offset);
+            list.offset_ = new_offset;
+            list.capacity_ = new_capacity;
+        }
+        arena_[list.offset_ + list.size_++] = edge_idx;
     }
-};
-}
-namespace lamure
-{
-namespace pre
-{
 
-bool a = false;
+    void remove_from_adjacency(const uint32_t surfel_idx, const uint32_t edge_idx)
+    {
+        adjacency_list &list = adjacency_[surfel_idx];
+        auto const begin = arena_.begin() + list.offset_;
+        auto const it = std::find(begin, begin + list.size_, edge_idx);
+        *it = *(begin + list.size_ - 1);
+        --list.size_;
+    }
 
-real sum(const mat4r &quadric)
-{
-    real sum = 0;
-    for (int i = 0; i < 16; ++i) {
-        sum += quadric[i] * quadric[i];
+    uint32_t other_end(const uint32_t edge_idx, const uint32_t surfel_idx) const
+    {
+        return edge_first_[edge_idx] == surfel_idx ? edge_second_[edge_idx] : edge_first_[edge_idx];
     }
-    return sum;
-}
 
-vec3b n_to_c(vec3f normal)
-{
-    // normal = normal * 255;
-    normal = (normal * 0.5f + 0.5f) * 255;
-    return vec3b{uint8_t(normal.x), uint8_t(normal.y), uint8_t(normal.z)};
-}
-vec3b n_to_cb(vec3f normal)
-{
-    normal.x = (normal.x < 0) ? 0 : 1;
-    normal.y = (normal.y < 0) ? 0 : 1;
-    normal.z = (normal.z < 0) ? 0 : 1;
-    normal = normal * 255;
-    // normal = (normal * 0.5f + 0.5f) * 255;
-    return vec3b{uint8_t(normal.x), uint8_t(normal.y), uint8_t(normal.z)};
-}
+    // the merged surfel of an edge is the mean of both surfels, or one of
+    // them if it fits the summed planes better
+    real contract(const uint32_t first, const uint32_t second, surfel &new_surfel, vec4r &new_quadric) const
+    {
+        const surfel &surfel1 = surfels_[first];
+        const surfel &surfel2 = surfels_[second];
 
-static vec3b heatmap(float norm_val)
-{
-    vec3f color{0.0f};
-    float third = 1 / 3.0f;
-    if (norm_val <= third) {
-        color.g = 1.0f;
-        color.r = std::max(0.0f, (third - norm_val) * 3.0f);
-    }
-    else if (norm_val <= third * 2.0f) {
-        norm_val -= third;
-        color.b = std::max(0.0f, norm_val * 3.0f);
-        color.g = std::max(0.0f, (third - norm_val) * 3.0f);
+        new_surfel = surfel{(surfel1.pos() + surfel2.pos()) * 0.5,
+                            vec3b{(vec3r{surfel1.color()} + vec3r{surfel2.color()}) * 0.5},
+                            (surfel1.radius() + surfel2.radius()) * 0.5f,
+                            (normalize(surfel1.normal() + surfel2.normal()))
+        };
+        new_quadric = add_quadrics(quadrics_[first], quadrics_[second]);
+
+        real error = quadric_error(new_quadric, new_surfel.pos());
+        real error1 = quadric_error(new_quadric, surfel1.pos());
+        real error2 = quadric_error(new_quadric, surfel2.pos());
+        if (error1 < error) {
+            if (error2 < error1) {
+                new_surfel = surfel2;
+                error = error2;
+            }
+            else {
+                new_surfel = surfel1;
+                error = error1;
+            }
+        }
+        else if (error2 < error) {
+            new_surfel = surfel2;
+            error = error2;
+        }
+
+        // keep the heap order well defined for degenerate surfels
+        return std::isnan(error) ? std::numeric_limits<real>::infinity() : error;
     }
-    else {
-        norm_val -= 2.0f * third;
-        color.r = std::max(0.0f, norm_val * 3.0f);
-        color.b = std::max(0.0f, (third - norm_val) * 3.0f);
+
+    void connect(const uint32_t edge_idx, const uint32_t first, const uint32_t second)
+    {
+        edge_first_[edge_idx] = std::min(first, second);
+        edge_second_[edge_idx] = std::max(first, second);
+
+        surfel new_surfel;
+        vec4r new_quadric;
+        edge_error_[edge_idx] = contract(edge_first_[edge_idx], edge_second_[edge_idx], new_surfel, new_quadric);
     }
-    color *= 255;
-    return vec3b{uint8_t(color.x), uint8_t(color.y), uint8_t(color.z)};
-}
+};
 
-real qlength(const mat4r &quadric)
-{
-    real a = sqrt(quadric[0]);
-    vec4r n = vec4r{quadric[0], quadric[1], quadric[2], quadric[3]};
-    n /= a;
-    return scm::math::length_sqr(n);
 }
 
 surfel_mem_array reduction_pair_contraction::
@@ -242,324 +213,151 @@ create_lod(real &reduction_error,
       throw std::runtime_error("reduction_pair_contraction not supported for PROVENANCE");
     }
 
-    const uint32_t fan_factor = input.size();
-    size_t num_surfels = 0;
-    size_t min_num_surfels = input[0]->length();
-    //compute max total number of surfels from all nodes
-    for (size_t node_idx = 0; node_idx < fan_factor; ++node_idx) {
-        num_surfels += input[node_idx]->length();
+    contraction_workspace ws;
+    ws.clear();
 
-        if (input[node_idx]->length() < min_num_surfels) {
-            min_num_surfels = input[node_idx]->length();
-        }
+    size_t num_surfels = 0;
+    for (const auto *mem_array : input) {
+        ws.first_surfel_of_array_.push_back(uint32_t(num_surfels));
+        num_surfels += mem_array->length();
     }
 
-    std::map<surfel_id_t, quadric_t> quadrics{};
-    std::vector<std::vector<surfel>> node_surfels{input.size() + 1, std::vector<surfel>{}};
-    std::set<edge_t> edges{};
-    // accumulate edges and point quadrics
-    for (node_id_type node_idx = 0; node_idx < fan_factor; ++node_idx) {
-        for (size_t surfel_idx = 0; surfel_idx < input[node_idx]->length(); ++surfel_idx) {
-
-            surfel curr_surfel = input[node_idx]->read_surfel(surfel_idx);
-            // save surfel
-            node_surfels[node_idx].push_back(curr_surfel);
-            surfel_id_t curr_id = surfel_id_t{node_idx, surfel_idx};
-
-            assert(node_idx < num_nodes_per_level && surfel_idx < num_surfels_per_node);
-            // get and store neighbours
-            auto nearest_neighbours = get_local_nearest_neighbours(input, number_of_neighbours_, curr_id);
-            std::vector<surfel_id_t> neighbour_ids{};
-            for (const auto &pair : nearest_neighbours) {
-                neighbour_ids.push_back(pair.first);
-            }
+    const size_t num_contractions = num_surfels > surfels_per_node ? num_surfels - surfels_per_node : 0;
 
-            quadric_t curr_quadric{};
-            for (auto const &neighbour : nearest_neighbours) {
-                edge_t curr_edge = edge_t{curr_id, neighbour.first};
-                assert(neighbour.first.node_idx < num_nodes_per_level && neighbour.first.surfel_idx < num_surfels_per_node);
-                if (edges.find(curr_edge) == edges.end()) {
-                    edges.insert(curr_edge);
-                }
-                // accumulate quadric
-                surfel neighbour_surfel = input[neighbour.first.node_idx]->read_surfel(neighbour.first.surfel_idx);
-                curr_quadric += edge_quadric(curr_surfel.normal(), neighbour_surfel.normal(), curr_surfel.pos(), neighbour_surfel.pos());
-            }
-            quadrics[curr_id] = curr_quadric;
+    ws.surfels_.reserve(num_surfels + num_contractions);
+    ws.quadrics_.reserve(num_surfels + num_contractions);
+    for (const auto *mem_array : input) {
+        for (size_t surfel_idx = 0; surfel_idx < mem_array->length(); ++surfel_idx) {
+            ws.surfels_.push_back(mem_array->read_surfel(surfel_idx));
         }
     }
 
+    // the knn graph of all input surfels gives the edges and point quadrics
+    ws.index_.build(input);
 
-    // allocate space for new surfels that will be created
-    node_surfels.back() = std::vector<surfel>{num_surfels - surfels_per_node};
-#ifdef DEBUG
-    real error_min = std::numeric_limits<real>::max();
-    real error_max = 0;
-    std::cout << "creating contractions" << std::endl;
-    auto create_contraction = [&node_surfels, &quadrics, &error_max, &error_min](const edge_t& edge)->contraction
-#else
-    auto create_contraction = [&node_surfels, &quadrics](const edge_t &edge) -> contraction
-#endif
-    {
-        const surfel &surfel1 = node_surfels[edge.a.node_idx][edge.a.surfel_idx];
-        const surfel &surfel2 = node_surfels[edge.b.node_idx][edge.b.surfel_idx];
-        // new surfel is mean of both old surfels
-        surfel new_surfel = surfel{(surfel1.pos() + surfel2.pos()) * 0.5,
-                                   vec3b{(vec3r{surfel1.color()} + vec3r{surfel2.color()}) * 0.5},
-                                   (surfel1.radius() + surfel2.radius()) * 0.5f,
-                                   (normalize(surfel1.normal() + surfel2.normal()))
-        };
-        auto new_quadric = (quadrics.at(edge.a) + quadrics.at(edge.b));
-        real error = new_quadric.error(new_surfel.pos());
-        real error1 = new_quadric.error(surfel1.pos());
-        real error2 = new_quadric.error(surfel2.pos());
-        if (error1 < error) {
-            if (error2 < error1) {
-                new_surfel = surfel2;
-                error = error2;
-            }
-            else {
-                new_surfel = surfel1;
-                error = error1;
+    for (size_t array_idx = 0; array_idx < input.size(); ++array_idx) {
+        for (size_t surfel_idx = 0; surfel_idx < input[array_idx]->length(); ++surfel_idx) {
+            const uint32_t curr_idx = ws.first_surfel_of_array_[array_idx] + uint32_t(surfel_idx);
+            const surfel &curr_surfel = ws.surfels_[curr_idx];
+
+            ws.index_.find_nearest_neighbours(curr_surfel.pos(), surfel_id_t(array_idx, surfel_idx),
+                                              number_of_neighbours_, ws.knn_result_, ws.knn_scratch_);
+
+            vec4r curr_quadric{0.0};
+            for (const auto &neighbour : ws.knn_result_) {
+                const uint32_t neighbour_idx = ws.first_surfel_of_array_[neighbour.first.node_idx]
+                    + uint32_t(neighbour.first.surfel_idx);
+                const surfel &neighbour_surfel = ws.surfels_[neighbour_idx];
+
+                ws.pairs_.emplace_back(std::min(curr_idx, neighbour_idx), std::max(curr_idx, neighbour_idx));
+                curr_quadric = add_quadrics(curr_quadric, edge_quadric(curr_surfel.normal(), neighbour_surfel.normal(),
+                                                                       curr_surfel.pos(), neighbour_surfel.pos()));
             }
+            ws.quadrics_.push_back(curr_quadric);
         }
-        else if (error2 < error) {
-            new_surfel = surfel2;
-            error = error2;
-        }
-#ifdef DEBUG
-        if (error > error_max) error_max = error;
-        if (error < error_min) error_min = error;
-#endif
-        return contraction{edge, std::move(new_quadric), error, std::move(new_surfel)};
-    };
-
-    // store contractions and operations in queue
-    std::unordered_map<surfel_id_t, std::map<surfel_id_t, std::shared_ptr<contraction>>> contractions{};
-    std::vector<std::shared_ptr<contraction_op>> contraction_queue{};
-    for (const auto &edge : edges) {
-        if (contractions[edge.a].find(edge.b) != contractions[edge.a].end()) {
-            continue;
-        }
-        // map contraction to both surfels
-        contractions[edge.a][edge.b] = std::make_shared<contraction>(create_contraction(edge));
-        contractions[edge.b][edge.a] = contractions.at(edge.a).at(edge.b);
-        // check surfel id bounds
-        assert(edge.a.node_idx < num_nodes_per_level && edge.a.surfel_idx < num_surfels_per_node);
-        assert(edge.b.node_idx < num_nodes_per_level && edge.b.surfel_idx < num_surfels_per_node);
-        // store contraction operation pointing to new contraction
-        contraction_op op{contractions.at(edge.a).at(edge.b).get()};
-        contraction_queue.push_back(std::make_shared<contraction_op>(op));
-        // let contraction point to related contraction_op
-        contractions.at(edge.a).at(edge.b)->cont_op = contraction_queue.back().get();
-        //check pointer correctness
-        assert(contraction_queue.back().get() == contraction_queue.back()->cont->cont_op);
-        assert(contractions.at(edge.a).at(edge.b).get() == contractions.at(edge.a).at(edge.b).get()->cont_op->cont);
-        assert(contractions.at(edge.a).at(edge.b).get() == contractions.at(edge.b).at(edge.a).get());
     }
-#ifdef DEBUG
-    std::cout << "error min " << error_min << " max " << error_max << std::endl;
-
-    error_min = std::numeric_limits<real>::max();
-    error_max = 0;
-    for (node_id_type node_idx = 0; node_idx < fan_factor; ++node_idx) {
-      for (size_t surfel_idx = 0; surfel_idx < input[node_idx]->length(); ++surfel_idx) {
-        real error = 0;
-        size_t i = 0;
-        for(const auto& pair : contractions.at(surfel_id_t{node_idx, surfel_idx})) {
-          error += pair.second->error;
-          ++i;
-        }
-        error /= real(i);
-        if (error > error_max) error_max = error;
-        if (error < error_min) error_min = error;
-      }
+    ws.index_.clear();
+
+    std::sort(ws.pairs_.begin(), ws.pairs_.end());
+    ws.pairs_.erase(std::unique(ws.pairs_.begin(), ws.pairs_.end()), ws.pairs_.end());
+
+    const uint32_t num_edges = uint32_t(ws.pairs_.size());
+    ws.edge_first_.resize(num_edges);
+    ws.edge_second_.resize(num_edges);
+    ws.edge_error_.resize(num_edges);
+
+    // adjacency lists of the input surfels are laid out back to back
+    ws.adjacency_.assign(num_surfels, adjacency_list{0, 0, 0});
+    ws.adjacency_.reserve(num_surfels + num_contractions);
+    for (const auto &pair : ws.pairs_) {
+        ++ws.adjacency_[pair.first].capacity_;
+        ++ws.adjacency_[pair.second].capacity_;
     }
-    for (node_id_type node_idx = 0; node_idx < fan_factor; ++node_idx) {
-      for (size_t surfel_idx = 0; surfel_idx < input[node_idx]->length(); ++surfel_idx) {
-        surfel& curr_surfel = node_surfels[node_idx][surfel_idx];
-        real error = 0;
-        size_t i = 0;
-        for(const auto& pair : contractions.at(surfel_id_t{node_idx, surfel_idx})) {
-          error += pair.second->error;
-          ++i;
-        }
-        error /= real(i);
-#ifdef ERROR_COLOR
-        // error of contraction
-        curr_surfel.color() = heatmap((error - error_min) / (error_max - error_min));
-        // binary dir of surfel normal
-        // curr_surfel.color() = n_to_c(curr_surfel.normal());
-        // write to orig data
-        input[node_idx]->write_surfel(curr_surfel, surfel_idx);
-        curr_surfel.color() = vec3b{127, 127, 127};
-#endif
-      }
+    uint32_t arena_size = 0;
+    for (auto &list : ws.adjacency_) {
+        list.offset_ = arena_size;
+        arena_size += list.capacity_;
     }
-    size_t n_min = number_of_neighbours_;
-    size_t n_max = 0;
-    std::cout << "doing contractions" << std::endl;
-#endif
+    ws.arena_.resize(arena_size);
 
-    auto sort_func = [](const std::shared_ptr<contraction_op> &a,
-                        const std::shared_ptr<contraction_op> &b)
-    {
-        return *a > *b;
-    };
+    indexed_heap<cheapest_contraction> contraction_queue(cheapest_contraction{&ws.edge_error_});
+    contraction_queue.reset(num_edges);
+
+    for (uint32_t edge_idx = 0; edge_idx < num_edges; ++edge_idx) {
+        ws.connect(edge_idx, ws.pairs_[edge_idx].first, ws.pairs_[edge_idx].second);
+        ws.add_to_adjacency(ws.edge_first_[edge_idx], edge_idx);
+        ws.add_to_adjacency(ws.edge_second_[edge_idx], edge_idx);
+        contraction_queue.push(edge_idx);
+    }
+
+    ws.stamp_.assign(num_surfels, 0);
 
     // work off queue until target num of surfels is reached
-    for (size_t i = 0; i < num_surfels - surfels_per_node; ++i) {
-        // update queue, cheapest contraction at the back
-        std::sort(contraction_queue.begin(), contraction_queue.end(), sort_func);
-
-        contraction curr_contraction = *(contraction_queue.back()->cont);
-        contraction_queue.pop_back();
-
-#ifdef DEBUG
-        for (int i = contraction_queue.size() - 1; i >= 0; --i) {
-          if (curr_contraction.error > contraction_queue[i]->cont->error) {
-            std::cout << "size2 " << contraction_queue.size() << std::endl;
-            std::cout << contraction_queue[i-1]->cont->error << ", " << contraction_queue[i]->cont->error << ", " << contraction_queue[i+1]->cont->error << std::endl;
-            std::cout << "curr " << curr_contraction.error << ", smaller " << i << " with " << contraction_queue[i]->cont->error << std::endl;
-            throw std::runtime_error("curr " + std::to_string(curr_contraction.error) + ", smaller " + std::to_string(i) + " with " + std::to_string(contraction_queue[i]->cont->error));
-          }
-        }
-#endif
-
-        assert(node_surfels.size() - 1 >= 0);
-        assert(node_surfels.size() <= std::numeric_limits<int>::max());
-        surfel_id_t new_id = surfel_id_t{uint32_t(node_surfels.size() - 1), i};
-
-        // save new surfels in vector at back
-        surfel &new_surfel = curr_contraction.new_surfel;
-        // save new surfel
-#ifdef ERROR_COLOR
-        new_surfel.color() = heatmap((curr_contraction.error - error_min) / (error_max - error_min));
-#endif
-        node_surfels.back()[i] = new_surfel;
-
-        const surfel_id_t &old_id_1 = curr_contraction.edge.a;
-        const surfel_id_t &old_id_2 = curr_contraction.edge.b;
+    for (size_t i = 0; i < num_contractions && !contraction_queue.empty(); ++i) {
+        const uint32_t contracted_edge = contraction_queue.pop();
+        const uint32_t old_idx_1 = ws.edge_first_[contracted_edge];
+        const uint32_t old_idx_2 = ws.edge_second_[contracted_edge];
+
+        surfel new_surfel;
+        vec4r new_quadric;
+        ws.contract(old_idx_1, old_idx_2, new_surfel, new_quadric);
+
+        const uint32_t new_idx = uint32_t(ws.surfels_.size());
+        ws.surfels_.push_back(new_surfel);
+        ws.quadrics_.push_back(new_quadric);
+        ws.adjacency_.push_back(adjacency_list{0, 0, 0});
+        ws.stamp_.push_back(0);
+
         // invalidate old surfels
-#ifdef LEAF_REMOVAL
-        if (old_id_1.node_idx < fan_factor) {
-          surfel surf = node_surfels[old_id_1.node_idx][old_id_1.surfel_idx];
-          surf.color() = vec3b{255,255,255};
-          input[old_id_1.node_idx]->write_surfel(surf, old_id_1.surfel_idx);
-        }
-#endif
-        node_surfels[old_id_1.node_idx][old_id_1.surfel_idx].radius() = -1.0f;
-#ifdef LEAF_REMOVAL
-        if (old_id_2.node_idx < fan_factor) {
-          surfel surf = node_surfels[old_id_2.node_idx][old_id_2.surfel_idx];
-          surf.color() = vec3b{255,255,255};
-          input[old_id_2.node_idx]->write_surfel(surf, old_id_2.surfel_idx);
-        }
-#endif
-        node_surfels[old_id_2.node_idx][old_id_2.surfel_idx].radius() = -1.0f;
-        // add new point quadric
-        quadrics[new_id] = curr_contraction.quadric;
-        // delete old point quadrics
-        quadrics.erase(curr_contraction.edge.a);
-        quadrics.erase(curr_contraction.edge.b);
-
-        auto update_contraction = [&create_contraction, &contractions, &curr_contraction]
-            (const surfel_id_t &new_id, const surfel_id_t &old_id, const std::pair<const surfel_id_t, std::shared_ptr<contraction>> &cont)
-        {
-            edge_t new_edge = edge_t{new_id, cont.first};
-            // store new contraction
-            contractions[new_id][cont.first] = std::make_shared<contraction>(create_contraction(new_edge));
-            // update contractions of neighbour
-            assert(contractions.find(cont.first) != contractions.end());
-            contractions.at(cont.first).erase(old_id);
-            contractions.at(cont.first)[new_id] = contractions.at(new_id).at(cont.first);
-            // get attached operation
-            contraction_op *operation = cont.second->cont_op;
-            // transfer contraction op
-            contractions.at(new_id).at(cont.first)->cont_op = operation;
-            operation->cont = contractions.at(new_id).at(cont.first).get();
-            // check for pointer correctness
-            assert(contractions.at(new_edge.a).at(new_edge.b).get() == contractions.at(new_edge.a).at(new_edge.b).get()->cont_op->cont);
-            assert(contractions.at(new_edge.a).at(new_edge.b).get() == contractions.at(new_edge.b).at(new_edge.a).get());
-        };
+        ws.surfels_[old_idx_1].radius() = -1.0f;
+        ws.surfels_[old_idx_2].radius() = -1.0f;
 
+        ++ws.current_stamp_;
         size_t neighbours = 0;
-        for (const auto &cont : contractions.at(old_id_1)) {
-            if (cont.first != old_id_2) {
-#ifdef LIMIT_NEIGHBOURS
-                if (neighbours >= number_of_neighbours_) {
-                    // already added -> remove duplicate contractions
-                    contractions.at(cont.first).erase(old_id_1);
-                    // // and invalidate respective operation
-                    cont.second->cont_op->cont = nullptr;
-                }
-                else
-#endif
-                {
-                    update_contraction(new_id, old_id_1, cont);
-                    assert(contractions.at(cont.first).find(old_id_1) == contractions.at(cont.first).end());
-                    ++neighbours;
+
+        // the edges of both old surfels are moved to the new one, up to k
+        // edges in the order of the neighbour index, duplicates are dropped
+        for (const uint32_t old_idx : {old_idx_1, old_idx_2}) {
+            const adjacency_list &list = ws.adjacency_[old_idx];
+
+            ws.neighbours_.clear();
+            for (uint32_t entry = list.offset_; entry < list.offset_ + list.size_; ++entry) {
+                const uint32_t edge_idx = ws.arena_[entry];
+                if (edge_idx != contracted_edge) {
+                    ws.neighbours_.emplace_back(ws.other_end(edge_idx, old_idx), edge_idx);
                 }
             }
-            else {
-                // invalidate operation
-                cont.second->cont_op->cont = nullptr;
-            }
-        }
-        // in case no new contractions were created yet
-        if (contractions.find(new_id) == contractions.end()) {
-            // std::cout << old_id_1 << std::endl;
-            contractions[new_id];
-        }
-        for (const auto &cont : contractions.at(old_id_2)) {
-            if (cont.first != old_id_1) {
-#ifdef LIMIT_NEIGHBOURS
-                if (contractions.at(new_id).find(cont.first) == contractions.at(new_id).end() && neighbours < number_of_neighbours_)
-#else
-                    if(contractions.at(new_id).find(cont.first) == contractions.at(new_id).end())
-#endif
-                {
-                    update_contraction(new_id, old_id_2, cont);
+            std::sort(ws.neighbours_.begin(), ws.neighbours_.end());
+
+            for (const auto &neighbour : ws.neighbours_) {
+                const uint32_t neighbour_idx = neighbour.first;
+                const uint32_t edge_idx = neighbour.second;
+
+                ws.remove_from_adjacency(neighbour_idx, edge_idx);
+
+                if (neighbours < number_of_neighbours_ && ws.stamp_[neighbour_idx] != ws.current_stamp_) {
+                    ws.connect(edge_idx, new_idx, neighbour_idx);
+                    ws.add_to_adjacency(new_idx, edge_idx);
+                    ws.add_to_adjacency(neighbour_idx, edge_idx);
+                    ws.stamp_[neighbour_idx] = ws.current_stamp_;
+                    contraction_queue.update(edge_idx);
                     ++neighbours;
                 }
                 else {
-                    // already added -> remove duplicate contractions
-                    contractions.at(cont.first).erase(old_id_2);
-                    // // and invalidate respective operation
-                    cont.second->cont_op->cont = nullptr;
+                    // already connected or enough neighbours -> remove contraction
+                    contraction_queue.remove(edge_idx);
                 }
-                assert(contractions.at(cont.first).find(old_id_2) == contractions.at(cont.first).end());
             }
-            else {
-                // invalidate operation
-                cont.second->cont_op->cont = nullptr;
-            }
-        }
-#ifdef DEBUG
-        if(neighbours < n_min) {
-          n_min = neighbours;
         }
-        if(neighbours > n_max) {
-          n_max = neighbours;
-        }
-#endif
-        // remove old mapping
-        contractions.erase(old_id_1);
-        contractions.erase(old_id_2);
-        //remove invalid contraction operations
-        contraction_queue.erase(std::remove_if(contraction_queue.begin(), contraction_queue.end(), [](const std::shared_ptr<contraction_op> &op)
-        { return op->cont == nullptr; }), contraction_queue.end());
+
+        ws.adjacency_[old_idx_1].size_ = 0;
+        ws.adjacency_[old_idx_2].size_ = 0;
     }
-#ifdef DEBUG
-    std::cout << "neighbours min " << n_min << " max " << n_max << std::endl;
-    std::cout << "copying surfels" << std::endl;
-#endif
+
     surfel_mem_array mem_array(std::make_shared<surfel_vector>(surfel_vector()), 0, 0);
-    for (auto &node : node_surfels) {
-        for (auto &surfel : node) {
-            if (surfel.radius() > 0.0f) {
-                mem_array.surfel_mem_data()->push_back(surfel);
-            }
+    for (const auto &surfel : ws.surfels_) {
+        if (surfel.radius() > 0.0f) {
+            mem_array.surfel_mem_data()->push_back(surfel);
         }
     }
     mem_array.set_length(mem_array.surfel_mem_data()->size());
@@ -569,73 +367,7 @@ create_lod(real &reduction_error,
     return mem_array;
 }
 
-lamure::pre::quadric_t edge_quadric(const vec3f &normal_p1, const vec3f &normal_p2, const vec3r &p1, const vec3r &p2)
-{
-    vec3r edge_dir = p2 - p1;
-    vec3r tangent = cross(vec3r(normal_p1 + (dot(normal_p1, normal_p2) < 0.0 ? -1.0 : 1.0f) * normal_p2), edge_dir);
-
-    vec3r normal = cross(tangent, edge_dir);
-    // check for degenerate surfels on same position to prevent NaN values
-    if (normal.x == 0 && normal.y == 0 && normal.z == 0) {
-        normal = vec3r{0.0};
-    }
-    else {
-        // dont take root for more smooth result
-        normal /= normal.x * normal.x + normal.y * normal.y + normal.z * normal.z;
-    }
-
-    vec4r hessian = vec4r{normal, -dot(p1, normal)};
-    return quadric_t{hessian};
-}
-
-lamure::real quadric_error(const vec3r &p, const quadric_t &quadric)
-{
-    return quadric.error(p);
-}
-
-// get k nearest neighbours in simplification nodes
-std::vector<std::pair<surfel_id_t, real>>
-get_local_nearest_neighbours(const std::vector<surfel_mem_array *> &input,
-                             size_t num_local_neighbours,
-                             surfel_id_t const &target_surfel)
-{
-
-    //size_t current_node = target_surfel.node_idx;
-    vec3r center = input[target_surfel.node_idx]->read_surfel(target_surfel.surfel_idx).pos();
-
-    std::vector<std::pair<surfel_id_t, real>> candidates;
-    real max_candidate_distance = std::numeric_limits<real>::infinity();
-
-    for (size_t local_node_id = 0; local_node_id < input.size(); ++local_node_id) {
-        for (size_t surfel_id = 0; surfel_id < input[local_node_id]->length(); ++surfel_id) {
-            if (surfel_id != target_surfel.surfel_idx || local_node_id != target_surfel.node_idx) {
-                const surfel &current_surfel = input[local_node_id]->read_surfel(surfel_id);
-                real distance_to_center = scm::math::length_sqr(center - current_surfel.pos());
-
-                if (candidates.size() < num_local_neighbours || (distance_to_center < max_candidate_distance)) {
-                    if (candidates.size() == num_local_neighbours)
-                        candidates.pop_back();
-
-                    candidates.push_back(std::make_pair(surfel_id_t(local_node_id, surfel_id), distance_to_center));
-
-                    for (uint16_t k = candidates.size() - 1; k > 0; --k) {
-                        if (candidates[k].second < candidates[k - 1].second) {
-                            std::swap(candidates[k], candidates[k - 1]);
-                        }
-                        else
-                            break;
-                    }
-
-                    max_candidate_distance = candidates.back().second;
-                }
-            }
-        }
-    }
-
-    return candidates;
-}
-
 } // namespace pre
 } // namespace lamure
 
-#endif // CMAKE_OPTION_ENABLE_ALTERNATIVE_STRATEGIES
\ No newline at end of file
+#endif // CMAKE_OPTION_ENABLE_ALTERNATIVE_STRATEGIES
@@ -44,11 +44,11 @@ create_lod(real &reduction_error,
 
     //push input in a single surfel_mem_array
     for (size_t node_id = 0; node_id < input.size(); ++node_id) {
-        for (size_t surfel_id = input[node_id]->offset();
-             surfel_id < input[node_id]->offset() + input[node_id]->length();
+        for (size_t surfel_id = 0;
+             surfel_id < input[node_id]->length();
              ++surfel_id) {
 
-            auto current_surfel = input[node_id]->surfel_mem_data()->at(input[node_id]->offset() + surfel_id);
+            auto const current_surfel = input[node_id]->read_surfel(surfel_id);
 
             // ignore outlier radii of any kind
             if (current_surfel.radius() == 0.0) {
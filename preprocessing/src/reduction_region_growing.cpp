@@ -32,14 +32,18 @@ create_lod(real &reduction_error,
     }
 
     // Create a single surfel vector to sample from.
-    std::vector<surfel *> surfels_to_sample;
+    surfel_vector input_surfels;
     for (uint32_t child_mem_array_index = 0; child_mem_array_index < input.size(); ++child_mem_array_index) {
         surfel_mem_array *child_mem_array = input.at(child_mem_array_index);
 
         for (uint32_t surfel_index = 0; surfel_index < child_mem_array->length(); ++surfel_index) {
-            surfels_to_sample.push_back(&child_mem_array->surfel_mem_data()->at(surfel_index));
+            input_surfels.push_back(child_mem_array->read_surfel(surfel_index));
         }
     }
+    std::vector<surfel *> surfels_to_sample;
+    for (auto &input_surfel : input_surfels) {
+        surfels_to_sample.push_back(&input_surfel);
+    }
 
     surfel_mem_array resulting_mem_array(std::make_shared<surfel_vector>(surfel_vector()), 0, 0);
     std::vector<std::vector<surfel *>> clusters;
@@ -107,8 +111,7 @@ create_lod(real &reduction_error,
         int random_index_memarray = rand() % input.size();
         int random_index_surfel = rand() % input.at(random_index_memarray)->length();
 
-        surfel *random_surfel = &input.at(random_index_memarray)->surfel_mem_data()->at(random_index_surfel);
-        resulting_mem_array.surfel_mem_data()->push_back(*random_surfel);
+        resulting_mem_array.surfel_mem_data()->push_back(input.at(random_index_memarray)->read_surfel(random_index_surfel));
     }
 
     resulting_mem_array.set_length(resulting_mem_array.surfel_mem_data()->size());
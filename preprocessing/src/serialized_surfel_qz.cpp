@@ -0,0 +1,128 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/pre/serialized_surfel_qz.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace lamure
+{
+namespace pre
+{
+
+namespace
+{
+
+const uint32_t MAX_POSITION_INDEX = 0xFFFF;
+
+// the shader divides the radius range into 2047 steps, the last index
+// is reserved for invalid surfels
+const uint32_t MAX_RADIUS_INDEX = serialized_surfel_qz::INVALID_RADIUS - 1;
+
+const uint32_t MAX_COLOR_INDEX = 0x7F;
+const uint32_t COLOR_QUANTIZATION_STEP = 2;
+
+const int32_t NORMAL_POINTS_U = 104;
+const int32_t NORMAL_POINTS_V = 105;
+
+uint32_t quantize(const double value, const double min, const double max, const uint32_t max_index)
+{
+    if (!(max > min)) {
+        return 0;
+    }
+    const double index = std::round((value - min) / (max - min) * max_index);
+    return uint32_t(std::min(double(max_index), std::max(0.0, index)));
+}
+
+}
+
+serialized_surfel_qz::node_range::
+node_range(const bounding_box &bbox,
+           const float avg_surfel_radius,
+           const float max_surfel_radius_deviation)
+    : min_vertex(bbox.min()),
+      max_vertex(bbox.max()),
+      min_radius(avg_surfel_radius - max_surfel_radius_deviation),
+      max_radius(avg_surfel_radius + max_surfel_radius_deviation)
+{}
+
+void serialized_surfel_qz::
+set_surfel(const surfel &surfel, const node_range &range)
+{
+    // the renderer dequantizes with the float node range, so the
+    // indices are computed relative to exactly these values
+    data_.x = quantize(surfel.pos().x, range.min_vertex.x, range.max_vertex.x, MAX_POSITION_INDEX);
+    data_.y = quantize(surfel.pos().y, range.min_vertex.y, range.max_vertex.y, MAX_POSITION_INDEX);
+    data_.z = quantize(surfel.pos().z, range.min_vertex.z, range.max_vertex.z, MAX_POSITION_INDEX);
+
+    uint32_t radius = INVALID_RADIUS;
+    if (surfel.radius() > 0.0) {
+        radius = std::min(quantize(surfel.radius(), range.min_radius, range.max_radius, MAX_RADIUS_INDEX + 1),
+                          MAX_RADIUS_INDEX);
+    }
+
+    uint32_t color = 0;
+    for (uint8_t channel = 0; channel < 3; ++channel) {
+        const uint32_t value = (surfel.color()[channel] + COLOR_QUANTIZATION_STEP / 2) / COLOR_QUANTIZATION_STEP;
+        color = (color << 7) | std::min(value, MAX_COLOR_INDEX);
+    }
+    data_.color777_radius11 = (color << 11) | radius;
+
+    // face of the dominant axis, the other two components are
+    // enumerated on a regular grid on that face
+    const vec3f &normal = surfel.normal();
+    uint8_t axis = 0;
+    for (uint8_t i = 1; i < 3; ++i) {
+        if (std::fabs(normal[i]) > std::fabs(normal[axis])) {
+            axis = i;
+        }
+    }
+    const int32_t face = axis * 2 + (normal[axis] < 0.f ? 1 : 0);
+    const double u = (normal[(axis + 1) % 3] + 1.0) / 2.0;
+    const double v = (normal[(axis + 2) % 3] + 1.0) / 2.0;
+    const int32_t u_index = std::min(NORMAL_POINTS_U - 1, std::max(0, int32_t(std::round(u * NORMAL_POINTS_U))));
+    const int32_t v_index = std::min(NORMAL_POINTS_V - 1, std::max(0, int32_t(std::round(v * NORMAL_POINTS_V))));
+    data_.normal = uint16_t(face * NORMAL_POINTS_U * NORMAL_POINTS_V + v_index * NORMAL_POINTS_U + u_index);
+}
+
+surfel serialized_surfel_qz::
+get_surfel(const node_range &range) const
+{
+    const vec3f extent = range.max_vertex - range.min_vertex;
+    const vec3r pos(range.min_vertex.x + data_.x * (extent.x / float(MAX_POSITION_INDEX)),
+                    range.min_vertex.y + data_.y * (extent.y / float(MAX_POSITION_INDEX)),
+                    range.min_vertex.z + data_.z * (extent.z / float(MAX_POSITION_INDEX)));
+
+    const uint32_t radius_index = data_.color777_radius11 & INVALID_RADIUS;
+    real radius = 0.0;
+    if (radius_index != INVALID_RADIUS) {
+        radius = range.min_radius + radius_index * ((range.max_radius - range.min_radius) / float(INVALID_RADIUS));
+    }
+
+    const vec3b color(((data_.color777_radius11 >> 25) & MAX_COLOR_INDEX) * COLOR_QUANTIZATION_STEP,
+                      ((data_.color777_radius11 >> 18) & MAX_COLOR_INDEX) * COLOR_QUANTIZATION_STEP,
+                      ((data_.color777_radius11 >> 11) & MAX_COLOR_INDEX) * COLOR_QUANTIZATION_STEP);
+
+    int32_t enumerator = data_.normal;
+    const int32_t face = enumerator / (NORMAL_POINTS_U * NORMAL_POINTS_V);
+    enumerator -= face * NORMAL_POINTS_U * NORMAL_POINTS_V;
+    const uint8_t axis = face / 2;
+    const float u = (enumerator % NORMAL_POINTS_U) / float(NORMAL_POINTS_U) * 2.f - 1.f;
+    const float v = (enumerator / NORMAL_POINTS_U) / float(NORMAL_POINTS_V) * 2.f - 1.f;
+
+    vec3f normal;
+    normal[(axis + 1) % 3] = u;
+    normal[(axis + 2) % 3] = v;
+    normal[axis] = (face % 2 == 1 ? -1.f : 1.f) * std::sqrt(std::max(0.f, 1.f - u * u - v * v));
+    normal = scm::math::normalize(normal);
+
+    return surfel(pos, color, radius, normal);
+}
+
+}
+} // namespace lamure
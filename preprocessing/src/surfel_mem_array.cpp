@@ -17,14 +17,46 @@ read_surfel(const size_t index) const
 {
     assert(!is_empty_);
     assert(index < length_);
+
+    if (soa_mem_data_) {
+        return soa_mem_data_->read_surfel(offset_ + index);
+    }
+
     assert(offset_ + index < surfel_mem_data_->size());
 
     return surfel_mem_data_->operator[](offset_ + index);
 }
 
+vec3r surfel_mem_array::
+position(const size_t index) const
+{
+    assert(!is_empty_);
+    assert(index < length_);
+
+    if (soa_mem_data_) {
+        return soa_mem_data_->position(offset_ + index);
+    }
+
+    assert(offset_ + index < surfel_mem_data_->size());
+
+    return surfel_mem_data_->operator[](offset_ + index).pos();
+}
+
+std::shared_ptr<std::vector<surfel>> surfel_mem_array::
+copy_surfels() const
+{
+    auto surfels = std::make_shared<std::vector<surfel>>();
+    surfels->reserve(length_);
+    for (size_t i = 0; i < length_; ++i) {
+        surfels->push_back(read_surfel(i));
+    }
+    return surfels;
+}
+
 surfel const &surfel_mem_array::
 read_surfel_ref(const size_t index) const
 {
+    assert(!soa_mem_data_);
     assert(!is_empty_);
     assert(index < length_);
     assert(offset_ + index < surfel_mem_data_->size());
@@ -56,6 +88,12 @@ write_surfel(const surfel &surfel, const size_t index) const
 {
     assert(!is_empty_);
     assert(index < length_);
+
+    if (soa_mem_data_) {
+        soa_mem_data_->write_surfel(surfel, offset_ + index);
+        return;
+    }
+
     assert(offset_ + index < surfel_mem_data_->size());
 
     surfel_mem_data_->at(offset_ + index) = surfel;
@@ -98,6 +136,7 @@ reset()
     array_abstract<surfel>::reset();
     surfel_mem_data_.reset();
     prov_mem_data_.reset();
+    soa_mem_data_.reset();
     has_provenance_ = false;
 }
 
@@ -111,6 +150,7 @@ reset(const std::shared_ptr<std::vector<surfel>> &surfel_mem_data,
     length_ = length;
     surfel_mem_data_ = surfel_mem_data;
     prov_mem_data_.reset();
+    soa_mem_data_.reset();
     has_provenance_ = false;
 }
 
@@ -125,9 +165,24 @@ reset(const std::shared_ptr<std::vector<surfel>> &surfel_mem_data,
     length_ = length;
     surfel_mem_data_ = surfel_mem_data;
     prov_mem_data_ = prov_mem_data;
+    soa_mem_data_.reset();
     has_provenance_ = true;
 }
 
+void surfel_mem_array::
+reset(const std::shared_ptr<surfel_soa> &soa_mem_data,
+      const size_t offset,
+      const size_t length)
+{
+    is_empty_ = false;
+    offset_ = offset;
+    length_ = length;
+    surfel_mem_data_.reset();
+    prov_mem_data_.reset();
+    soa_mem_data_ = soa_mem_data;
+    has_provenance_ = false;
+}
+
 void surfel_mem_array::
 get(std::vector<surfel_ext>& data) {
   data.clear();
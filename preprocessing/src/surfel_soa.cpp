@@ -0,0 +1,109 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/pre/surfel_soa.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace lamure
+{
+namespace pre
+{
+
+const size_t surfel_soa::bytes_per_surfel;
+
+void surfel_soa::
+reserve(const size_t size)
+{
+    for (auto &coordinates : pos_) {
+        coordinates.reserve(size);
+    }
+    radius_.reserve(size);
+    normal_.reserve(size);
+    color_.reserve(size);
+}
+
+void surfel_soa::
+clear()
+{
+    for (auto &coordinates : pos_) {
+        std::vector<float>().swap(coordinates);
+    }
+    std::vector<float>().swap(radius_);
+    std::vector<vec3f>().swap(normal_);
+    std::vector<vec3b>().swap(color_);
+}
+
+void surfel_soa::
+append(const surfel_vector &surfels, const size_t offset, const size_t length, const vec3r &translation)
+{
+    assert(offset + length <= surfels.size());
+
+    for (size_t i = offset; i < offset + length; ++i) {
+        const surfel &surfel = surfels[i];
+        const vec3r offset_to_origin = surfel.pos() + translation - origin_;
+
+        pos_[0].push_back(float(offset_to_origin.x));
+        pos_[1].push_back(float(offset_to_origin.y));
+        pos_[2].push_back(float(offset_to_origin.z));
+        radius_.push_back(float(surfel.radius()));
+        normal_.push_back(surfel.normal());
+        color_.push_back(surfel.color());
+    }
+}
+
+surfel surfel_soa::
+read_surfel(const size_t index) const
+{
+    assert(index < size());
+
+    return surfel(position(index), color_[index], radius_[index], normal_[index]);
+}
+
+void surfel_soa::
+write_surfel(const surfel &surfel, const size_t index)
+{
+    assert(index < size());
+
+    const vec3r offset_to_origin = surfel.pos() - origin_;
+
+    pos_[0][index] = float(offset_to_origin.x);
+    pos_[1][index] = float(offset_to_origin.y);
+    pos_[2][index] = float(offset_to_origin.z);
+    radius_[index] = float(surfel.radius());
+    normal_[index] = surfel.normal();
+    color_[index] = surfel.color();
+}
+
+template <typename T>
+void surfel_soa::
+permute_stream(std::vector<T> &stream, const size_t first, const std::vector<uint32_t> &order)
+{
+    // one stream at a time, so the scratch space is bounded by the largest attribute
+    std::vector<T> permuted(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        permuted[i] = stream[first + order[i]];
+    }
+    std::copy(permuted.begin(), permuted.end(), stream.begin() + first);
+}
+
+void surfel_soa::
+permute(const size_t first, const std::vector<uint32_t> &order)
+{
+    assert(first + order.size() <= size());
+
+    for (auto &coordinates : pos_) {
+        permute_stream(coordinates, first, order);
+    }
+    permute_stream(radius_, first, order);
+    permute_stream(normal_, first, order);
+    permute_stream(color_, first, order);
+}
+
+} // namespace pre
+} // namespace lamure
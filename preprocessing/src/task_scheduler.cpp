@@ -0,0 +1,151 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/pre/task_scheduler.h>
+
+#include <algorithm>
+
+namespace lamure
+{
+namespace pre
+{
+
+task_scheduler::
+task_scheduler(const uint32_t num_threads)
+{
+    uint32_t num_workers = num_threads;
+    if (num_workers == 0) {
+        num_workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers_.reserve(num_workers);
+    for (uint32_t worker_idx = 0; worker_idx < num_workers; ++worker_idx) {
+        workers_.emplace_back(&task_scheduler::work, this);
+    }
+}
+
+task_scheduler::
+~task_scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+    task_ready_.notify_all();
+
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+task_scheduler::task_id task_scheduler::
+add_task(const task_function &function, const std::vector<task_id> &dependencies)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    const task_id id = task_id(tasks_.size());
+    tasks_.push_back(task{function, 0, false, {}});
+
+    for (const task_id dependency : dependencies) {
+        task &predecessor = tasks_.at(dependency);
+        if (!predecessor.finished_) {
+            predecessor.dependents_.push_back(id);
+            ++tasks_[id].num_open_dependencies_;
+        }
+    }
+
+    if (tasks_[id].num_open_dependencies_ == 0) {
+        ready_tasks_.push_back(id);
+        lock.unlock();
+        task_ready_.notify_one();
+    }
+
+    return id;
+}
+
+void task_scheduler::
+wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    graph_finished_.wait(lock, [this] { return num_finished_tasks_ == tasks_.size(); });
+
+    tasks_.clear();
+    num_finished_tasks_ = 0;
+
+    std::exception_ptr exception = exception_;
+    exception_ = nullptr;
+    lock.unlock();
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void task_scheduler::
+work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+        task_ready_.wait(lock, [this] { return shutdown_ || !ready_tasks_.empty(); });
+        if (ready_tasks_.empty()) {
+            return;
+        }
+
+        const task_id id = ready_tasks_.front();
+        ready_tasks_.pop_front();
+
+        // tasks_ may grow while the task runs, so it must not be referenced
+        task_function function;
+        std::swap(function, tasks_[id].function_);
+
+        if (!exception_) {
+            lock.unlock();
+            try {
+                function();
+            }
+            catch (...) {
+                lock.lock();
+                if (!exception_) {
+                    exception_ = std::current_exception();
+                }
+                lock.unlock();
+            }
+            lock.lock();
+        }
+
+        finish(id, lock);
+    }
+}
+
+void task_scheduler::
+finish(const task_id id, std::unique_lock<std::mutex> &lock)
+{
+    task &finished_task = tasks_[id];
+    finished_task.finished_ = true;
+
+    size_t num_ready_tasks = 0;
+    for (const task_id dependent : finished_task.dependents_) {
+        if (--tasks_[dependent].num_open_dependencies_ == 0) {
+            ready_tasks_.push_back(dependent);
+            ++num_ready_tasks;
+        }
+    }
+    finished_task.dependents_.clear();
+
+    if (++num_finished_tasks_ == tasks_.size()) {
+        graph_finished_.notify_all();
+    }
+
+    // this worker continues with one of the ready tasks itself
+    for (size_t task_idx = 1; task_idx < num_ready_tasks; ++task_idx) {
+        task_ready_.notify_one();
+    }
+}
+
+} // namespace pre
+} // namespace lamure
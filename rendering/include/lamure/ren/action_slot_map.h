@@ -0,0 +1,66 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_ACTION_SLOT_MAP_H_
+#define REN_ACTION_SLOT_MAP_H_
+
+#include <lamure/types.h>
+#include <lamure/ren/platform.h>
+
+#include <vector>
+#include <cstdint>
+
+namespace lamure {
+namespace ren
+{
+
+// maps (model, node) to the heap slots of all actions queued for that node.
+// open addressing with linear probing over a flat entry array; the same key
+// may occur several times (one entry per slot, e.g. one per view), an entry
+// is identified by the (key, slot) pair. deletion shifts the following
+// cluster back, so no tombstones accumulate over a frame.
+class RENDERING_DLL action_slot_map
+{
+public:
+                        action_slot_map();
+    virtual             ~action_slot_map();
+
+    void                insert(const model_t model_id, const node_t node_id, const slot_t slot_id);
+    void                erase(const model_t model_id, const node_t node_id, const slot_t slot_id);
+    void                replace(const model_t model_id, const node_t node_id,
+                            const slot_t old_slot_id, const slot_t new_slot_id);
+
+    const bool          contains(const model_t model_id, const node_t node_id, const slot_t slot_id) const;
+    void                find(const model_t model_id, const node_t node_id, std::vector<slot_t>& slot_ids) const;
+
+    void                clear();
+    const size_t        size() const { return num_entries_; };
+
+private:
+    struct entry
+    {
+        uint64_t        key_;
+        slot_t          slot_id_;
+    };
+
+    static const uint64_t empty_key_ = ~uint64_t(0);
+
+    static uint64_t     make_key(const model_t model_id, const node_t node_id) {
+                            return (uint64_t(model_id) << 32) | uint64_t(node_id);
+                        };
+    const size_t        home(const uint64_t key) const;
+    const size_t        locate(const uint64_t key, const slot_t slot_id) const;
+    void                grow();
+
+    std::vector<entry>  entries_;
+    size_t              mask_;
+    size_t              num_entries_;
+};
+
+} } // namespace lamure
+
+#endif // REN_ACTION_SLOT_MAP_H_
@@ -15,6 +15,7 @@
 #include <vector>
 
 #include <lamure/ren/platform.h>
+#include <lamure/ren/config.h>
 #include <lamure/types.h>
 #include <lamure/bounding_box.h>
 
@@ -40,6 +41,21 @@ public:
        NODE_INVISIBLE = 1
     };
 
+    //structure-of-arrays copy of the per-node data evaluated by the cut analysis,
+    //every array is padded to a multiple of LAMURE_CUT_UPDATE_ANALYSIS_BLOCK_SIZE
+    struct node_soa {
+       std::vector<float> centroid_x_;
+       std::vector<float> centroid_y_;
+       std::vector<float> centroid_z_;
+       std::vector<float> avg_primitive_extent_;
+       std::vector<float> min_x_;
+       std::vector<float> min_y_;
+       std::vector<float> min_z_;
+       std::vector<float> max_x_;
+       std::vector<float> max_y_;
+       std::vector<float> max_z_;
+    };
+
                         bvh();
                         bvh(const std::string& filename);
     virtual             ~bvh() {}
@@ -66,6 +82,13 @@ public:
     const float         get_max_surfel_radius_deviation(const node_t node_id) const;
     const node_visibility get_visibility(const node_t node_id) const;
     const primitive_type get_primitive() const { return primitive_; }
+    const node_soa&     get_node_soa() const { return node_soa_; }
+
+    // a compressed .lod stores every node as one lod_block, the offsets
+    // of the blocks are loaded from the .bvh
+    const bool          is_lod_compressed() const { return !lod_block_offsets_.empty(); }
+    const uint64_t      get_lod_block_offset(const node_t node_id) const;
+    const uint64_t      get_lod_block_size(const node_t node_id) const;
     
     void                set_num_nodes(const uint32_t num_nodes) { num_nodes_ = num_nodes; }
     void                set_fan_factor(const uint32_t fan_factor) { fan_factor_ = fan_factor; }
@@ -80,12 +103,14 @@ public:
     void                set_max_surfel_radius_deviation(const node_t node_id, const float max_radius_deviation);
     void                set_visibility(const node_t node_id, const node_visibility visibility);
     void                set_primitive(const primitive_type primitive) { primitive_ = primitive; };
+    void                set_lod_block_offsets(const std::vector<uint64_t>& lod_block_offsets) { lod_block_offsets_ = lod_block_offsets; }
 
     void                write_bvh_file(const std::string& filename);
 
 protected:
 
     void                load_bvh_file(const std::string& filename);
+    void                resize_node_soa(const node_t node_id);
 
     uint32_t            num_nodes_;
     uint32_t            fan_factor_;
@@ -101,6 +126,10 @@ protected:
     std::vector<float>  avg_primitive_extent_;
     std::vector<float>  max_primitive_extent_deviation_; //new for radius quantization
 
+    node_soa            node_soa_;
+
+    std::vector<uint64_t> lod_block_offsets_;
+
     std::string         filename_;
 
     vec3f               translation_;
@@ -536,6 +536,61 @@ protected:
 
     };
 
+    // offsets of the blocks of a compressed .lod, block i spans
+    // [block_offsets_[i], block_offsets_[i + 1])
+    class bvh_lod_block_seg : public bvh_serializable {
+    public:
+        bvh_lod_block_seg()
+        : bvh_serializable() {};
+        ~bvh_lod_block_seg() {};
+
+        uint32_t segment_id_;
+        uint32_t codec_;
+        uint64_t reserved_;
+        uint64_t num_blocks_;
+        std::vector<uint64_t> block_offsets_;
+
+    protected:
+        friend class bvh_stream;
+        const size_t size() const {
+            return 4*sizeof(uint32_t) + 8 + (num_blocks_ + 1) * 8;
+        };
+        void signature(char* signature) {
+            signature[0] = 'B';
+            signature[1] = 'V';
+            signature[2] = 'H';
+            signature[3] = 'X';
+            signature[4] = 'L';
+            signature[5] = 'O';
+            signature[6] = 'D';
+            signature[7] = 'B';
+        }
+        void serialize(std::fstream& file) {
+            if (!file.is_open()) {
+               throw std::runtime_error(
+                   "PLOD: bvh_stream::Unable to serialize");
+            }
+            file.write((char*)&segment_id_, 4);
+            file.write((char*)&codec_, 4);
+            file.write((char*)&reserved_, 8);
+            file.write((char*)&num_blocks_, 8);
+            file.write((char*)block_offsets_.data(), (num_blocks_ + 1) * 8);
+        }
+        void deserialize(std::fstream& file) {
+            if (!file.is_open()) {
+               throw std::runtime_error(
+                   "PLOD: bvh_stream::Unable to deserialize");
+            }
+            file.read((char*)&segment_id_, 4);
+            file.read((char*)&codec_, 4);
+            file.read((char*)&reserved_, 8);
+            file.read((char*)&num_blocks_, 8);
+            block_offsets_.resize(num_blocks_ + 1);
+            file.read((char*)block_offsets_.data(), (num_blocks_ + 1) * 8);
+        }
+
+    };
+
     
     void open_stream(const std::string& bvh_filename,
                     const bvh_stream_type type);
@@ -12,6 +12,7 @@
 #include <queue>
 #include <lamure/utils.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <scm/core.h>
@@ -35,6 +36,11 @@ public:
     virtual             ~cache();
 
     const bool          is_node_resident(const model_t model_id, const node_t node_id);
+    //same as is_node_resident, but counts the request as hit or miss
+    const bool          request_node(const model_t model_id, const node_t node_id);
+
+    const uint64_t      num_hits() const { return num_hits_.load(); };
+    const uint64_t      num_misses() const { return num_misses_.load(); };
 
     const slot_t        num_free_slots();
     const slot_t        slot_id(const model_t model_id, const node_t node_id);
@@ -62,6 +68,8 @@ private:
     node_t              num_nodes_;
     size_t              slot_size_;
 
+    std::atomic<uint64_t> num_hits_;
+    std::atomic<uint64_t> num_misses_;
 
 };
 
@@ -8,6 +8,8 @@
 #ifndef REN_CACHE_QUEUE_H_
 #define REN_CACHE_QUEUE_H_
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
@@ -58,7 +60,8 @@ public:
             slot_id_(slot_id),
             priority_(priority),
             slot_mem_(slot_mem),
-            slot_mem_provenance_(slot_mem_provenance) {};
+            slot_mem_provenance_(slot_mem_provenance),
+            prefetched_(false) {};
 
         explicit job()
             : model_id_(invalid_model_t),
@@ -66,7 +69,8 @@ public:
             slot_id_(invalid_slot_t),
             priority_(0),
             slot_mem_(nullptr),
-            slot_mem_provenance_(nullptr) {};
+            slot_mem_provenance_(nullptr),
+            prefetched_(false) {};
 
         model_t         model_id_;
         node_t          node_id_;
@@ -74,6 +78,7 @@ public:
         int32_t         priority_;
         char*           slot_mem_;
         char*           slot_mem_provenance_;
+        bool            prefetched_;
     };
 
                         cache_queue();
@@ -85,26 +90,59 @@ public:
     void                update_job(const model_t model_id, const node_t node_id, int32_t priority);
     const abort_result  abort_job(const job& job);
 
+    // collects up to max_num_jobs waiting jobs that were not collected
+    // before. jobs are taken from the front of the heap, which holds the
+    // highest priorities; they are not returned in strict priority order.
+    void                collect_prefetch_jobs(const size_t max_num_jobs, std::vector<job>& jobs);
+
+    // removes waiting jobs of the same model whose node ids extend the
+    // node id of the given (already taken) job without gaps, so that all
+    // of them can be served by one sequential read. jobs are returned in
+    // ascending node id order and include the given job.
+    void                collect_adjacent_jobs(const job& first_job, const size_t max_num_jobs, std::vector<job>& jobs);
+
     const size_t        num_jobs();
-    void                initialize(const update_mode mode, const model_t num_models);
+
+    // jobs are distributed over num_shards independently locked heaps.
+    // top_job picks the shard with the highest top priority without
+    // locking, so with more than one shard the order is relaxed: a job
+    // can be handed out while a concurrently pushed job of slightly
+    // higher priority still waits in another shard
+    void                initialize(const update_mode mode, const model_t num_models, const size_t num_shards = 1);
+    const size_t        num_shards() const { return shards_.size(); };
     const query_result  is_node_indexed(const model_t model_id, const node_t node_id);
 
 private:
-    void                swap(const size_t slot_id_0, const size_t slot_id_1);
-    void                shuffle_up(const size_t slot_id);
-    void                shuffle_down(const size_t slot_id);
+    struct shard
+    {
+        void            swap(const size_t slot_id_0, const size_t slot_id_1);
+        void            shuffle_up(const size_t slot_id);
+        void            shuffle_down(const size_t slot_id);
+        void            remove(const size_t slot_id);
+        void            publish();
+
+        std::mutex      mutex_;
+        size_t          num_slots_;
+        std::vector<job> slots_;
+
+        //mapping (model, node) to slot
+        std::vector<std::unordered_map<node_t, slot_t>> requested_set_;
+        std::vector<std::unordered_set<node_t>> pending_set_;
+
+        // read without the lock by top_job and num_jobs
+        std::atomic<int32_t> top_priority_;
+        std::atomic<size_t> num_jobs_;
+    };
+
+    shard&              get_shard(const model_t model_id, const node_t node_id);
+    // requires the lock of the given shard
+    bool                take_waiting_job(shard& shard, const model_t model_id, const node_t node_id, job& job);
 
-    size_t              num_slots_;
     model_t             num_models_;
-    std::mutex          mutex_;
     update_mode         mode_;
     bool                initialized_;
 
-    std::vector<job>    slots_;
-
-    //mapping (model, node) to slot
-    std::vector<std::unordered_map<node_t, slot_t>> requested_set_;
-    std::vector<std::unordered_set<node_t>> pending_set_;
+    std::vector<std::unique_ptr<shard>> shards_;
 };
 
 
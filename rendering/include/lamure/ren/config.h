@@ -41,6 +41,15 @@ namespace ren {
 
 #define LAMURE_CUT_UPDATE_NUM_CUT_UPDATE_THREADS 4
 
+//cut analysis is scheduled in chunks of about this many cut nodes
+#define LAMURE_CUT_UPDATE_ANALYSIS_CHUNK_SIZE 2048
+//node error and frustum visibility are evaluated for blocks of consecutive nodes
+#define LAMURE_CUT_UPDATE_ANALYSIS_BLOCK_SIZE 8
+
+//report the per-update cost of the cut analysis phase
+//#define LAMURE_CUT_UPDATE_ENABLE_MEASURE_CUT_ANALYSIS
+#define LAMURE_CUT_UPDATE_MEASURE_CUT_ANALYSIS_INTERVAL 64
+
 //#define LAMURE_CUT_UPDATE_ENABLE_SHOW_OOC_CACHE_USAGE
 //#define LAMURE_CUT_UPDATE_ENABLE_SHOW_GPU_CACHE_USAGE
 
@@ -88,6 +97,18 @@ namespace ren {
 //#define LAMURE_CUT_UPDATE_ENABLE_CACHE_MAINTENANCE
 #define LAMURE_CUT_UPDATE_CACHE_MAINTENANCE_COUNTER 500
 
+//with policy::LOADING_MODE_MMAP, each loader thread hints up to this many
+//queued jobs to the kernel (madvise WILLNEED) before copying its own node
+#define LAMURE_CUT_UPDATE_MMAP_PREFETCH_JOBS 16
+
+//upper bound of waiting jobs with adjacent node ids that a loader thread
+//serves with one sequential read (1 disables coalescing)
+#define LAMURE_CUT_UPDATE_MAX_COALESCED_JOBS 16
+
+//with policy::LOADING_MODE_IO_URING, number of reads a single loader
+//thread keeps in flight
+#define LAMURE_CUT_UPDATE_IO_URING_DEPTH 64
+
 //------------------------------
 //for ooc_pool:
 //------------------------------
@@ -95,6 +116,9 @@ namespace ren {
 #define LAMURE_CUT_UPDATE_LOADING_QUEUE_MODE cache_queue::update_mode::UPDATE_ALWAYS
 //#define LAMURE_CUT_UPDATE_LOADING_QUEUE_MODE cache_queue::update_mode::UPDATE_INCREMENT_ONLY
 
+//independently locked heaps in the loading queue (1 gives strict priority order)
+#define LAMURE_CUT_UPDATE_LOADING_QUEUE_SHARDS 16
+
 //------------------------------
 //for bvh_stream: 
 //------------------------------
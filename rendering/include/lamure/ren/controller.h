@@ -48,13 +48,17 @@ class RENDERING_DLL controller
 
     void dispatch(const context_t context_id, scm::gl::render_device_ptr device);
     void dispatch(const context_t context_id, scm::gl::render_device_ptr device, Data_Provenance const &data_provenance);
+    // gpu-free dispatch, the primary buffer of the context is plain host memory
+    void dispatch_host(const context_t context_id);
     const bool is_cut_update_in_progress(const context_t context_id);
     const bool is_cut_update_in_progress(const context_t context_id, Data_Provenance const &data_provenanc);
+    const cut_update_pool::statistics get_cut_update_statistics(const context_t context_id);
 
     scm::gl::buffer_ptr get_context_buffer(const context_t context_id, scm::gl::render_device_ptr device);
     scm::gl::buffer_ptr get_context_buffer(const context_t context_id, scm::gl::render_device_ptr device, Data_Provenance const &data_provenance);
     scm::gl::vertex_array_ptr get_context_memory(const context_t context_id, bvh::primitive_type type, scm::gl::render_device_ptr device);
     scm::gl::vertex_array_ptr get_context_memory(const context_t context_id, bvh::primitive_type type, scm::gl::render_device_ptr device, Data_Provenance const &data_provenance);
+    const char *get_context_host_memory(const context_t context_id);
 
     size_t ms_since_last_node_upload() { return ms_since_last_node_upload_; };
     void reset_ms_since_last_node_upload() { ms_since_last_node_upload_ = 0; };
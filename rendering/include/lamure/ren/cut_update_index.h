@@ -11,6 +11,8 @@
 #include <lamure/types.h>
 #include <lamure/utils.h>
 #include <lamure/ren/config.h>
+#include <lamure/ren/flat_cut.h>
+#include <lamure/ren/action_slot_map.h>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -94,13 +96,14 @@ public:
     const size_t        num_actions(const queue_t queue);
 
     void                push_action(const action& action, bool sort);
+    void                push_actions(const std::vector<action>& actions);
     const action        front_action(const queue_t queue);
     const action        back_action(const queue_t queue);
     void                pop_front_action(const queue_t queue);
     void                Popback_action(const queue_t queue);
 
-    const std::set<node_t>& get_current_cut(const view_t view_id, const model_t model_id);
-    const std::set<node_t>& get_previous_cut(const view_t view_id, const model_t model_id);
+    const flat_cut&     get_current_cut(const view_t view_id, const model_t model_id);
+    const flat_cut&     get_previous_cut(const view_t view_id, const model_t model_id);
     void                swap_cuts();
     void                reset_cut(const view_t view_id, const model_t model_id);
 
@@ -126,6 +129,10 @@ private:
 
     void                add_action(const action& action, bool sort);
 
+    flat_cut&           current_front(const view_t view_id, const model_t model_id);
+    flat_cut&           previous_front(const view_t view_id, const model_t model_id);
+    void                resize_fronts();
+
     void                swap(const queue_t queue, const size_t slot_id_0, const size_t slot_id_1);
     void                shuffle_up(const queue_t queue, const size_t slot_id);
     void                shuffle_down(const queue_t queue, const size_t slot_id);
@@ -143,12 +150,12 @@ private:
     std::stack<action> initial_queue_;
 
     //mapping [queue] (model, node) to slot
-    std::vector<std::map<node_t, std::set<slot_t>>> slot_maps_[queue_t::NUM_QUEUES];
+    action_slot_map     slot_maps_[queue_t::NUM_QUEUES];
 
     cut_front            current_cut_front_;
-    //[user][model][node]
-    std::map<view_t, std::vector<std::set<node_t>>> front_a_cuts_;
-    std::map<view_t, std::vector<std::set<node_t>>> front_b_cuts_;
+    //[user][model]
+    std::vector<std::vector<flat_cut>> front_a_cuts_;
+    std::vector<std::vector<flat_cut>> front_b_cuts_;
 
 };
 
@@ -14,6 +14,8 @@
 
 #include <lamure/utils.h>
 #include <vector>
+#include <atomic>
+#include <chrono>
 
 #include <lamure/ren/cut_database.h>
 #include <lamure/ren/model_database.h>
@@ -26,6 +28,8 @@
 #include <lamure/ren/cut_update_queue.h>
 #include <lamure/ren/gpu_cache.h>
 #include <lamure/ren/ooc_cache.h>
+#include <lamure/ren/work_stealing_queue.h>
+#include <lamure/ren/node_evaluation_cache.h>
 
 namespace lamure
 {
@@ -40,11 +44,42 @@ class cut_update_pool
 
     const uint32_t num_threads() const { return num_threads_; };
 
+    // totals since construction, except for the duration of the latest cut update
+    struct statistics
+    {
+        uint64_t num_cut_updates_;
+        uint64_t last_cut_update_in_us_;
+        uint64_t nodes_transferred_;
+        uint64_t gpu_cache_hits_;
+        uint64_t gpu_cache_misses_;
+    };
+
     void dispatch_cut_update(char *current_gpu_storage_A, char *current_gpu_storage_B, char *current_gpu_storage_A_provenance, char *current_gpu_storage_B_provenance);
     // void                    dispatch_cut_update(char* current_gpu_storage_A, char* current_gpu_storage_B);
     const bool is_running();
+    const statistics get_statistics();
 
   protected:
+    // per (view, model) state shared by all analysis chunks of that pair
+    struct analysis_context
+    {
+        view_t view_id_;
+        model_t model_id_;
+        const flat_cut *old_cut_;
+        uint32_t fan_factor_;
+        bool freshness_timeout_;
+        float min_error_threshold_;
+        float max_error_threshold_;
+    };
+
+    // range [first_node_, last_node_) of a previous cut, never splits a group of siblings
+    struct analysis_chunk
+    {
+        size_t context_id_;
+        size_t first_node_;
+        size_t last_node_;
+    };
+
     void initialize(bool provenance = false);
     const bool prepare();
 
@@ -52,7 +87,7 @@ class cut_update_pool
     void collapse_node(const cut_update_index::action &item);
     void cut_update_split_again(const cut_update_index::action &split_action);
 
-    const bool is_all_nodes_in_cut(const model_t model_id, const std::vector<node_t> &node_ids, const std::set<node_t> &cut);
+    const bool is_all_nodes_in_cut(const model_t model_id, const std::vector<node_t> &node_ids, const flat_cut &cut);
     const bool is_node_in_frustum(const view_t view_id, const model_t model_id, const node_t node_id, const scm::gl::frustum &frustum);
     const bool is_no_node_in_frustum(const view_t view_id, const model_t model_id, const std::vector<node_t> &node_ids, const scm::gl::frustum &frustum);
 
@@ -62,7 +97,9 @@ class cut_update_pool
     void shutdown();
 
     void cut_master();
-    void cut_analysis(view_t view_id, model_t model_id);
+    void prepare_analysis();
+    void cut_analysis_worker(const size_t worker_id);
+    void cut_analysis(const analysis_chunk &chunk, std::vector<cut_update_index::action> &actions);
     void cut_update();
     void compile_transfer_list();
     void compile_render_list();
@@ -129,6 +166,24 @@ class cut_update_pool
     boost::timer::nanosecond_type last_frame_elapsed_;
 #endif
 
+    std::vector<analysis_context> analysis_contexts_;
+    std::vector<analysis_chunk> analysis_chunks_;
+    // [view * num_models + model], valid for the whole cut update
+    std::vector<std::unique_ptr<node_evaluation_cache>> node_caches_;
+    std::vector<std::vector<cut_update_index::action>> analysis_results_;
+    work_stealing_queue analysis_queue_;
+    std::atomic<size_t> next_analysis_worker_;
+
+#ifdef LAMURE_CUT_UPDATE_ENABLE_MEASURE_CUT_ANALYSIS
+    std::atomic<uint64_t> analysis_task_time_;
+    std::atomic<uint64_t> analysis_num_nodes_;
+    uint64_t analysis_wall_time_;
+    uint32_t analysis_num_updates_;
+#endif
+
+    std::chrono::steady_clock::time_point master_start_;
+    statistics statistics_;
+
     semaphore master_semaphore_;
     bool master_dispatched_;
 };
@@ -0,0 +1,60 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_FLAT_CUT_H_
+#define REN_FLAT_CUT_H_
+
+#include <lamure/types.h>
+#include <lamure/ren/platform.h>
+
+#include <vector>
+#include <cstdint>
+
+namespace lamure {
+namespace ren
+{
+
+// node set of one cut front, stored as a contiguous vector of node ids plus
+// a membership bitset. insertions append and only mark the vector unsorted;
+// sort() restores ascending order once the front is complete, so iteration
+// visits sibling groups consecutively like the former std::set did.
+class RENDERING_DLL flat_cut
+{
+public:
+    typedef std::vector<node_t>::const_iterator const_iterator;
+
+                        flat_cut();
+    virtual             ~flat_cut();
+
+    void                insert(const node_t node_id);
+    template <typename iterator_t>
+    void                insert(iterator_t first, iterator_t last) {
+                            for (; first != last; ++first) insert(*first);
+                        };
+    void                erase(const node_t node_id);
+    void                clear();
+    void                sort();
+
+    const bool          contains(const node_t node_id) const;
+    const bool          empty() const { return nodes_.empty(); };
+    const size_t        size() const { return nodes_.size(); };
+    const bool          is_sorted() const { return is_sorted_; };
+
+    const node_t        operator[](const size_t index) const { return nodes_[index]; };
+
+    const_iterator      begin() const { return nodes_.begin(); };
+    const_iterator      end() const { return nodes_.end(); };
+
+private:
+    std::vector<node_t>   nodes_;
+    std::vector<uint64_t> membership_;
+    bool                  is_sorted_;
+};
+
+} } // namespace lamure
+
+#endif // REN_FLAT_CUT_H_
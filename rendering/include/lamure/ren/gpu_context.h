@@ -38,6 +38,7 @@ class gpu_context
     };
     const context_t context_id() const { return context_id_; };
     const bool is_created() const { return is_created_; };
+    const bool is_host_only() const { return host_primary_buffer_ != nullptr; };
 
     temporary_storages get_temporary_storages() { return temporary_storages_; };
     temporary_storages get_temporary_storages_provenance() { return temporary_storages_provenance_; };
@@ -56,16 +57,22 @@ class gpu_context
     void unmap_temporary_storage(const cut_database_record::temporary_buffer &buffer, scm::gl::render_device_ptr device, Data_Provenance const &data_provenance);
     bool update_primary_buffer(const cut_database_record::temporary_buffer &from_buffer, scm::gl::render_device_ptr device_);
     bool update_primary_buffer_fix(const cut_database_record::temporary_buffer &from_buffer, scm::gl::render_device_ptr device, Data_Provenance const &data_provenance);
+    bool update_primary_buffer_host(const cut_database_record::temporary_buffer &from_buffer);
 
     fix_struct get_fix_a() { return fix_a_; };
     fix_struct get_fix_b() { return fix_b_; };
 
     void create(scm::gl::render_device_ptr device);
     void create(scm::gl::render_device_ptr device, Data_Provenance const &data_provenance);
+    // gpu-free mode: temporary storages and the primary buffer live in host memory,
+    // budgets are taken from the policy as is
+    void create_host();
+    const char *get_host_primary_buffer() const { return host_primary_buffer_; };
 
   private:
     void test_video_memory(scm::gl::render_device_ptr device);
     void test_video_memory(scm::gl::render_device_ptr device, Data_Provenance const &data_provenance);
+    void test_host_memory();
 
     context_t context_id_;
 
@@ -78,6 +85,7 @@ class gpu_context
     fix_struct fix_b_;
 
     gpu_access *primary_buffer_;
+    char *host_primary_buffer_;
 
     temporary_storages temporary_storages_;
     temporary_storages temporary_storages_provenance_;
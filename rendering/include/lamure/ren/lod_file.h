@@ -0,0 +1,70 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_LOD_FILE_H_
+#define REN_LOD_FILE_H_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include <lamure/ren/platform.h>
+
+namespace lamure {
+namespace ren
+{
+
+// read-only handle to a .lod or .prov file that is kept open across
+// many node requests. in contrast to lod_stream, reads are positional
+// (pread) and do not touch a shared file offset, so the destination can
+// be cache slot memory directly.
+class RENDERING_DLL lod_file
+{
+public:
+                        lod_file();
+                        lod_file(const lod_file&) = delete;
+                        lod_file& operator=(const lod_file&) = delete;
+    virtual             ~lod_file();
+
+    void                open(const std::string& file_name);
+    void                close();
+    const bool          is_file_open() const { return is_file_open_; };
+    const std::string&  file_name() const { return file_name_; };
+
+    void                read(char* const data,
+                            const size_t start_in_file,
+                            const size_t length_in_bytes);
+
+    // reads num_destinations consecutive blocks of length_per_destination
+    // bytes starting at start_in_file, block i goes to destinations[i]
+    void                read_scattered(char* const* destinations,
+                            const size_t num_destinations,
+                            const size_t start_in_file,
+                            const size_t length_per_destination);
+
+    // number of read syscalls issued since open()
+    const uint64_t      num_syscalls() const { return num_syscalls_; };
+
+#ifndef _WIN32
+    const int           descriptor() const { return descriptor_; };
+#endif
+
+private:
+#ifdef _WIN32
+    void*               handle_;
+#else
+    int                 descriptor_;
+#endif
+
+    std::string         file_name_;
+    bool                is_file_open_;
+    uint64_t            num_syscalls_;
+};
+
+} } // namespace lamure
+
+#endif // REN_LOD_FILE_H_
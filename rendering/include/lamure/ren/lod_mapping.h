@@ -0,0 +1,62 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_LOD_MAPPING_H_
+#define REN_LOD_MAPPING_H_
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include <lamure/ren/platform.h>
+
+namespace lamure {
+namespace ren
+{
+
+// read-only memory mapping of a whole .lod or .prov file. the mapping is
+// created once and may be shared by all loader threads; node data is served
+// by copying straight out of the page cache.
+class RENDERING_DLL lod_mapping
+{
+public:
+                        lod_mapping();
+                        lod_mapping(const lod_mapping&) = delete;
+                        lod_mapping& operator=(const lod_mapping&) = delete;
+    virtual             ~lod_mapping();
+
+    void                open(const std::string& file_name);
+    void                close();
+    const bool          is_file_open() const { return is_file_open_; };
+    const std::string&  file_name() const { return file_name_; };
+    const size_t        size() const { return size_; };
+    const char*         data() const { return data_; };
+
+    void                read(char* const data,
+                            const size_t start_in_file,
+                            const size_t length_in_bytes) const;
+
+    // hint the kernel to start read-ahead for the given range
+    void                will_need(const size_t start_in_file,
+                            const size_t length_in_bytes) const;
+
+private:
+#ifdef _WIN32
+    void*               file_handle_;
+    void*               mapping_handle_;
+#endif
+
+    char*               data_;
+    size_t              size_;
+
+    std::string         file_name_;
+    bool                is_file_open_;
+};
+
+} } // namespace lamure
+
+#endif // REN_LOD_MAPPING_H_
@@ -0,0 +1,87 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_NODE_EVALUATION_CACHE_H_
+#define REN_NODE_EVALUATION_CACHE_H_
+
+#include <lamure/types.h>
+#include <lamure/ren/platform.h>
+#include <lamure/ren/config.h>
+#include <lamure/ren/bvh.h>
+
+#include <scm/core/math.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace lamure {
+namespace ren
+{
+
+// projected node error and frustum visibility of one model seen from one view.
+// nodes are evaluated in blocks of LAMURE_CUT_UPDATE_ANALYSIS_BLOCK_SIZE
+// consecutive ids straight from the soa arrays of the bvh (siblings and
+// children are consecutive, so one block usually serves a whole group).
+// every block is evaluated at most once per frame; the cache may be read by
+// several analysis workers at the same time.
+class RENDERING_DLL node_evaluation_cache
+{
+public:
+    struct parameters
+    {
+        //third row of view * model, yields the view space depth of a centroid
+        float           depth_row_[4];
+        //2 * radius scaling * near plane * height / (top - bottom)
+        float           error_scale_;
+        //frustum planes in model space, normals pointing inwards
+        float           planes_[6][4];
+    };
+
+                        node_evaluation_cache();
+                        node_evaluation_cache(const node_evaluation_cache&) = delete;
+                        node_evaluation_cache& operator=(const node_evaluation_cache&) = delete;
+    virtual             ~node_evaluation_cache();
+
+    static void         setup_parameters(parameters& params,
+                            const scm::math::mat4f& view_matrix,
+                            const scm::math::mat4f& projection_matrix,
+                            const scm::math::mat4f& model_matrix,
+                            const float near_plane,
+                            const float height_divided_by_top_minus_bottom);
+
+    //evaluates the block of nodes starting at first_node_id, which must be a
+    //multiple of the block size
+    static void         evaluate_block(const parameters& params,
+                            const bvh::node_soa& soa,
+                            const node_t first_node_id,
+                            float* errors,
+                            uint8_t* in_frustum);
+
+    //invalidates all cached results, call once per cut update before reading
+    void                begin_frame(const bvh* bvh, const parameters& params);
+
+    const float         node_error(const node_t node_id);
+    const bool          is_node_in_frustum(const node_t node_id);
+
+private:
+    void                lookup(const node_t node_id, float& error, bool& in_frustum);
+
+    const bvh*          bvh_;
+    parameters          params_;
+
+    size_t              num_blocks_;
+    std::vector<float>  errors_;
+    std::vector<uint8_t> in_frustum_;
+    std::unique_ptr<std::atomic<uint32_t>[]> block_stamps_;
+
+    uint32_t            frame_stamp_;
+};
+
+} } // namespace lamure
+
+#endif // REN_NODE_EVALUATION_CACHE_H_
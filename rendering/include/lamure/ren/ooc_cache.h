@@ -51,6 +51,7 @@ class RENDERING_DLL ooc_cache : public cache
 
     void begin_measure();
     void end_measure();
+    const ooc_pool::statistics get_loading_statistics();
 
   protected:
     ooc_cache(const size_t num_slots);
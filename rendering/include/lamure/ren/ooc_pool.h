@@ -12,11 +12,14 @@
 #include <lamure/ren/cache_index.h>
 #include <lamure/ren/cache_queue.h>
 #include <lamure/ren/config.h>
-#include <lamure/ren/lod_stream.h>
+#include <lamure/ren/lod_file.h>
+#include <lamure/ren/lod_mapping.h>
+#include <lamure/ren/uring_queue.h>
 #include <lamure/ren/model_database.h>
-#include <lamure/ren/provenance_stream.h>
+#include <lamure/ren/policy.h>
 #include <lamure/types.h>
 #include <lamure/utils.h>
+#include <chrono>
 #include <map>
 #include <mutex>
 #include <set>
@@ -28,7 +31,6 @@
 #include <lamure/types.h>
 #include <lamure/ren/config.h>
 #include <lamure/ren/model_database.h>
-#include <lamure/ren/lod_stream.h>
 #include <lamure/ren/cache_queue.h>
 #include <lamure/ren/cache_index.h>
 
@@ -42,6 +44,14 @@ class ooc_pool
     ooc_pool(const uint32_t num_loader_threads, const size_t size_of_slot_in_bytes, const size_t size_of_slot_provenance_, Data_Provenance const &data_provenance);
     /*virtual*/ ~ooc_pool();
 
+    // totals since construction, begin_measure() does not reset them
+    struct statistics
+    {
+        uint64_t bytes_loaded_;
+        uint64_t nodes_loaded_;
+        uint64_t syscalls_issued_;
+    };
+
     const uint32_t num_threads() const { return num_threads_; };
 
     bool acknowledge_request(cache_queue::job job);
@@ -57,11 +67,23 @@ class ooc_pool
 
     void begin_measure();
     void end_measure();
+    const statistics get_statistics();
 
   protected:
     void run();
+#ifndef _WIN32
+    void run_uring();
+#endif
     bool is_shutdown();
 
+  private:
+    void initialize_files();
+    void start_threads();
+    uint64_t read_jobs_blocking(const std::vector<cache_queue::job> &jobs, std::vector<lod_file> &lod_access, std::vector<lod_file> &provenance_access,
+                                std::vector<char> &block_buffer);
+    // blocks holds the lod blocks of the adjacent jobs, starting with the block of the first one
+    void decompress_jobs(const std::vector<cache_queue::job> &jobs, const char *blocks);
+
   private:
     bool locked_;
     semaphore semaphore_;
@@ -71,10 +93,23 @@ class ooc_pool
 
     uint32_t num_threads_;
     std::vector<std::thread> threads_;
+    // pread threads started when the io_uring thread falls back
+    std::vector<std::thread> fallback_threads_;
 
     bool shutdown_;
 
+    policy::loading_mode loading_mode_;
+    std::vector<std::string> lod_file_names_;
+    std::vector<std::string> provenance_file_names_;
+    std::vector<lod_mapping *> lod_mappings_;
+    std::vector<lod_mapping *> provenance_mappings_;
+    uring_queue *uring_;
+
     size_t bytes_loaded_;
+    size_t nodes_loaded_;
+    uint64_t syscalls_issued_;
+    std::chrono::steady_clock::time_point measure_start_;
+    statistics statistics_;
 
     std::vector<cache_queue::job> history_;
 
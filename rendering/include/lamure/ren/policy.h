@@ -26,6 +26,13 @@ public:
                         policy& operator=(const policy&) = delete;
     virtual             ~policy();
 
+    enum loading_mode
+    {
+        LOADING_MODE_PREAD,
+        LOADING_MODE_MMAP,
+        LOADING_MODE_IO_URING
+    };
+
     static policy*      get_instance();
 
     void                set_reset_system(const bool reset_system) { reset_system_ = reset_system; };
@@ -33,12 +40,14 @@ public:
     void                set_render_budget_in_mb(const size_t render_budget) { render_budget_in_mb_ = render_budget; };
     void                set_out_of_core_budget_in_mb(const size_t out_of_core_budget) { out_of_core_budget_in_mb_ = out_of_core_budget; };
     void                set_size_of_provenance(const size_t size_of_provenance) { size_of_provenance_ = size_of_provenance; };
+    void                set_loading_mode(const loading_mode mode) { loading_mode_ = mode; };
 
     const bool          reset_system() const { return reset_system_; };
     const size_t        max_upload_budget_in_mb() const { return max_upload_budget_in_mb_; };
     const size_t        render_budget_in_mb() const { return render_budget_in_mb_; };
     const size_t        out_of_core_budget_in_mb() const { return out_of_core_budget_in_mb_; };
     const size_t        size_of_provenance() const { return size_of_provenance_; };
+    const loading_mode  get_loading_mode() const { return loading_mode_; };
 
     const int32_t       window_width() const { return window_width_; };
     const int32_t       window_height() const { return window_height_; };
@@ -64,6 +73,8 @@ private:
 
     size_t              size_of_provenance_;
 
+    loading_mode        loading_mode_;
+
     int32_t             window_width_;
     int32_t             window_height_;
 
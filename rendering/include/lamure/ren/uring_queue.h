@@ -0,0 +1,121 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_URING_QUEUE_H_
+#define REN_URING_QUEUE_H_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <lamure/ren/platform.h>
+
+namespace lamure {
+namespace ren
+{
+
+// minimal submission/completion queue on top of linux io_uring, driven by
+// raw syscalls (no liburing dependency). initialize() returns false where
+// io_uring is unavailable (other platforms, old kernels, seccomp), callers
+// are expected to fall back to blocking reads then.
+class RENDERING_DLL uring_queue
+{
+public:
+                        uring_queue();
+                        uring_queue(const uring_queue&) = delete;
+                        uring_queue& operator=(const uring_queue&) = delete;
+    virtual             ~uring_queue();
+
+    bool                initialize(const uint32_t depth);
+    void                shutdown();
+
+    const bool          is_initialized() const { return is_initialized_; };
+    const uint32_t      depth() const { return depth_; };
+    const uint32_t      num_in_flight() const { return num_in_flight_; };
+    const bool          is_full() const { return num_in_flight_ >= depth_; };
+
+    // queues a positional read, returns false if the queue is full.
+    // nothing is handed to the kernel before submit()
+    bool                push_read(const int descriptor,
+                            char* const data,
+                            const size_t start_in_file,
+                            const size_t length_in_bytes,
+                            const uint64_t user_data);
+
+    // same as push_read, but consecutive blocks of length_per_destination
+    // bytes are scattered to destinations[i] by a single request
+    bool                push_read_scattered(const int descriptor,
+                            char* const* destinations,
+                            const size_t num_destinations,
+                            const size_t start_in_file,
+                            const size_t length_per_destination,
+                            const uint64_t user_data);
+
+    // submits all queued reads and blocks until at least
+    // min_complete reads have completed. returns false if the ring
+    // refused the submission, also if it was busy or out of resources
+    bool                submit(const uint32_t min_complete);
+
+    // result is the number of bytes read or a negated errno value,
+    // length_in_bytes the number of bytes the read asked for
+    bool                pop_completion(uint64_t& user_data, int32_t& result, size_t& length_in_bytes);
+
+    // takes back the reads that were not submitted yet, cancels the others
+    // and blocks until the kernel has completed every one of them. the
+    // completions are still handed out by pop_completion, taken back reads
+    // with -ECANCELED. returns false if the ring cannot be waited on, the
+    // destinations of submitted reads must not be reused then
+    bool                drain();
+
+    const uint64_t      num_syscalls() const { return num_syscalls_; };
+
+private:
+    struct request
+    {
+        uint64_t        user_data_;
+        size_t          length_in_bytes_;
+        bool            is_submitted_;
+        std::vector<char> vectors_;
+    };
+
+    int                 ring_descriptor_;
+    uint32_t            depth_;
+    uint32_t            num_in_flight_;
+    uint32_t            num_to_submit_;
+    bool                is_initialized_;
+    uint64_t            num_syscalls_;
+
+    // rings shared with the kernel
+    void*               sq_ring_;
+    size_t              sq_ring_size_;
+    void*               cq_ring_;
+    size_t              cq_ring_size_;
+    void*               sqes_;
+    size_t              sqes_size_;
+
+    uint32_t*           sq_head_;
+    uint32_t*           sq_tail_;
+    uint32_t*           sq_mask_;
+    uint32_t*           sq_array_;
+    uint32_t*           cq_head_;
+    uint32_t*           cq_tail_;
+    uint32_t*           cq_mask_;
+    void*               cqes_;
+
+    // per-request bookkeeping, iovecs must stay valid until completion
+    std::vector<request> requests_;
+    std::vector<uint32_t> free_requests_;
+    std::vector<uint32_t> unsubmitted_requests_;
+
+    // completions collected by drain(), request id and result
+    std::vector<std::pair<uint32_t, int32_t>> drained_completions_;
+};
+
+} } // namespace lamure
+
+#endif // REN_URING_QUEUE_H_
@@ -0,0 +1,49 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_WORK_STEALING_QUEUE_H_
+#define REN_WORK_STEALING_QUEUE_H_
+
+#include <lamure/ren/platform.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lamure {
+namespace ren
+{
+
+// distributes a fixed set of task ids over per-worker deques. every worker
+// starts on a contiguous block of tasks and takes from the front of its own
+// deque; once it runs dry it steals from the back of the other workers'
+// deques, so neighbouring tasks tend to stay on the same worker.
+class RENDERING_DLL work_stealing_queue
+{
+public:
+                        work_stealing_queue();
+    virtual             ~work_stealing_queue();
+
+    void                reset(const size_t num_workers, const size_t num_tasks);
+    const bool          pop_task(const size_t worker_id, size_t& task_id);
+
+    const size_t        num_workers() const { return workers_.size(); };
+
+private:
+    struct worker
+    {
+        std::mutex          mutex_;
+        std::deque<size_t>  tasks_;
+    };
+
+    std::vector<std::unique_ptr<worker>> workers_;
+};
+
+} } // namespace lamure
+
+#endif // REN_WORK_STEALING_QUEUE_H_
@@ -0,0 +1,173 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/action_slot_map.h>
+
+#include <algorithm>
+#include <assert.h>
+
+namespace lamure
+{
+
+namespace ren
+{
+
+namespace
+{
+const size_t initial_capacity = 1024;
+}
+
+const uint64_t action_slot_map::empty_key_;
+
+action_slot_map::
+action_slot_map()
+: entries_(initial_capacity, entry{empty_key_, 0}),
+  mask_(initial_capacity-1),
+  num_entries_(0) {
+
+}
+
+action_slot_map::
+~action_slot_map() {
+
+}
+
+const size_t action_slot_map::
+home(const uint64_t key) const {
+    uint64_t h = key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h & mask_;
+}
+
+const size_t action_slot_map::
+locate(const uint64_t key, const slot_t slot_id) const {
+    size_t i = home(key);
+
+    while (entries_[i].key_ != empty_key_) {
+        if (entries_[i].key_ == key && entries_[i].slot_id_ == slot_id) {
+            return i;
+        }
+        i = (i + 1) & mask_;
+    }
+
+    return entries_.size();
+}
+
+void action_slot_map::
+grow() {
+    std::vector<entry> old_entries(entries_.size() * 2, entry{empty_key_, 0});
+    old_entries.swap(entries_);
+    mask_ = entries_.size() - 1;
+
+    for (const auto& e : old_entries) {
+        if (e.key_ == empty_key_) {
+            continue;
+        }
+
+        size_t i = home(e.key_);
+        while (entries_[i].key_ != empty_key_) {
+            i = (i + 1) & mask_;
+        }
+        entries_[i] = e;
+    }
+}
+
+void action_slot_map::
+insert(const model_t model_id, const node_t node_id, const slot_t slot_id) {
+    //keep the load factor below one half
+    if ((num_entries_ + 1) * 2 > entries_.size()) {
+        grow();
+    }
+
+    const uint64_t key = make_key(model_id, node_id);
+    assert(locate(key, slot_id) == entries_.size());
+
+    size_t i = home(key);
+    while (entries_[i].key_ != empty_key_) {
+        i = (i + 1) & mask_;
+    }
+
+    entries_[i].key_ = key;
+    entries_[i].slot_id_ = slot_id;
+    ++num_entries_;
+}
+
+void action_slot_map::
+erase(const model_t model_id, const node_t node_id, const slot_t slot_id) {
+    size_t i = locate(make_key(model_id, node_id), slot_id);
+
+    if (i == entries_.size()) {
+        return;
+    }
+
+    //backward shift deletion: pull up every following entry whose home
+    //position does not lie cyclically in (i, j]
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask_;
+
+        if (entries_[j].key_ == empty_key_) {
+            break;
+        }
+
+        const size_t k = home(entries_[j].key_);
+        const bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+
+        if (!stays) {
+            entries_[i] = entries_[j];
+            i = j;
+        }
+    }
+
+    entries_[i].key_ = empty_key_;
+    --num_entries_;
+}
+
+void action_slot_map::
+replace(const model_t model_id, const node_t node_id,
+    const slot_t old_slot_id, const slot_t new_slot_id) {
+
+    const size_t i = locate(make_key(model_id, node_id), old_slot_id);
+    assert(i != entries_.size());
+
+    entries_[i].slot_id_ = new_slot_id;
+}
+
+const bool action_slot_map::
+contains(const model_t model_id, const node_t node_id, const slot_t slot_id) const {
+    return locate(make_key(model_id, node_id), slot_id) != entries_.size();
+}
+
+void action_slot_map::
+find(const model_t model_id, const node_t node_id, std::vector<slot_t>& slot_ids) const {
+    const uint64_t key = make_key(model_id, node_id);
+
+    size_t i = home(key);
+    while (entries_[i].key_ != empty_key_) {
+        if (entries_[i].key_ == key) {
+            slot_ids.push_back(entries_[i].slot_id_);
+        }
+        i = (i + 1) & mask_;
+    }
+}
+
+void action_slot_map::
+clear() {
+    if (num_entries_ == 0) {
+        return;
+    }
+
+    std::fill(entries_.begin(), entries_.end(), entry{empty_key_, 0});
+    num_entries_ = 0;
+}
+
+
+} // namespace ren
+
+} // namespace lamure
@@ -8,6 +8,7 @@
 #include <lamure/ren/bvh.h>
 
 #include <limits>
+#include <algorithm>
 
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -131,6 +132,14 @@ set_bounding_box(const node_t node_id, const scm::gl::boxf& bounding_box) {
        bounding_boxes_.push_back(scm::gl::boxf());
     }
     bounding_boxes_[node_id] = bounding_box;
+
+    resize_node_soa(node_id);
+    node_soa_.min_x_[node_id] = bounding_box.min_vertex().x;
+    node_soa_.min_y_[node_id] = bounding_box.min_vertex().y;
+    node_soa_.min_z_[node_id] = bounding_box.min_vertex().z;
+    node_soa_.max_x_[node_id] = bounding_box.max_vertex().x;
+    node_soa_.max_y_[node_id] = bounding_box.max_vertex().y;
+    node_soa_.max_z_[node_id] = bounding_box.max_vertex().z;
 }
 
 const scm::math::vec3f& bvh::
@@ -146,6 +155,11 @@ set_centroid(const node_t node_id, const scm::math::vec3f& centroid) {
        centroids_.push_back(scm::math::vec3f(0.f, 0.f, 0.f));
     }
     centroids_[node_id] = centroid;
+
+    resize_node_soa(node_id);
+    node_soa_.centroid_x_[node_id] = centroid.x;
+    node_soa_.centroid_y_[node_id] = centroid.y;
+    node_soa_.centroid_z_[node_id] = centroid.z;
 }
 
 const float bvh::
@@ -161,6 +175,28 @@ set_avg_primitive_extent(const node_t node_id, const float radius) {
        avg_primitive_extent_.push_back(0.f);
     }
     avg_primitive_extent_[node_id] = radius;
+
+    resize_node_soa(node_id);
+    node_soa_.avg_primitive_extent_[node_id] = radius;
+}
+
+void bvh::
+resize_node_soa(const node_t node_id) {
+    if (node_id < node_soa_.centroid_x_.size()) {
+       return;
+    }
+
+    const size_t block_size = LAMURE_CUT_UPDATE_ANALYSIS_BLOCK_SIZE;
+    const size_t num_nodes = std::max<size_t>(num_nodes_, node_id + 1);
+    const size_t padded_size = ((num_nodes + block_size - 1) / block_size) * block_size;
+
+    //padding nodes sit at the origin with an empty box, their results are never read
+    for (auto* soa_array : {&node_soa_.centroid_x_, &node_soa_.centroid_y_, &node_soa_.centroid_z_,
+                            &node_soa_.avg_primitive_extent_,
+                            &node_soa_.min_x_, &node_soa_.min_y_, &node_soa_.min_z_,
+                            &node_soa_.max_x_, &node_soa_.max_y_, &node_soa_.max_z_}) {
+       soa_array->resize(padded_size, 0.f);
+    }
 }
 
 const float bvh::
@@ -180,6 +216,20 @@ set_max_surfel_radius_deviation(const node_t node_id, const float max_radius_dev
 
 
 
+const uint64_t bvh::
+get_lod_block_offset(const node_t node_id) const {
+    assert(node_id >= 0 && node_id < num_nodes_);
+    assert(is_lod_compressed());
+    return lod_block_offsets_[node_id];
+}
+
+const uint64_t bvh::
+get_lod_block_size(const node_t node_id) const {
+    assert(node_id >= 0 && node_id < num_nodes_);
+    assert(is_lod_compressed());
+    return lod_block_offsets_[node_id + 1] - lod_block_offsets_[node_id];
+}
+
 const bvh::
 node_visibility bvh::get_visibility(const node_t node_id) const {
     assert(node_id >= 0 && node_id < num_nodes_);
@@ -6,6 +6,7 @@
 // http://www.uni-weimar.de/medien/vr
 
 #include <lamure/ren/bvh_stream.h>
+#include <lamure/lod_block.h>
 
 namespace lamure {
 namespace ren {
@@ -140,6 +141,8 @@ read_bvh(const std::string& filename, bvh& bvh) {
     bvh_tree_extension_seg tree_ext;
     std::vector<bvh_node_seg> nodes;
     std::vector<bvh_node_extension_seg> nodes_ext;
+    bvh_lod_block_seg lod_blocks;
+    lod_blocks.num_blocks_ = 0;
     uint32_t tree_id = 0;
     uint32_t tree_ext_id = 0;
     uint32_t node_id = 0;
@@ -219,6 +222,14 @@ read_bvh(const std::string& filename, bvh& bvh) {
                 }
                 break;
             }
+            case 'L': { //"BVHXLODB"
+                lod_blocks.deserialize(file_);
+                if (lod_blocks.codec_ != lod_block::CODEC_ZLIB) {
+                    throw std::runtime_error(
+                        "lamure: bvh_stream::Unsupported lod compression in: " + filename_);
+                }
+                break;
+            }
             default: {
                 throw std::runtime_error(
                     "lamure: bvh_stream::file corrupt -- Invalid segment encountered");
@@ -266,6 +277,14 @@ read_bvh(const std::string& filename, bvh& bvh) {
            "lamure: bvh_stream::Stream corrupt -- Ivalid number of node segments");
     }
 
+    if (lod_blocks.num_blocks_ > 0) {
+       if (lod_blocks.num_blocks_ != node_id) {
+          throw std::runtime_error(
+              "lamure: bvh_stream::Stream corrupt -- Invalid number of lod blocks");
+       }
+       bvh.set_lod_block_offsets(lod_blocks.block_offsets_);
+    }
+
     for (const auto& node : nodes) {
        scm::math::vec3f centroid(node.centroid_.x_,
                                  node.centroid_.y_,
@@ -354,6 +373,21 @@ write_bvh(const std::string& filename, bvh& bvh) {
        write(node);
    }
 
+   if (bvh.is_lod_compressed()) {
+       bvh_lod_block_seg lod_blocks;
+       lod_blocks.segment_id_ = num_segments_++;
+       lod_blocks.codec_ = lod_block::CODEC_ZLIB;
+       lod_blocks.reserved_ = 0;
+       lod_blocks.num_blocks_ = bvh.get_num_nodes();
+       for (uint32_t node_id = 0; node_id < bvh.get_num_nodes(); ++node_id) {
+           lod_blocks.block_offsets_.push_back(bvh.get_lod_block_offset(node_id));
+       }
+       lod_blocks.block_offsets_.push_back(bvh.get_lod_block_offset(bvh.get_num_nodes() - 1) +
+                                           bvh.get_lod_block_size(bvh.get_num_nodes() - 1));
+
+       write(lod_blocks);
+   }
+
    close_stream(false);
 
 }
@@ -16,7 +16,7 @@ namespace ren
 
 cache::
 cache(const slot_t num_slots)
-    : num_slots_(num_slots), slot_size_(0) {
+    : num_slots_(num_slots), slot_size_(0), num_hits_(0), num_misses_(0) {
     model_database* database = model_database::get_instance();
 
     slot_size_ = database->get_slot_size();
@@ -36,6 +36,17 @@ is_node_resident(const model_t model_id, const node_t node_id) {
     return index_->is_node_indexed(model_id, node_id);
 }
 
+const bool cache::
+request_node(const model_t model_id, const node_t node_id) {
+    if (index_->is_node_indexed(model_id, node_id)) {
+        num_hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    num_misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
 const slot_t cache::
 num_free_slots() {
     return index_->num_free_slots();
@@ -6,6 +6,11 @@
 // http://www.uni-weimar.de/medien/vr
 
 #include <lamure/ren/cache_queue.h>
+#include <lamure/ren/config.h>
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
 
 namespace lamure
 {
@@ -15,8 +20,7 @@ namespace ren
 
 cache_queue::
 cache_queue()
-: num_slots_(0),
-  num_models_(0),
+: num_models_(0),
   mode_(update_mode::UPDATE_NEVER),
   initialized_(false) {
 
@@ -29,24 +33,36 @@ cache_queue::
 
 const size_t cache_queue::
 num_jobs() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return num_slots_;
+    size_t num_jobs = 0;
+    for (const auto& shard : shards_) {
+        num_jobs += shard->num_jobs_.load(std::memory_order_relaxed);
+    }
+    return num_jobs;
+}
+
+cache_queue::shard& cache_queue::
+get_shard(const model_t model_id, const node_t node_id) {
+    // blocks of adjacent nodes share a shard, so that siblings
+    // can still be coalesced by collect_adjacent_jobs
+    size_t block_id = node_id / LAMURE_CUT_UPDATE_MAX_COALESCED_JOBS;
+    return *shards_[(block_id + (size_t)model_id * 7919) % shards_.size()];
 }
 
 const cache_queue::query_result cache_queue::
 is_node_indexed(const model_t model_id, const node_t node_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     assert(initialized_);
     assert(model_id < num_models_);
 
+    shard& shard = get_shard(model_id, node_id);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+
     query_result result = query_result::NOT_INDEXED;
 
-    if (requested_set_[model_id].find(node_id) != requested_set_[model_id].end()) {
+    if (shard.requested_set_[model_id].find(node_id) != shard.requested_set_[model_id].end()) {
         result = query_result::INDEXED_AS_LOADING;
 
         if (mode_ != update_mode::UPDATE_NEVER) {
-            if (pending_set_[model_id].find(node_id) == pending_set_[model_id].end()) {
+            if (shard.pending_set_[model_id].find(node_id) == shard.pending_set_[model_id].end()) {
                 result = query_result::INDEXED_AS_WAITING;
             }
         }
@@ -56,18 +72,25 @@ is_node_indexed(const model_t model_id, const node_t node_id) {
 }
 
 void cache_queue::
-initialize(const update_mode mode, const model_t num_models) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
+initialize(const update_mode mode, const model_t num_models, const size_t num_shards) {
     assert(!initialized_);
+    assert(num_shards > 0);
 
     mode_ = mode;
     num_models_ = num_models;
 
-    requested_set_.resize(num_models_);
+    for (size_t shard_id = 0; shard_id < num_shards; ++shard_id) {
+        shards_.push_back(std::unique_ptr<shard>(new shard()));
+        shard& shard = *shards_.back();
 
-    if (mode_ != update_mode::UPDATE_NEVER) {
-        pending_set_.resize(num_models_);
+        shard.num_slots_ = 0;
+        shard.requested_set_.resize(num_models_);
+
+        if (mode_ != update_mode::UPDATE_NEVER) {
+            shard.pending_set_.resize(num_models_);
+        }
+
+        shard.publish();
     }
 
     initialized_ = true;
@@ -75,18 +98,20 @@ initialize(const update_mode mode, const model_t num_models) {
 
 bool cache_queue::
 push_job(const job& job) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     assert(initialized_);
     assert(job.model_id_ < num_models_);
 
-    if (requested_set_[job.model_id_].find(job.node_id_) == requested_set_[job.model_id_].end()) {
-        slots_.push_back(job);
-        requested_set_[job.model_id_][job.node_id_] = num_slots_;
+    shard& shard = get_shard(job.model_id_, job.node_id_);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+
+    if (shard.requested_set_[job.model_id_].find(job.node_id_) == shard.requested_set_[job.model_id_].end()) {
+        shard.slots_.push_back(job);
+        shard.requested_set_[job.model_id_][job.node_id_] = shard.num_slots_;
 
-        ++num_slots_;
+        ++shard.num_slots_;
 
-        shuffle_up(num_slots_-1);
+        shard.shuffle_up(shard.num_slots_-1);
+        shard.publish();
 
         return true;
     }
@@ -97,23 +122,42 @@ push_job(const job& job) {
 
 const cache_queue::job cache_queue::
 top_job() {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     job job;
 
-    if (num_slots_ > 0) {
-        job = slots_.front();
+    // a shard may be emptied by another thread between selecting and
+    // locking it, in that case select again
+    for (size_t attempt = 0; attempt < shards_.size(); ++attempt) {
+        shard* best_shard = nullptr;
+        int32_t best_priority = std::numeric_limits<int32_t>::min();
 
-        if (mode_ != update_mode::UPDATE_NEVER) {
-            pending_set_[job.model_id_].insert(job.node_id_);
+        for (const auto& shard : shards_) {
+            if (shard->num_jobs_.load(std::memory_order_acquire) == 0) {
+                continue;
+            }
+            int32_t priority = shard->top_priority_.load(std::memory_order_relaxed);
+            if (best_shard == nullptr || priority > best_priority) {
+                best_shard = shard.get();
+                best_priority = priority;
+            }
         }
 
-        swap(0, num_slots_-1);
-        slots_.pop_back();
+        if (best_shard == nullptr) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(best_shard->mutex_);
 
-        --num_slots_;
+        if (best_shard->num_slots_ > 0) {
+            job = best_shard->slots_.front();
 
-        shuffle_down(0);
+            if (mode_ != update_mode::UPDATE_NEVER) {
+                best_shard->pending_set_[job.model_id_].insert(job.node_id_);
+            }
+
+            best_shard->remove(0);
+            best_shard->publish();
+            break;
+        }
     }
 
     return job;
@@ -121,17 +165,18 @@ top_job() {
 
 void cache_queue::
 pop_job(const job& job) {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     assert(job.model_id_ < num_models_);
 
-    requested_set_[job.model_id_].erase(job.node_id_);
+    shard& shard = get_shard(job.model_id_, job.node_id_);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+
+    shard.requested_set_[job.model_id_].erase(job.node_id_);
 
     if (mode_ != update_mode::UPDATE_NEVER) {
-        assert(pending_set_[job.model_id_].find(job.node_id_) != pending_set_[job.model_id_].end());
+        assert(shard.pending_set_[job.model_id_].find(job.node_id_) != shard.pending_set_[job.model_id_].end());
 
-        if (pending_set_[job.model_id_].find(job.node_id_) != pending_set_[job.model_id_].end()) {
-            pending_set_[job.model_id_].erase(job.node_id_);
+        if (shard.pending_set_[job.model_id_].find(job.node_id_) != shard.pending_set_[job.model_id_].end()) {
+            shard.pending_set_[job.model_id_].erase(job.node_id_);
         }
     }
 }
@@ -142,37 +187,132 @@ update_job(const model_t model_id, const node_t node_id, int32_t priority) {
         return;
     }
 
-    std::lock_guard<std::mutex> lock(mutex_);
-
     assert(model_id < num_models_);
 
-    if (pending_set_[model_id].find(node_id) != pending_set_[model_id].end()) {
+    shard& shard = get_shard(model_id, node_id);
+    std::lock_guard<std::mutex> lock(shard.mutex_);
+
+    if (shard.pending_set_[model_id].find(node_id) != shard.pending_set_[model_id].end()) {
         return;
     }
 
-    const auto it = requested_set_[model_id].find(node_id);
+    const auto it = shard.requested_set_[model_id].find(node_id);
 
     //assert(it != requested_set_[model_id].end());
 
-    if (it == requested_set_[model_id].end()) {
+    if (it == shard.requested_set_[model_id].end()) {
         return;
     }
 
     size_t slot_id = it->second;
 
-    if (priority < slots_[slot_id].priority_) {
+    if (priority < shard.slots_[slot_id].priority_) {
         if (mode_ == update_mode::UPDATE_ALWAYS || mode_ == update_mode::UPDATE_DECREMENT_ONLY) {
-            slots_[slot_id].priority_ = priority;
-            shuffle_down(slot_id);
+            shard.slots_[slot_id].priority_ = priority;
+            shard.shuffle_down(slot_id);
         }
     }
-    else if (priority > slots_[slot_id].priority_) {
+    else if (priority > shard.slots_[slot_id].priority_) {
         if (mode_ == update_mode::UPDATE_ALWAYS || mode_ == update_mode::UPDATE_INCREMENT_ONLY) {
-            slots_[slot_id].priority_ = priority;
-            shuffle_up(slot_id);
+            shard.slots_[slot_id].priority_ = priority;
+            shard.shuffle_up(slot_id);
+        }
+    }
+
+    shard.publish();
+}
+
+void cache_queue::
+collect_prefetch_jobs(const size_t max_num_jobs, std::vector<job>& jobs) {
+    jobs.clear();
+
+    // visit shards in the order of their top priority
+    std::vector<std::pair<int32_t, shard*>> order;
+    for (const auto& shard : shards_) {
+        if (shard->num_jobs_.load(std::memory_order_acquire) > 0) {
+            order.push_back(std::make_pair(shard->top_priority_.load(std::memory_order_relaxed), shard.get()));
+        }
+    }
+    std::sort(order.begin(), order.end(),
+        [](const std::pair<int32_t, shard*>& lhs, const std::pair<int32_t, shard*>& rhs) { return lhs.first > rhs.first; });
+
+    for (const auto& entry : order) {
+        if (jobs.size() >= max_num_jobs) {
+            break;
         }
+
+        shard& shard = *entry.second;
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+
+        size_t num_candidates = std::min(shard.num_slots_, max_num_jobs - jobs.size());
+        for (size_t slot_id = 0; slot_id < num_candidates; ++slot_id) {
+            if (!shard.slots_[slot_id].prefetched_) {
+                shard.slots_[slot_id].prefetched_ = true;
+                jobs.push_back(shard.slots_[slot_id]);
+            }
+        }
+    }
+}
+
+void cache_queue::
+collect_adjacent_jobs(const job& first_job, const size_t max_num_jobs, std::vector<job>& jobs) {
+    jobs.clear();
+    jobs.push_back(first_job);
+
+    // walk towards lower node ids first, then towards higher ones
+    job adjacent_job;
+    node_t node_id = first_job.node_id_;
+    while (jobs.size() < max_num_jobs && node_id > 0) {
+        --node_id;
+        shard& shard = get_shard(first_job.model_id_, node_id);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        if (!take_waiting_job(shard, first_job.model_id_, node_id, adjacent_job)) {
+            break;
+        }
+        jobs.push_back(adjacent_job);
+    }
+
+    std::reverse(jobs.begin(), jobs.end());
+
+    node_id = first_job.node_id_;
+    while (jobs.size() < max_num_jobs) {
+        ++node_id;
+        shard& shard = get_shard(first_job.model_id_, node_id);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        if (!take_waiting_job(shard, first_job.model_id_, node_id, adjacent_job)) {
+            break;
+        }
+        jobs.push_back(adjacent_job);
+    }
+}
+
+bool cache_queue::
+take_waiting_job(shard& shard, const model_t model_id, const node_t node_id, job& job) {
+    const auto it = shard.requested_set_[model_id].find(node_id);
+
+    if (it == shard.requested_set_[model_id].end()) {
+        return false;
     }
 
+    // jobs that were handed out keep their entry in requested_set_
+    // until pop_job, but no longer occupy a heap slot
+    size_t slot_id = it->second;
+    if (slot_id >= shard.num_slots_
+        || shard.slots_[slot_id].model_id_ != model_id
+        || shard.slots_[slot_id].node_id_ != node_id) {
+        return false;
+    }
+
+    job = shard.slots_[slot_id];
+
+    if (mode_ != update_mode::UPDATE_NEVER) {
+        shard.pending_set_[model_id].insert(node_id);
+    }
+
+    shard.remove(slot_id);
+    shard.publish();
+
+    return true;
 }
 
 const cache_queue::abort_result cache_queue::
@@ -180,19 +320,18 @@ abort_job(const job& job) {
     abort_result result = abort_result::ABORT_FAILED;
 
     if (mode_ != update_mode::UPDATE_NEVER) {
-        std::lock_guard<std::mutex> lock(mutex_);
+        shard& shard = get_shard(job.model_id_, job.node_id_);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
 
-        const auto it = requested_set_[job.model_id_].find(job.node_id_);
+        const auto it = shard.requested_set_[job.model_id_].find(job.node_id_);
 
-        if (it != requested_set_[job.model_id_].end()) {
-            if (pending_set_[job.model_id_].find(job.node_id_) == pending_set_[job.model_id_].end()) {
+        if (it != shard.requested_set_[job.model_id_].end()) {
+            if (shard.pending_set_[job.model_id_].find(job.node_id_) == shard.pending_set_[job.model_id_].end()) {
                 size_t slot_id = it->second;
 
-                swap(slot_id, num_slots_-1);
-                slots_.pop_back();
-                --num_slots_;
-                shuffle_down(slot_id);
-                requested_set_[job.model_id_].erase(job.node_id_);
+                shard.remove(slot_id);
+                shard.requested_set_[job.model_id_].erase(job.node_id_);
+                shard.publish();
 
                 result = abort_result::ABORT_SUCCESS;
             }
@@ -202,7 +341,26 @@ abort_job(const job& job) {
     return result;
 }
 
-void cache_queue::
+void cache_queue::shard::
+remove(const size_t slot_id) {
+    swap(slot_id, num_slots_-1);
+    slots_.pop_back();
+    --num_slots_;
+
+    if (slot_id < num_slots_) {
+        shuffle_up(slot_id);
+        shuffle_down(slot_id);
+    }
+}
+
+void cache_queue::shard::
+publish() {
+    top_priority_.store(num_slots_ > 0 ? slots_.front().priority_ : std::numeric_limits<int32_t>::min(),
+                        std::memory_order_relaxed);
+    num_jobs_.store(num_slots_, std::memory_order_release);
+}
+
+void cache_queue::shard::
 swap(const size_t slot_id_0, const size_t slot_id_1) {
     job& job0 = slots_[slot_id_0];
     job& job1 = slots_[slot_id_1];
@@ -212,7 +370,7 @@ swap(const size_t slot_id_0, const size_t slot_id_1) {
     std::swap(slots_[slot_id_0], slots_[slot_id_1]);
 }
 
-void cache_queue::
+void cache_queue::shard::
 shuffle_up(const size_t slot_id) {
     if (slot_id == 0) {
         return;
@@ -229,7 +387,7 @@ shuffle_up(const size_t slot_id) {
     shuffle_up(parent_slot_id);
 }
 
-void cache_queue::
+void cache_queue::shard::
 shuffle_down(const size_t slot_id) {
     size_t left_child_id = slot_id*2 + 1;
     size_t right_child_id = slot_id*2 + 2;
@@ -261,4 +419,3 @@ shuffle_down(const size_t slot_id) {
 } // namespace ren
 
 } // namespace lamure
-
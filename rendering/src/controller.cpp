@@ -369,6 +369,18 @@ const bool controller::is_cut_update_in_progress(const context_t context_id)
     return true;
 }
 
+const cut_update_pool::statistics controller::get_cut_update_statistics(const context_t context_id)
+{
+    auto cut_update_it = cut_update_pools_.find(context_id);
+
+    if(cut_update_it == cut_update_pools_.end())
+    {
+        return cut_update_pool::statistics();
+    }
+
+    return cut_update_it->second->get_statistics();
+}
+
 void controller::dispatch(const context_t context_id, scm::gl::render_device_ptr device, Data_Provenance const &data_provenance)
 {
     auto gpu_context_it = gpu_contexts_.find(context_id);
@@ -494,6 +506,61 @@ void controller::dispatch(const context_t context_id, scm::gl::render_device_ptr
     }
 }
 
+void controller::dispatch_host(const context_t context_id)
+{
+    auto gpu_context_it = gpu_contexts_.find(context_id);
+
+    if(gpu_context_it == gpu_contexts_.end())
+    {
+        throw std::runtime_error("lamure: controller::Gpu Context not found for context: " + context_id);
+    }
+
+    auto cut_update_it = cut_update_pools_.find(context_id);
+
+    if(cut_update_it != cut_update_pools_.end())
+    {
+        gpu_context *ctx = gpu_context_it->second;
+        if(!ctx->is_host_only())
+        {
+            throw std::runtime_error("lamure: controller::Gpu Context is not a host context: " + context_id);
+        }
+
+        lamure::ren::cut_database *cuts = lamure::ren::cut_database::get_instance();
+        cuts->swap(context_id);
+
+        cut_update_it->second->dispatch_cut_update(ctx->get_fix_a().fix_buffer_, ctx->get_fix_b().fix_buffer_, nullptr, nullptr);
+
+        if(cuts->is_front_modified(context_id))
+        {
+            cut_database_record::temporary_buffer current = cuts->get_buffer(context_id);
+
+            if(ctx->update_primary_buffer_host(current))
+            {
+                ms_since_last_node_upload_ = 0;
+            }
+
+            cuts->signal_upload_complete(context_id);
+        }
+    }
+    else
+    {
+        gpu_context *ctx = gpu_context_it->second;
+        if(!ctx->is_created())
+        {
+            ctx->create_host();
+        }
+
+        cut_update_pools_[context_id] = new cut_update_pool(context_id, ctx->upload_budget_in_nodes(), ctx->render_budget_in_nodes());
+        dispatch_host(context_id);
+    }
+
+    {
+        auto const &current_time_stamp = std::chrono::system_clock::now();
+        ms_since_last_node_upload_ += (std::chrono::duration_cast<std::chrono::duration<int, std::milli>>(current_time_stamp - latest_timestamp_).count());
+        latest_timestamp_ = current_time_stamp;
+    }
+}
+
 const bool controller::is_model_present(const gua_model_desc_t model_desc) { return model_map_.find(model_desc) != model_map_.end(); }
 
 scm::gl::buffer_ptr controller::get_context_buffer(const context_t context_id, scm::gl::render_device_ptr device)
@@ -544,6 +611,18 @@ scm::gl::vertex_array_ptr controller::get_context_memory(const context_t context
     return gpu_context_it->second->get_context_memory(type, device, data_provenance);
 }
 
+const char *controller::get_context_host_memory(const context_t context_id)
+{
+    auto gpu_context_it = gpu_contexts_.find(context_id);
+
+    if(gpu_context_it == gpu_contexts_.end())
+    {
+        throw std::runtime_error("lamure: controller::Gpu Context not found for context: " + context_id);
+    }
+
+    return gpu_context_it->second->get_host_primary_buffer();
+}
+
 } // namespace ren
 
 } // namespace lamure
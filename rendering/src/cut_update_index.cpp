@@ -7,6 +7,8 @@
 
 #include <lamure/ren/cut_update_index.h>
 
+#include <functional>
+
 namespace lamure
 {
 
@@ -26,13 +28,9 @@ cut_update_index()
 
     for (int32_t queue_id = 0; queue_id < queue_t::NUM_QUEUES; ++queue_id) {
         num_slots_[queue_id] = 0;
-        slot_maps_[queue_id].resize(num_models_);
     }
 
-    for (const auto& view_id : view_ids_) {
-        front_a_cuts_[view_id].resize(num_models_);
-        front_b_cuts_[view_id].resize(num_models_);
-    }
+    resize_fronts();
 
     for (model_t model_id = 0; model_id < num_models_; ++model_id) {
         fan_factor_table_.push_back(database->get_model(model_id)->get_bvh()->get_fan_factor());
@@ -68,15 +66,11 @@ update_policy(const view_t num_views) {
         for (int32_t queue_id = 0; queue_id < queue_t::NUM_QUEUES; ++queue_id) {
             num_slots_[queue_id] = 0;
             slot_maps_[queue_id].clear();
-            slot_maps_[queue_id].resize(num_models_);
         }
 
-        for (const auto& view_id : view_ids_) {
-            front_a_cuts_[view_id].clear();
-            front_a_cuts_[view_id].resize(num_models_);
-            front_b_cuts_[view_id].clear();
-            front_b_cuts_[view_id].resize(num_models_);
-        }
+        front_a_cuts_.clear();
+        front_b_cuts_.clear();
+        resize_fronts();
 
         fan_factor_table_.clear();
         num_nodes_table_.clear();
@@ -88,10 +82,7 @@ update_policy(const view_t num_views) {
 
     }
     else if (num_views_ > prev_num_views) {
-        for (const auto& view_id : view_ids_) {
-            front_a_cuts_[view_id].resize(num_models_);
-            front_b_cuts_[view_id].resize(num_models_);
-        }
+        resize_fronts();
     }
 
 
@@ -120,50 +111,28 @@ num_actions(const queue_t queue) {
     return num_slots_[queue];
 }
 
-const std::set<node_t>& cut_update_index::
+const flat_cut& cut_update_index::
 get_current_cut(const view_t view_id, const model_t model_id) {
     std::lock_guard<std::mutex> lock(mutex_);
 
     assert(view_ids_.find(view_id) != view_ids_.end());
     assert(model_id < num_models_);
 
-    switch (current_cut_front_) {
-        case cut_front::FRONT_A:
-            return front_a_cuts_[view_id][model_id];
-            break;
-
-        case cut_front::FRONT_B:
-            return front_b_cuts_[view_id][model_id];
-            break;
-
-        default: break;
+    //the current front is filled in approval order, callers iterate it sorted
+    flat_cut& cut = current_front(view_id, model_id);
+    cut.sort();
 
-    }
-
-    return front_a_cuts_[view_id][model_id];
+    return cut;
 }
 
-const std::set<node_t>& cut_update_index::
+const flat_cut& cut_update_index::
 get_previous_cut(const view_t view_id, const model_t model_id) {
     std::lock_guard<std::mutex> lock(mutex_);
 
     assert(view_ids_.find(view_id) != view_ids_.end());
     assert(model_id < num_models_);
 
-    switch (current_cut_front_) {
-        case cut_front::FRONT_A:
-            return front_b_cuts_[view_id][model_id];
-            break;
-
-        case cut_front::FRONT_B:
-            return front_a_cuts_[view_id][model_id];
-            break;
-
-        default: break;
-
-    }
-
-    return front_b_cuts_[view_id][model_id];
+    return previous_front(view_id, model_id);
 }
 
 void cut_update_index::
@@ -177,6 +146,14 @@ swap_cuts() {
         current_cut_front_ = cut_front::FRONT_A;
     }
 
+    //the previous front is read concurrently by the analysis tasks,
+    //bring it into node order once before they start
+    for (const auto& view_id : view_ids_) {
+        for (model_t model_id = 0; model_id < num_models_; ++model_id) {
+            previous_front(view_id, model_id).sort();
+        }
+    }
+
 }
 
 void cut_update_index::
@@ -186,19 +163,37 @@ reset_cut(const view_t view_id, const model_t model_id) {
     assert(view_ids_.find(view_id) != view_ids_.end());
     assert(model_id < num_models_);
 
-    switch (current_cut_front_) {
-        case cut_front::FRONT_A:
-            front_a_cuts_[view_id][model_id].clear();
-            break;
+    current_front(view_id, model_id).clear();
 
-        case cut_front::FRONT_B:
-            front_b_cuts_[view_id][model_id].clear();
-            break;
+}
 
-        default: break;
+flat_cut& cut_update_index::
+current_front(const view_t view_id, const model_t model_id) {
+    if (current_cut_front_ == cut_front::FRONT_B) {
+        return front_b_cuts_[view_id][model_id];
+    }
 
+    return front_a_cuts_[view_id][model_id];
+}
+
+flat_cut& cut_update_index::
+previous_front(const view_t view_id, const model_t model_id) {
+    if (current_cut_front_ == cut_front::FRONT_B) {
+        return front_a_cuts_[view_id][model_id];
     }
 
+    return front_b_cuts_[view_id][model_id];
+}
+
+void cut_update_index::
+resize_fronts() {
+    front_a_cuts_.resize(num_views_);
+    front_b_cuts_.resize(num_views_);
+
+    for (view_t view_id = 0; view_id < num_views_; ++view_id) {
+        front_a_cuts_[view_id].resize(num_models_);
+        front_b_cuts_[view_id].resize(num_models_);
+    }
 }
 
 void cut_update_index::
@@ -212,6 +207,19 @@ push_action(const action& action, bool sort) {
     add_action(action, sort);
 }
 
+void cut_update_index::
+push_actions(const std::vector<action>& actions) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const auto& action : actions) {
+        assert(action.model_id_ < num_models_);
+        assert(action.node_id_ < num_nodes_table_[action.model_id_]);
+        assert(action.queue_ < queue_t::NUM_QUEUES);
+
+        add_action(action, false);
+    }
+}
+
 const cut_update_index::action cut_update_index::
 front_action(const queue_t queue) {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -255,19 +263,15 @@ pop_front_action(const queue_t queue) {
     swap(queue, 0, num_slots_[queue]-1);
 
 
-    assert(slot_maps_[queue][action.model_id_][action.node_id_].find(num_slots_[queue]-1) != slot_maps_[queue][action.model_id_][action.node_id_].end());
+    assert(slot_maps_[queue].contains(action.model_id_, action.node_id_, num_slots_[queue]-1));
 
     slots_[queue].pop_back();
-    slot_maps_[queue][action.model_id_][action.node_id_].erase(num_slots_[queue]-1);
+    slot_maps_[queue].erase(action.model_id_, action.node_id_, num_slots_[queue]-1);
 
     --num_slots_[queue];
 
     shuffle_down(queue, 0);
 
-    if (slot_maps_[queue][action.model_id_][action.node_id_].empty()) {
-        slot_maps_[queue][action.model_id_].erase(action.node_id_);
-    }
-
 }
 
 void cut_update_index::
@@ -280,18 +284,14 @@ Popback_action(const queue_t queue) {
     action action = slots_[queue].back();
     assert(action.queue_ == queue);
 
-    assert(slot_maps_[queue][action.model_id_][action.node_id_].find(num_slots_[queue]-1) != slot_maps_[queue][action.model_id_][action.node_id_].end());
+    assert(slot_maps_[queue].contains(action.model_id_, action.node_id_, num_slots_[queue]-1));
 
 
     slots_[queue].pop_back();
-    slot_maps_[queue][action.model_id_][action.node_id_].erase(num_slots_[queue]-1);
+    slot_maps_[queue].erase(action.model_id_, action.node_id_, num_slots_[queue]-1);
 
     --num_slots_[queue];
 
-    if (slot_maps_[queue][action.model_id_][action.node_id_].empty()) {
-        slot_maps_[queue][action.model_id_].erase(action.node_id_);
-    }
-
 }
 
 void cut_update_index::
@@ -495,7 +495,7 @@ add_action(const action& action, bool sort) {
         slots_[action.queue_].push_back(action);
         ++num_slots_[action.queue_];
 
-        slot_maps_[action.queue_][action.model_id_][action.node_id_].insert(num_slots_[action.queue_]-1);
+        slot_maps_[action.queue_].insert(action.model_id_, action.node_id_, num_slots_[action.queue_]-1);
 
         shuffle_up(action.queue_, num_slots_[action.queue_]-1);
 
@@ -514,81 +514,52 @@ cancel_action(const view_t view_id, const model_t model_id, const node_t node_id
 
     //firstly, cancel actions that already happened (remove nodes from cuts)
 
-    switch (current_cut_front_) {
-        case cut_front::FRONT_A:
-            if (front_a_cuts_[view_id][model_id].find(node_id) != front_a_cuts_[view_id][model_id].end()) {
-                front_a_cuts_[view_id][model_id].erase(node_id);
-            }
-            break;
-
-        case cut_front::FRONT_B:
-            if (front_b_cuts_[view_id][model_id].find(node_id) != front_b_cuts_[view_id][model_id].end()) {
-                front_b_cuts_[view_id][model_id].erase(node_id);
-            }
-            break;
-
-        default: break;
-
-    }
+    current_front(view_id, model_id).erase(node_id);
 
     //secondly, cancel all pending actions (remove actions from queues)
 
+    std::vector<slot_t> slot_ids;
+
     for (uint32_t queue = 0; queue < queue_t::NUM_QUEUES; ++queue) {
-        const auto slot_it = slot_maps_[queue][model_id].find(node_id);
+        slot_ids.clear();
+        slot_maps_[queue].find(model_id, node_id, slot_ids);
 
-        if (slot_it == slot_maps_[queue][model_id].end()) {
+        if (slot_ids.empty()) {
             continue;
         }
 
-        assert(slot_it != slot_maps_[queue][model_id].end());
-
-        std::set<slot_t> slot_ids = slot_it->second; //copy
-
-        std::set<slot_t>::iterator it = std::prev(slot_ids.end());
-
-        while (true) {
-            std::set<slot_t>::iterator current_it = it--;
+        //process back to front, like the ordered set did
+        std::sort(slot_ids.begin(), slot_ids.end(), std::greater<slot_t>());
 
-            slot_t slot_id = *(current_it);
+        for (const auto slot_id : slot_ids) {
 
             if (slots_[queue][slot_id].view_id_ == view_id) {
 
                 action current_item = slots_[queue][slot_id];
                 action last_item = slots_[queue][num_slots_[queue]-1];
 
-                assert(slot_maps_[queue][current_item.model_id_][current_item.node_id_].find(slot_id) != slot_maps_[queue][current_item.model_id_][current_item.node_id_].end());
-                assert(slot_maps_[queue][last_item.model_id_][last_item.node_id_].find(num_slots_[queue]-1) != slot_maps_[queue][last_item.model_id_][last_item.node_id_].end());
+                assert(slot_maps_[queue].contains(current_item.model_id_, current_item.node_id_, slot_id));
+                assert(slot_maps_[queue].contains(last_item.model_id_, last_item.node_id_, num_slots_[queue]-1));
 
                 assert(current_item.queue_ == queue);
                 assert(current_item.model_id_ == model_id);
                 assert(current_item.node_id_ == node_id);
                 assert(last_item.queue_ == queue);
 
-                slot_maps_[queue][current_item.model_id_][current_item.node_id_].erase(slot_id);
-                slot_maps_[queue][last_item.model_id_][last_item.node_id_].erase(num_slots_[queue]-1);
+                swap((queue_t)queue, slot_id, num_slots_[queue]-1);
 
-                slot_maps_[queue][current_item.model_id_][current_item.node_id_].insert(num_slots_[queue]-1);
-                slot_maps_[queue][last_item.model_id_][last_item.node_id_].insert(slot_id);
-
-                std::swap(slots_[queue][slot_id], slots_[queue][num_slots_[queue]-1]);
-
-                slot_maps_[queue][current_item.model_id_][current_item.node_id_].erase(num_slots_[queue]-1);
+                slot_maps_[queue].erase(current_item.model_id_, current_item.node_id_, num_slots_[queue]-1);
 
                 slots_[queue].pop_back();
 
                 --num_slots_[queue];
 
-                shuffle_down((queue_t)queue, slot_id);
+                if (slot_id < num_slots_[queue]) {
+                    shuffle_down((queue_t)queue, slot_id);
+                }
 
             }
 
-            if (current_it == slot_ids.begin()) {
-                break;
-            }
-        }
-
-        if (slot_maps_[queue][model_id][node_id].empty()) {
-            slot_maps_[queue][model_id].erase(node_id);
         }
     }
 
@@ -603,7 +574,7 @@ sort() {
         slots_[action.queue_].push_back(action);
         ++num_slots_[action.queue_];
 
-        slot_maps_[action.queue_][action.model_id_][action.node_id_].insert(num_slots_[action.queue_]-1);
+        slot_maps_[action.queue_].insert(action.model_id_, action.node_id_, num_slots_[action.queue_]-1);
 
         shuffle_up(action.queue_, num_slots_[action.queue_]-1);
 
@@ -621,15 +592,14 @@ swap(const queue_t queue, const size_t slot_id_0, const size_t slot_id_1) {
     action& item1 = slots_[queue][slot_id_1];
 
 
-    assert(slot_maps_[queue][item0.model_id_][item0.node_id_].find(slot_id_0) != slot_maps_[queue][item0.model_id_][item0.node_id_].end());
-    assert(slot_maps_[queue][item1.model_id_][item1.node_id_].find(slot_id_1) != slot_maps_[queue][item1.model_id_][item1.node_id_].end());
-
+    assert(slot_maps_[queue].contains(item0.model_id_, item0.node_id_, slot_id_0));
+    assert(slot_maps_[queue].contains(item1.model_id_, item1.node_id_, slot_id_1));
 
-    slot_maps_[queue][item0.model_id_][item0.node_id_].erase(slot_id_0);
-    slot_maps_[queue][item1.model_id_][item1.node_id_].erase(slot_id_1);
-
-    slot_maps_[queue][item0.model_id_][item0.node_id_].insert(slot_id_1);
-    slot_maps_[queue][item1.model_id_][item1.node_id_].insert(slot_id_0);
+    //both slots already belong to the same node, its slot set is unchanged
+    if (item0.model_id_ != item1.model_id_ || item0.node_id_ != item1.node_id_) {
+        slot_maps_[queue].replace(item0.model_id_, item0.node_id_, slot_id_0, slot_id_1);
+        slot_maps_[queue].replace(item1.model_id_, item1.node_id_, slot_id_1, slot_id_0);
+    }
 
     std::swap(slots_[queue][slot_id_0], slots_[queue][slot_id_1]);
 }
@@ -92,7 +92,14 @@ void cut_update_pool::initialize(bool provenance)
     semaphore_.set_max_signal_count(1);
     semaphore_.set_min_signal_count(1);
 
-    
+    statistics_ = statistics();
+
+#ifdef LAMURE_CUT_UPDATE_ENABLE_MEASURE_CUT_ANALYSIS
+    analysis_task_time_ = 0;
+    analysis_num_nodes_ = 0;
+    analysis_wall_time_ = 0;
+    analysis_num_updates_ = 0;
+#endif
 
 #ifdef LAMURE_ENABLE_INFO
     std::cout << "lamure: num models: " << index_->num_models() << std::endl;
@@ -135,6 +142,19 @@ const bool cut_update_pool::is_running()
     return master_dispatched_;
 }
 
+const cut_update_pool::statistics cut_update_pool::get_statistics()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    statistics result = statistics_;
+    if(gpu_cache_ != nullptr)
+    {
+        result.gpu_cache_hits_ = gpu_cache_->num_hits();
+        result.gpu_cache_misses_ = gpu_cache_->num_misses();
+    }
+    return result;
+}
+
 void cut_update_pool::dispatch_cut_update(char *current_gpu_storage_A, char *current_gpu_storage_B, char *current_gpu_storage_A_provenance, char *current_gpu_storage_B_provenance)
 {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -187,7 +207,8 @@ void cut_update_pool::run()
                 break;
 
             case cut_update_queue::task_t::CUT_ANALYSIS_TASK:
-                cut_analysis(job.view_id_, job.model_id_);
+                cut_analysis_worker(next_analysis_worker_++);
+                master_semaphore_.signal(1);
                 break;
 
             case cut_update_queue::task_t::CUT_UPDATE_TASK:
@@ -313,6 +334,8 @@ const bool cut_update_pool::prepare()
 
 void cut_update_pool::cut_master()
 {
+    master_start_ = std::chrono::steady_clock::now();
+
     if(!prepare())
     {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -373,35 +396,75 @@ void cut_update_pool::cut_master()
         assert(semaphore_.num_signals() == 0);
         assert(master_semaphore_.num_signals() == 0);
 
-        // re-configure semaphores
-        master_semaphore_.lock();
-        master_semaphore_.set_max_signal_count(index_->num_models() * index_->num_views());
-        master_semaphore_.set_min_signal_count(index_->num_models() * index_->num_views());
-        master_semaphore_.unlock();
+#ifdef LAMURE_CUT_UPDATE_ENABLE_MEASURE_CUT_ANALYSIS
+        boost::timer::cpu_timer analysis_timer;
+#endif
 
-        semaphore_.lock();
-        semaphore_.set_max_signal_count(index_->num_models() * index_->num_views());
-        semaphore_.set_min_signal_count(1);
-        semaphore_.unlock();
+        // split the previous cuts of all views and models into chunks
+        prepare_analysis();
 
-        // launch slaves
-        for(view_t view_id = 0; view_id < index_->num_views(); ++view_id)
+        size_t num_helpers = std::min<size_t>(num_threads_ - 1, analysis_chunks_.size() > 0 ? analysis_chunks_.size() - 1 : 0);
+
+        analysis_queue_.reset(num_helpers + 1, analysis_chunks_.size());
+        next_analysis_worker_ = 1;
+
+        if(num_helpers > 0)
         {
-            for(model_t model_id = 0; model_id < index_->num_models(); ++model_id)
+            // re-configure semaphores
+            master_semaphore_.lock();
+            master_semaphore_.set_max_signal_count(num_helpers);
+            master_semaphore_.set_min_signal_count(num_helpers);
+            master_semaphore_.unlock();
+
+            semaphore_.lock();
+            semaphore_.set_max_signal_count(num_helpers);
+            semaphore_.set_min_signal_count(1);
+            semaphore_.unlock();
+
+            // launch slaves
+            for(size_t helper_id = 0; helper_id < num_helpers; ++helper_id)
             {
-                job_queue_.push_job(cut_update_queue::job(cut_update_queue::task_t::CUT_ANALYSIS_TASK, view_id, model_id));
+                job_queue_.push_job(cut_update_queue::job(cut_update_queue::task_t::CUT_ANALYSIS_TASK, invalid_view_t, invalid_model_t));
             }
+
+            semaphore_.signal(num_helpers);
         }
 
-        semaphore_.signal(index_->num_models() * index_->num_views());
+        // the master works on the analysis as well instead of idling
+        cut_analysis_worker(0);
 
-        master_semaphore_.wait();
-        if(is_shutdown())
-            return;
+        if(num_helpers > 0)
+        {
+            master_semaphore_.wait();
+            if(is_shutdown())
+                return;
+        }
+
+#ifdef LAMURE_CUT_UPDATE_ENABLE_MEASURE_CUT_ANALYSIS
+        analysis_wall_time_ += analysis_timer.elapsed().wall;
+
+        if(++analysis_num_updates_ >= LAMURE_CUT_UPDATE_MEASURE_CUT_ANALYSIS_INTERVAL)
+        {
+            std::cout << "lamure: cut analysis: " << (analysis_wall_time_ / analysis_num_updates_) / 1000.0 << " us wall, "
+                      << (analysis_task_time_ / analysis_num_updates_) / 1000.0 << " us in tasks, "
+                      << analysis_num_nodes_ / analysis_num_updates_ << " nodes per update" << std::endl;
+
+            analysis_wall_time_ = 0;
+            analysis_task_time_ = 0;
+            analysis_num_nodes_ = 0;
+            analysis_num_updates_ = 0;
+        }
+#endif
 
         assert(semaphore_.num_signals() == 0);
         assert(master_semaphore_.num_signals() == 0);
 
+        // merge in chunk order, the queues do not depend on which worker analysed which chunk
+        for(const auto &actions : analysis_results_)
+        {
+            index_->push_actions(actions);
+        }
+
         index_->sort();
 
         // re-configure semaphores
@@ -454,55 +517,150 @@ void cut_update_pool::cut_master()
 
         {
             std::lock_guard<std::mutex> lock(mutex_);
+            ++statistics_.num_cut_updates_;
+            statistics_.last_cut_update_in_us_ = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - master_start_).count();
+            statistics_.nodes_transferred_ += transfer_list_.size();
             master_dispatched_ = false;
         }
     }
 }
 
 
-void cut_update_pool::
-cut_analysis(view_t view_id, model_t model_id) {
+void cut_update_pool::prepare_analysis()
+{
+    model_database *database = model_database::get_instance();
 
-    lamure::pvs::pvs_database* pvs = lamure::pvs::pvs_database::get_instance();
+    analysis_contexts_.clear();
+    analysis_chunks_.clear();
 
-    assert(view_id != invalid_view_t);
-    assert(model_id != invalid_model_t);
-    assert(view_id < index_->num_views());
-    assert(model_id < index_->num_models());
+    for(view_t view_id = 0; view_id < index_->num_views(); ++view_id)
+    {
+        for(model_t model_id = 0; model_id < index_->num_models(); ++model_id)
+        {
+            analysis_context context;
+            context.view_id_ = view_id;
+            context.model_id_ = model_id;
 
-    scm::math::mat4f model_matrix;
+            scm::math::mat4f model_matrix;
 #ifdef LAMURE_CUT_UPDATE_ENABLE_MODEL_TIMEOUT
-    size_t freshness;
+            size_t freshness;
 #endif
-    scm::gl::frustum frustum;
+            node_evaluation_cache::parameters params;
 
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        model_matrix = model_transforms_[model_id];
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                model_matrix = model_transforms_[model_id];
 #ifdef LAMURE_CUT_UPDATE_ENABLE_MODEL_TIMEOUT
-        freshness = model_freshness_[model_id];
+                freshness = model_freshness_[model_id];
 #endif
-        frustum = user_cameras_[view_id].get_frustum_by_model(model_matrix);
-    }
+                const camera &user_camera = user_cameras_[view_id];
+                node_evaluation_cache::setup_parameters(params, user_camera.get_view_matrix(), user_camera.get_projection_matrix(), model_matrix,
+                                                        user_camera.near_plane_value(), height_divided_by_top_minus_bottoms_[view_id]);
+            }
+
+            // node errors and frustum visibility are evaluated on demand, once per update
+            const size_t context_id = analysis_contexts_.size();
+            if(node_caches_.size() <= context_id)
+            {
+                node_caches_.emplace_back(new node_evaluation_cache());
+            }
+            node_caches_[context_id]->begin_frame(database->get_model(model_id)->get_bvh(), params);
 
-    // perform cut analysis
-    std::set<node_t> old_cut = index_->get_previous_cut(view_id, model_id);
+            // the previous front stays untouched until the next swap, read it in place
+            context.old_cut_ = &index_->get_previous_cut(view_id, model_id);
 
-    index_->reset_cut(view_id, model_id);
+            index_->reset_cut(view_id, model_id);
 
-    uint32_t fan_factor = index_->fan_factor(model_id);
+            context.fan_factor_ = index_->fan_factor(model_id);
 
-    bool freshness_timeout = false;
+            context.freshness_timeout_ = false;
 #ifdef LAMURE_CUT_UPDATE_ENABLE_MODEL_TIMEOUT
-    freshness_timeout = cut_update_counter_ - freshness > LAMURE_CUT_UPDATE_MAX_MODEL_TIMEOUT;
+            context.freshness_timeout_ = cut_update_counter_ - freshness > LAMURE_CUT_UPDATE_MAX_MODEL_TIMEOUT;
+#endif
+
+            context.min_error_threshold_ = model_thresholds_[model_id] - 0.1f;
+            context.max_error_threshold_ = model_thresholds_[model_id] + 0.1f;
+
+            // chunk boundaries are moved past the end of a group of siblings,
+            // a sibling group is always analysed as a whole by one worker
+            const flat_cut &old_cut = *context.old_cut_;
+            const size_t num_cut_nodes = old_cut.size();
+
+            size_t first_node = 0;
+            while(first_node < num_cut_nodes)
+            {
+                size_t last_node = std::min<size_t>(first_node + LAMURE_CUT_UPDATE_ANALYSIS_CHUNK_SIZE, num_cut_nodes);
+
+                while(last_node < num_cut_nodes && index_->get_parent_id(model_id, old_cut[last_node]) == index_->get_parent_id(model_id, old_cut[last_node - 1]))
+                {
+                    ++last_node;
+                }
+
+                analysis_chunk chunk;
+                chunk.context_id_ = analysis_contexts_.size();
+                chunk.first_node_ = first_node;
+                chunk.last_node_ = last_node;
+                analysis_chunks_.push_back(chunk);
+
+                first_node = last_node;
+            }
+
+            analysis_contexts_.push_back(context);
+        }
+    }
+
+    // keep the per-chunk buffers around, their capacity is reused next update
+    if(analysis_results_.size() < analysis_chunks_.size())
+    {
+        analysis_results_.resize(analysis_chunks_.size());
+    }
+
+    for(auto &actions : analysis_results_)
+    {
+        actions.clear();
+    }
+}
+
+void cut_update_pool::cut_analysis_worker(const size_t worker_id)
+{
+    size_t chunk_id;
+
+    while(analysis_queue_.pop_task(worker_id, chunk_id))
+    {
+        cut_analysis(analysis_chunks_[chunk_id], analysis_results_[chunk_id]);
+    }
+}
+
+void cut_update_pool::
+cut_analysis(const analysis_chunk &chunk, std::vector<cut_update_index::action> &actions) {
+
+    lamure::pvs::pvs_database* pvs = lamure::pvs::pvs_database::get_instance();
+
+    const analysis_context &context = analysis_contexts_[chunk.context_id_];
+
+    const view_t view_id = context.view_id_;
+    const model_t model_id = context.model_id_;
+
+    assert(view_id < index_->num_views());
+    assert(model_id < index_->num_models());
+
+#ifdef LAMURE_CUT_UPDATE_ENABLE_MEASURE_CUT_ANALYSIS
+    boost::timer::cpu_timer analysis_timer;
 #endif
 
-    float min_error_threshold = model_thresholds_[model_id] - 0.1f;
-    float max_error_threshold = model_thresholds_[model_id] + 0.1f;
+    const flat_cut &old_cut = *context.old_cut_;
+    node_evaluation_cache &evaluation = *node_caches_[chunk.context_id_];
+
+    const uint32_t fan_factor = context.fan_factor_;
+    const bool freshness_timeout = context.freshness_timeout_;
+
+    const float min_error_threshold = context.min_error_threshold_;
+    const float max_error_threshold = context.max_error_threshold_;
 
     // cut analysis
-    std::set<node_t>::iterator cut_it;
-    for(cut_it = old_cut.begin(); cut_it != old_cut.end(); ++cut_it)
+    const flat_cut::const_iterator cut_end = old_cut.begin() + chunk.last_node_;
+    flat_cut::const_iterator cut_it;
+    for(cut_it = old_cut.begin() + chunk.first_node_; cut_it != cut_end; ++cut_it)
     {
         node_t node_id = *cut_it;
 
@@ -521,12 +679,12 @@ cut_analysis(view_t view_id, model_t model_id) {
         if (node_id > 0 && node_id < index_->num_nodes(model_id))
         {
             parent_id = index_->get_parent_id(model_id, node_id);
-            parent_error = calculate_node_error(view_id, model_id, parent_id);
+            parent_error = evaluation.node_error(parent_id);
 
             index_->get_all_siblings(model_id, node_id, siblings);
 
             all_siblings_in_cut = is_all_nodes_in_cut(model_id, siblings, old_cut);
-            no_sibling_in_frustum = !is_node_in_frustum(view_id, model_id, parent_id, frustum);
+            no_sibling_in_frustum = !evaluation.is_node_in_frustum(parent_id);
 
             // Check if no sibling is visible via PVS.
             for(node_t sibling_id : siblings)
@@ -541,8 +699,8 @@ cut_analysis(view_t view_id, model_t model_id) {
 
         if (!all_siblings_in_cut)
         {
-            float node_error = calculate_node_error(view_id, model_id, node_id);
-            bool node_in_frustum = is_node_in_frustum(view_id, model_id, node_id, frustum);
+            float node_error = evaluation.node_error(node_id);
+            bool node_in_frustum = evaluation.is_node_in_frustum(node_id);
 
             if (node_in_frustum && node_error > max_error_threshold && pvs->get_viewer_visibility(model_id, node_id))
             {
@@ -558,7 +716,7 @@ cut_analysis(view_t view_id, model_t model_id) {
                         break;
                     }
 
-                    float child_error = calculate_node_error(view_id, model_id, child_id);
+                    float child_error = evaluation.node_error(child_id);
                     if(child_error < min_error_threshold)
                     {
                         split = false;
@@ -568,16 +726,16 @@ cut_analysis(view_t view_id, model_t model_id) {
 
                 if (!split || freshness_timeout)
                 {
-                    index_->push_action(cut_update_index::action(cut_update_index::queue_t::KEEP, view_id, model_id, node_id, parent_error), false);
+                    actions.push_back(cut_update_index::action(cut_update_index::queue_t::KEEP, view_id, model_id, node_id, parent_error));
                 }
                 else
                 {
-                    index_->push_action(cut_update_index::action(cut_update_index::queue_t::MUST_SPLIT,view_id, model_id, node_id, node_error), false);
+                    actions.push_back(cut_update_index::action(cut_update_index::queue_t::MUST_SPLIT,view_id, model_id, node_id, node_error));
                 }
             }
             else
             {
-                index_->push_action(cut_update_index::action(cut_update_index::queue_t::KEEP, view_id, model_id, node_id, parent_error), false);
+                actions.push_back(cut_update_index::action(cut_update_index::queue_t::KEEP, view_id, model_id, node_id, parent_error));
             }
         }
         else
@@ -586,15 +744,15 @@ cut_analysis(view_t view_id, model_t model_id) {
             if (no_sibling_in_frustum)
             {
 #ifdef LAMURE_CUT_UPDATE_MUST_COLLAPSE_OUTSIDE_FRUSTUM
-                index_->push_action(cut_update_index::action(cut_update_index::queue_t::MUST_COLLAPSE, view_id, model_id, parent_id, parent_error), false);
+                actions.push_back(cut_update_index::action(cut_update_index::queue_t::MUST_COLLAPSE, view_id, model_id, parent_id, parent_error));
 #else
-                index_->push_action(cut_update_index::action(cut_update_index::queue_t::COLLAPSE_ON_NEED, view_id, model_id, parent_id, parent_error), false);
+                actions.push_back(cut_update_index::action(cut_update_index::queue_t::COLLAPSE_ON_NEED, view_id, model_id, parent_id, parent_error));
 #endif
             }
             else if(no_sibling_visible_in_pvs)
             {
                 // Parent is invisible from current view point per PVS.
-                index_->push_action(cut_update_index::action(cut_update_index::queue_t::MUST_COLLAPSE, view_id, model_id, parent_id, parent_error), false);
+                actions.push_back(cut_update_index::action(cut_update_index::queue_t::MUST_COLLAPSE, view_id, model_id, parent_id, parent_error));
             }
             else
             {
@@ -602,7 +760,7 @@ cut_analysis(view_t view_id, model_t model_id) {
 
                 if (freshness_timeout)
                 {
-                    index_->push_action(cut_update_index::action(cut_update_index::queue_t::COLLAPSE_ON_NEED, view_id, model_id, parent_id, parent_error), false);
+                    actions.push_back(cut_update_index::action(cut_update_index::queue_t::COLLAPSE_ON_NEED, view_id, model_id, parent_id, parent_error));
 
                     // skip to next group of siblings
                     std::advance(cut_it, fan_factor - 1);
@@ -617,8 +775,8 @@ cut_analysis(view_t view_id, model_t model_id) {
 
                 for (const auto& sibling_id : siblings)
                 {
-                    float sibling_error = calculate_node_error(view_id, model_id, sibling_id);
-                    bool sibling_in_frustum = is_node_in_frustum(view_id, model_id, sibling_id, frustum);
+                    float sibling_error = evaluation.node_error(sibling_id);
+                    bool sibling_in_frustum = evaluation.is_node_in_frustum(sibling_id);
 
                     if (sibling_error > max_error_threshold && sibling_in_frustum && pvs->get_viewer_visibility(model_id, sibling_id))
                     {
@@ -634,7 +792,7 @@ cut_analysis(view_t view_id, model_t model_id) {
                                 break;
                             }
 
-                            float child_error = calculate_node_error(view_id, model_id, child_id);
+                            float child_error = evaluation.node_error(child_id);
 
                             if (child_error < min_error_threshold)
                             {
@@ -649,7 +807,7 @@ cut_analysis(view_t view_id, model_t model_id) {
                         }
                         else
                         {
-                            index_->push_action(cut_update_index::action(cut_update_index::queue_t::MUST_SPLIT, view_id, model_id, sibling_id, sibling_error), false);
+                            actions.push_back(cut_update_index::action(cut_update_index::queue_t::MUST_SPLIT, view_id, model_id, sibling_id, sibling_error));
 
                             keep_all_siblings = false;
                             keep_sibling.push_back(false);
@@ -669,11 +827,11 @@ cut_analysis(view_t view_id, model_t model_id) {
 
                 if (keep_all_siblings && all_sibling_errors_below_min_error_threshold)
                 {
-                    index_->push_action(cut_update_index::action(cut_update_index::queue_t::MUST_COLLAPSE, view_id, model_id, parent_id, parent_error), false);
+                    actions.push_back(cut_update_index::action(cut_update_index::queue_t::MUST_COLLAPSE, view_id, model_id, parent_id, parent_error));
                 }
                 else if (keep_all_siblings)
                 {
-                    index_->push_action(cut_update_index::action(cut_update_index::queue_t::MAYBE_COLLAPSE, view_id, model_id, parent_id, parent_error), false);
+                    actions.push_back(cut_update_index::action(cut_update_index::queue_t::MAYBE_COLLAPSE, view_id, model_id, parent_id, parent_error));
                 }
                 else
                 {
@@ -682,7 +840,7 @@ cut_analysis(view_t view_id, model_t model_id) {
                     {
                         if (keep_sibling[j])
                         {
-                            index_->push_action(cut_update_index::action(cut_update_index::queue_t::KEEP, view_id, model_id, siblings[j], parent_error), false);
+                            actions.push_back(cut_update_index::action(cut_update_index::queue_t::KEEP, view_id, model_id, siblings[j], parent_error));
                         }
                     }
                 }
@@ -693,7 +851,10 @@ cut_analysis(view_t view_id, model_t model_id) {
         }
     }
 
-    master_semaphore_.signal(1);
+#ifdef LAMURE_CUT_UPDATE_ENABLE_MEASURE_CUT_ANALYSIS
+    analysis_task_time_ += analysis_timer.elapsed().wall;
+    analysis_num_nodes_ += chunk.last_node_ - chunk.first_node_;
+#endif
 }
 
 void cut_update_pool::cut_update_split_again(const cut_update_index::action &split_action)
@@ -701,15 +862,15 @@ void cut_update_pool::cut_update_split_again(const cut_update_index::action &spl
     std::vector<node_t> candidates;
     index_->get_all_children(split_action.model_id_, split_action.node_id_, candidates);
 
-    scm::math::mat4f model_matrix = model_transforms_[split_action.model_id_];
-    scm::gl::frustum frustum = user_cameras_[split_action.view_id_].get_frustum_by_model(model_matrix);
-
     float min_error_threshold = model_thresholds_[split_action.model_id_] - 0.1f;
     float max_error_threshold = model_thresholds_[split_action.model_id_] + 0.1f;
 
+    // the camera has not changed since the analysis, reuse its evaluations
+    node_evaluation_cache &evaluation = *node_caches_[split_action.view_id_ * index_->num_models() + split_action.model_id_];
+
     for(const auto &candidate_id : candidates)
     {
-        float node_error = calculate_node_error(split_action.view_id_, split_action.model_id_, candidate_id);
+        float node_error = evaluation.node_error(candidate_id);
 
         if(node_error > max_error_threshold)
         {
@@ -725,7 +886,7 @@ void cut_update_pool::cut_update_split_again(const cut_update_index::action &spl
                     break;
                 }
 
-                float child_error = calculate_node_error(split_action.view_id_, split_action.model_id_, child_id);
+                float child_error = evaluation.node_error(child_id);
                 if(child_error < min_error_threshold)
                 {
                     split = false;
@@ -1079,7 +1240,7 @@ void cut_update_pool::compile_render_list()
         {
             std::vector<cut::node_slot_aggregate> model_render_lists;
 
-            const std::set<node_t> &current_cut = index_->get_current_cut(view_id, model_id);
+            const flat_cut &current_cut = index_->get_current_cut(view_id, model_id);
 
             for(const auto &node_id : current_cut)
             {
@@ -1243,7 +1404,7 @@ void cut_update_pool::split_node(const cut_update_index::action &action)
     // try to obtain children
     for(const auto &child_id : child_ids)
     {
-        if(!ooc_cache->is_node_resident(action.model_id_, child_id))
+        if(!ooc_cache->request_node(action.model_id_, child_id))
         {
             if(all_children_fit_in_ooc_cache)
             {
@@ -1261,7 +1422,7 @@ void cut_update_pool::split_node(const cut_update_index::action &action)
     {
         for(const auto &child_id : child_ids)
         {
-            if(!gpu_cache_->is_node_resident(action.model_id_, child_id))
+            if(!gpu_cache_->request_node(action.model_id_, child_id))
             {
                 if(all_children_fit_in_gpu_cache)
                 {
@@ -1345,7 +1506,7 @@ void cut_update_pool::collapse_node(const cut_update_index::action &action)
     index_->approve_action(action);
 }
 
-const bool cut_update_pool::is_all_nodes_in_cut(const model_t model_id, const std::vector<node_t> &node_ids, const std::set<node_t> &cut)
+const bool cut_update_pool::is_all_nodes_in_cut(const model_t model_id, const std::vector<node_t> &node_ids, const flat_cut &cut)
 {
     for(node_t i = 0; i < node_ids.size(); ++i)
     {
@@ -1357,7 +1518,7 @@ const bool cut_update_pool::is_all_nodes_in_cut(const model_t model_id, const st
         if(node_id == invalid_node_t)
             return false;
 
-        if(cut.find(node_id) == cut.end())
+        if(!cut.contains(node_id))
             return false;
     }
 
@@ -0,0 +1,99 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/flat_cut.h>
+
+#include <algorithm>
+
+namespace lamure
+{
+
+namespace ren
+{
+
+flat_cut::
+flat_cut()
+: is_sorted_(true) {
+
+}
+
+flat_cut::
+~flat_cut() {
+
+}
+
+void flat_cut::
+insert(const node_t node_id) {
+    const size_t word = node_id >> 6;
+    const uint64_t bit = uint64_t(1) << (node_id & 63);
+
+    if (word >= membership_.size()) {
+        membership_.resize(std::max(word + 1, membership_.size() * 2), 0);
+    }
+    else if (membership_[word] & bit) {
+        return;
+    }
+
+    membership_[word] |= bit;
+
+    if (!nodes_.empty() && node_id < nodes_.back()) {
+        is_sorted_ = false;
+    }
+    nodes_.push_back(node_id);
+}
+
+void flat_cut::
+erase(const node_t node_id) {
+    if (!contains(node_id)) {
+        return;
+    }
+
+    membership_[node_id >> 6] &= ~(uint64_t(1) << (node_id & 63));
+
+    //erasing keeps the relative order, a sorted cut stays sorted
+    if (is_sorted_) {
+        nodes_.erase(std::lower_bound(nodes_.begin(), nodes_.end(), node_id));
+    }
+    else {
+        nodes_.erase(std::find(nodes_.begin(), nodes_.end(), node_id));
+    }
+}
+
+void flat_cut::
+clear() {
+    //only touch the words that are actually set, the bitset spans the whole bvh
+    for (const auto node_id : nodes_) {
+        membership_[node_id >> 6] = 0;
+    }
+
+    nodes_.clear();
+    is_sorted_ = true;
+}
+
+void flat_cut::
+sort() {
+    if (!is_sorted_) {
+        std::sort(nodes_.begin(), nodes_.end());
+        is_sorted_ = true;
+    }
+}
+
+const bool flat_cut::
+contains(const node_t node_id) const {
+    const size_t word = node_id >> 6;
+
+    if (word >= membership_.size()) {
+        return false;
+    }
+
+    return (membership_[word] >> (node_id & 63)) & 1;
+}
+
+
+} // namespace ren
+
+} // namespace lamure
@@ -12,14 +12,21 @@
 #include <lamure/ren/policy.h>
 #include <scm/gl_core/render_device/opengl/gl_core.h>
 
+#include <cstring>
+
 namespace lamure
 {
 namespace ren
 {
 gpu_context::gpu_context(const context_t context_id)
-    : context_id_(context_id), is_created_(false), temp_buffer_a_(nullptr), temp_buffer_b_(nullptr), primary_buffer_(nullptr), temporary_storages_(temporary_storages(nullptr, nullptr)),
-      temporary_storages_provenance_(temporary_storages(nullptr, nullptr)), upload_budget_in_nodes_(LAMURE_DEFAULT_UPLOAD_BUDGET), render_budget_in_nodes_(LAMURE_DEFAULT_VIDEO_MEMORY_BUDGET)
+    : context_id_(context_id), is_created_(false), temp_buffer_a_(nullptr), temp_buffer_b_(nullptr), primary_buffer_(nullptr), host_primary_buffer_(nullptr),
+      temporary_storages_(temporary_storages(nullptr, nullptr)), temporary_storages_provenance_(temporary_storages(nullptr, nullptr)), upload_budget_in_nodes_(LAMURE_DEFAULT_UPLOAD_BUDGET),
+      render_budget_in_nodes_(LAMURE_DEFAULT_VIDEO_MEMORY_BUDGET)
 {
+    fix_a_.fix_buffer_ = nullptr;
+    fix_a_.fix_buffer_provenance_ = nullptr;
+    fix_b_.fix_buffer_ = nullptr;
+    fix_b_.fix_buffer_provenance_ = nullptr;
 }
 
 gpu_context::~gpu_context()
@@ -44,6 +51,17 @@ gpu_context::~gpu_context()
         delete primary_buffer_;
         primary_buffer_ = nullptr;
     }
+
+    if(host_primary_buffer_)
+    {
+        delete[] host_primary_buffer_;
+        host_primary_buffer_ = nullptr;
+    }
+
+    delete[] fix_a_.fix_buffer_;
+    delete[] fix_a_.fix_buffer_provenance_;
+    delete[] fix_b_.fix_buffer_;
+    delete[] fix_b_.fix_buffer_provenance_;
 }
 
 void gpu_context::create(scm::gl::render_device_ptr device)
@@ -94,6 +112,44 @@ void gpu_context::create(scm::gl::render_device_ptr device, Data_Provenance cons
 
 }
 
+void gpu_context::create_host()
+{
+    if(is_created_)
+    {
+        return;
+    }
+    is_created_ = true;
+
+    test_host_memory();
+
+    model_database *database = model_database::get_instance();
+
+    fix_a_.fix_buffer_ = new char[database->get_slot_size() * upload_budget_in_nodes_];
+    fix_b_.fix_buffer_ = new char[database->get_slot_size() * upload_budget_in_nodes_];
+    host_primary_buffer_ = new char[database->get_slot_size() * render_budget_in_nodes_];
+}
+
+void gpu_context::test_host_memory()
+{
+    model_database *database = model_database::get_instance();
+    policy *policy = policy::get_instance();
+
+    size_t render_budget_in_mb = policy->render_budget_in_mb();
+    render_budget_in_mb = render_budget_in_mb < LAMURE_MIN_VIDEO_MEMORY_BUDGET ? LAMURE_MIN_VIDEO_MEMORY_BUDGET : render_budget_in_mb;
+
+    size_t max_upload_budget_in_mb = policy->max_upload_budget_in_mb();
+    max_upload_budget_in_mb = max_upload_budget_in_mb < LAMURE_MIN_UPLOAD_BUDGET ? LAMURE_MIN_UPLOAD_BUDGET : max_upload_budget_in_mb;
+
+    long node_size_total = database->get_slot_size();
+    render_budget_in_nodes_ = (render_budget_in_mb * 1024 * 1024) / node_size_total;
+    upload_budget_in_nodes_ = (max_upload_budget_in_mb * 1024u * 1024u) / node_size_total;
+
+#ifdef LAMURE_ENABLE_INFO
+    std::cout << "lamure: context " << context_id_ << " host render budget (MB): " << render_budget_in_mb << std::endl;
+    std::cout << "lamure: context " << context_id_ << " host upload budget (MB): " << max_upload_budget_in_mb << std::endl;
+#endif
+}
+
 void gpu_context::test_video_memory(scm::gl::render_device_ptr device)
 {
     model_database *database = model_database::get_instance();
@@ -476,5 +532,44 @@ bool gpu_context::update_primary_buffer_fix(const cut_database_record::temporary
 
     return uploaded_nodes != 0;
 }
+// returns true if any node has been copied; false otherwise
+bool gpu_context::update_primary_buffer_host(const cut_database_record::temporary_buffer &from_buffer)
+{
+    if(!is_created_)
+        create_host();
+
+    assert(host_primary_buffer_ != nullptr);
+
+    model_database *database = model_database::get_instance();
+
+    cut_database *cuts = cut_database::get_instance();
+
+    const char *temp_buffer = nullptr;
+
+    switch(from_buffer)
+    {
+    case cut_database_record::temporary_buffer::BUFFER_A:
+        temp_buffer = fix_a_.fix_buffer_;
+        break;
+
+    case cut_database_record::temporary_buffer::BUFFER_B:
+        temp_buffer = fix_b_.fix_buffer_;
+        break;
+
+    default:
+        return false;
+    }
+
+    std::vector<cut_database_record::slot_update_desc> &transfer_descr_list = cuts->get_updated_set(context_id_);
+
+    for(const auto &transfer_desc : transfer_descr_list)
+    {
+        size_t offset_in_temp_buffer = transfer_desc.src_ * database->get_slot_size();
+        size_t offset_in_render_buffer = transfer_desc.dst_ * database->get_slot_size();
+        memcpy(host_primary_buffer_ + offset_in_render_buffer, temp_buffer + offset_in_temp_buffer, database->get_slot_size());
+    }
+
+    return !transfer_descr_list.empty();
+}
 }
 }
@@ -0,0 +1,182 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/lod_file.h>
+
+#include <stdexcept>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/uio.h>
+  #include <climits>
+#endif
+
+#include <vector>
+#include <algorithm>
+
+namespace lamure {
+namespace ren {
+
+lod_file::
+lod_file()
+:
+#ifdef _WIN32
+  handle_(INVALID_HANDLE_VALUE),
+#else
+  descriptor_(-1),
+#endif
+  is_file_open_(false),
+  num_syscalls_(0) {
+
+}
+
+lod_file::
+~lod_file() {
+    try {
+        close();
+    }
+    catch (...) {}
+}
+
+void lod_file::
+open(const std::string& file_name) {
+    close();
+
+    file_name_ = file_name;
+    num_syscalls_ = 0;
+
+#ifdef _WIN32
+    handle_ = CreateFileA(file_name_.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                          NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (handle_ == INVALID_HANDLE_VALUE) {
+#else
+    descriptor_ = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor_ < 0) {
+#endif
+        throw std::runtime_error(
+            "lamure: lod_file::Unable to open file: " + file_name_);
+    }
+
+    is_file_open_ = true;
+}
+
+void lod_file::
+close() {
+    if (!is_file_open_) {
+        return;
+    }
+
+#ifdef _WIN32
+    CloseHandle(handle_);
+    handle_ = INVALID_HANDLE_VALUE;
+#else
+    ::close(descriptor_);
+    descriptor_ = -1;
+#endif
+
+    file_name_ = "";
+    is_file_open_ = false;
+}
+
+void lod_file::
+read(char* const data,
+     const size_t start_in_file,
+     const size_t length_in_bytes) {
+
+    assert(length_in_bytes > 0);
+    assert(is_file_open_);
+    assert(data != nullptr);
+
+    size_t bytes_done = 0;
+    while (bytes_done < length_in_bytes) {
+        size_t bytes_left = length_in_bytes - bytes_done;
+        size_t offset = start_in_file + bytes_done;
+        ++num_syscalls_;
+
+#ifdef _WIN32
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(OVERLAPPED));
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFFull);
+        overlapped.OffsetHigh = (DWORD)((uint64_t)offset >> 32);
+        DWORD chunk = bytes_left > 0x40000000 ? 0x40000000 : (DWORD)bytes_left;
+        DWORD bytes_read = 0;
+        if (!ReadFile(handle_, data + bytes_done, chunk, &bytes_read, &overlapped) || bytes_read == 0) {
+            throw std::runtime_error(
+                "lamure: lod_file::Read failed: " + file_name_);
+        }
+#else
+        ssize_t bytes_read = ::pread(descriptor_, data + bytes_done, bytes_left, (off_t)offset);
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            throw std::runtime_error(
+                "lamure: lod_file::Read failed: " + file_name_ +
+                (bytes_read < 0 ? " (" + std::string(strerror(errno)) + ")" : " (unexpected end of file)"));
+        }
+#endif
+
+        bytes_done += (size_t)bytes_read;
+    }
+}
+
+void lod_file::
+read_scattered(char* const* destinations,
+               const size_t num_destinations,
+               const size_t start_in_file,
+               const size_t length_per_destination) {
+
+    assert(length_per_destination > 0);
+    assert(is_file_open_);
+    assert(destinations != nullptr);
+
+#ifdef _WIN32
+    for (size_t i = 0; i < num_destinations; ++i) {
+        read(destinations[i], start_in_file + i * length_per_destination, length_per_destination);
+    }
+#else
+    const size_t length_in_bytes = num_destinations * length_per_destination;
+    std::vector<struct iovec> vectors;
+
+    size_t bytes_done = 0;
+    while (bytes_done < length_in_bytes) {
+        // rebuild the vector list from the first incomplete block
+        size_t first = bytes_done / length_per_destination;
+        size_t num_vectors = std::min(num_destinations - first, (size_t)IOV_MAX);
+
+        vectors.resize(num_vectors);
+        for (size_t i = 0; i < num_vectors; ++i) {
+            vectors[i].iov_base = destinations[first + i];
+            vectors[i].iov_len = length_per_destination;
+        }
+        size_t skip = bytes_done - first * length_per_destination;
+        vectors[0].iov_base = (char*)vectors[0].iov_base + skip;
+        vectors[0].iov_len -= skip;
+
+        ++num_syscalls_;
+        ssize_t bytes_read = ::preadv(descriptor_, vectors.data(), (int)num_vectors, (off_t)(start_in_file + bytes_done));
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            throw std::runtime_error(
+                "lamure: lod_file::Read failed: " + file_name_ +
+                (bytes_read < 0 ? " (" + std::string(strerror(errno)) + ")" : " (unexpected end of file)"));
+        }
+
+        bytes_done += (size_t)bytes_read;
+    }
+#endif
+}
+
+} } // namespace lamure
@@ -0,0 +1,170 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/lod_mapping.h>
+
+#include <stdexcept>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+namespace lamure {
+namespace ren {
+
+lod_mapping::
+lod_mapping()
+:
+#ifdef _WIN32
+  file_handle_(INVALID_HANDLE_VALUE),
+  mapping_handle_(NULL),
+#endif
+  data_(nullptr),
+  size_(0),
+  is_file_open_(false) {
+
+}
+
+lod_mapping::
+~lod_mapping() {
+    try {
+        close();
+    }
+    catch (...) {}
+}
+
+void lod_mapping::
+open(const std::string& file_name) {
+    close();
+
+    file_name_ = file_name;
+
+#ifdef _WIN32
+    file_handle_ = CreateFileA(file_name_.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                               NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file_handle_ == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(
+            "lamure: lod_mapping::Unable to open file: " + file_name_);
+    }
+
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file_handle_, &file_size);
+    size_ = (size_t)file_size.QuadPart;
+
+    mapping_handle_ = CreateFileMappingA(file_handle_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping_handle_ != NULL) {
+        data_ = (char*)MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (data_ == nullptr) {
+        if (mapping_handle_ != NULL) {
+            CloseHandle(mapping_handle_);
+            mapping_handle_ = NULL;
+        }
+        CloseHandle(file_handle_);
+        file_handle_ = INVALID_HANDLE_VALUE;
+        throw std::runtime_error(
+            "lamure: lod_mapping::Unable to map file: " + file_name_);
+    }
+#else
+    int descriptor = ::open(file_name_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) {
+        throw std::runtime_error(
+            "lamure: lod_mapping::Unable to open file: " + file_name_);
+    }
+
+    struct stat file_stat;
+    if (fstat(descriptor, &file_stat) != 0 || file_stat.st_size <= 0) {
+        ::close(descriptor);
+        throw std::runtime_error(
+            "lamure: lod_mapping::Unable to map empty file: " + file_name_);
+    }
+    size_ = (size_t)file_stat.st_size;
+
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+    // the mapping keeps its own reference to the file
+    ::close(descriptor);
+
+    if (mapping == MAP_FAILED) {
+        size_ = 0;
+        throw std::runtime_error(
+            "lamure: lod_mapping::Unable to map file: " + file_name_);
+    }
+    data_ = (char*)mapping;
+
+    // access pattern is driven by the cut update, not by file order
+    madvise(data_, size_, MADV_RANDOM);
+#endif
+
+    is_file_open_ = true;
+}
+
+void lod_mapping::
+close() {
+    if (!is_file_open_) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_handle_);
+    CloseHandle(file_handle_);
+    mapping_handle_ = NULL;
+    file_handle_ = INVALID_HANDLE_VALUE;
+#else
+    munmap(data_, size_);
+#endif
+
+    data_ = nullptr;
+    size_ = 0;
+    file_name_ = "";
+    is_file_open_ = false;
+}
+
+void lod_mapping::
+read(char* const data,
+     const size_t start_in_file,
+     const size_t length_in_bytes) const {
+
+    assert(length_in_bytes > 0);
+    assert(is_file_open_);
+    assert(data != nullptr);
+
+    if (start_in_file + length_in_bytes > size_) {
+        throw std::runtime_error(
+            "lamure: lod_mapping::Read beyond end of file: " + file_name_);
+    }
+
+    memcpy(data, data_ + start_in_file, length_in_bytes);
+}
+
+void lod_mapping::
+will_need(const size_t start_in_file,
+          const size_t length_in_bytes) const {
+
+    if (!is_file_open_ || start_in_file >= size_) {
+        return;
+    }
+
+#ifndef _WIN32
+    static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    size_t begin = start_in_file - (start_in_file % page_size);
+    size_t end = std::min(start_in_file + length_in_bytes, size_);
+
+    madvise(data_ + begin, end - begin, MADV_WILLNEED);
+#endif
+}
+
+} } // namespace lamure
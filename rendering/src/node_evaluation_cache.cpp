@@ -0,0 +1,265 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/node_evaluation_cache.h>
+
+#include <assert.h>
+#include <cmath>
+
+#if defined(__AVX__)
+  #include <immintrin.h>
+  #define LAMURE_NODE_EVALUATION_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define LAMURE_NODE_EVALUATION_SSE
+#endif
+
+namespace lamure
+{
+
+namespace ren
+{
+
+namespace
+{
+const size_t block_size = LAMURE_CUT_UPDATE_ANALYSIS_BLOCK_SIZE;
+}
+
+node_evaluation_cache::
+node_evaluation_cache()
+: bvh_(nullptr),
+  num_blocks_(0),
+  frame_stamp_(0) {
+
+}
+
+node_evaluation_cache::
+~node_evaluation_cache() {
+
+}
+
+void node_evaluation_cache::
+setup_parameters(parameters& params,
+    const scm::math::mat4f& view_matrix,
+    const scm::math::mat4f& projection_matrix,
+    const scm::math::mat4f& model_matrix,
+    const float near_plane,
+    const float height_divided_by_top_minus_bottom) {
+
+    const scm::math::mat4f model_view_matrix = view_matrix * model_matrix;
+    const scm::math::mat4f clip_matrix = projection_matrix * model_view_matrix;
+
+    //matrices are column major
+    for (uint32_t i = 0; i < 4; ++i) {
+        params.depth_row_[i] = model_view_matrix.data_array[i*4 + 2];
+    }
+
+    float radius_scaling = scm::math::length(model_matrix * scm::math::vec4f(1.0f, 0.f, 0.f, 0.f));
+    params.error_scale_ = 2.0f * radius_scaling * near_plane * height_divided_by_top_minus_bottom;
+
+    //left, right, bottom, top, near, far
+    for (uint32_t plane = 0; plane < 6; ++plane) {
+        const uint32_t row = plane / 2;
+        const float sign = (plane % 2 == 0) ? 1.f : -1.f;
+
+        for (uint32_t i = 0; i < 4; ++i) {
+            params.planes_[plane][i] = clip_matrix.data_array[i*4 + 3] + sign * clip_matrix.data_array[i*4 + row];
+        }
+    }
+}
+
+void node_evaluation_cache::
+evaluate_block(const parameters& params,
+    const bvh::node_soa& soa,
+    const node_t first_node_id,
+    float* errors,
+    uint8_t* in_frustum) {
+
+    assert(first_node_id % block_size == 0);
+    assert(first_node_id + block_size <= soa.centroid_x_.size());
+
+    const float* centroid_x = soa.centroid_x_.data() + first_node_id;
+    const float* centroid_y = soa.centroid_y_.data() + first_node_id;
+    const float* centroid_z = soa.centroid_z_.data() + first_node_id;
+    const float* extent = soa.avg_primitive_extent_.data() + first_node_id;
+
+    //positive vertex of the box with respect to each plane, selected once per block
+    const float* p_vertex[6][3];
+    for (uint32_t plane = 0; plane < 6; ++plane) {
+        p_vertex[plane][0] = (params.planes_[plane][0] >= 0.f ? soa.max_x_.data() : soa.min_x_.data()) + first_node_id;
+        p_vertex[plane][1] = (params.planes_[plane][1] >= 0.f ? soa.max_y_.data() : soa.min_y_.data()) + first_node_id;
+        p_vertex[plane][2] = (params.planes_[plane][2] >= 0.f ? soa.max_z_.data() : soa.min_z_.data()) + first_node_id;
+    }
+
+    size_t i = 0;
+
+#if defined(LAMURE_NODE_EVALUATION_AVX)
+
+    const __m256 sign_mask = _mm256_set1_ps(-0.f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (; i + 8 <= block_size; i += 8) {
+        __m256 depth = _mm256_set1_ps(params.depth_row_[3]);
+        depth = _mm256_add_ps(depth, _mm256_mul_ps(_mm256_set1_ps(params.depth_row_[0]), _mm256_loadu_ps(centroid_x + i)));
+        depth = _mm256_add_ps(depth, _mm256_mul_ps(_mm256_set1_ps(params.depth_row_[1]), _mm256_loadu_ps(centroid_y + i)));
+        depth = _mm256_add_ps(depth, _mm256_mul_ps(_mm256_set1_ps(params.depth_row_[2]), _mm256_loadu_ps(centroid_z + i)));
+
+        __m256 error = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(params.error_scale_), _mm256_loadu_ps(extent + i)), depth);
+        _mm256_storeu_ps(errors + i, _mm256_andnot_ps(sign_mask, error));
+
+        __m256 outside = zero;
+        for (uint32_t plane = 0; plane < 6; ++plane) {
+            __m256 distance = _mm256_set1_ps(params.planes_[plane][3]);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(params.planes_[plane][0]), _mm256_loadu_ps(p_vertex[plane][0] + i)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(params.planes_[plane][1]), _mm256_loadu_ps(p_vertex[plane][1] + i)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(params.planes_[plane][2]), _mm256_loadu_ps(p_vertex[plane][2] + i)));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_LT_OQ));
+        }
+
+        const int outside_mask = _mm256_movemask_ps(outside);
+        for (uint32_t k = 0; k < 8; ++k) {
+            in_frustum[i + k] = ((outside_mask >> k) & 1) ? 0 : 1;
+        }
+    }
+
+#elif defined(LAMURE_NODE_EVALUATION_SSE)
+
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= block_size; i += 4) {
+        __m128 depth = _mm_set1_ps(params.depth_row_[3]);
+        depth = _mm_add_ps(depth, _mm_mul_ps(_mm_set1_ps(params.depth_row_[0]), _mm_loadu_ps(centroid_x + i)));
+        depth = _mm_add_ps(depth, _mm_mul_ps(_mm_set1_ps(params.depth_row_[1]), _mm_loadu_ps(centroid_y + i)));
+        depth = _mm_add_ps(depth, _mm_mul_ps(_mm_set1_ps(params.depth_row_[2]), _mm_loadu_ps(centroid_z + i)));
+
+        __m128 error = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(params.error_scale_), _mm_loadu_ps(extent + i)), depth);
+        _mm_storeu_ps(errors + i, _mm_andnot_ps(sign_mask, error));
+
+        __m128 outside = zero;
+        for (uint32_t plane = 0; plane < 6; ++plane) {
+            __m128 distance = _mm_set1_ps(params.planes_[plane][3]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(params.planes_[plane][0]), _mm_loadu_ps(p_vertex[plane][0] + i)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(params.planes_[plane][1]), _mm_loadu_ps(p_vertex[plane][1] + i)));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(params.planes_[plane][2]), _mm_loadu_ps(p_vertex[plane][2] + i)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+        }
+
+        const int outside_mask = _mm_movemask_ps(outside);
+        for (uint32_t k = 0; k < 4; ++k) {
+            in_frustum[i + k] = ((outside_mask >> k) & 1) ? 0 : 1;
+        }
+    }
+
+#endif
+
+    //scalar path for targets without sse and for the remainder of the block
+    for (; i < block_size; ++i) {
+        const float depth = params.depth_row_[0] * centroid_x[i]
+                          + params.depth_row_[1] * centroid_y[i]
+                          + params.depth_row_[2] * centroid_z[i]
+                          + params.depth_row_[3];
+
+        errors[i] = std::abs(params.error_scale_ * extent[i] / depth);
+
+        bool outside = false;
+        for (uint32_t plane = 0; plane < 6; ++plane) {
+            const float distance = params.planes_[plane][0] * p_vertex[plane][0][i]
+                                 + params.planes_[plane][1] * p_vertex[plane][1][i]
+                                 + params.planes_[plane][2] * p_vertex[plane][2][i]
+                                 + params.planes_[plane][3];
+            outside |= distance < 0.f;
+        }
+
+        in_frustum[i] = outside ? 0 : 1;
+    }
+}
+
+void node_evaluation_cache::
+begin_frame(const bvh* bvh, const parameters& params) {
+    assert(bvh != nullptr);
+
+    bvh_ = bvh;
+    params_ = params;
+
+    const size_t num_blocks = bvh->get_node_soa().centroid_x_.size() / block_size;
+
+    if (num_blocks != num_blocks_) {
+        num_blocks_ = num_blocks;
+        errors_.assign(num_blocks_ * block_size, 0.f);
+        in_frustum_.assign(num_blocks_ * block_size, 0);
+        block_stamps_.reset(new std::atomic<uint32_t>[num_blocks_]);
+        frame_stamp_ = 0;
+    }
+
+    //a block stamped frame_stamp_ - 1 is being evaluated, frame_stamp_ is valid
+    frame_stamp_ += 2;
+
+    //fresh stamp arrays and a wrapped around counter start from cleared stamps
+    if (frame_stamp_ == 2 || frame_stamp_ == 0) {
+        for (size_t block_id = 0; block_id < num_blocks_; ++block_id) {
+            block_stamps_[block_id].store(0, std::memory_order_relaxed);
+        }
+        frame_stamp_ = 2;
+    }
+}
+
+void node_evaluation_cache::
+lookup(const node_t node_id, float& error, bool& in_frustum) {
+    assert(bvh_ != nullptr);
+    assert(node_id < num_blocks_ * block_size);
+
+    const size_t block_id = node_id / block_size;
+    const node_t first_node_id = (node_t)(block_id * block_size);
+
+    uint32_t stamp = block_stamps_[block_id].load(std::memory_order_acquire);
+
+    if (stamp != frame_stamp_) {
+        const uint32_t busy_stamp = frame_stamp_ - 1;
+
+        if (stamp != busy_stamp
+            && block_stamps_[block_id].compare_exchange_strong(stamp, busy_stamp, std::memory_order_acquire, std::memory_order_acquire)) {
+
+            evaluate_block(params_, bvh_->get_node_soa(), first_node_id, &errors_[first_node_id], &in_frustum_[first_node_id]);
+            block_stamps_[block_id].store(frame_stamp_, std::memory_order_release);
+        }
+        else if (stamp != frame_stamp_) {
+            //another worker is evaluating this block right now, do not wait for it
+            float block_errors[block_size];
+            uint8_t block_in_frustum[block_size];
+            evaluate_block(params_, bvh_->get_node_soa(), first_node_id, block_errors, block_in_frustum);
+
+            error = block_errors[node_id - first_node_id];
+            in_frustum = block_in_frustum[node_id - first_node_id] != 0;
+            return;
+        }
+    }
+
+    error = errors_[node_id];
+    in_frustum = in_frustum_[node_id] != 0;
+}
+
+const float node_evaluation_cache::
+node_error(const node_t node_id) {
+    float error;
+    bool in_frustum;
+    lookup(node_id, error, in_frustum);
+    return error;
+}
+
+const bool node_evaluation_cache::
+is_node_in_frustum(const node_t node_id) {
+    float error;
+    bool in_frustum;
+    lookup(node_id, error, in_frustum);
+    return in_frustum;
+}
+
+
+} // namespace ren
+
+} // namespace lamure
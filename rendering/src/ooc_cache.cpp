@@ -30,7 +30,7 @@ ooc_cache::ooc_cache(const slot_t num_slots, Data_Provenance const &data_provena
 #endif
 }
 
-ooc_cache::ooc_cache(const slot_t num_slots) : cache(num_slots), maintenance_counter_(0)
+ooc_cache::ooc_cache(const slot_t num_slots) : cache(num_slots), cache_data_provenance_(nullptr), maintenance_counter_(0)
 {
     model_database *database = model_database::get_instance();
 
@@ -284,6 +284,8 @@ void ooc_cache::begin_measure() { pool_->begin_measure(); }
 
 void ooc_cache::end_measure() { pool_->end_measure(); }
 
+const ooc_pool::statistics ooc_cache::get_loading_statistics() { return pool_->get_statistics(); }
+
 } // namespace ren
 
 } // namespace lamure
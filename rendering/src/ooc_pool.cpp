@@ -6,12 +6,15 @@
 // http://www.uni-weimar.de/medien/vr
 
 #include <lamure/ren/ooc_pool.h>
+#include <lamure/lod_block.h>
+
+#include <cstring>
 
 namespace lamure
 {
 namespace ren
 {
-ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_bytes) : locked_(false), size_of_slot_(size_of_slot_in_bytes), num_threads_(num_threads), shutdown_(false), bytes_loaded_(0)
+ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_bytes) : locked_(false), size_of_slot_(size_of_slot_in_bytes), num_threads_(num_threads), shutdown_(false), uring_(nullptr), bytes_loaded_(0), nodes_loaded_(0), syscalls_issued_(0), statistics_()
 {
     assert(num_threads_ > 0);
 
@@ -21,16 +24,14 @@ ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_byte
 
     model_database *database = model_database::get_instance();
 
-    priority_queue_.initialize(LAMURE_CUT_UPDATE_LOADING_QUEUE_MODE, database->num_models());
+    priority_queue_.initialize(LAMURE_CUT_UPDATE_LOADING_QUEUE_MODE, database->num_models(), LAMURE_CUT_UPDATE_LOADING_QUEUE_SHARDS);
 
-    for(uint32_t i = 0; i < num_threads_; ++i)
-    {
-        threads_.push_back(std::thread(&ooc_pool::run, this));
-    }
+    initialize_files();
+    start_threads();
 }
 
 ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_bytes, const size_t size_of_slot_provenance, Data_Provenance const &data_provenance)
-    : locked_(false), size_of_slot_(size_of_slot_in_bytes), size_of_slot_provenance_(size_of_slot_provenance), num_threads_(num_threads), shutdown_(false), bytes_loaded_(0)
+    : locked_(false), size_of_slot_(size_of_slot_in_bytes), size_of_slot_provenance_(size_of_slot_provenance), num_threads_(num_threads), shutdown_(false), uring_(nullptr), bytes_loaded_(0), nodes_loaded_(0), syscalls_issued_(0), statistics_()
 {
     assert(num_threads_ > 0);
 
@@ -40,12 +41,10 @@ ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_byte
     semaphore_.set_min_signal_count(1);
     semaphore_.set_max_signal_count(std::numeric_limits<size_t>::max());
 
-    priority_queue_.initialize(LAMURE_CUT_UPDATE_LOADING_QUEUE_MODE, database->num_models());
+    priority_queue_.initialize(LAMURE_CUT_UPDATE_LOADING_QUEUE_MODE, database->num_models(), LAMURE_CUT_UPDATE_LOADING_QUEUE_SHARDS);
 
-    for(uint32_t i = 0; i < num_threads_; ++i)
-    {
-        threads_.push_back(std::thread(&ooc_pool::run, this));
-    }
+    initialize_files();
+    start_threads();
 }
 
 ooc_pool::~ooc_pool()
@@ -65,6 +64,200 @@ ooc_pool::~ooc_pool()
         }
     }
     threads_.clear();
+
+    // started by the io_uring thread, which has been joined above
+    for(auto &thread : fallback_threads_)
+    {
+        if(thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    fallback_threads_.clear();
+
+    for(auto &mapping : lod_mappings_)
+    {
+        delete mapping;
+    }
+    lod_mappings_.clear();
+
+    for(auto &mapping : provenance_mappings_)
+    {
+        delete mapping;
+    }
+    provenance_mappings_.clear();
+
+    if(uring_ != nullptr)
+    {
+        delete uring_;
+        uring_ = nullptr;
+    }
+}
+
+void ooc_pool::initialize_files()
+{
+    model_database *database = model_database::get_instance();
+    model_t num_models = database->num_models();
+
+    loading_mode_ = policy::get_instance()->get_loading_mode();
+
+    for(model_t model_id = 0; model_id < num_models; ++model_id)
+    {
+        std::string bvh_filename = database->get_model(model_id)->get_bvh()->get_filename();
+        std::string base_name = bvh_filename.substr(0, bvh_filename.find_last_of(".") + 1);
+        std::string file_extension = bvh_filename.substr(base_name.size());
+        std::string bvh_suffix = file_extension.substr(3);
+        std::string lod_file_name = base_name + "lod" + bvh_suffix;
+        std::string provenance_file_name = bvh_filename.substr(0, bvh_filename.size() - 3) + "prov";
+
+        lod_file_names_.push_back(lod_file_name);
+
+        if(_data_provenance.get_size_in_bytes() > 0)
+        {
+            provenance_file_names_.push_back(provenance_file_name);
+        }
+    }
+
+    // mappings are shared by all loader threads and live as long as the pool
+    if(loading_mode_ == policy::LOADING_MODE_MMAP)
+    {
+        for(const auto &file_name : lod_file_names_)
+        {
+            lod_mappings_.push_back(new lod_mapping());
+            lod_mappings_.back()->open(file_name);
+        }
+        for(const auto &file_name : provenance_file_names_)
+        {
+            provenance_mappings_.push_back(new lod_mapping());
+            provenance_mappings_.back()->open(file_name);
+        }
+    }
+
+    // compressed nodes are read into a staging buffer and decompressed
+    // into the slot afterwards, which the io_uring thread does not do
+    if(loading_mode_ == policy::LOADING_MODE_IO_URING)
+    {
+        for(model_t model_id = 0; model_id < num_models; ++model_id)
+        {
+            if(database->get_model(model_id)->get_bvh()->is_lod_compressed())
+            {
+                std::cout << "lamure: compressed .lod files are not loaded with io_uring, falling back to pread loading" << std::endl;
+                loading_mode_ = policy::LOADING_MODE_PREAD;
+                break;
+            }
+        }
+    }
+
+    if(loading_mode_ == policy::LOADING_MODE_IO_URING)
+    {
+        uring_ = new uring_queue();
+        if(!uring_->initialize(LAMURE_CUT_UPDATE_IO_URING_DEPTH))
+        {
+            std::cout << "lamure: io_uring is not available, falling back to pread loading" << std::endl;
+            delete uring_;
+            uring_ = nullptr;
+            loading_mode_ = policy::LOADING_MODE_PREAD;
+        }
+    }
+}
+
+void ooc_pool::start_threads()
+{
+#ifndef _WIN32
+    if(loading_mode_ == policy::LOADING_MODE_IO_URING)
+    {
+        // a single thread keeps the submission queue filled, num_threads_
+        // stays the size of the pread pool it falls back to
+        threads_.push_back(std::thread(&ooc_pool::run_uring, this));
+        return;
+    }
+#endif
+    for(uint32_t i = 0; i < num_threads_; ++i)
+    {
+        threads_.push_back(std::thread(&ooc_pool::run, this));
+    }
+}
+
+uint64_t ooc_pool::read_jobs_blocking(const std::vector<cache_queue::job> &jobs, std::vector<lod_file> &lod_access, std::vector<lod_file> &provenance_access,
+                                      std::vector<char> &block_buffer)
+{
+    model_database *database = model_database::get_instance();
+
+    const cache_queue::job &first_job = jobs.front();
+    uint64_t syscalls = 0;
+
+    std::vector<char *> destinations;
+    for(const auto &job : jobs)
+    {
+        destinations.push_back(job.slot_mem_);
+    }
+
+    size_t stride_in_bytes = database->get_node_size(first_job.model_id_);
+
+    lod_file &access = lod_access[first_job.model_id_];
+    if(!access.is_file_open())
+    {
+        access.open(lod_file_names_[first_job.model_id_]);
+    }
+    uint64_t syscalls_before = access.num_syscalls();
+    const bvh *model_bvh = database->get_model(first_job.model_id_)->get_bvh();
+    if(model_bvh->is_lod_compressed())
+    {
+        // the blocks of adjacent nodes are adjacent in the file as well
+        size_t first_block_offset = model_bvh->get_lod_block_offset(first_job.node_id_);
+        size_t blocks_length = model_bvh->get_lod_block_offset(jobs.back().node_id_) + model_bvh->get_lod_block_size(jobs.back().node_id_) - first_block_offset;
+        block_buffer.resize(blocks_length);
+        access.read(block_buffer.data(), first_block_offset, blocks_length);
+        decompress_jobs(jobs, block_buffer.data());
+    }
+    else
+    {
+        access.read_scattered(destinations.data(), destinations.size(), first_job.node_id_ * stride_in_bytes, stride_in_bytes);
+    }
+    syscalls += access.num_syscalls() - syscalls_before;
+
+    if(_data_provenance.get_size_in_bytes() > 0)
+    {
+        size_t stride_in_bytes_provenance = database->get_primitives_per_node(first_job.model_id_) * _data_provenance.get_size_in_bytes();
+
+        destinations.clear();
+        for(const auto &job : jobs)
+        {
+            assert(job.slot_mem_provenance_ != nullptr);
+            destinations.push_back(job.slot_mem_provenance_);
+        }
+
+        lod_file &access_provenance = provenance_access[first_job.model_id_];
+        if(!access_provenance.is_file_open())
+        {
+            access_provenance.open(provenance_file_names_[first_job.model_id_]);
+        }
+        syscalls_before = access_provenance.num_syscalls();
+        access_provenance.read_scattered(destinations.data(), destinations.size(), first_job.node_id_ * stride_in_bytes_provenance, stride_in_bytes_provenance);
+        syscalls += access_provenance.num_syscalls() - syscalls_before;
+    }
+
+    return syscalls;
+}
+
+void ooc_pool::decompress_jobs(const std::vector<cache_queue::job> &jobs, const char *blocks)
+{
+    model_database *database = model_database::get_instance();
+
+    const bvh *model_bvh = database->get_model(jobs.front().model_id_)->get_bvh();
+    size_t node_size = database->get_node_size(jobs.front().model_id_);
+    size_t first_block_offset = model_bvh->get_lod_block_offset(jobs.front().node_id_);
+
+    for(const auto &job : jobs)
+    {
+        const char *block = blocks + (model_bvh->get_lod_block_offset(job.node_id_) - first_block_offset);
+        if(!lod_block::decompress(block, model_bvh->get_lod_block_size(job.node_id_), job.slot_mem_, node_size))
+        {
+            // an empty node is rendered as nothing instead of garbage
+            std::cout << "lamure: unable to decompress node " << job.node_id_ << " of model " << job.model_id_ << std::endl;
+            memset(job.slot_mem_, 0, node_size);
+        }
+    }
 }
 
 bool ooc_pool::is_shutdown()
@@ -89,12 +282,31 @@ void ooc_pool::begin_measure()
 {
     std::lock_guard<std::mutex> lock(mutex_);
     bytes_loaded_ = 0;
+    nodes_loaded_ = 0;
+    syscalls_issued_ = 0;
+    measure_start_ = std::chrono::steady_clock::now();
 }
 
 void ooc_pool::end_measure()
 {
     std::lock_guard<std::mutex> lock(mutex_);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - measure_start_).count();
     std::cout << "megabytes loaded: " << bytes_loaded_ / 1024 / 1024 << std::endl;
+    std::cout << "nodes loaded: " << nodes_loaded_ << std::endl;
+    if(seconds > 0.0)
+    {
+        std::cout << "megabytes per second: " << (bytes_loaded_ / 1024.0 / 1024.0) / seconds << std::endl;
+    }
+    if(nodes_loaded_ > 0)
+    {
+        std::cout << "syscalls per node: " << (double)syscalls_issued_ / (double)nodes_loaded_ << std::endl;
+    }
+}
+
+const ooc_pool::statistics ooc_pool::get_statistics()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
 }
 
 void ooc_pool::run()
@@ -102,33 +314,15 @@ void ooc_pool::run()
     model_database *database = model_database::get_instance();
     model_t num_models = database->num_models();
 
-    std::vector<std::string> lod_files;
-    std::vector<std::string> provenance_files;
-
-    for (model_t model_id = 0; model_id < num_models; ++model_id) {
-        
-        std::string bvh_filename = database->get_model(model_id)->get_bvh()->get_filename();        
-        std::string base_name = bvh_filename.substr(0, bvh_filename.find_last_of(".") + 1);
-        std::string file_extension = bvh_filename.substr(base_name.size());
-        std::string bvh_suffix = file_extension.substr(3);
-        std::string lod_file_name = base_name + "lod" + bvh_suffix;
-        std::string provenance_file_name = bvh_filename.substr(0, bvh_filename.size() - 3) + "prov";
-
+    // descriptors stay open for the lifetime of the loader thread;
+    // reads go straight into the reserved cache slot
+    bool use_descriptors = loading_mode_ != policy::LOADING_MODE_MMAP;
+    std::vector<lod_file> lod_access(use_descriptors ? num_models : 0);
+    std::vector<lod_file> provenance_access(use_descriptors ? provenance_file_names_.size() : 0);
 
-        lod_files.push_back(lod_file_name);
-
-        if(_data_provenance.get_size_in_bytes() > 0)
-        {
-            provenance_files.push_back(provenance_file_name);
-        }
-    }
-
-    char *local_cache = new char[size_of_slot_];
-    
-    char *local_cache_provenance = nullptr;
-    if(_data_provenance.get_size_in_bytes() > 0) {
-      local_cache_provenance = new char[size_of_slot_provenance_];
-    }
+    std::vector<cache_queue::job> prefetch_jobs;
+    std::vector<cache_queue::job> jobs;
+    std::vector<char> block_buffer;
 
     while(true)
     {
@@ -142,53 +336,318 @@ void ooc_pool::run()
         if(job.node_id_ != invalid_node_t)
         {
             assert(job.slot_mem_ != nullptr);
-            // assert(job.slot_mem_provenance_ != nullptr);
+
+            // siblings requested by a split are stored next to each other,
+            // so pending neighbours are served by the same sequential read
+            priority_queue_.collect_adjacent_jobs(job, LAMURE_CUT_UPDATE_MAX_COALESCED_JOBS, jobs);
+
+            bool has_provenance = _data_provenance.get_size_in_bytes() > 0;
 
             size_t stride_in_bytes = database->get_node_size(job.model_id_);
-            size_t offset_in_bytes = job.node_id_ * stride_in_bytes;
+            size_t stride_in_bytes_provenance = 0;
+            if(has_provenance)
+            {
+                stride_in_bytes_provenance = database->get_primitives_per_node(job.model_id_) * _data_provenance.get_size_in_bytes();
+            }
+
+            uint64_t syscalls = 0;
+
+            if(loading_mode_ == policy::LOADING_MODE_MMAP)
+            {
+                // let the kernel read ahead the nodes that will be requested next
+                priority_queue_.collect_prefetch_jobs(LAMURE_CUT_UPDATE_MMAP_PREFETCH_JOBS, prefetch_jobs);
+                for(const auto &prefetch_job : prefetch_jobs)
+                {
+                    const bvh *prefetch_bvh = database->get_model(prefetch_job.model_id_)->get_bvh();
+                    if(prefetch_bvh->is_lod_compressed())
+                    {
+                        lod_mappings_[prefetch_job.model_id_]->will_need(prefetch_bvh->get_lod_block_offset(prefetch_job.node_id_),
+                                                                         prefetch_bvh->get_lod_block_size(prefetch_job.node_id_));
+                    }
+                    else
+                    {
+                        size_t prefetch_stride = database->get_node_size(prefetch_job.model_id_);
+                        lod_mappings_[prefetch_job.model_id_]->will_need(prefetch_job.node_id_ * prefetch_stride, prefetch_stride);
+                    }
+                    ++syscalls;
+                }
+
+                // compressed blocks are decompressed straight out of the mapping
+                const bvh *model_bvh = database->get_model(job.model_id_)->get_bvh();
+                if(model_bvh->is_lod_compressed())
+                {
+                    // a .lod that is truncated or does not match its .bvh is
+                    // treated like blocks that fail to decompress
+                    const lod_mapping *mapping = lod_mappings_[job.model_id_];
+                    size_t blocks_end = model_bvh->get_lod_block_offset(jobs.back().node_id_) + model_bvh->get_lod_block_size(jobs.back().node_id_);
+                    if(mapping->is_file_open() && blocks_end <= mapping->size())
+                    {
+                        decompress_jobs(jobs, mapping->data() + model_bvh->get_lod_block_offset(jobs.front().node_id_));
+                    }
+                    else
+                    {
+                        std::cout << "lamure: blocks of nodes " << jobs.front().node_id_ << " to " << jobs.back().node_id_ << " of model " << job.model_id_
+                                  << " lie beyond the end of " << mapping->file_name() << std::endl;
+                        for(const auto &loading_job : jobs)
+                        {
+                            memset(loading_job.slot_mem_, 0, stride_in_bytes);
+                        }
+                    }
+                }
+
+                for(const auto &loading_job : jobs)
+                {
+                    if(!model_bvh->is_lod_compressed())
+                    {
+                        lod_mappings_[job.model_id_]->read(loading_job.slot_mem_, loading_job.node_id_ * stride_in_bytes, stride_in_bytes);
+                    }
+
+                    if(has_provenance)
+                    {
+                        provenance_mappings_[job.model_id_]->read(loading_job.slot_mem_provenance_, loading_job.node_id_ * stride_in_bytes_provenance,
+                                                                  stride_in_bytes_provenance);
+                    }
+                }
+            }
+            else
+            {
+                syscalls += read_jobs_blocking(jobs, lod_access, provenance_access, block_buffer);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            bytes_loaded_ += jobs.size() * (stride_in_bytes + stride_in_bytes_provenance);
+            syscalls_issued_ += syscalls;
+            nodes_loaded_ += jobs.size();
+            statistics_.bytes_loaded_ += jobs.size() * (stride_in_bytes + stride_in_bytes_provenance);
+            statistics_.syscalls_issued_ += syscalls;
+            statistics_.nodes_loaded_ += jobs.size();
+
+            history_.insert(history_.end(), jobs.begin(), jobs.end());
+        }
+    }
+
+    lod_access.clear();
+    provenance_access.clear();
+}
+
+#ifndef _WIN32
+void ooc_pool::run_uring()
+{
+    model_database *database = model_database::get_instance();
+    model_t num_models = database->num_models();
+    bool has_provenance = _data_provenance.get_size_in_bytes() > 0;
+
+    std::vector<lod_file> lod_access(num_models);
+    std::vector<lod_file> provenance_access(provenance_file_names_.size());
+
+    // a group is a run of adjacent jobs, served by one read per file
+    struct loading_group
+    {
+        std::vector<cache_queue::job> jobs_;
+        uint32_t num_pending_reads_;
+        bool failed_;
+    };
+
+    std::vector<loading_group> groups(uring_->depth());
+    std::vector<uint64_t> free_groups;
+    for(uint64_t group_id = groups.size(); group_id > 0; --group_id)
+    {
+        free_groups.push_back(group_id - 1);
+    }
+
+    std::vector<char *> destinations;
+    std::vector<char> block_buffer;
+    uint64_t syscalls_reported = 0;
+    bool ring_failed = false;
+
+    auto get_descriptor = [&](std::vector<lod_file> &access, const std::vector<std::string> &file_names, const model_t model_id) {
+        if(!access[model_id].is_file_open())
+        {
+            access[model_id].open(file_names[model_id]);
+        }
+        return access[model_id].descriptor();
+    };
+
+    auto complete_group = [&](const uint64_t group_id) {
+        loading_group &group = groups[group_id];
+
+        // short reads and errors are rare, repeat the whole group with blocking reads
+        uint64_t syscalls = 0;
+        if(group.failed_)
+        {
+            syscalls += read_jobs_blocking(group.jobs_, lod_access, provenance_access, block_buffer);
+        }
 
-            lod_stream access;
-            access.open(lod_files[job.model_id_]);
-            access.read(local_cache, offset_in_bytes, stride_in_bytes);
-            access.close();
+        size_t stride_in_bytes = database->get_node_size(group.jobs_.front().model_id_);
+        if(has_provenance)
+        {
+            stride_in_bytes += database->get_primitives_per_node(group.jobs_.front().model_id_) * _data_provenance.get_size_in_bytes();
+        }
 
+        {
             std::lock_guard<std::mutex> lock(mutex_);
-            bytes_loaded_ += stride_in_bytes;
+            bytes_loaded_ += group.jobs_.size() * stride_in_bytes;
+            syscalls_issued_ += syscalls + uring_->num_syscalls() - syscalls_reported;
+            nodes_loaded_ += group.jobs_.size();
+            statistics_.bytes_loaded_ += group.jobs_.size() * stride_in_bytes;
+            statistics_.syscalls_issued_ += syscalls + uring_->num_syscalls() - syscalls_reported;
+            statistics_.nodes_loaded_ += group.jobs_.size();
+
+            history_.insert(history_.end(), group.jobs_.begin(), group.jobs_.end());
+        }
+        syscalls_reported = uring_->num_syscalls();
+
+        group.jobs_.clear();
+        free_groups.push_back(group_id);
+    };
+
+    auto reap_completions = [&]() {
+        uint64_t group_id;
+        int32_t result;
+        size_t length_in_bytes;
+        while(uring_->pop_completion(group_id, result, length_in_bytes))
+        {
+            loading_group &group = groups[group_id];
+            // errors and short reads leave parts of the slots unfilled
+            if(result < 0 || size_t(result) != length_in_bytes)
+            {
+                group.failed_ = true;
+            }
+            if(--group.num_pending_reads_ == 0)
+            {
+                complete_group(group_id);
+            }
+        }
+    };
+
+    while(!ring_failed)
+    {
+        if(uring_->num_in_flight() == 0)
+        {
+            semaphore_.wait();
+        }
+
+        if(is_shutdown())
+            break;
+
+        // top up the ring in priority order, one group needs up to two entries
+        while(!free_groups.empty() && uring_->num_in_flight() + 2 <= uring_->depth())
+        {
+            cache_queue::job job = priority_queue_.top_job();
+
+            if(job.node_id_ == invalid_node_t)
+            {
+                break;
+            }
+
+            assert(job.slot_mem_ != nullptr);
+
+            uint64_t group_id = free_groups.back();
+            free_groups.pop_back();
+
+            loading_group &group = groups[group_id];
+            priority_queue_.collect_adjacent_jobs(job, LAMURE_CUT_UPDATE_MAX_COALESCED_JOBS, group.jobs_);
+            group.num_pending_reads_ = 0;
+            group.failed_ = false;
 
-            memcpy(job.slot_mem_, local_cache, stride_in_bytes);
+            node_t first_node_id = group.jobs_.front().node_id_;
+            size_t stride_in_bytes = database->get_node_size(job.model_id_);
 
-            history_.push_back(job);
+            destinations.clear();
+            for(const auto &loading_job : group.jobs_)
+            {
+                destinations.push_back(loading_job.slot_mem_);
+            }
+            if(uring_->push_read_scattered(get_descriptor(lod_access, lod_file_names_, job.model_id_), destinations.data(), destinations.size(),
+                                           first_node_id * stride_in_bytes, stride_in_bytes, group_id))
+            {
+                ++group.num_pending_reads_;
+            }
+            else
+            {
+                group.failed_ = true;
+            }
 
-            if(_data_provenance.get_size_in_bytes() > 0) {
-                provenance_stream access_provenance;
-                access_provenance.open(provenance_files[job.model_id_]);
+            if(has_provenance)
+            {
                 size_t stride_in_bytes_provenance = database->get_primitives_per_node(job.model_id_) * _data_provenance.get_size_in_bytes();
-                bytes_loaded_ += stride_in_bytes_provenance;
-                size_t offset_in_bytes_provenance = job.node_id_ * stride_in_bytes_provenance;
-                access_provenance.read(local_cache_provenance, offset_in_bytes_provenance, stride_in_bytes_provenance);
-                access_provenance.close();
-                memcpy(job.slot_mem_provenance_, local_cache_provenance, stride_in_bytes_provenance);
+
+                destinations.clear();
+                for(const auto &loading_job : group.jobs_)
+                {
+                    assert(loading_job.slot_mem_provenance_ != nullptr);
+                    destinations.push_back(loading_job.slot_mem_provenance_);
+                }
+                if(uring_->push_read_scattered(get_descriptor(provenance_access, provenance_file_names_, job.model_id_), destinations.data(),
+                                               destinations.size(), first_node_id * stride_in_bytes_provenance, stride_in_bytes_provenance, group_id))
+                {
+                    ++group.num_pending_reads_;
+                }
+                else
+                {
+                    group.failed_ = true;
+                }
             }
 
+            if(group.num_pending_reads_ == 0)
+            {
+                complete_group(group_id);
+            }
         }
-    }
 
-    
-    lod_files.clear();
-    provenance_files.clear();
+        // block for at least one completion while reads are in flight
+        if(!uring_->submit(uring_->num_in_flight() > 0 ? 1 : 0))
+        {
+            ring_failed = true;
+        }
 
+        reap_completions();
+    }
 
-    if(local_cache != nullptr)
+    // slots must not be released while the kernel may still write to them
+    while(uring_->num_in_flight() > 0 && !ring_failed)
     {
-        delete[] local_cache;
-        local_cache = nullptr;
+        if(!uring_->submit(1))
+        {
+            ring_failed = true;
+        }
+        reap_completions();
     }
-    if(local_cache_provenance != nullptr)
+
+    if(ring_failed)
     {
-        delete[] local_cache_provenance;
-        local_cache_provenance = nullptr;
+        std::cout << "lamure: io_uring submission failed, falling back to pread loading" << std::endl;
+
+        // the kernel may still write into the slots of submitted reads, the
+        // groups are finished with blocking reads once all of them completed
+        if(uring_->drain())
+        {
+            reap_completions();
+        }
+        else
+        {
+            std::cout << "lamure: io_uring reads could not be drained, their slots stay reserved" << std::endl;
+        }
+
+        // the configured pool takes over, this thread is one of its threads
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(!shutdown_)
+            {
+                for(uint32_t i = 1; i < num_threads_; ++i)
+                {
+                    fallback_threads_.push_back(std::thread(&ooc_pool::run, this));
+                }
+            }
+        }
+
+        if(!is_shutdown())
+        {
+            run();
+        }
     }
 }
+#endif
 
 void ooc_pool::resolve_cache_history(cache_index *index)
 {
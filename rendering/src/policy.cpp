@@ -26,6 +26,7 @@ policy()
   render_budget_in_mb_(LAMURE_DEFAULT_VIDEO_MEMORY_BUDGET),
   out_of_core_budget_in_mb_(LAMURE_DEFAULT_MAIN_MEMORY_BUDGET),
   size_of_provenance_(LAMURE_DEFAULT_SIZE_OF_PROVENANCE),
+  loading_mode_(LOADING_MODE_PREAD),
   window_width_(800),
   window_height_(600) {
 
@@ -0,0 +1,425 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/uring_queue.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__linux__) && defined(__has_include)
+  #if __has_include(<linux/io_uring.h>)
+    #define LAMURE_RENDERING_HAS_IO_URING
+  #endif
+#endif
+
+#ifdef LAMURE_RENDERING_HAS_IO_URING
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <sys/uio.h>
+  #include <unistd.h>
+#endif
+
+namespace lamure {
+namespace ren {
+
+#ifdef LAMURE_RENDERING_HAS_IO_URING
+namespace {
+
+int sys_io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+int sys_io_uring_enter(int ring_descriptor, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring_descriptor, to_submit, min_complete, flags, nullptr, 0);
+}
+
+// user data of the cancel requests issued by drain(), read requests
+// carry their index into requests_
+const uint64_t CANCEL_USER_DATA = ~0ull;
+
+}
+#endif
+
+uring_queue::
+uring_queue()
+: ring_descriptor_(-1),
+  depth_(0),
+  num_in_flight_(0),
+  num_to_submit_(0),
+  is_initialized_(false),
+  num_syscalls_(0),
+  sq_ring_(nullptr),
+  sq_ring_size_(0),
+  cq_ring_(nullptr),
+  cq_ring_size_(0),
+  sqes_(nullptr),
+  sqes_size_(0),
+  sq_head_(nullptr),
+  sq_tail_(nullptr),
+  sq_mask_(nullptr),
+  sq_array_(nullptr),
+  cq_head_(nullptr),
+  cq_tail_(nullptr),
+  cq_mask_(nullptr),
+  cqes_(nullptr) {
+
+}
+
+uring_queue::
+~uring_queue() {
+    shutdown();
+}
+
+bool uring_queue::
+initialize(const uint32_t depth) {
+    shutdown();
+
+#ifdef LAMURE_RENDERING_HAS_IO_URING
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring_descriptor_ = sys_io_uring_setup(depth, &params);
+    if (ring_descriptor_ < 0) {
+        ring_descriptor_ = -1;
+        return false;
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    bool single_mapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mapping) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_descriptor_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        shutdown();
+        return false;
+    }
+
+    if (single_mapping) {
+        cq_ring_ = sq_ring_;
+    }
+    else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_descriptor_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            shutdown();
+            return false;
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 ring_descriptor_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+        sqes_ = nullptr;
+        shutdown();
+        return false;
+    }
+
+    char* sq = (char*)sq_ring_;
+    sq_head_ = (uint32_t*)(sq + params.sq_off.head);
+    sq_tail_ = (uint32_t*)(sq + params.sq_off.tail);
+    sq_mask_ = (uint32_t*)(sq + params.sq_off.ring_mask);
+    sq_array_ = (uint32_t*)(sq + params.sq_off.array);
+
+    char* cq = (char*)cq_ring_;
+    cq_head_ = (uint32_t*)(cq + params.cq_off.head);
+    cq_tail_ = (uint32_t*)(cq + params.cq_off.tail);
+    cq_mask_ = (uint32_t*)(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+
+    // the kernel rounds up to a power of two, never hand out more requests
+    // than there are submission entries
+    depth_ = params.sq_entries;
+    num_in_flight_ = 0;
+    num_to_submit_ = 0;
+    num_syscalls_ = 0;
+
+    requests_.resize(depth_);
+    unsubmitted_requests_.clear();
+    drained_completions_.clear();
+    free_requests_.clear();
+    for (uint32_t i = depth_; i > 0; --i) {
+        free_requests_.push_back(i - 1);
+    }
+
+    is_initialized_ = true;
+    return true;
+#else
+    (void)depth;
+    return false;
+#endif
+}
+
+void uring_queue::
+shutdown() {
+#ifdef LAMURE_RENDERING_HAS_IO_URING
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_descriptor_ >= 0) {
+        ::close(ring_descriptor_);
+    }
+#endif
+
+    ring_descriptor_ = -1;
+    sq_ring_ = cq_ring_ = sqes_ = nullptr;
+    is_initialized_ = false;
+    depth_ = 0;
+    num_in_flight_ = 0;
+    num_to_submit_ = 0;
+    requests_.clear();
+    free_requests_.clear();
+    unsubmitted_requests_.clear();
+    drained_completions_.clear();
+}
+
+bool uring_queue::
+push_read(const int descriptor,
+          char* const data,
+          const size_t start_in_file,
+          const size_t length_in_bytes,
+          const uint64_t user_data) {
+    return push_read_scattered(descriptor, &data, 1, start_in_file, length_in_bytes, user_data);
+}
+
+bool uring_queue::
+push_read_scattered(const int descriptor,
+                    char* const* destinations,
+                    const size_t num_destinations,
+                    const size_t start_in_file,
+                    const size_t length_per_destination,
+                    const uint64_t user_data) {
+
+    assert(is_initialized_);
+    assert(destinations != nullptr);
+    assert(num_destinations > 0);
+    assert(length_per_destination > 0);
+
+#ifdef LAMURE_RENDERING_HAS_IO_URING
+    if (free_requests_.empty()) {
+        return false;
+    }
+
+    uint32_t request_id = free_requests_.back();
+    free_requests_.pop_back();
+
+    request& req = requests_[request_id];
+    req.user_data_ = user_data;
+    req.length_in_bytes_ = num_destinations * length_per_destination;
+    req.is_submitted_ = false;
+    req.vectors_.resize(num_destinations * sizeof(struct iovec));
+
+    struct iovec* vectors = (struct iovec*)req.vectors_.data();
+    for (size_t i = 0; i < num_destinations; ++i) {
+        vectors[i].iov_base = destinations[i];
+        vectors[i].iov_len = length_per_destination;
+    }
+
+    uint32_t tail = *sq_tail_;
+    uint32_t index = tail & *sq_mask_;
+
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes_ + index;
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = descriptor;
+    sqe->off = start_in_file;
+    sqe->addr = (uint64_t)(uintptr_t)vectors;
+    sqe->len = (uint32_t)num_destinations;
+    sqe->user_data = request_id;
+
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    unsubmitted_requests_.push_back(request_id);
+    ++num_in_flight_;
+    ++num_to_submit_;
+    return true;
+#else
+    (void)descriptor; (void)start_in_file; (void)user_data;
+    return false;
+#endif
+}
+
+bool uring_queue::
+submit(const uint32_t min_complete) {
+    assert(is_initialized_);
+
+#ifdef LAMURE_RENDERING_HAS_IO_URING
+    uint32_t wait_for = std::min(min_complete, num_in_flight_);
+    if (num_to_submit_ == 0 && wait_for == 0) {
+        return true;
+    }
+
+    while (true) {
+        ++num_syscalls_;
+        int submitted = sys_io_uring_enter(ring_descriptor_, num_to_submit_, wait_for,
+                                           wait_for > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if (submitted >= 0) {
+            // the kernel consumes the submission ring in order
+            uint32_t num_submitted = std::min(num_to_submit_, (uint32_t)submitted);
+            for (uint32_t i = 0; i < num_submitted; ++i) {
+                requests_[unsubmitted_requests_[i]].is_submitted_ = true;
+            }
+            unsubmitted_requests_.erase(unsubmitted_requests_.begin(), unsubmitted_requests_.begin() + num_submitted);
+            num_to_submit_ -= num_submitted;
+            if (num_to_submit_ == 0) {
+                return true;
+            }
+            continue;
+        }
+        // EBUSY means the completion ring is full, retrying without
+        // reaping it would spin forever, the caller drains and falls back
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+#else
+    (void)min_complete;
+    return false;
+#endif
+}
+
+bool uring_queue::
+pop_completion(uint64_t& user_data, int32_t& result, size_t& length_in_bytes) {
+    assert(is_initialized_);
+
+#ifdef LAMURE_RENDERING_HAS_IO_URING
+    uint32_t request_id;
+    if (!drained_completions_.empty()) {
+        request_id = drained_completions_.back().first;
+        result = drained_completions_.back().second;
+        drained_completions_.pop_back();
+    }
+    else {
+        while (true) {
+            uint32_t head = *cq_head_;
+            if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                return false;
+            }
+
+            struct io_uring_cqe* cqe = (struct io_uring_cqe*)cqes_ + (head & *cq_mask_);
+            uint64_t cqe_user_data = cqe->user_data;
+            result = cqe->res;
+
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+
+            // late results of cancel requests carry no read
+            if (cqe_user_data != CANCEL_USER_DATA) {
+                request_id = (uint32_t)cqe_user_data;
+                break;
+            }
+        }
+    }
+
+    request& req = requests_[request_id];
+    user_data = req.user_data_;
+    length_in_bytes = req.length_in_bytes_;
+    req.is_submitted_ = false;
+    free_requests_.push_back(request_id);
+    --num_in_flight_;
+    return true;
+#else
+    (void)user_data; (void)result; (void)length_in_bytes;
+    return false;
+#endif
+}
+
+bool uring_queue::
+drain() {
+    assert(is_initialized_);
+
+#ifdef LAMURE_RENDERING_HAS_IO_URING
+    // the kernel reads the submission tail only when entering the ring,
+    // so entries that were never submitted can simply be taken back
+    if (num_to_submit_ > 0) {
+        __atomic_store_n(sq_tail_, *sq_tail_ - num_to_submit_, __ATOMIC_RELEASE);
+        for (uint32_t request_id : unsubmitted_requests_) {
+            drained_completions_.push_back(std::make_pair(request_id, -ECANCELED));
+        }
+        unsubmitted_requests_.clear();
+        num_to_submit_ = 0;
+    }
+
+    uint32_t num_submitted = 0;
+    for (uint32_t request_id = 0; request_id < requests_.size(); ++request_id) {
+        if (!requests_[request_id].is_submitted_) {
+            continue;
+        }
+        ++num_submitted;
+
+        uint32_t tail = *sq_tail_;
+        uint32_t index = tail & *sq_mask_;
+
+        struct io_uring_sqe* sqe = (struct io_uring_sqe*)sqes_ + index;
+        memset(sqe, 0, sizeof(struct io_uring_sqe));
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = request_id;
+        sqe->user_data = CANCEL_USER_DATA;
+
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    // cancelling is best effort, completion of the reads is what counts
+    uint32_t num_cancels_to_submit = num_submitted;
+    while (num_submitted > 0) {
+        uint32_t head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe* cqe = (struct io_uring_cqe*)cqes_ + (head & *cq_mask_);
+            if (cqe->user_data != CANCEL_USER_DATA) {
+                uint32_t request_id = (uint32_t)cqe->user_data;
+                requests_[request_id].is_submitted_ = false;
+                drained_completions_.push_back(std::make_pair(request_id, cqe->res));
+                --num_submitted;
+            }
+            ++head;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+        if (num_submitted == 0) {
+            break;
+        }
+
+        ++num_syscalls_;
+        int submitted = sys_io_uring_enter(ring_descriptor_, num_cancels_to_submit, 1, IORING_ENTER_GETEVENTS);
+        if (submitted >= 0) {
+            num_cancels_to_submit -= std::min(num_cancels_to_submit, (uint32_t)submitted);
+        }
+        else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            if (num_cancels_to_submit == 0) {
+                return false;
+            }
+            // keep waiting without the cancel requests
+            __atomic_store_n(sq_tail_, *sq_tail_ - num_cancels_to_submit, __ATOMIC_RELEASE);
+            num_cancels_to_submit = 0;
+        }
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+} } // namespace lamure
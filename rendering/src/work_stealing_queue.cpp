@@ -0,0 +1,83 @@
+// Copyright (c) 2014-2018 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/work_stealing_queue.h>
+
+#include <assert.h>
+
+namespace lamure
+{
+
+namespace ren
+{
+
+work_stealing_queue::
+work_stealing_queue() {
+
+}
+
+work_stealing_queue::
+~work_stealing_queue() {
+
+}
+
+void work_stealing_queue::
+reset(const size_t num_workers, const size_t num_tasks) {
+    assert(num_workers > 0);
+
+    while (workers_.size() < num_workers) {
+        workers_.emplace_back(new worker());
+    }
+    workers_.resize(num_workers);
+
+    for (size_t worker_id = 0; worker_id < num_workers; ++worker_id) {
+        std::lock_guard<std::mutex> lock(workers_[worker_id]->mutex_);
+        std::deque<size_t>& tasks = workers_[worker_id]->tasks_;
+        tasks.clear();
+
+        size_t first_task = (num_tasks * worker_id) / num_workers;
+        size_t last_task = (num_tasks * (worker_id + 1)) / num_workers;
+
+        for (size_t task_id = first_task; task_id < last_task; ++task_id) {
+            tasks.push_back(task_id);
+        }
+    }
+}
+
+const bool work_stealing_queue::
+pop_task(const size_t worker_id, size_t& task_id) {
+    assert(worker_id < workers_.size());
+
+    {
+        worker& own = *workers_[worker_id];
+        std::lock_guard<std::mutex> lock(own.mutex_);
+
+        if (!own.tasks_.empty()) {
+            task_id = own.tasks_.front();
+            own.tasks_.pop_front();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < workers_.size(); ++i) {
+        worker& victim = *workers_[(worker_id + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex_);
+
+        if (!victim.tasks_.empty()) {
+            task_id = victim.tasks_.back();
+            victim.tasks_.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+} // namespace ren
+
+} // namespace lamure
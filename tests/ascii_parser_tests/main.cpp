@@ -0,0 +1,8 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() 
+						   //- only do this in one cpp file per binary
+
+//including the .tests files will execute the tests within 
+//when running the program
+#include "ascii_parser.tests"
+#include "ascii_chunk_reader.tests"
+#include "xyz_prov_alignment.tests"
@@ -0,0 +1,9 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() 
+						   //- only do this in one cpp file per binary
+
+//including the .tests files will execute the tests within 
+//when running the program
+#include "flat_cut.tests"
+#include "action_slot_map.tests"
+#include "work_stealing_queue.tests"
+#include "node_evaluation_cache.tests"
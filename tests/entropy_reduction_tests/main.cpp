@@ -5,3 +5,4 @@
 //when running the program
 #include "entropy_sorting.tests"
 #include "create_lod.tests"
+#include "entropy_reference.tests"